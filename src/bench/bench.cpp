@@ -29,7 +29,7 @@ benchmark::BenchRunner::RunAll(benchmark::duration elapsedTimeForOne)
         std::cerr << "WARNING: Clock precision is worse than microsecond - benchmarks may be less accurate!\n";
     }
     std::cout << "#Benchmark" << "," << "count" << "," << "min(ns)" << "," << "max(ns)" << "," << "average(ns)" << ","
-              << "min_cycles" << "," << "max_cycles" << "," << "average_cycles" << "\n";
+              << "min_cycles" << "," << "max_cycles" << "," << "average_cycles" << "," << "per_second" << "\n";
 
     for (const auto &p: benchmarks()) {
         State state(p.first, elapsedTimeForOne);
@@ -98,8 +98,9 @@ bool benchmark::State::KeepRunning()
     int64_t max_elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(maxTime).count();
     int64_t avg_elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>((now-beginTime)/count).count();
     int64_t averageCycles = (nowCycles-beginCycles)/count;
+    double perSecond = count / std::chrono::duration_cast<std::chrono::duration<double> >(now-beginTime).count();
     std::cout << std::fixed << std::setprecision(15) << name << "," << count << "," << min_elapsed << "," << max_elapsed << "," << avg_elapsed << ","
-              << minCycles << "," << maxCycles << "," << averageCycles << "\n";
+              << minCycles << "," << maxCycles << "," << averageCycles << "," << std::setprecision(1) << perSecond << "\n";
     std::cout.copyfmt(std::ios(nullptr));
 
     return false;
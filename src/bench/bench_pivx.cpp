@@ -6,6 +6,8 @@
 
 #include "bench.h"
 
+#include "crypto/sha256.h"
+#include "crypto/sph_x4.h"
 #include "key.h"
 #include "main.h"
 #include "util.h"
@@ -13,6 +15,8 @@
 int
 main(int argc, char** argv)
 {
+    SHA256AutoDetect();
+    SphX4AutoDetect();
     ECC_Start();
     SetupEnvironment();
     g_logger->m_print_to_file = false; // don't want to write to debug.log file
@@ -0,0 +1,159 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "hashx11kvs.h"
+#include "main.h"
+#include "streams.h"
+#include "txdb.h"
+#include "util.h"
+
+#include <vector>
+
+/* Number of blocks written to disk, each holding TXS_PER_BLOCK transactions */
+static const int NUM_BLOCKS = 20;
+static const int TXS_PER_BLOCK = 10;
+
+/**
+ * A short chain of version 3 (X11KVS hashed) blocks written to a temporary
+ * datadir, indexed in mapBlockIndex, chainActive and an in-memory txindex.
+ */
+class BlockReadSetup
+{
+public:
+    std::vector<CBlockIndex*> vIndex;
+    std::vector<uint256> vTxids;
+
+    BlockReadSetup()
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+        ClearDatadirCache();
+        pathTemp = GetTempPath() / strprintf("bench_blockread_%lu_%i", (unsigned long)GetTime(), (int)GetRand(100000));
+        fs::create_directories(pathTemp);
+        mapArgs["-datadir"] = pathTemp.string();
+        pblocktree = new CBlockTreeDB(1 << 20, true);
+        fTxIndex = true;
+
+        std::vector<std::pair<uint256, CDiskTxPos> > vPos;
+        CDiskBlockPos pos(0, 0);
+        CBlockIndex* pindexPrev = nullptr;
+        for (int i = 0; i < NUM_BLOCKS; i++) {
+            CBlock block;
+            block.nVersion = 3;
+            block.hashPrevBlock = pindexPrev ? pindexPrev->GetBlockHash() : UINT256_ZERO;
+            block.nTime = 1600000000 + i * 60;
+            block.nBits = 0x207fffff;
+            block.nNonce = i;
+            for (int j = 0; j < TXS_PER_BLOCK; j++) {
+                CMutableTransaction tx;
+                tx.vin.resize(1);
+                tx.vin[0].scriptSig = CScript() << i << j;
+                tx.vout.resize(1);
+                tx.vout[0].nValue = j;
+                block.vtx.push_back(CTransaction(tx));
+            }
+            if (!WriteBlockToDisk(block, pos))
+                throw std::runtime_error("BlockReadSetup: WriteBlockToDisk failed");
+
+            CBlockIndex* pindex = new CBlockIndex(block);
+            BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(block.GetHash(), pindex)).first;
+            pindex->phashBlock = &((*mi).first);
+            pindex->pprev = pindexPrev;
+            pindex->nHeight = i;
+            pindex->nFile = pos.nFile;
+            pindex->nDataPos = pos.nPos;
+            pindex->nStatus |= BLOCK_HAVE_DATA;
+            vIndex.push_back(pindex);
+
+            CDiskTxPos postx(pos, GetSizeOfCompactSize(block.vtx.size()));
+            for (const CTransaction& tx : block.vtx) {
+                vPos.push_back(std::make_pair(tx.GetHash(), postx));
+                vTxids.push_back(tx.GetHash());
+                postx.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
+            }
+
+            pos.nPos += ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+            pindexPrev = pindex;
+        }
+        pblocktree->WriteTxIndex(vPos);
+        chainActive.SetTip(pindexPrev);
+    }
+
+    ~BlockReadSetup()
+    {
+        chainActive.SetTip(nullptr);
+        for (CBlockIndex* pindex : vIndex) {
+            mapBlockIndex.erase(pindex->GetBlockHash());
+            delete pindex;
+        }
+        fTxIndex = false;
+        delete pblocktree;
+        pblocktree = nullptr;
+        GetX11KVSCache().SetMaxSize(DEFAULT_X11KVS_CACHE_SIZE << 20);
+        fs::remove_all(pathTemp);
+    }
+
+private:
+    fs::path pathTemp;
+};
+
+// Reads through the block index, which trusts the hash stored in it
+static void ReadBlockFromDisk_Index(benchmark::State& state)
+{
+    BlockReadSetup setup;
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        CBlock block;
+        ReadBlockFromDisk(block, setup.vIndex[i++ % setup.vIndex.size()]);
+        block.GetHash();
+    }
+}
+
+// The previous behaviour: proof of work check plus index comparison, each one a full X11KVS
+static void ReadBlockFromDisk_Rehash(benchmark::State& state)
+{
+    BlockReadSetup setup;
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        const CBlockIndex* pindex = setup.vIndex[i++ % setup.vIndex.size()];
+        CBlock block;
+        CAutoFile filein(OpenBlockFile(pindex->GetBlockPos(), true), SER_DISK, CLIENT_VERSION);
+        filein >> block;
+        HashX11KVS(BEGIN(block.nVersion), END(block.nNonce));
+        HashX11KVS(BEGIN(block.nVersion), END(block.nNonce));
+    }
+}
+
+// getrawtransaction with -txindex, the block hash resolved through the block index
+static void GetTransaction_TxIndex(benchmark::State& state)
+{
+    BlockReadSetup setup;
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        CTransaction tx;
+        uint256 hashBlock;
+        GetTransaction(setup.vTxids[i++ % setup.vTxids.size()], tx, hashBlock);
+    }
+}
+
+// getrawtransaction with -txindex, the block hash recomputed from the header
+static void GetTransaction_TxIndexRehash(benchmark::State& state)
+{
+    BlockReadSetup setup;
+    chainActive.SetTip(nullptr);
+    GetX11KVSCache().SetMaxEntries(0);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        CTransaction tx;
+        uint256 hashBlock;
+        GetTransaction(setup.vTxids[i++ % setup.vTxids.size()], tx, hashBlock);
+    }
+}
+
+BENCHMARK(ReadBlockFromDisk_Index);
+BENCHMARK(ReadBlockFromDisk_Rehash);
+BENCHMARK(GetTransaction_TxIndex);
+BENCHMARK(GetTransaction_TxIndexRehash);
@@ -33,14 +33,47 @@ static void SHA1(benchmark::State& state)
         CSHA1().Write(begin_ptr(in), in.size()).Finalize(hash);
 }
 
-static void SHA256(benchmark::State& state)
+static void SHA256(benchmark::State& state, sha256_implementation::UseImplementation use_implementation)
 {
+    SHA256AutoDetect(use_implementation);
     uint8_t hash[CSHA256::OUTPUT_SIZE];
     std::vector<uint8_t> in(BUFFER_SIZE,0);
     while (state.KeepRunning())
         CSHA256().Write(begin_ptr(in), in.size()).Finalize(hash);
+    SHA256AutoDetect();
 }
 
+static void SHA256_32b(benchmark::State& state, sha256_implementation::UseImplementation use_implementation)
+{
+    SHA256AutoDetect(use_implementation);
+    std::vector<uint8_t> in(32,0);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 1000000; i++) {
+            CSHA256().Write(begin_ptr(in), in.size()).Finalize(&in[0]);
+        }
+    }
+    SHA256AutoDetect();
+}
+
+static void SHA256D64_1024(benchmark::State& state, sha256_implementation::UseImplementation use_implementation)
+{
+    SHA256AutoDetect(use_implementation);
+    std::vector<uint8_t> in(64 * 1024, 0);
+    while (state.KeepRunning()) {
+        SHA256D64(in.data(), in.data(), 1024);
+    }
+    SHA256AutoDetect();
+}
+
+static void SHA256_STANDARD(benchmark::State& state) { SHA256(state, sha256_implementation::STANDARD); }
+static void SHA256_SHANI(benchmark::State& state) { SHA256(state, sha256_implementation::USE_SHANI); }
+static void SHA256_32b_STANDARD(benchmark::State& state) { SHA256_32b(state, sha256_implementation::STANDARD); }
+static void SHA256_32b_SHANI(benchmark::State& state) { SHA256_32b(state, sha256_implementation::USE_SHANI); }
+static void SHA256D64_1024_STANDARD(benchmark::State& state) { SHA256D64_1024(state, sha256_implementation::STANDARD); }
+static void SHA256D64_1024_SSE41(benchmark::State& state) { SHA256D64_1024(state, sha256_implementation::USE_SSE41); }
+static void SHA256D64_1024_AVX2(benchmark::State& state) { SHA256D64_1024(state, sha256_implementation::USE_AVX2); }
+static void SHA256D64_1024_SHANI(benchmark::State& state) { SHA256D64_1024(state, sha256_implementation::USE_SHANI); }
+
 static void SHA512(benchmark::State& state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -73,7 +106,14 @@ static void FastRandom_1bit(benchmark::State& state)
 
 BENCHMARK(RIPEMD160);
 BENCHMARK(SHA1);
-BENCHMARK(SHA256);
+BENCHMARK(SHA256_STANDARD);
+BENCHMARK(SHA256_SHANI);
+BENCHMARK(SHA256_32b_STANDARD);
+BENCHMARK(SHA256_32b_SHANI);
+BENCHMARK(SHA256D64_1024_STANDARD);
+BENCHMARK(SHA256D64_1024_SSE41);
+BENCHMARK(SHA256D64_1024_AVX2);
+BENCHMARK(SHA256D64_1024_SHANI);
 BENCHMARK(SHA512);
 
 BENCHMARK(FastRandom_32bit);
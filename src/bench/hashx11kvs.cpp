@@ -0,0 +1,144 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "crypto/sph_x4.h"
+#include "hashx11kvs.h"
+#include "random.h"
+
+#include <vector>
+
+/* Size of the cache used by the cached benchmarks, in megabytes */
+static const size_t BENCH_CACHE_SIZE = 64;
+
+// Miner style scan: a fixed 76-byte prefix and consecutive nonces
+static void X11KVS_NonceScan(benchmark::State& state)
+{
+    unsigned char header[80];
+    GetRandBytes(header, sizeof(header));
+    uint32_t nonce = 0;
+    while (state.KeepRunning()) {
+        le32enc(header + 76, nonce++);
+        HashX11KVS(header, header + 80);
+    }
+}
+
+static void X11KVS_NonceScanBatched(benchmark::State& state)
+{
+    unsigned char header[80];
+    GetRandBytes(header, sizeof(header));
+    uint32_t nonce = 0;
+    while (state.KeepRunning()) {
+        le32enc(header + 76, nonce++);
+        HashX11KVSBatched(header);
+    }
+}
+
+static void X11KVS_NonceScanCached(benchmark::State& state)
+{
+    CX11KVSCache cache((BENCH_CACHE_SIZE << 20) / CX11KVSCache::ENTRY_SIZE);
+    unsigned char header[80];
+    GetRandBytes(header, sizeof(header));
+    uint32_t nonce = 0;
+    while (state.KeepRunning()) {
+        le32enc(header + 76, nonce++);
+        HashX11KVSCached(header, cache);
+    }
+}
+
+// Reindex style load: every header is distinct and is hashed twice,
+// once for the proof of work check and once for the block index lookup
+static void X11KVS_Reindex(benchmark::State& state)
+{
+    unsigned char header[80];
+    while (state.KeepRunning()) {
+        GetRandBytes(header, sizeof(header));
+        HashX11KVS(header, header + 80);
+        HashX11KVS(header, header + 80);
+    }
+}
+
+static void X11KVS_ReindexCached(benchmark::State& state)
+{
+    CX11KVSCache cache((BENCH_CACHE_SIZE << 20) / CX11KVSCache::ENTRY_SIZE);
+    unsigned char header[80];
+    while (state.KeepRunning()) {
+        GetRandBytes(header, sizeof(header));
+        HashX11KVSCached(header, cache);
+        HashX11KVSCached(header, cache);
+    }
+}
+
+/* Number of headers hashed per iteration by the X11KV benchmarks */
+static const size_t BENCH_BATCH_SIZE = 64;
+
+// The deepest level of a full X11KVS tree: independent headers hashed one by one
+static void X11KV_Single(benchmark::State& state)
+{
+    std::vector<unsigned char> vHeaders(BENCH_BATCH_SIZE * 80);
+    GetRandBytes(vHeaders.data(), vHeaders.size());
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < BENCH_BATCH_SIZE; i++) {
+            HashX11KV(&vHeaders[i * 80], &vHeaders[i * 80] + 80);
+        }
+    }
+}
+
+// The same headers hashed together, lanes grouped by algorithm
+static void X11KV_Batch(benchmark::State& state)
+{
+    std::vector<unsigned char> vHeaders(BENCH_BATCH_SIZE * 80);
+    GetRandBytes(vHeaders.data(), vHeaders.size());
+    std::vector<const unsigned char*> vPtrs;
+    for (size_t i = 0; i < BENCH_BATCH_SIZE; i++) vPtrs.push_back(&vHeaders[i * 80]);
+    std::vector<uint256> vHashes(BENCH_BATCH_SIZE);
+    while (state.KeepRunning()) {
+        HashX11KVBatch(vPtrs.data(), BENCH_BATCH_SIZE, vHashes.data());
+    }
+}
+
+template <typename Context>
+static void SphScalar(benchmark::State& state, void (*init)(void*), void (*update)(void*, const void*, size_t), void (*close)(void*, void*))
+{
+    unsigned char buf[4][64] = {{0}};
+    while (state.KeepRunning()) {
+        for (int l = 0; l < 4; l++) {
+            Context ctx;
+            init(&ctx);
+            update(&ctx, buf[l], 64);
+            close(&ctx, buf[l]);
+        }
+    }
+}
+
+static void SphX4(benchmark::State& state, void (*fn)(unsigned char* const out[4], const unsigned char* const in[4], size_t len))
+{
+    unsigned char buf[4][64] = {{0}};
+    unsigned char* p[4] = {buf[0], buf[1], buf[2], buf[3]};
+    while (state.KeepRunning()) {
+        fn(p, p, 64);
+    }
+}
+
+// Four 64-byte messages per iteration
+static void Blake512_Scalar(benchmark::State& state) { SphScalar<sph_blake512_context>(state, sph_blake512_init, sph_blake512, sph_blake512_close); }
+static void Blake512_X4(benchmark::State& state) { SphX4(state, sph_blake512_x4); }
+static void Keccak512_Scalar(benchmark::State& state) { SphScalar<sph_keccak512_context>(state, sph_keccak512_init, sph_keccak512, sph_keccak512_close); }
+static void Keccak512_X4(benchmark::State& state) { SphX4(state, sph_keccak512_x4); }
+static void Skein512_Scalar(benchmark::State& state) { SphScalar<sph_skein512_context>(state, sph_skein512_init, sph_skein512, sph_skein512_close); }
+static void Skein512_X4(benchmark::State& state) { SphX4(state, sph_skein512_x4); }
+
+BENCHMARK(X11KVS_NonceScan);
+BENCHMARK(X11KVS_NonceScanBatched);
+BENCHMARK(X11KVS_NonceScanCached);
+BENCHMARK(X11KVS_Reindex);
+BENCHMARK(X11KVS_ReindexCached);
+BENCHMARK(X11KV_Single);
+BENCHMARK(X11KV_Batch);
+BENCHMARK(Blake512_Scalar);
+BENCHMARK(Blake512_X4);
+BENCHMARK(Keccak512_Scalar);
+BENCHMARK(Keccak512_X4);
+BENCHMARK(Skein512_Scalar);
+BENCHMARK(Skein512_X4);
@@ -0,0 +1,71 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "masternode.h"
+#include "masternode-scores.h"
+#include "random.h"
+
+#include <list>
+#include <vector>
+
+/** A masternode list of random collaterals, all enabled */
+class MasternodeScoresSetup
+{
+public:
+    std::vector<CMasternode*> vMasternodes;
+    uint256 hashBlock;
+
+    explicit MasternodeScoresSetup(size_t nSize)
+    {
+        FastRandomContext rng(true);
+        for (size_t i = 0; i < nSize; i++) {
+            mns.emplace_back();
+            mns.back().vin = CTxIn(rng.rand256(), rng.randrange(4));
+            vMasternodes.push_back(&mns.back());
+        }
+        hashBlock = rng.rand256();
+    }
+
+private:
+    std::list<CMasternode> mns;
+};
+
+// A score table computed for a height: once per block or list change
+static void MasternodeScoresBuild(benchmark::State& state, size_t nSize)
+{
+    MasternodeScoresSetup setup(nSize);
+    uint64_t nVersion = 0;
+    while (state.KeepRunning()) {
+        CMasternodeScores scores(setup.hashBlock, nVersion++, setup.vMasternodes);
+    }
+}
+
+// The rank of a masternode read from the table of its height, as GetMasternodeRank does
+static void MasternodeScoresRank(benchmark::State& state, size_t nSize)
+{
+    MasternodeScoresSetup setup(nSize);
+    const CMasternodeScores scores(setup.hashBlock, 0, setup.vMasternodes);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        const COutPoint& prevout = setup.vMasternodes[i++ % nSize]->vin.prevout;
+        int rank = 0;
+        for (const auto& entry : scores.vEntries) {
+            if (!entry.pmn->IsEnabled()) continue;
+            rank++;
+            if (entry.pmn->vin.prevout == prevout) break;
+        }
+    }
+}
+
+static void MasternodeScoresBuild5k(benchmark::State& state) { MasternodeScoresBuild(state, 5000); }
+static void MasternodeScoresBuild20k(benchmark::State& state) { MasternodeScoresBuild(state, 20000); }
+static void MasternodeScoresRank5k(benchmark::State& state) { MasternodeScoresRank(state, 5000); }
+static void MasternodeScoresRank20k(benchmark::State& state) { MasternodeScoresRank(state, 20000); }
+
+BENCHMARK(MasternodeScoresBuild5k);
+BENCHMARK(MasternodeScoresBuild20k);
+BENCHMARK(MasternodeScoresRank5k);
+BENCHMARK(MasternodeScoresRank20k);
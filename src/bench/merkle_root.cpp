@@ -0,0 +1,84 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "consensus/merkle.h"
+#include "hash.h"
+#include "random.h"
+
+#include <vector>
+
+static std::vector<uint256> RandomLeaves(size_t count)
+{
+    FastRandomContext rng(true);
+    std::vector<uint256> leaves(count);
+    for (size_t i = 0; i < count; i++) {
+        leaves[i] = rng.rand256();
+    }
+    return leaves;
+}
+
+// Reference: one CHash256 per pair, a level at a time
+static uint256 MerkleRootPerPair(std::vector<uint256> hashes)
+{
+    while (hashes.size() > 1) {
+        if (hashes.size() & 1) hashes.push_back(hashes.back());
+        for (size_t pos = 0; pos < hashes.size(); pos += 2) {
+            CHash256().Write(hashes[pos].begin(), 32).Write(hashes[pos + 1].begin(), 32).Finalize(hashes[pos / 2].begin());
+        }
+        hashes.resize(hashes.size() / 2);
+    }
+    return hashes.empty() ? uint256() : hashes[0];
+}
+
+static void MerkleRootPerPair(benchmark::State& state, size_t count)
+{
+    const std::vector<uint256> leaves = RandomLeaves(count);
+    while (state.KeepRunning()) {
+        MerkleRootPerPair(leaves);
+    }
+}
+
+static void MerkleRootBatched(benchmark::State& state, size_t count)
+{
+    const std::vector<uint256> leaves = RandomLeaves(count);
+    while (state.KeepRunning()) {
+        bool mutated = false;
+        ComputeMerkleRoot(leaves, &mutated);
+    }
+}
+
+// Miner style extranonce roll: replace the coinbase and read the new root
+static void MerkleRootUpdateCoinbase(benchmark::State& state, size_t count)
+{
+    const std::vector<uint256> leaves = RandomLeaves(count);
+    CBlockMerkleTree tree(leaves);
+    uint256 coinbase = leaves[0];
+    while (state.KeepRunning()) {
+        *coinbase.begin() += 1;
+        tree.UpdateLeaf(0, coinbase);
+        tree.GetRoot();
+    }
+}
+
+static void MerkleRoot_PerPair_100(benchmark::State& state) { MerkleRootPerPair(state, 100); }
+static void MerkleRoot_PerPair_1000(benchmark::State& state) { MerkleRootPerPair(state, 1000); }
+static void MerkleRoot_PerPair_10000(benchmark::State& state) { MerkleRootPerPair(state, 10000); }
+static void MerkleRoot_Batched_100(benchmark::State& state) { MerkleRootBatched(state, 100); }
+static void MerkleRoot_Batched_1000(benchmark::State& state) { MerkleRootBatched(state, 1000); }
+static void MerkleRoot_Batched_10000(benchmark::State& state) { MerkleRootBatched(state, 10000); }
+static void MerkleRoot_UpdateCoinbase_100(benchmark::State& state) { MerkleRootUpdateCoinbase(state, 100); }
+static void MerkleRoot_UpdateCoinbase_1000(benchmark::State& state) { MerkleRootUpdateCoinbase(state, 1000); }
+static void MerkleRoot_UpdateCoinbase_10000(benchmark::State& state) { MerkleRootUpdateCoinbase(state, 10000); }
+
+BENCHMARK(MerkleRoot_PerPair_100);
+BENCHMARK(MerkleRoot_PerPair_1000);
+BENCHMARK(MerkleRoot_PerPair_10000);
+BENCHMARK(MerkleRoot_Batched_100);
+BENCHMARK(MerkleRoot_Batched_1000);
+BENCHMARK(MerkleRoot_Batched_10000);
+BENCHMARK(MerkleRoot_UpdateCoinbase_100);
+BENCHMARK(MerkleRoot_UpdateCoinbase_1000);
+BENCHMARK(MerkleRoot_UpdateCoinbase_10000);
@@ -0,0 +1,160 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "hash.h"
+#include "hashx11kvs.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "util.h"
+
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <vector>
+
+/* Headers hashed by every thread on each iteration of the scaling benchmarks */
+static const int HASHES_PER_THREAD = 8;
+
+// Every benchmark hashes an 80-byte header and bumps its nonce each time, so
+// the per_second column is the hash rate of the algorithm.
+static void PowHash(benchmark::State& state, uint256 (*fn)(const unsigned char* header))
+{
+    unsigned char header[80];
+    GetRandBytes(header, sizeof(header));
+    uint32_t nonce = 0;
+    while (state.KeepRunning()) {
+        le32enc(header + 76, nonce++);
+        fn(header);
+    }
+}
+
+static uint256 QuarkHeader(const unsigned char* header) { return HashQuark(header, header + 80); }
+static uint256 XevanHeader(const unsigned char* header) { return XEVAN(header, header + 80); }
+static uint256 X11KVHeader(const unsigned char* header) { return HashX11KV(header, header + 80); }
+template <unsigned int level>
+static uint256 X11KVSHeader(const unsigned char* header) { return HashX11KVS(header, header + 80, level); }
+
+static void PoW_HashQuark(benchmark::State& state) { PowHash(state, QuarkHeader); }
+static void PoW_XEVAN(benchmark::State& state) { PowHash(state, XevanHeader); }
+static void PoW_HashX11KV(benchmark::State& state) { PowHash(state, X11KVHeader); }
+static void PoW_HashX11KVS_Level1(benchmark::State& state) { PowHash(state, X11KVSHeader<1>); }
+static void PoW_HashX11KVS_Level2(benchmark::State& state) { PowHash(state, X11KVSHeader<2>); }
+static void PoW_HashX11KVS_Level3(benchmark::State& state) { PowHash(state, X11KVSHeader<3>); }
+static void PoW_HashX11KVS_Level4(benchmark::State& state) { PowHash(state, X11KVSHeader<4>); }
+static void PoW_HashX11KVS_Level5(benchmark::State& state) { PowHash(state, X11KVSHeader<5>); }
+static void PoW_HashX11KVS_Level6(benchmark::State& state) { PowHash(state, X11KVSHeader<6>); }
+static void PoW_HashX11KVS_Level7(benchmark::State& state) { PowHash(state, X11KVSHeader<7>); }
+
+// One X11KV round of the given algorithm over a 64-byte state
+template <unsigned int algo>
+static void PoW_X11KVAlgo(benchmark::State& state)
+{
+    uint512 hash;
+    GetRandBytes(hash.begin(), hash.size());
+    while (state.KeepRunning()) {
+        HashX11KVIteration(algo, hash);
+    }
+}
+
+static void PoW_X11KV_Blake512(benchmark::State& state) { PoW_X11KVAlgo<0>(state); }
+static void PoW_X11KV_Bmw512(benchmark::State& state) { PoW_X11KVAlgo<1>(state); }
+static void PoW_X11KV_Groestl512(benchmark::State& state) { PoW_X11KVAlgo<2>(state); }
+static void PoW_X11KV_Skein512(benchmark::State& state) { PoW_X11KVAlgo<3>(state); }
+static void PoW_X11KV_Jh512(benchmark::State& state) { PoW_X11KVAlgo<4>(state); }
+static void PoW_X11KV_Keccak512(benchmark::State& state) { PoW_X11KVAlgo<5>(state); }
+static void PoW_X11KV_Luffa512(benchmark::State& state) { PoW_X11KVAlgo<6>(state); }
+static void PoW_X11KV_Cubehash512(benchmark::State& state) { PoW_X11KVAlgo<7>(state); }
+static void PoW_X11KV_Shavite512(benchmark::State& state) { PoW_X11KVAlgo<8>(state); }
+static void PoW_X11KV_Simd512(benchmark::State& state) { PoW_X11KVAlgo<9>(state); }
+static void PoW_X11KV_Echo512(benchmark::State& state) { PoW_X11KVAlgo<10>(state); }
+
+// Block header hashing as done by validation: X11KVS up to version 3, double
+// SHA-256 from version 4. The nonce changes so that the cached hash is not used,
+// and the shared X11KVS subtree cache is disabled, consecutive nonces would
+// otherwise mostly hit it.
+static void BlockHeaderGetHash(benchmark::State& state, int32_t nVersion)
+{
+    CX11KVSCache& cache = GetX11KVSCache();
+    const size_t nMaxEntries = cache.GetMaxEntries();
+    cache.SetMaxEntries(0);
+
+    CBlockHeader header;
+    header.nVersion = nVersion;
+    header.hashPrevBlock = GetRandHash();
+    header.hashMerkleRoot = GetRandHash();
+    header.nTime = 1640995200;
+    header.nBits = 0x1e0ffff0;
+    header.nNonce = 0;
+    while (state.KeepRunning()) {
+        header.nNonce++;
+        header.GetHash();
+    }
+    cache.SetMaxEntries(nMaxEntries);
+}
+
+static void PoW_BlockHeaderGetHash_V3(benchmark::State& state) { BlockHeaderGetHash(state, 3); }
+static void PoW_BlockHeaderGetHash_V4(benchmark::State& state) { BlockHeaderGetHash(state, 4); }
+
+// Full level X11KVS on nThreads threads, each hashing its own nonce range. An
+// iteration hashes nThreads * HASHES_PER_THREAD headers, so the aggregate
+// rate is per_second times that.
+static void X11KVSThreads(benchmark::State& state, int nThreads)
+{
+    unsigned char header[80];
+    GetRandBytes(header, sizeof(header));
+    uint32_t nonce = 0;
+    while (state.KeepRunning()) {
+        boost::thread_group tg;
+        for (int t = 0; t < nThreads; t++) {
+            const uint32_t nonceStart = nonce + t * HASHES_PER_THREAD;
+            tg.create_thread([&header, nonceStart] {
+                unsigned char local[80];
+                memcpy(local, header, sizeof(local));
+                for (int i = 0; i < HASHES_PER_THREAD; i++) {
+                    le32enc(local + 76, nonceStart + i);
+                    HashX11KVS(local, local + 80);
+                }
+            });
+        }
+        tg.join_all();
+        nonce += nThreads * HASHES_PER_THREAD;
+    }
+}
+
+static void PoW_HashX11KVS_Threads_1(benchmark::State& state) { X11KVSThreads(state, 1); }
+static void PoW_HashX11KVS_Threads_2(benchmark::State& state) { X11KVSThreads(state, 2); }
+static void PoW_HashX11KVS_Threads_4(benchmark::State& state) { X11KVSThreads(state, 4); }
+static void PoW_HashX11KVS_Threads_8(benchmark::State& state) { X11KVSThreads(state, 8); }
+static void PoW_HashX11KVS_Threads_All(benchmark::State& state) { X11KVSThreads(state, std::max(GetNumCores(), 1)); }
+
+BENCHMARK(PoW_HashQuark);
+BENCHMARK(PoW_XEVAN);
+BENCHMARK(PoW_HashX11KV);
+BENCHMARK(PoW_HashX11KVS_Level1);
+BENCHMARK(PoW_HashX11KVS_Level2);
+BENCHMARK(PoW_HashX11KVS_Level3);
+BENCHMARK(PoW_HashX11KVS_Level4);
+BENCHMARK(PoW_HashX11KVS_Level5);
+BENCHMARK(PoW_HashX11KVS_Level6);
+BENCHMARK(PoW_HashX11KVS_Level7);
+BENCHMARK(PoW_X11KV_Blake512);
+BENCHMARK(PoW_X11KV_Bmw512);
+BENCHMARK(PoW_X11KV_Groestl512);
+BENCHMARK(PoW_X11KV_Skein512);
+BENCHMARK(PoW_X11KV_Jh512);
+BENCHMARK(PoW_X11KV_Keccak512);
+BENCHMARK(PoW_X11KV_Luffa512);
+BENCHMARK(PoW_X11KV_Cubehash512);
+BENCHMARK(PoW_X11KV_Shavite512);
+BENCHMARK(PoW_X11KV_Simd512);
+BENCHMARK(PoW_X11KV_Echo512);
+BENCHMARK(PoW_BlockHeaderGetHash_V3);
+BENCHMARK(PoW_BlockHeaderGetHash_V4);
+BENCHMARK(PoW_HashX11KVS_Threads_1);
+BENCHMARK(PoW_HashX11KVS_Threads_2);
+BENCHMARK(PoW_HashX11KVS_Threads_4);
+BENCHMARK(PoW_HashX11KVS_Threads_8);
+BENCHMARK(PoW_HashX11KVS_Threads_All);
@@ -0,0 +1,166 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "coins.h"
+#include "kernel.h"
+#include "key.h"
+#include "main.h"
+#include "script/interpreter.h"
+#include "streams.h"
+#include "txdb.h"
+#include "util.h"
+
+#include <vector>
+
+/* Blocks of the chain, each one creating a stakeable output */
+static const int NUM_BLOCKS = 400;
+/* Value of the stakeable outputs, low enough for a weighted target that almost every kernel meets */
+static const CAmount STAKE_VALUE = 100;
+
+/**
+ * A regtest chain past the last checkpoint whose blocks, written to a
+ * temporary datadir and indexed in a txindex, each create one P2PK output.
+ * With fCoins the outputs are also in pcoinsTip. vBlocks holds one signed
+ * PoS block on top of the tip staking each of them.
+ */
+class StakeInputSetup
+{
+public:
+    std::vector<CBlockIndex*> vIndex;
+    std::vector<CBlock> vBlocks;
+
+    explicit StakeInputSetup(bool fCoins)
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+        ClearDatadirCache();
+        pathTemp = GetTempPath() / strprintf("bench_stakeinput_%lu_%i", (unsigned long)GetTime(), (int)GetRand(100000));
+        fs::create_directories(pathTemp);
+        mapArgs["-datadir"] = pathTemp.string();
+        pblocktree = new CBlockTreeDB(1 << 20, true);
+        fTxIndex = true;
+        pcoinsTip = new CCoinsViewCache(&viewEmpty);
+
+        CKey key;
+        key.MakeNewKey(true);
+        const CScript scriptStake = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+
+        std::vector<std::pair<uint256, CDiskTxPos> > vPos;
+        std::vector<COutPoint> vStakes;
+        CDiskBlockPos pos(0, 0);
+        CBlockIndex* pindexPrev = nullptr;
+        for (int i = 0; i < NUM_BLOCKS; i++) {
+            CBlock block;
+            block.nVersion = 7;
+            block.hashPrevBlock = pindexPrev ? pindexPrev->GetBlockHash() : UINT256_ZERO;
+            block.nTime = 1600000000 + i * 60;
+            block.nBits = 0x207fffff;
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].scriptSig = CScript() << i;
+            tx.vout.emplace_back(STAKE_VALUE, scriptStake);
+            block.vtx.push_back(CTransaction(tx));
+            if (!WriteBlockToDisk(block, pos))
+                throw std::runtime_error("StakeInputSetup: WriteBlockToDisk failed");
+
+            CBlockIndex* pindex = new CBlockIndex(block);
+            BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(block.GetHash(), pindex)).first;
+            pindex->phashBlock = &((*mi).first);
+            pindex->pprev = pindexPrev;
+            pindex->nHeight = i;
+            pindex->nFile = pos.nFile;
+            pindex->nDataPos = pos.nPos;
+            pindex->nStatus |= BLOCK_HAVE_DATA;
+            pindex->SetStakeModifier(GetRandHash());
+            vIndex.push_back(pindex);
+
+            const CTransaction& txStake = block.vtx[0];
+            vPos.push_back(std::make_pair(txStake.GetHash(), CDiskTxPos(pos, GetSizeOfCompactSize(block.vtx.size()))));
+            vStakes.emplace_back(txStake.GetHash(), 0);
+            if (fCoins) pcoinsTip->AddCoin(vStakes.back(), Coin(txStake.vout[0], i, false, false), false);
+
+            pos.nPos += ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+            pindexPrev = pindex;
+        }
+        pblocktree->WriteTxIndex(vPos);
+        chainActive.SetTip(pindexPrev);
+
+        // The blocks staking every output deep enough
+        const int nMinDepth = Params().GetConsensus().nStakeMinDepth;
+        for (int i = 0; i + nMinDepth < NUM_BLOCKS; i++) {
+            CBlock block;
+            block.nVersion = 7;
+            block.hashPrevBlock = pindexPrev->GetBlockHash();
+            block.nTime = pindexPrev->nTime + 60;
+            block.nBits = 0x2100ffff;
+            CMutableTransaction txCoinbase;
+            txCoinbase.vin.resize(1);
+            txCoinbase.vout.resize(1);
+            txCoinbase.vout[0].SetEmpty();
+            CMutableTransaction txCoinStake;
+            txCoinStake.vin.emplace_back(vStakes[i]);
+            txCoinStake.vout.resize(1);
+            txCoinStake.vout[0].SetEmpty();
+            txCoinStake.vout.emplace_back(STAKE_VALUE, scriptStake);
+            const uint256 hash = SignatureHash(scriptStake, txCoinStake, 0, SIGHASH_ALL, STAKE_VALUE, SIGVERSION_BASE);
+            std::vector<unsigned char> vchSig;
+            key.Sign(hash, vchSig);
+            vchSig.push_back((unsigned char)SIGHASH_ALL);
+            txCoinStake.vin[0].scriptSig = CScript() << vchSig;
+            block.vtx.push_back(CTransaction(txCoinbase));
+            block.vtx.push_back(CTransaction(txCoinStake));
+            vBlocks.push_back(block);
+        }
+    }
+
+    ~StakeInputSetup()
+    {
+        chainActive.SetTip(nullptr);
+        for (CBlockIndex* pindex : vIndex) {
+            mapBlockIndex.erase(pindex->GetBlockHash());
+            delete pindex;
+        }
+        delete pcoinsTip;
+        pcoinsTip = nullptr;
+        fTxIndex = false;
+        delete pblocktree;
+        pblocktree = nullptr;
+        fs::remove_all(pathTemp);
+    }
+
+private:
+    fs::path pathTemp;
+    CCoinsView viewEmpty;
+};
+
+// Stake checks of PoS blocks on top of the tip, the stake found in the UTXO set
+static void CheckProofOfStake_Coins(benchmark::State& state)
+{
+    StakeInputSetup setup(true);
+    const CBlockIndex* pindexPrev = chainActive.Tip();
+    LOCK(cs_main);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        std::string strError;
+        CheckProofOfStake(setup.vBlocks[i++ % setup.vBlocks.size()], strError, pindexPrev);
+    }
+}
+
+// The previous behaviour: the stake transaction read from its block through the txindex
+static void CheckProofOfStake_TxIndex(benchmark::State& state)
+{
+    StakeInputSetup setup(false);
+    const CBlockIndex* pindexPrev = chainActive.Tip();
+    LOCK(cs_main);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        std::string strError;
+        CheckProofOfStake(setup.vBlocks[i++ % setup.vBlocks.size()], strError, pindexPrev);
+    }
+}
+
+BENCHMARK(CheckProofOfStake_Coins);
+BENCHMARK(CheckProofOfStake_TxIndex);
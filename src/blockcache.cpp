@@ -0,0 +1,90 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockcache.h"
+
+#include "serialize.h"
+#include "version.h"
+
+CBlockCache blockCache;
+
+void CBlockCache::SetMaxSize(size_t nMaxBytesIn)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    nMaxBytes = nMaxBytesIn;
+    Trim();
+}
+
+std::shared_ptr<const CBlock> CBlockCache::Get(const uint256& hash)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    auto it = mapEntries.find(hash);
+    if (it == mapEntries.end()) {
+        stats.nMisses++;
+        return nullptr;
+    }
+    stats.nHits++;
+    lru.splice(lru.begin(), lru, it->second);
+    return it->second->pblock;
+}
+
+void CBlockCache::Insert(const uint256& hash, const std::shared_ptr<const CBlock>& pblock)
+{
+    // Computed out of the lock
+    const size_t nSize = ::GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION);
+
+    std::unique_lock<std::mutex> lock(cs);
+    if (nSize > nMaxBytes)
+        return;
+    auto it = mapEntries.find(hash);
+    if (it != mapEntries.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+        return;
+    }
+    lru.push_front(CEntry{hash, pblock, nSize});
+    mapEntries.emplace(hash, lru.begin());
+    stats.nBytes += nSize;
+    stats.nInserts++;
+    Trim();
+}
+
+void CBlockCache::Erase(const uint256& hash)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    auto it = mapEntries.find(hash);
+    if (it != mapEntries.end())
+        EraseEntry(it->second);
+}
+
+void CBlockCache::Clear()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    mapEntries.clear();
+    lru.clear();
+    stats.nBytes = 0;
+}
+
+CBlockCacheStats CBlockCache::GetStats()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    CBlockCacheStats ret = stats;
+    ret.nBlocks = lru.size();
+    ret.nMaxBytes = nMaxBytes;
+    return ret;
+}
+
+void CBlockCache::EraseEntry(std::list<CEntry>::iterator it)
+{
+    stats.nBytes -= it->nSize;
+    mapEntries.erase(it->hash);
+    lru.erase(it);
+}
+
+void CBlockCache::Trim()
+{
+    while (stats.nBytes > nMaxBytes && !lru.empty()) {
+        EraseEntry(std::prev(lru.end()));
+        stats.nEvictions++;
+    }
+}
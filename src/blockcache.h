@@ -0,0 +1,77 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DECENOMY_BLOCKCACHE_H
+#define DECENOMY_BLOCKCACHE_H
+
+#include "primitives/block.h"
+#include "uint256.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/** Default for -blockcachesize, in MiB of serialized blocks */
+static const int64_t DEFAULT_BLOCK_CACHE_SIZE = 16;
+/** Maximum for -blockcachesize */
+static const int64_t MAX_BLOCK_CACHE_SIZE = 1024;
+
+struct CBlockCacheStats {
+    uint64_t nHits = 0;
+    uint64_t nMisses = 0;
+    uint64_t nInserts = 0;
+    uint64_t nEvictions = 0;
+    size_t nBlocks = 0;
+    size_t nBytes = 0;
+    size_t nMaxBytes = 0;
+};
+
+/**
+ * The blocks accepted or read from disk last, deserialized, shared by the
+ * readers of recent blocks: the masternode payment lookups, the fork checks,
+ * the blocks served to peers, the notifiers and the RPC.
+ *
+ * Bounded by the serialized size of the blocks it holds, the least recently
+ * used ones make room for new ones. Entries are keyed by block hash and are
+ * never modified, a block found is the one stored on disk for that hash.
+ */
+class CBlockCache
+{
+public:
+    /** Set the size of the blocks kept, in bytes. 0 disables the cache */
+    void SetMaxSize(size_t nMaxBytesIn);
+
+    /** The block with that hash, or null. Counts a hit or a miss */
+    std::shared_ptr<const CBlock> Get(const uint256& hash);
+    void Insert(const uint256& hash, const std::shared_ptr<const CBlock>& pblock);
+    void Erase(const uint256& hash);
+    void Clear();
+
+    CBlockCacheStats GetStats();
+
+private:
+    struct CEntry {
+        uint256 hash;
+        std::shared_ptr<const CBlock> pblock;
+        size_t nSize;
+    };
+    struct CHashHasher {
+        size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
+    };
+
+    std::mutex cs;
+    //! Most recently used first
+    std::list<CEntry> lru;
+    std::unordered_map<uint256, std::list<CEntry>::iterator, CHashHasher> mapEntries;
+    size_t nMaxBytes = DEFAULT_BLOCK_CACHE_SIZE << 20;
+    CBlockCacheStats stats;
+
+    void EraseEntry(std::list<CEntry>::iterator it);
+    void Trim();
+};
+
+extern CBlockCache blockCache;
+
+#endif // DECENOMY_BLOCKCACHE_H
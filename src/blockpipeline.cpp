@@ -0,0 +1,183 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockpipeline.h"
+
+#include "clientversion.h"
+#include "coinsprefetch.h"
+#include "consensus/validation.h"
+#include "main.h"
+#include "streams.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <functional>
+
+CBlockPipeline blockPipeline;
+
+CBlockPipelineStats CBlockPipelineStats::operator-(const CBlockPipelineStats& other) const
+{
+    CBlockPipelineStats diff = *this;
+    diff.nReadBlocks -= other.nReadBlocks;
+    diff.nReadBytes -= other.nReadBytes;
+    diff.nReadMicros -= other.nReadMicros;
+    diff.nCheckBlocks -= other.nCheckBlocks;
+    diff.nCheckMicros -= other.nCheckMicros;
+    diff.nWaitMicros -= other.nWaitMicros;
+    diff.nConnectBlocks -= other.nConnectBlocks;
+    diff.nConnectMicros -= other.nConnectMicros;
+    return diff;
+}
+
+std::string CBlockPipelineStats::ToString() const
+{
+    return strprintf("read %u blocks (%.2f MB/s), checked %u blocks on %d threads (%.1f blocks/s per thread), connected %u blocks (%.1f blocks/s), waited %.2fs for checks",
+        nReadBlocks, nReadMicros ? nReadBytes / (double)nReadMicros : 0.0,
+        nCheckBlocks, nThreads, nCheckMicros ? nCheckBlocks * 1000000.0 / nCheckMicros : 0.0,
+        nConnectBlocks, nConnectMicros ? nConnectBlocks * 1000000.0 / nConnectMicros : 0.0,
+        nWaitMicros * 0.000001);
+}
+
+void CBlockPipeline::Start(int nThreads)
+{
+    Stop();
+    std::unique_lock<std::mutex> lock(cs);
+    fStop = false;
+    for (int i = 0; i < nThreads; i++)
+        vThreads.emplace_back(&TraceThread<std::function<void()> >, "blockcheck", std::function<void()>(std::bind(&CBlockPipeline::ThreadCheck, this)));
+    stats.nThreads = nThreads;
+    LogPrintf("Using %d threads for block checks\n", nThreads);
+}
+
+void CBlockPipeline::Stop()
+{
+    std::vector<std::thread> vStopping;
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        fStop = true;
+        vStopping.swap(vThreads);
+    }
+    condWork.notify_all();
+    for (std::thread& t : vStopping)
+        t.join();
+
+    // Jobs left are run by Wait
+    std::unique_lock<std::mutex> lock(cs);
+    queue.clear();
+    stats.nThreads = 0;
+}
+
+void CBlockPipeline::Run(CBlockPipelineJob& job)
+{
+    const int64_t nTimeStart = GetTimeMicros();
+    if (!job.pblock) {
+        std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
+        try {
+            CDataStream ss(job.vData, SER_DISK, CLIENT_VERSION);
+            ss >> *pblockNew;
+            job.pblock = pblockNew;
+        } catch (const std::exception& e) {
+            job.strError = e.what();
+        }
+        std::vector<char>().swap(job.vData);
+    }
+    if (job.pblock) {
+        // The result is kept in the block, ProcessNewBlock reports the failures
+        CValidationState state;
+        if (CheckBlockContextFree(*job.pblock, state) && job.fPrefetch)
+            coinsPrefetcher.Prefetch(*job.pblock);
+    }
+    const int64_t nTime = GetTimeMicros() - nTimeStart;
+
+    std::unique_lock<std::mutex> lock(cs);
+    job.fDone = true;
+    stats.nCheckBlocks++;
+    stats.nCheckMicros += nTime;
+}
+
+void CBlockPipeline::ThreadCheck()
+{
+    while (true) {
+        CBlockPipelineJobRef job;
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            while (!fStop && queue.empty())
+                condWork.wait(lock);
+            if (fStop)
+                return;
+            job = queue.front();
+            queue.pop_front();
+            if (job->fStarted)
+                continue;
+            job->fStarted = true;
+        }
+        Run(*job);
+        condDone.notify_all();
+    }
+}
+
+CBlockPipelineJobRef CBlockPipeline::Push(const CBlockPipelineJobRef& job)
+{
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        if (vThreads.empty())
+            return job;
+        queue.push_back(job);
+    }
+    condWork.notify_one();
+    return job;
+}
+
+CBlockPipelineJobRef CBlockPipeline::Push(std::vector<char>&& vData, bool fPrefetch)
+{
+    CBlockPipelineJobRef job = std::make_shared<CBlockPipelineJob>();
+    job->vData = std::move(vData);
+    job->fPrefetch = fPrefetch;
+    return Push(job);
+}
+
+CBlockPipelineJobRef CBlockPipeline::Push(const std::shared_ptr<const CBlock>& pblock)
+{
+    CBlockPipelineJobRef job = std::make_shared<CBlockPipelineJob>();
+    job->pblock = pblock;
+    return Push(job);
+}
+
+void CBlockPipeline::Wait(const CBlockPipelineJobRef& job)
+{
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        if (job->fStarted) {
+            const int64_t nTimeStart = GetTimeMicros();
+            while (!job->fDone)
+                condDone.wait(lock);
+            stats.nWaitMicros += GetTimeMicros() - nTimeStart;
+            return;
+        }
+        // Left in the queue, the threads skip it
+        job->fStarted = true;
+    }
+    Run(*job);
+}
+
+void CBlockPipeline::AddRead(size_t nBytes, int64_t nMicros)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    stats.nReadBlocks++;
+    stats.nReadBytes += nBytes;
+    stats.nReadMicros += nMicros;
+}
+
+void CBlockPipeline::AddConnect(int64_t nMicros)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    stats.nConnectBlocks++;
+    stats.nConnectMicros += nMicros;
+}
+
+CBlockPipelineStats CBlockPipeline::GetStats()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    return stats;
+}
@@ -0,0 +1,101 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DECENOMY_BLOCKPIPELINE_H
+#define DECENOMY_BLOCKPIPELINE_H
+
+#include "primitives/block.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** Default for -blockcheckthreads, 0 = one per core */
+static const int DEFAULT_BLOCK_CHECK_THREADS = 0;
+/** Maximum for -blockcheckthreads */
+static const int MAX_BLOCK_CHECK_THREADS = 16;
+/** Blocks read and checked ahead of the one being connected during reindex and import */
+static const size_t BLOCK_PIPELINE_DEPTH = 32;
+
+/** A block going through the pipeline */
+struct CBlockPipelineJob {
+    //! The block as read from disk, to deserialize. Empty once done
+    std::vector<char> vData;
+    //! The block, null if it couldn't be deserialized
+    std::shared_ptr<const CBlock> pblock;
+    std::string strError;
+    //! Whether the coins the block spends are read ahead once it is checked
+    bool fPrefetch = false;
+    bool fStarted = false;
+    bool fDone = false;
+};
+typedef std::shared_ptr<CBlockPipelineJob> CBlockPipelineJobRef;
+
+/** Cumulative time spent and blocks handled by each stage of the pipeline */
+struct CBlockPipelineStats {
+    int nThreads = 0;
+    uint64_t nReadBlocks = 0;
+    uint64_t nReadBytes = 0;
+    int64_t nReadMicros = 0;
+    uint64_t nCheckBlocks = 0;
+    //! Summed over the threads
+    int64_t nCheckMicros = 0;
+    //! Time the connecting thread waited for a block still being checked
+    int64_t nWaitMicros = 0;
+    uint64_t nConnectBlocks = 0;
+    int64_t nConnectMicros = 0;
+
+    CBlockPipelineStats operator-(const CBlockPipelineStats& other) const;
+    std::string ToString() const;
+};
+
+/**
+ * Deserializes blocks and runs their context-free checks on a pool of
+ * threads, without cs_main, while the blocks before them are connected.
+ *
+ * The block of a job must not be used before Wait returned for it: Wait
+ * runs the job on the calling thread if no thread has started it yet, so
+ * the connecting thread never waits behind blocks that come later.
+ */
+class CBlockPipeline
+{
+public:
+    ~CBlockPipeline() { Stop(); }
+
+    void Start(int nThreads);
+    void Stop();
+
+    /** Queue a block read from disk, to deserialize then check */
+    CBlockPipelineJobRef Push(std::vector<char>&& vData, bool fPrefetch);
+    /** Queue a block received from the network, to check */
+    CBlockPipelineJobRef Push(const std::shared_ptr<const CBlock>& pblock);
+    /** Wait until job is done */
+    void Wait(const CBlockPipelineJobRef& job);
+
+    void AddRead(size_t nBytes, int64_t nMicros);
+    void AddConnect(int64_t nMicros);
+    CBlockPipelineStats GetStats();
+
+private:
+    std::mutex cs;
+    std::condition_variable condWork;
+    std::condition_variable condDone;
+    std::deque<CBlockPipelineJobRef> queue;
+    std::vector<std::thread> vThreads;
+    bool fStop = false;
+    CBlockPipelineStats stats;
+
+    void ThreadCheck();
+    //! Deserialize and check the block of job. Called without cs
+    void Run(CBlockPipelineJob& job);
+    CBlockPipelineJobRef Push(const CBlockPipelineJobRef& job);
+};
+
+extern CBlockPipeline blockPipeline;
+
+#endif // DECENOMY_BLOCKPIPELINE_H
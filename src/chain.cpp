@@ -120,6 +120,7 @@ CBlockHeader CBlockIndex::GetBlockHeader() const
     block.nBits = nBits;
     block.nNonce = nNonce;
     if (nVersion > 3 && nVersion < 7) block.nAccumulatorCheckpoint = nAccumulatorCheckpoint;
+    if (phashBlock) block.SetCachedHash(*phashBlock);
     return block;
 }
 
@@ -244,23 +245,11 @@ uint256 CBlockIndex::GetStakeModifierV2() const
     return nStakeModifier;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex);
-
-CScript* CBlockIndex::GetPaidPayee()
+const CScript* CBlockIndex::GetPaidPayee() const
 {
-    if(paidPayee == nullptr || paidPayee->empty()) {
-        CBlock block;
-        if (nHeight <= chainActive.Height() && ReadBlockFromDisk(block, this)) {
-            auto amount = CMasternode::GetMasternodePayment(nHeight);
-            auto mnpayee = block.GetPaidPayee(amount);
-            
-            if(!mnpayee.empty()) {
-                paidPayee = new CScript(mnpayee);
-            }
-        }
-    }
-
-    return paidPayee;
+    if (!paidPayee || paidPayee->empty())
+        return nullptr;
+    return &*paidPayee;
 }
 
 //! Check whether this block index entry is valid up to the passed validity level.
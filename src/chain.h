@@ -158,6 +158,8 @@ enum BlockStatus {
     BLOCK_FAILED_VALID = 32, //! stage after last reached validness failed
     BLOCK_FAILED_CHILD = 64, //! descends from failed block
     BLOCK_FAILED_MASK = BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
+
+    BLOCK_SNAPSHOT = 128, //! block data not stored, the block came with a UTXO snapshot (-loadutxosnapshot)
 };
 
 // BlockIndex flags
@@ -232,8 +234,9 @@ public:
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
     uint32_t nSequenceId{0};
 
-    //! (memory only) paid masternode.
-    CScript* paidPayee{nullptr};
+    //! Payee of the masternode payment of this block, an empty script if it paid none.
+    //! Will be nullopt until the block is connected, or migrated for entries written before it was stored.
+    Optional<CScript> paidPayee{nullopt};
 
     CBlockIndex() {}
     CBlockIndex(const CBlock& block);
@@ -264,7 +267,8 @@ public:
     void SetNewStakeModifier(const uint256& prevoutId);     // generates and sets new v2 modifier
     uint64_t GetStakeModifierV1() const;
     uint256 GetStakeModifierV2() const;
-    CScript* GetPaidPayee();
+    //! The paid masternode, or nullptr if none or not known yet. Never reads the block
+    const CScript* GetPaidPayee() const;
 
     //! Check whether this block index entry is valid up to the passed validity level.
     bool IsValid(enum BlockStatus nUpTo = BLOCK_VALID_TRANSACTIONS) const;
@@ -284,6 +288,7 @@ public:
 static const int DBI_SER_VERSION_NO_MS = 0;   // removes nMoneySupply from persisted block index
 // New serialization introduced on XMD
 static const int DBI_SER_VERSION_MS = INT32_MAX;   // reintroduces the nMoneySupply to the persisted block index
+static const int DBI_SER_VERSION_PAYEE = INT32_MAX - 1;   // appends the paid masternode payee, read as DBI_SER_VERSION_NO_MS by older clients
 
 class CDiskBlockIndex : public CBlockIndex
 {
@@ -306,8 +311,11 @@ public:
     inline void SerializationOp(Stream& s, Operation ser_action)
     {
         int nSerVersion = s.GetVersion();
-        if (!(s.GetType() & SER_GETHASH))
+        if (!(s.GetType() & SER_GETHASH)) {
+            if (!ser_action.ForRead() && nSerVersion >= DBI_SER_VERSION_NO_MS && paidPayee)
+                nSerVersion = DBI_SER_VERSION_PAYEE;
             READWRITE(VARINT(nSerVersion));
+        }
 
         READWRITE(VARINT(nHeight));
         READWRITE(VARINT(nStatus));
@@ -338,6 +346,14 @@ public:
                 READWRITE(nMoneySupply);
             }
 
+            if (nSerVersion == DBI_SER_VERSION_PAYEE) {
+                // Only written once known
+                CScript payee = paidPayee ? *paidPayee : CScript();
+                READWRITE(*(CScriptBase*)(&payee));
+                if (ser_action.ForRead())
+                    paidPayee = payee;
+            }
+
         } else if (ser_action.ForRead()) {
             // Serialization with CLIENT_VERSION <= DBI_SER_VERSION_NO_MS
             int64_t nMint = 0;
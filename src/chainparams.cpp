@@ -172,6 +172,7 @@ public:
         consensus.nTargetTimespanV2 = 30 * 60;
         consensus.nTargetSpacing = 1 * 60;
         consensus.nTimeSlotLength = 15;
+        consensus.defaultAssumeValid = UINT256_ZERO;
 
         // spork keys
         consensus.strSporkPubKey = "0411d3c6927fc73a7712c176fc7f632d6fa598646a6934278d4324d25bc33740ba4d35056b414e214a590a2cfaa607d5b509fbab1ee199c1ac59cc71e1afadfd1c";
@@ -277,6 +278,7 @@ public:
         consensus.nTargetTimespanV2 = 30 * 60;
         consensus.nTargetSpacing = 1 * 60;
         consensus.nTimeSlotLength = 15;
+        consensus.defaultAssumeValid = UINT256_ZERO;
 
         // spork keys
         consensus.strSporkPubKey = "03ef91259425a39d0deba6190caebd9326800e6dbc140a41472bb2663d19680fcc";
@@ -363,6 +365,7 @@ public:
         consensus.nTargetTimespanV2 = 30 * 60;
         consensus.nTargetSpacing = 1 * 60;
         consensus.nTimeSlotLength = 15;
+        consensus.defaultAssumeValid = UINT256_ZERO;
 
         /* Spork Key for RegTest:
         WIF private key: 
@@ -63,8 +63,8 @@ public:
 
     /** Make miner wait to have peers to avoid wasting work */
     bool MiningRequiresPeers() const { return !IsRegTestNet(); }
-    /** Headers first syncing is disabled */
-    bool HeadersFirstSyncingActive() const { return false; };
+    /** Download the chain headers first from the peers supporting it */
+    bool HeadersFirstSyncingActive() const { return true; };
     /** Default value for -checkmempool and -checkblockindex argument */
     bool DefaultConsistencyChecks() const { return IsRegTestNet(); }
 
@@ -113,6 +113,17 @@ void CCoinsViewCache::SpendCoin(const COutPoint& outpoint, Coin* moveout)
 
 static const Coin coinEmpty;
 
+bool CCoinsViewCache::WarmCoin(const COutPoint& outpoint, Coin&& coin)
+{
+    if (coin.IsSpent())
+        return false;
+    std::pair<CCoinsMap::iterator, bool> ret = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(coin)));
+    if (!ret.second)
+        return false;
+    cachedCoinsUsage += memusage::DynamicUsage(ret.first->second.coin);
+    return true;
+}
+
 const Coin& CCoinsViewCache::AccessCoin(const COutPoint& outpoint) const
 {
     CCoinsMap::const_iterator it = FetchCoin(outpoint);
@@ -249,6 +260,22 @@ bool CCoinsViewCache::HaveInputs(const CTransaction& tx) const
     return true;
 }
 
+bool CCoinsViewCache::GetInputs(const CTransaction& tx, std::vector<const Coin*>& vCoins) const
+{
+    vCoins.clear();
+    if (tx.IsCoinBase())
+        return true;
+
+    vCoins.reserve(tx.vin.size());
+    for (const CTxIn& txin : tx.vin) {
+        CCoinsMap::const_iterator it = FetchCoin(txin.prevout);
+        if (it == cacheCoins.end() || it->second.coin.IsSpent())
+            return error("%s : invalid input %s", __func__, txin.prevout.ToString());
+        vCoins.push_back(&it->second.coin);
+    }
+    return true;
+}
+
 double CCoinsViewCache::GetPriority(const CTransaction& tx, int nHeight, CAmount &inChainInputValue) const
 {
     inChainInputValue = 0;
@@ -241,6 +241,13 @@ public:
      */
     void AddCoin(const COutPoint& outpoint, Coin&& coin, bool potential_overwrite);
 
+    /**
+     * Load into the cache a coin read from the backing view, as if it had been
+     * fetched by AccessCoin. Nothing is done if the cache has an entry for the
+     * outpoint already. Returns whether the coin was added.
+     */
+    bool WarmCoin(const COutPoint& outpoint, Coin&& coin);
+
     /**
      * Spend a coin. Pass moveto in order to get the deleted data.
      * If no unspent output exists for the passed outpoint, this call
@@ -279,6 +286,13 @@ public:
     //! Check whether all prevouts of the transaction are present in the UTXO set represented by this view
     bool HaveInputs(const CTransaction& tx) const;
 
+    /**
+     * Look up the coins spent by the transaction once, in the order of its inputs.
+     * False if one of them is missing or spent. The pointers stay valid until
+     * a coin is spent or the cache is flushed.
+     */
+    bool GetInputs(const CTransaction& tx, std::vector<const Coin*>& vCoins) const;
+
     /**
      * Return priority of tx at height nHeight. Also calculate the sum of the values of the inputs
      * that are already in the chain.  These are the inputs that will age and increase priority as
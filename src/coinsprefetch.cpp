@@ -0,0 +1,264 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "coinsprefetch.h"
+
+#include "main.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+
+/** Outpoints read by one thread at a time */
+static const size_t PREFETCH_RANGE_SIZE = 32;
+
+CCoinsPrefetcher coinsPrefetcher;
+
+void CCoinsPrefetcher::Start(CCoinsView* pbaseIn, int nThreads)
+{
+    Stop();
+    if (nThreads <= 0)
+        return;
+    std::unique_lock<std::mutex> lock(cs);
+    pbase = pbaseIn;
+    fStop = false;
+    for (int i = 0; i < nThreads; i++)
+        vThreads.emplace_back(&TraceThread<std::function<void()> >, "coinsprefetch", std::function<void()>(std::bind(&CCoinsPrefetcher::ThreadRead, this)));
+    LogPrintf("%s: %d threads\n", __func__, nThreads);
+}
+
+void CCoinsPrefetcher::Stop()
+{
+    std::vector<std::thread> vStopping;
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        fStop = true;
+        vStopping.swap(vThreads);
+    }
+    condWork.notify_all();
+    for (std::thread& t : vStopping)
+        t.join();
+
+    std::unique_lock<std::mutex> lock(cs);
+    listBlocks.clear();
+    pbase = nullptr;
+}
+
+void CCoinsPrefetcher::SetOutpoints(CPrefetchBlock& entry, const CBlock& block)
+{
+    // Outputs created in the block itself are not in the database yet
+    std::unordered_set<uint256, BlockHasher> setBlockTxs;
+    for (const CTransaction& tx : block.vtx)
+        setBlockTxs.insert(tx.GetHash());
+
+    entry.vOutpoints.clear();
+    for (const CTransaction& tx : block.vtx) {
+        if (tx.IsCoinBase())
+            continue;
+        for (const CTxIn& txin : tx.vin) {
+            if (!setBlockTxs.count(txin.prevout.hash))
+                entry.vOutpoints.push_back(txin.prevout);
+        }
+    }
+    entry.vCoins.clear();
+    entry.vCoins.resize(entry.vOutpoints.size());
+    entry.nNext = 0;
+    entry.fReady = true;
+}
+
+CCoinsPrefetcher::CPrefetchBlockRef CCoinsPrefetcher::Find(const uint256& hashBlock) const
+{
+    for (const CPrefetchBlockRef& pblock : listBlocks) {
+        if (pblock->hashBlock == hashBlock)
+            return pblock;
+    }
+    return nullptr;
+}
+
+CCoinsPrefetcher::CPrefetchBlockRef CCoinsPrefetcher::Add(const uint256& hashBlock)
+{
+    if (vThreads.empty() || Find(hashBlock))
+        return nullptr;
+
+    // Make room with the blocks that were never connected: those on a fork, or already connected
+    // by the time they were queued
+    if (listBlocks.size() >= MAX_PREFETCH_BLOCKS) {
+        const int64_t nNow = GetTime();
+        for (auto it = listBlocks.begin(); it != listBlocks.end() && listBlocks.size() >= MAX_PREFETCH_BLOCKS;) {
+            if ((*it)->nTimeAdded + PREFETCH_BLOCK_EXPIRE_TIME < nNow)
+                it = listBlocks.erase(it);
+            else
+                ++it;
+        }
+        if (listBlocks.size() >= MAX_PREFETCH_BLOCKS)
+            return nullptr;
+    }
+
+    CPrefetchBlockRef pblock = std::make_shared<CPrefetchBlock>();
+    pblock->hashBlock = hashBlock;
+    pblock->nTimeAdded = GetTime();
+    pblock->fReady = false;
+    pblock->fReading = false;
+    pblock->nNext = 0;
+    pblock->nPending = 0;
+    listBlocks.push_back(pblock);
+    return pblock;
+}
+
+void CCoinsPrefetcher::Prefetch(const CBlock& block)
+{
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        CPrefetchBlockRef pblock = Add(block.GetHash());
+        if (!pblock)
+            return;
+        SetOutpoints(*pblock, block);
+    }
+    condWork.notify_all();
+}
+
+void CCoinsPrefetcher::Prefetch(const uint256& hashBlock, const CDiskBlockPos& pos)
+{
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        CPrefetchBlockRef pblock = Add(hashBlock);
+        if (!pblock)
+            return;
+        pblock->pos = pos;
+    }
+    condWork.notify_all();
+}
+
+bool CCoinsPrefetcher::ReadRange(const CPrefetchBlockRef& pblock)
+{
+    size_t nBegin, nEnd;
+    uint64_t nEpochStart;
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        if (!pblock->fReady || pblock->nNext >= pblock->vOutpoints.size())
+            return false;
+        nBegin = pblock->nNext;
+        nEnd = std::min(nBegin + PREFETCH_RANGE_SIZE, pblock->vOutpoints.size());
+        pblock->nNext = nEnd;
+        pblock->nPending++;
+        nEpochStart = nEpoch;
+    }
+
+    // The database is thread safe, and the outpoints are not changed while nPending is set
+    std::vector<Coin> vCoins(nEnd - nBegin);
+    for (size_t i = nBegin; i < nEnd; i++)
+        pbase->GetCoin(pblock->vOutpoints[i], vCoins[i - nBegin]);
+
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        if (nEpochStart == nEpoch) {
+            for (size_t i = nBegin; i < nEnd; i++)
+                pblock->vCoins[i] = std::move(vCoins[i - nBegin]);
+        }
+        pblock->nPending--;
+    }
+    condDone.notify_all();
+    return true;
+}
+
+void CCoinsPrefetcher::ThreadRead()
+{
+    while (true) {
+        CPrefetchBlockRef pblock;
+        bool fReadBlock = false;
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            while (!fStop) {
+                for (const CPrefetchBlockRef& pentry : listBlocks) {
+                    if (!pentry->fReady && !pentry->fReading) {
+                        pentry->fReading = true;
+                        fReadBlock = true;
+                        pblock = pentry;
+                        break;
+                    }
+                    if (pentry->fReady && pentry->nNext < pentry->vOutpoints.size()) {
+                        pblock = pentry;
+                        break;
+                    }
+                }
+                if (pblock)
+                    break;
+                condWork.wait(lock);
+            }
+            if (fStop)
+                return;
+        }
+
+        if (fReadBlock) {
+            CBlock block;
+            const bool fRead = ReadBlockFromDisk(block, pblock->pos);
+            {
+                std::unique_lock<std::mutex> lock(cs);
+                pblock->fReading = false;
+                // Apply may have set the outpoints from its own copy meanwhile
+                if (!pblock->fReady) {
+                    if (fRead && block.GetHash() == pblock->hashBlock)
+                        SetOutpoints(*pblock, block);
+                    else
+                        listBlocks.remove(pblock);
+                }
+            }
+            condWork.notify_all();
+            condDone.notify_all();
+            continue;
+        }
+
+        ReadRange(pblock);
+    }
+}
+
+size_t CCoinsPrefetcher::Apply(const CBlock& block, CCoinsViewCache& view)
+{
+    const uint256 hashBlock = block.GetHash();
+    CPrefetchBlockRef pblock;
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        pblock = Find(hashBlock);
+        if (!pblock)
+            pblock = Add(hashBlock);
+        if (!pblock)
+            return 0;
+        if (!pblock->fReady)
+            SetOutpoints(*pblock, block);
+    }
+    condWork.notify_all();
+
+    // Read along with the threads, then wait for their last ranges
+    while (ReadRange(pblock)) {}
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        while (pblock->nPending > 0)
+            condDone.wait(lock);
+        listBlocks.remove(pblock);
+    }
+
+    size_t nAdded = 0;
+    for (size_t i = 0; i < pblock->vOutpoints.size(); i++) {
+        if (view.WarmCoin(pblock->vOutpoints[i], std::move(pblock->vCoins[i])))
+            nAdded++;
+    }
+    return nAdded;
+}
+
+void CCoinsPrefetcher::Invalidate()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    nEpoch++;
+    for (const CPrefetchBlockRef& pblock : listBlocks) {
+        if (!pblock->fReady)
+            continue;
+        pblock->vCoins.clear();
+        pblock->vCoins.resize(pblock->vOutpoints.size());
+        pblock->nNext = 0;
+    }
+    if (!listBlocks.empty())
+        condWork.notify_all();
+}
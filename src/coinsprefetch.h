@@ -0,0 +1,103 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DECENOMY_COINSPREFETCH_H
+#define DECENOMY_COINSPREFETCH_H
+
+#include "chain.h"
+#include "coins.h"
+#include "primitives/block.h"
+#include "uint256.h"
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Default for -prefetchthreads, the number of threads reading the coins spent by upcoming blocks */
+static const int DEFAULT_PREFETCH_THREADS = 4;
+/** Maximum for -prefetchthreads */
+static const int MAX_PREFETCH_THREADS = 16;
+/** Maximum number of blocks whose coins are queued or held for ConnectBlock */
+static const size_t MAX_PREFETCH_BLOCKS = 64;
+/** Seconds after which an unused block can make room for a new one */
+static const int64_t PREFETCH_BLOCK_EXPIRE_TIME = 60;
+
+/**
+ * Reads from the coins database, on a pool of threads, the coins spent by
+ * the blocks about to be connected, so that ConnectBlock finds them in
+ * pcoinsTip instead of going to disk one input at a time under cs_main.
+ *
+ * A coin read from the database is still the current one as long as the
+ * database is not written: FlushStateToDisk calls Invalidate around the
+ * write, which makes the blocks queued so far read again, and Apply never
+ * replaces an entry that pcoinsTip has already.
+ */
+class CCoinsPrefetcher
+{
+public:
+    ~CCoinsPrefetcher() { Stop(); }
+
+    /** Start nThreads threads reading from pbaseIn, the view below pcoinsTip */
+    void Start(CCoinsView* pbaseIn, int nThreads);
+    void Stop();
+
+    /** Queue the reads of the coins spent by block */
+    void Prefetch(const CBlock& block);
+    /** Queue the read of the block stored at pos, then of the coins it spends */
+    void Prefetch(const uint256& hashBlock, const CDiskBlockPos& pos);
+
+    /**
+     * Load into view the coins spent by block, taking part in the reads still
+     * queued and waiting for those in flight. Returns the number of coins added.
+     * Requires cs_main.
+     */
+    size_t Apply(const CBlock& block, CCoinsViewCache& view);
+
+    /** The coins database is being written: the coins read so far are read again. Requires cs_main */
+    void Invalidate();
+
+private:
+    struct CPrefetchBlock {
+        uint256 hashBlock;
+        CDiskBlockPos pos;
+        int64_t nTimeAdded;
+        //! Whether vOutpoints is known, otherwise the block is still to be read from pos
+        bool fReady;
+        bool fReading;
+        std::vector<COutPoint> vOutpoints;
+        std::vector<Coin> vCoins;
+        //! First outpoint not handed to a reader yet
+        size_t nNext;
+        //! Ranges of outpoints being read
+        int nPending;
+    };
+    typedef std::shared_ptr<CPrefetchBlock> CPrefetchBlockRef;
+
+    std::mutex cs;
+    std::condition_variable condWork;
+    std::condition_variable condDone;
+    std::list<CPrefetchBlockRef> listBlocks;
+    std::vector<std::thread> vThreads;
+    CCoinsView* pbase = nullptr;
+    bool fStop = false;
+    //! Bumped by Invalidate, reads started under an older epoch are dropped
+    uint64_t nEpoch = 0;
+
+    void ThreadRead();
+    //! Read the next range of outpoints of pblock, returns false if there was none
+    bool ReadRange(const CPrefetchBlockRef& pblock);
+    //! Queue a block, or return nullptr if there is no room. Requires cs
+    CPrefetchBlockRef Add(const uint256& hashBlock);
+    //! Requires cs
+    CPrefetchBlockRef Find(const uint256& hashBlock) const;
+    //! Set the outpoints of pblock from block. Requires cs
+    static void SetOutpoints(CPrefetchBlock& entry, const CBlock& block);
+};
+
+extern CCoinsPrefetcher coinsPrefetcher;
+
+#endif // DECENOMY_COINSPREFETCH_H
@@ -4,9 +4,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "merkle.h"
+#include "crypto/sha256.h"
 #include "hash.h"
 #include "utilstrencodings.h"
 
+#include <assert.h>
+
 /*     WARNING! If you're reading this because you're learning about crypto
        and/or designing a new system that will use merkle trees, keep in mind
        that the following merkle tree algorithm has a serious flaw related to
@@ -39,7 +42,7 @@
        root.
 */
 
-/* This implements a constant-space merkle root/path calculator, limited to 2^32 leaves. */
+/* This implements a constant-space merkle root/path calculator, limited to 2^32 leaves. Only used for branches, see ComputeMerkleRoot. */
 static void MerkleComputation(const std::vector<uint256>& leaves, uint256* proot, bool* pmutated, uint32_t branchpos, std::vector<uint256>* pbranch) {
     if (pbranch) pbranch->clear();
     if (leaves.size() == 0) {
@@ -127,10 +130,66 @@ static void MerkleComputation(const std::vector<uint256>& leaves, uint256* proot
     if (proot) *proot = h;
 }
 
-uint256 ComputeMerkleRoot(const std::vector<uint256>& leaves, bool* mutated) {
-    uint256 hash;
-    MerkleComputation(leaves, &hash, mutated, -1, NULL);
-    return hash;
+uint256 ComputeMerkleRoot(std::vector<uint256> hashes, bool* mutated) {
+    bool mutation = false;
+    while (hashes.size() > 1) {
+        if (mutated) {
+            for (size_t pos = 0; pos + 1 < hashes.size(); pos += 2) {
+                if (hashes[pos] == hashes[pos + 1]) mutation = true;
+            }
+        }
+        if (hashes.size() & 1) {
+            hashes.push_back(hashes.back());
+        }
+        // uint256 is a plain 32-byte blob, so each pair is one 64-byte input
+        // and the level can be hashed in place.
+        SHA256D64(hashes[0].begin(), hashes[0].begin(), hashes.size() / 2);
+        hashes.resize(hashes.size() / 2);
+    }
+    if (mutated) *mutated = mutation;
+    if (hashes.size() == 0) return uint256();
+    return hashes[0];
+}
+
+void CBlockMerkleTree::Build(std::vector<uint256> leaves)
+{
+    vLevels.clear();
+    nMutatedPairs = 0;
+    if (leaves.empty()) return;
+    vLevels.push_back(std::move(leaves));
+    std::vector<uint256> buf;
+    while (vLevels.back().size() > 1) {
+        const std::vector<uint256>& level = vLevels.back();
+        for (size_t pos = 0; pos + 1 < level.size(); pos += 2) {
+            if (level[pos] == level[pos + 1]) nMutatedPairs++;
+        }
+        buf.assign(level.begin(), level.end());
+        if (buf.size() & 1) {
+            buf.push_back(buf.back());
+        }
+        SHA256D64(buf[0].begin(), buf[0].begin(), buf.size() / 2);
+        buf.resize(buf.size() / 2);
+        vLevels.push_back(buf);
+    }
+}
+
+void CBlockMerkleTree::UpdateLeaf(size_t pos, const uint256& leaf)
+{
+    assert(pos < GetLeafCount());
+    uint256 h = leaf;
+    for (size_t l = 0; l < vLevels.size(); l++) {
+        std::vector<uint256>& level = vLevels[l];
+        const size_t sibling = pos ^ 1;
+        const bool fPaired = sibling < level.size();
+        if (fPaired && level[pos] == level[sibling]) nMutatedPairs--;
+        level[pos] = h;
+        if (fPaired && level[pos] == level[sibling]) nMutatedPairs++;
+        if (l + 1 == vLevels.size()) break;
+        const uint256& left = level[pos & ~(size_t)1];
+        const uint256& right = fPaired ? level[pos | 1] : left;
+        CHash256().Write(left.begin(), 32).Write(right.begin(), 32).Finalize(h.begin());
+        pos >>= 1;
+    }
 }
 
 std::vector<uint256> ComputeMerkleBranch(const std::vector<uint256>& leaves, uint32_t position) {
@@ -152,22 +211,22 @@ uint256 ComputeMerkleRootFromBranch(const uint256& leaf, const std::vector<uint2
     return hash;
 }
 
-uint256 BlockMerkleRoot(const CBlock& block, bool* mutated)
+std::vector<uint256> BlockMerkleLeaves(const CBlock& block)
 {
     std::vector<uint256> leaves;
     leaves.resize(block.vtx.size());
     for (size_t s = 0; s < block.vtx.size(); s++) {
         leaves[s] = block.vtx[s].GetHash();
     }
-    return ComputeMerkleRoot(leaves, mutated);
+    return leaves;
+}
+
+uint256 BlockMerkleRoot(const CBlock& block, bool* mutated)
+{
+    return ComputeMerkleRoot(BlockMerkleLeaves(block), mutated);
 }
 
 std::vector<uint256> BlockMerkleBranch(const CBlock& block, uint32_t position)
 {
-    std::vector<uint256> leaves;
-    leaves.resize(block.vtx.size());
-    for (size_t s = 0; s < block.vtx.size(); s++) {
-        leaves[s] = block.vtx[s].GetHash();
-    }
-    return ComputeMerkleBranch(leaves, position);
-}
\ No newline at end of file
+    return ComputeMerkleBranch(BlockMerkleLeaves(block), position);
+}
@@ -13,10 +13,48 @@
 #include "primitives/block.h"
 #include "uint256.h"
 
-uint256 ComputeMerkleRoot(const std::vector<uint256>& leaves, bool* mutated = NULL);
+/*
+ * Compute the Merkle root of a list of leaves, one tree level at a time, with
+ * all the pairs of a level hashed in a single SHA256D64 call.
+ * *mutated is set to true if a duplicated subtree was found.
+ */
+uint256 ComputeMerkleRoot(std::vector<uint256> leaves, bool* mutated = NULL);
 std::vector<uint256> ComputeMerkleBranch(const std::vector<uint256>& leaves, uint32_t position);
 uint256 ComputeMerkleRootFromBranch(const uint256& leaf, const std::vector<uint256>& branch, uint32_t position);
 
+/*
+ * Merkle tree that keeps all its levels, so that replacing one leaf only
+ * rehashes the log(n) nodes on its path to the root. Block assembly uses it
+ * to swap the coinbase or the coinstake (leaf 0 or 1) without rebuilding the
+ * whole tree. The root and the mutation flag always match ComputeMerkleRoot
+ * over the current leaves.
+ */
+class CBlockMerkleTree
+{
+public:
+    CBlockMerkleTree() : nMutatedPairs(0) {}
+    explicit CBlockMerkleTree(std::vector<uint256> leaves) { Build(std::move(leaves)); }
+
+    /** Rebuild every level from scratch */
+    void Build(std::vector<uint256> leaves);
+    /** Replace the leaf at position pos and rehash its path to the root */
+    void UpdateLeaf(size_t pos, const uint256& leaf);
+
+    uint256 GetRoot() const { return vLevels.empty() ? uint256() : vLevels.back()[0]; }
+    /** True if a duplicated subtree is present, see ComputeMerkleRoot */
+    bool IsMutated() const { return nMutatedPairs > 0; }
+    size_t GetLeafCount() const { return vLevels.empty() ? 0 : vLevels[0].size(); }
+
+private:
+    /** vLevels[0] holds the leaves and vLevels.back() the root, odd levels are not padded */
+    std::vector<std::vector<uint256> > vLevels;
+    /** Number of pairs, over all levels, made of two identical hashes */
+    size_t nMutatedPairs;
+};
+
+/* The transaction hashes of a block, in Merkle leaf order */
+std::vector<uint256> BlockMerkleLeaves(const CBlock& block);
+
 /*
  * Compute the Merkle root of the transactions in a block.
  * *mutated is set to true if a duplicated subtree was found.
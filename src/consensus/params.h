@@ -86,6 +86,10 @@ struct NetworkUpgrade {
  */
 struct Params {
     uint256 hashGenesisBlock;
+    /** Default for -assumevalid, the scripts of its ancestors are not checked. Zero to check them all, as every network ships */
+    uint256 defaultAssumeValid;
+    /** Content hashes of the published UTXO snapshots (dumptxoutset) by base block, checked by -loadutxosnapshot */
+    std::map<uint256, uint256> mUTXOSnapshots = {};
     bool fPowAllowMinDifficultyBlocks;
     uint256 powLimit;
     uint256 posLimitV1;
@@ -11,6 +11,7 @@
 
 class CBlockIndex;
 class CCoinsViewCache;
+class Coin;
 class CTransaction;
 class CValidationState;
 
@@ -34,6 +35,8 @@ unsigned int GetLegacySigOpCount(const CTransaction& tx);
  * @see CTransaction::FetchInputs
  */
 unsigned int GetP2SHSigOpCount(const CTransaction& tx, const CCoinsViewCache& mapInputs);
+/** Same, from the coins spent by tx as returned by CCoinsViewCache::GetInputs */
+unsigned int GetP2SHSigOpCount(const CTransaction& tx, const std::vector<const Coin*>& vCoins);
 
 /**
  * Check if transaction is final and can be included in a block with the
@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
 
 /** A hasher class for SHA-256. */
 class CSHA256
@@ -27,4 +28,28 @@ public:
     CSHA256& Reset();
 };
 
+namespace sha256_implementation
+{
+/** Backends SHA256AutoDetect may select, mostly useful to benchmark each of them */
+enum UseImplementation : uint8_t {
+    STANDARD = 0,
+    USE_SSE41 = 1 << 0,
+    USE_AVX2 = 1 << 1,
+    USE_SHANI = 1 << 2,
+    USE_ALL = USE_SSE41 | USE_AVX2 | USE_SHANI,
+};
+} // namespace sha256_implementation
+
+/** Autodetect the best available SHA256 implementation, among the allowed ones.
+ *  Returns the name of the implementation. Must not race with other hashing threads.
+ */
+std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implementation = sha256_implementation::USE_ALL);
+
+/** Compute multiple double-SHA256's of 64-byte blobs.
+ *  output:  pointer to a blocks*32 byte output buffer
+ *  input:   pointer to a blocks*64 byte input buffer
+ *  blocks:  the number of hashes to compute.
+ */
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
@@ -0,0 +1,44 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/pivx-config.h"
+#endif
+
+#ifdef ENABLE_AVX2
+
+#include "crypto/sha256_d64_impl.h"
+
+#include <immintrin.h>
+
+namespace sha256d64_avx2
+{
+namespace
+{
+/** Eight lanes per 256-bit register */
+struct Ops {
+    typedef __m256i V;
+    static const int LANES = 8;
+
+    static inline V Set1(uint32_t x) { return _mm256_set1_epi32((int)x); }
+    static inline V Load(const uint32_t* w) { return _mm256_loadu_si256((const __m256i*)w); }
+    static inline void Store(uint32_t* w, V x) { _mm256_storeu_si256((__m256i*)w, x); }
+    static inline V Add(V a, V b) { return _mm256_add_epi32(a, b); }
+    static inline V Xor(V a, V b) { return _mm256_xor_si256(a, b); }
+    static inline V Or(V a, V b) { return _mm256_or_si256(a, b); }
+    static inline V And(V a, V b) { return _mm256_and_si256(a, b); }
+    template <int n>
+    static inline V ShR(V x) { return _mm256_srli_epi32(x, n); }
+    template <int n>
+    static inline V ShL(V x) { return _mm256_slli_epi32(x, n); }
+};
+} // namespace
+
+void Transform_8way(unsigned char* out, const unsigned char* in)
+{
+    sha256_d64_impl::TransformD64<Ops>(out, in);
+}
+} // namespace sha256d64_avx2
+
+#endif
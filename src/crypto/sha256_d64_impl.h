@@ -0,0 +1,126 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DECENOMY_CRYPTO_SHA256_D64_IMPL_H
+#define DECENOMY_CRYPTO_SHA256_D64_IMPL_H
+
+// Lane generic double SHA-256 of 64-byte messages.
+//
+// Only meant to be included by the translation units that provide a backend.
+// The kernel is a template on an Ops type that describes a vector of 32-bit
+// lanes:
+//
+//   typedef ... V;                        vector of LANES 32-bit words
+//   static const int LANES;
+//   static V Set1(uint32_t x);            broadcast
+//   static V Load(const uint32_t* w);     w[i] goes to lane i
+//   static void Store(uint32_t* w, V x);
+//   static V Add(V a, V b), Xor(V a, V b), Or(V a, V b), And(V a, V b)
+//   template <int n> static V ShR(V x), ShL(V x); 0 < n < 32
+
+#include "crypto/common.h"
+
+#include <stdint.h>
+
+namespace sha256_d64_impl
+{
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static const uint32_t IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+template <int n, typename Ops>
+inline typename Ops::V Rotr(typename Ops::V x) { return Ops::Or(Ops::template ShR<n>(x), Ops::template ShL<32 - n>(x)); }
+
+template <typename Ops>
+inline typename Ops::V Ch(typename Ops::V x, typename Ops::V y, typename Ops::V z) { return Ops::Xor(z, Ops::And(x, Ops::Xor(y, z))); }
+template <typename Ops>
+inline typename Ops::V Maj(typename Ops::V x, typename Ops::V y, typename Ops::V z) { return Ops::Or(Ops::And(x, y), Ops::And(z, Ops::Or(x, y))); }
+template <typename Ops>
+inline typename Ops::V Sigma0(typename Ops::V x) { return Ops::Xor(Ops::Xor(Rotr<2, Ops>(x), Rotr<13, Ops>(x)), Rotr<22, Ops>(x)); }
+template <typename Ops>
+inline typename Ops::V Sigma1(typename Ops::V x) { return Ops::Xor(Ops::Xor(Rotr<6, Ops>(x), Rotr<11, Ops>(x)), Rotr<25, Ops>(x)); }
+template <typename Ops>
+inline typename Ops::V sigma0(typename Ops::V x) { return Ops::Xor(Ops::Xor(Rotr<7, Ops>(x), Rotr<18, Ops>(x)), Ops::template ShR<3>(x)); }
+template <typename Ops>
+inline typename Ops::V sigma1(typename Ops::V x) { return Ops::Xor(Ops::Xor(Rotr<17, Ops>(x), Rotr<19, Ops>(x)), Ops::template ShR<10>(x)); }
+
+/** 64 rounds of SHA-256 over the block w, expanded in place, added into s */
+template <typename Ops>
+void Compress(typename Ops::V s[8], typename Ops::V w[16])
+{
+    typedef typename Ops::V V;
+    V a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+    for (int i = 0; i < 64; i++) {
+        if (i >= 16) {
+            w[i & 15] = Ops::Add(Ops::Add(w[i & 15], sigma1<Ops>(w[(i + 14) & 15])), Ops::Add(w[(i + 9) & 15], sigma0<Ops>(w[(i + 1) & 15])));
+        }
+        const V t1 = Ops::Add(Ops::Add(Ops::Add(h, Sigma1<Ops>(e)), Ops::Add(Ch<Ops>(e, f, g), Ops::Set1(K[i]))), w[i & 15]);
+        const V t2 = Ops::Add(Sigma0<Ops>(a), Maj<Ops>(a, b, c));
+        h = g;
+        g = f;
+        f = e;
+        e = Ops::Add(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = Ops::Add(t1, t2);
+    }
+    s[0] = Ops::Add(s[0], a);
+    s[1] = Ops::Add(s[1], b);
+    s[2] = Ops::Add(s[2], c);
+    s[3] = Ops::Add(s[3], d);
+    s[4] = Ops::Add(s[4], e);
+    s[5] = Ops::Add(s[5], f);
+    s[6] = Ops::Add(s[6], g);
+    s[7] = Ops::Add(s[7], h);
+}
+
+/** Double SHA-256 of LANES consecutive 64-byte inputs into LANES consecutive 32-byte outputs */
+template <typename Ops>
+void TransformD64(unsigned char* out, const unsigned char* in)
+{
+    typedef typename Ops::V V;
+    V s[8], w[16];
+    uint32_t tmp[Ops::LANES];
+
+    for (int i = 0; i < 16; i++) {
+        for (int l = 0; l < Ops::LANES; l++) tmp[l] = ReadBE32(in + 64 * l + 4 * i);
+        w[i] = Ops::Load(tmp);
+    }
+    for (int i = 0; i < 8; i++) s[i] = Ops::Set1(IV[i]);
+    Compress<Ops>(s, w);
+
+    // Padding block of a 64-byte message
+    w[0] = Ops::Set1(0x80000000);
+    for (int i = 1; i < 15; i++) w[i] = Ops::Set1(0);
+    w[15] = Ops::Set1(512);
+    Compress<Ops>(s, w);
+
+    // Second hash, over the 32-byte digest
+    for (int i = 0; i < 8; i++) {
+        w[i] = s[i];
+        s[i] = Ops::Set1(IV[i]);
+    }
+    w[8] = Ops::Set1(0x80000000);
+    for (int i = 9; i < 15; i++) w[i] = Ops::Set1(0);
+    w[15] = Ops::Set1(256);
+    Compress<Ops>(s, w);
+
+    for (int i = 0; i < 8; i++) {
+        Ops::Store(tmp, s[i]);
+        for (int l = 0; l < Ops::LANES; l++) WriteBE32(out + 32 * l + 4 * i, tmp[l]);
+    }
+}
+} // namespace sha256_d64_impl
+
+#endif // DECENOMY_CRYPTO_SHA256_D64_IMPL_H
@@ -0,0 +1,91 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// Based on the public domain SHA-NI reference flow by Intel and Sean Gulley.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/pivx-config.h"
+#endif
+
+#ifdef ENABLE_SHANI
+
+#include "crypto/sha256_d64_impl.h"
+
+#include <immintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sha256_shani
+{
+namespace
+{
+/** Load 16 big endian message bytes as four 32-bit words */
+inline __m128i Load(const unsigned char* in)
+{
+    const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)in), MASK);
+}
+
+/**
+ * Rounds 4q to 4q+3. The message schedule is kept in m[4], where m[q % 4]
+ * holds the words of the current quad: sha256msg1 and sha256msg2 prepare
+ * the quads that are consumed one and three steps later.
+ */
+template <int q>
+inline void QuadRound(__m128i& s0, __m128i& s1, __m128i m[4], const unsigned char* chunk)
+{
+    if (q < 4) m[q] = Load(chunk + 16 * q);
+    const __m128i msg = _mm_add_epi32(m[q % 4], _mm_loadu_si128((const __m128i*)(sha256_d64_impl::K + 4 * q)));
+    s1 = _mm_sha256rnds2_epu32(s1, s0, msg);
+    if (q >= 3 && q <= 14) {
+        m[(q + 1) % 4] = _mm_sha256msg2_epu32(_mm_add_epi32(m[(q + 1) % 4], _mm_alignr_epi8(m[q % 4], m[(q + 3) % 4], 4)), m[q % 4]);
+    }
+    s0 = _mm_sha256rnds2_epu32(s0, s1, _mm_shuffle_epi32(msg, 0x0e));
+    if (q >= 1 && q <= 12) {
+        m[(q + 3) % 4] = _mm_sha256msg1_epu32(m[(q + 3) % 4], m[q % 4]);
+    }
+}
+} // namespace
+
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    // From a b c d / e f g h to the ABEF / CDGH layout of sha256rnds2
+    __m128i t1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)s), 0xB1);
+    __m128i t2 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(s + 4)), 0x1B);
+    __m128i s0 = _mm_alignr_epi8(t1, t2, 0x08);
+    __m128i s1 = _mm_blend_epi16(t2, t1, 0xF0);
+
+    __m128i m[4];
+    while (blocks--) {
+        const __m128i so0 = s0, so1 = s1;
+        QuadRound<0>(s0, s1, m, chunk);
+        QuadRound<1>(s0, s1, m, chunk);
+        QuadRound<2>(s0, s1, m, chunk);
+        QuadRound<3>(s0, s1, m, chunk);
+        QuadRound<4>(s0, s1, m, chunk);
+        QuadRound<5>(s0, s1, m, chunk);
+        QuadRound<6>(s0, s1, m, chunk);
+        QuadRound<7>(s0, s1, m, chunk);
+        QuadRound<8>(s0, s1, m, chunk);
+        QuadRound<9>(s0, s1, m, chunk);
+        QuadRound<10>(s0, s1, m, chunk);
+        QuadRound<11>(s0, s1, m, chunk);
+        QuadRound<12>(s0, s1, m, chunk);
+        QuadRound<13>(s0, s1, m, chunk);
+        QuadRound<14>(s0, s1, m, chunk);
+        QuadRound<15>(s0, s1, m, chunk);
+        s0 = _mm_add_epi32(s0, so0);
+        s1 = _mm_add_epi32(s1, so1);
+        chunk += 64;
+    }
+
+    // Back to a b c d / e f g h
+    t1 = _mm_shuffle_epi32(s0, 0x1B);
+    t2 = _mm_shuffle_epi32(s1, 0xB1);
+    _mm_storeu_si128((__m128i*)s, _mm_blend_epi16(t1, t2, 0xF0));
+    _mm_storeu_si128((__m128i*)(s + 4), _mm_alignr_epi8(t2, t1, 0x08));
+}
+} // namespace sha256_shani
+
+#endif
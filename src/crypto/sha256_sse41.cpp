@@ -0,0 +1,44 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/pivx-config.h"
+#endif
+
+#ifdef ENABLE_SSE41
+
+#include "crypto/sha256_d64_impl.h"
+
+#include <immintrin.h>
+
+namespace sha256d64_sse41
+{
+namespace
+{
+/** Four lanes per 128-bit register */
+struct Ops {
+    typedef __m128i V;
+    static const int LANES = 4;
+
+    static inline V Set1(uint32_t x) { return _mm_set1_epi32((int)x); }
+    static inline V Load(const uint32_t* w) { return _mm_loadu_si128((const __m128i*)w); }
+    static inline void Store(uint32_t* w, V x) { _mm_storeu_si128((__m128i*)w, x); }
+    static inline V Add(V a, V b) { return _mm_add_epi32(a, b); }
+    static inline V Xor(V a, V b) { return _mm_xor_si128(a, b); }
+    static inline V Or(V a, V b) { return _mm_or_si128(a, b); }
+    static inline V And(V a, V b) { return _mm_and_si128(a, b); }
+    template <int n>
+    static inline V ShR(V x) { return _mm_srli_epi32(x, n); }
+    template <int n>
+    static inline V ShL(V x) { return _mm_slli_epi32(x, n); }
+};
+} // namespace
+
+void Transform_4way(unsigned char* out, const unsigned char* in)
+{
+    sha256_d64_impl::TransformD64<Ops>(out, in);
+}
+} // namespace sha256d64_sse41
+
+#endif
@@ -0,0 +1,103 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/pivx-config.h"
+#endif
+
+#include "crypto/sph_x4.h"
+
+#include "compat/cpuid.h"
+#include "crypto/sph_x4_impl.h"
+
+namespace sph_x4_sse41
+{
+void Blake512(unsigned char* const out[4], const unsigned char* const in[4], size_t len);
+void Keccak512(unsigned char* const out[4], const unsigned char* const in[4], size_t len);
+void Skein512(unsigned char* const out[4], const unsigned char* const in[4], size_t len);
+}
+
+namespace sph_x4_avx2
+{
+void Blake512(unsigned char* const out[4], const unsigned char* const in[4], size_t len);
+void Keccak512(unsigned char* const out[4], const unsigned char* const in[4], size_t len);
+void Skein512(unsigned char* const out[4], const unsigned char* const in[4], size_t len);
+}
+
+namespace
+{
+/** Portable fallback: one lane per vector */
+struct ScalarOps {
+    typedef uint64_t V;
+    static const int LANES = 1;
+
+    static inline V Set1(uint64_t x) { return x; }
+    static inline V Load(const uint64_t* w) { return w[0]; }
+    static inline void Store(uint64_t* w, V x) { w[0] = x; }
+    static inline V Add(V a, V b) { return a + b; }
+    static inline V Xor(V a, V b) { return a ^ b; }
+    static inline V Or(V a, V b) { return a | b; }
+    static inline V AndNot(V a, V b) { return ~a & b; }
+    template <int n>
+    static inline V Rotr(V x) { return (x >> n) | (x << (64 - n)); }
+};
+
+typedef void (*X4Function)(unsigned char* const out[4], const unsigned char* const in[4], size_t len);
+
+X4Function Blake512X4 = sph_x4_impl::Blake512<ScalarOps>;
+X4Function Keccak512X4 = sph_x4_impl::Keccak512<ScalarOps>;
+X4Function Skein512X4 = sph_x4_impl::Skein512<ScalarOps>;
+} // namespace
+
+std::string SphX4AutoDetect()
+{
+    std::string ret = "standard";
+#if defined(HAVE_GETCPUID)
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    const bool have_sse41 = (ecx >> 19) & 1;
+    bool have_avx2 = false;
+    if (AVXEnabled()) {
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+    }
+
+#if defined(ENABLE_SSE41)
+    if (have_sse41) {
+        Blake512X4 = sph_x4_sse41::Blake512;
+        Keccak512X4 = sph_x4_sse41::Keccak512;
+        Skein512X4 = sph_x4_sse41::Skein512;
+        ret = "sse41(2way)";
+    }
+#endif
+
+#if defined(ENABLE_AVX2)
+    if (have_avx2) {
+        Blake512X4 = sph_x4_avx2::Blake512;
+        Keccak512X4 = sph_x4_avx2::Keccak512;
+        Skein512X4 = sph_x4_avx2::Skein512;
+        ret = "avx2(4way)";
+    }
+#endif
+
+    (void)have_sse41;
+    (void)have_avx2;
+#endif
+    return ret;
+}
+
+void sph_blake512_x4(unsigned char* const out[4], const unsigned char* const in[4], size_t len)
+{
+    Blake512X4(out, in, len);
+}
+
+void sph_keccak512_x4(unsigned char* const out[4], const unsigned char* const in[4], size_t len)
+{
+    Keccak512X4(out, in, len);
+}
+
+void sph_skein512_x4(unsigned char* const out[4], const unsigned char* const in[4], size_t len)
+{
+    Skein512X4(out, in, len);
+}
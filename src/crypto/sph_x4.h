@@ -0,0 +1,35 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DECENOMY_CRYPTO_SPH_X4_H
+#define DECENOMY_CRYPTO_SPH_X4_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+/**
+ * Multi-lane versions of the sph 512-bit hashes used by X11KV.
+ *
+ * Each call hashes four independent messages of the same length and writes
+ * four 64-byte digests, bit for bit identical to the scalar sph functions.
+ * Messages must fit in a single block, which covers the 80-byte headers and
+ * the 64-byte intermediate hashes of X11KV. out[i] may be the same buffer as
+ * in[i].
+ */
+
+/** Number of messages hashed by a single multi-lane call */
+static const int SPH_X4_LANES = 4;
+
+/** sph_blake512 of four messages of at most 111 bytes */
+void sph_blake512_x4(unsigned char* const out[4], const unsigned char* const in[4], size_t len);
+/** sph_keccak512 of four messages of at most 71 bytes */
+void sph_keccak512_x4(unsigned char* const out[4], const unsigned char* const in[4], size_t len);
+/** sph_skein512 of four messages of 1 to 64 bytes */
+void sph_skein512_x4(unsigned char* const out[4], const unsigned char* const in[4], size_t len);
+
+/** Autodetect the best available multi-lane implementation. Returns its name. */
+std::string SphX4AutoDetect();
+
+#endif // DECENOMY_CRYPTO_SPH_X4_H
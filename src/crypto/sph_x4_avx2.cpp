@@ -0,0 +1,61 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/pivx-config.h"
+#endif
+
+#ifdef ENABLE_AVX2
+
+#include "crypto/sph_x4_impl.h"
+
+#include <immintrin.h>
+
+namespace sph_x4_avx2
+{
+namespace
+{
+/** Four lanes per 256-bit register, a single run of the kernel per call */
+struct Ops {
+    typedef __m256i V;
+    static const int LANES = 4;
+
+    static inline V Set1(uint64_t x) { return _mm256_set1_epi64x((long long)x); }
+    static inline V Load(const uint64_t* w) { return _mm256_loadu_si256((const __m256i*)w); }
+    static inline void Store(uint64_t* w, V x) { _mm256_storeu_si256((__m256i*)w, x); }
+    static inline V Add(V a, V b) { return _mm256_add_epi64(a, b); }
+    static inline V Xor(V a, V b) { return _mm256_xor_si256(a, b); }
+    static inline V Or(V a, V b) { return _mm256_or_si256(a, b); }
+    static inline V AndNot(V a, V b) { return _mm256_andnot_si256(a, b); }
+    template <int n>
+    static inline V Rotr(V x) { return _mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64 - n)); }
+};
+
+template <>
+inline Ops::V Ops::Rotr<32>(V x) { return _mm256_shuffle_epi32(x, 0xB1); }
+template <>
+inline Ops::V Ops::Rotr<16>(V x)
+{
+    return _mm256_shuffle_epi8(x, _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+                                                   2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9));
+}
+} // namespace
+
+void Blake512(unsigned char* const out[4], const unsigned char* const in[4], size_t len)
+{
+    sph_x4_impl::Blake512<Ops>(out, in, len);
+}
+
+void Keccak512(unsigned char* const out[4], const unsigned char* const in[4], size_t len)
+{
+    sph_x4_impl::Keccak512<Ops>(out, in, len);
+}
+
+void Skein512(unsigned char* const out[4], const unsigned char* const in[4], size_t len)
+{
+    sph_x4_impl::Skein512<Ops>(out, in, len);
+}
+} // namespace sph_x4_avx2
+
+#endif
@@ -0,0 +1,365 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DECENOMY_CRYPTO_SPH_X4_IMPL_H
+#define DECENOMY_CRYPTO_SPH_X4_IMPL_H
+
+// Lane generic implementation of the multi-lane sph functions.
+//
+// Only meant to be included by the translation units that provide a backend.
+// The kernels are templates on an Ops type that describes a vector of 64-bit
+// lanes:
+//
+//   typedef ... V;                        vector of LANES 64-bit words
+//   static const int LANES;
+//   static V Set1(uint64_t x);            broadcast
+//   static V Load(const uint64_t* w);     w[i] goes to lane i
+//   static void Store(uint64_t* w, V x);
+//   static V Add(V a, V b), Xor(V a, V b), Or(V a, V b), AndNot(V a, V b) (~a & b)
+//   template <int n> static V Rotr(V x); 0 < n < 64
+
+#include "crypto/common.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace sph_x4_impl
+{
+template <int n, typename Ops>
+inline typename Ops::V Rotr(typename Ops::V x) { return Ops::template Rotr<n>(x); }
+template <int n, typename Ops>
+inline typename Ops::V Rotl(typename Ops::V x) { return Ops::template Rotr<64 - n>(x); }
+
+/** Transpose word i of every lane in [base, base + LANES) into a vector */
+template <typename Ops>
+inline typename Ops::V Gather(const uint64_t (*words)[16], int base, int i)
+{
+    uint64_t w[Ops::LANES];
+    for (int l = 0; l < Ops::LANES; l++) w[l] = words[base + l][i];
+    return Ops::Load(w);
+}
+
+template <typename Ops>
+inline void Scatter(uint64_t (*words)[16], int base, int i, typename Ops::V x)
+{
+    uint64_t w[Ops::LANES];
+    Ops::Store(w, x);
+    for (int l = 0; l < Ops::LANES; l++) words[base + l][i] = w[l];
+}
+
+namespace blake512
+{
+static const uint64_t IV[8] = {
+    0x6A09E667F3BCC908ULL, 0xBB67AE8584CAA73BULL, 0x3C6EF372FE94F82BULL, 0xA54FF53A5F1D36F1ULL,
+    0x510E527FADE682D1ULL, 0x9B05688C2B3E6C1FULL, 0x1F83D9ABFB41BD6BULL, 0x5BE0CD19137E2179ULL};
+
+static const uint64_t CB[16] = {
+    0x243F6A8885A308D3ULL, 0x13198A2E03707344ULL, 0xA4093822299F31D0ULL, 0x082EFA98EC4E6C89ULL,
+    0x452821E638D01377ULL, 0xBE5466CF34E90C6CULL, 0xC0AC29B7C97C50DDULL, 0x3F84D5B5B5470917ULL,
+    0x9216D5D98979FB1BULL, 0xD1310BA698DFB5ACULL, 0x2FFD72DBD01ADFB7ULL, 0xB8E1AFED6A267E96ULL,
+    0xBA7C9045F12C7F99ULL, 0x24A19947B3916CF7ULL, 0x0801F2E2858EFC16ULL, 0x636920D871574E69ULL};
+
+static const unsigned char SIGMA[10][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0}};
+
+template <typename Ops>
+inline void G(typename Ops::V& a, typename Ops::V& b, typename Ops::V& c, typename Ops::V& d, const typename Ops::V* m, const unsigned char* s, int i)
+{
+    a = Ops::Add(Ops::Add(a, b), Ops::Xor(m[s[2 * i]], Ops::Set1(CB[s[2 * i + 1]])));
+    d = Rotr<32, Ops>(Ops::Xor(d, a));
+    c = Ops::Add(c, d);
+    b = Rotr<25, Ops>(Ops::Xor(b, c));
+    a = Ops::Add(Ops::Add(a, b), Ops::Xor(m[s[2 * i + 1]], Ops::Set1(CB[s[2 * i]])));
+    d = Rotr<16, Ops>(Ops::Xor(d, a));
+    c = Ops::Add(c, d);
+    b = Rotr<11, Ops>(Ops::Xor(b, c));
+}
+
+/** Compress one block into the initial chaining value, with a zero salt and a 64-bit counter */
+template <typename Ops>
+void Compress(typename Ops::V h[8], const typename Ops::V m[16], uint64_t t0)
+{
+    typedef typename Ops::V V;
+    V v[16];
+    for (int i = 0; i < 8; i++) v[i] = h[i];
+    for (int i = 0; i < 4; i++) v[8 + i] = Ops::Set1(CB[i]);
+    v[12] = Ops::Set1(t0 ^ CB[4]);
+    v[13] = Ops::Set1(t0 ^ CB[5]);
+    v[14] = Ops::Set1(CB[6]);
+    v[15] = Ops::Set1(CB[7]);
+
+    for (int r = 0; r < 16; r++) {
+        const unsigned char* s = SIGMA[r % 10];
+        G<Ops>(v[0], v[4], v[8], v[12], m, s, 0);
+        G<Ops>(v[1], v[5], v[9], v[13], m, s, 1);
+        G<Ops>(v[2], v[6], v[10], v[14], m, s, 2);
+        G<Ops>(v[3], v[7], v[11], v[15], m, s, 3);
+        G<Ops>(v[0], v[5], v[10], v[15], m, s, 4);
+        G<Ops>(v[1], v[6], v[11], v[12], m, s, 5);
+        G<Ops>(v[2], v[7], v[8], v[13], m, s, 6);
+        G<Ops>(v[3], v[4], v[9], v[14], m, s, 7);
+    }
+
+    for (int i = 0; i < 8; i++) h[i] = Ops::Xor(h[i], Ops::Xor(v[i], v[i + 8]));
+}
+} // namespace blake512
+
+namespace keccak512
+{
+static const uint64_t RC[24] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808AULL, 0x8000000080008000ULL,
+    0x000000000000808BULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+    0x000000000000008AULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000AULL,
+    0x000000008000808BULL, 0x800000000000008BULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+    0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800AULL, 0x800000008000000AULL,
+    0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL};
+
+template <typename Ops>
+inline void Theta(typename Ops::V* row, const typename Ops::V* d)
+{
+    row[0] = Ops::Xor(row[0], d[0]);
+    row[1] = Ops::Xor(row[1], d[1]);
+    row[2] = Ops::Xor(row[2], d[2]);
+    row[3] = Ops::Xor(row[3], d[3]);
+    row[4] = Ops::Xor(row[4], d[4]);
+}
+
+template <typename Ops>
+inline void Chi(typename Ops::V* row, const typename Ops::V* b)
+{
+    row[0] = Ops::Xor(b[0], Ops::AndNot(b[1], b[2]));
+    row[1] = Ops::Xor(b[1], Ops::AndNot(b[2], b[3]));
+    row[2] = Ops::Xor(b[2], Ops::AndNot(b[3], b[4]));
+    row[3] = Ops::Xor(b[3], Ops::AndNot(b[4], b[0]));
+    row[4] = Ops::Xor(b[4], Ops::AndNot(b[0], b[1]));
+}
+
+/** The Keccak-f[1600] permutation, a[x + 5 * y] */
+template <typename Ops>
+void Permute(typename Ops::V a[25])
+{
+    typedef typename Ops::V V;
+    V b[25], c[5], d[5];
+    for (int r = 0; r < 24; r++) {
+        // Theta
+        c[0] = Ops::Xor(Ops::Xor(Ops::Xor(a[0], a[5]), Ops::Xor(a[10], a[15])), a[20]);
+        c[1] = Ops::Xor(Ops::Xor(Ops::Xor(a[1], a[6]), Ops::Xor(a[11], a[16])), a[21]);
+        c[2] = Ops::Xor(Ops::Xor(Ops::Xor(a[2], a[7]), Ops::Xor(a[12], a[17])), a[22]);
+        c[3] = Ops::Xor(Ops::Xor(Ops::Xor(a[3], a[8]), Ops::Xor(a[13], a[18])), a[23]);
+        c[4] = Ops::Xor(Ops::Xor(Ops::Xor(a[4], a[9]), Ops::Xor(a[14], a[19])), a[24]);
+        d[0] = Ops::Xor(c[4], Rotl<1, Ops>(c[1]));
+        d[1] = Ops::Xor(c[0], Rotl<1, Ops>(c[2]));
+        d[2] = Ops::Xor(c[1], Rotl<1, Ops>(c[3]));
+        d[3] = Ops::Xor(c[2], Rotl<1, Ops>(c[4]));
+        d[4] = Ops::Xor(c[3], Rotl<1, Ops>(c[0]));
+        Theta<Ops>(a + 0, d);
+        Theta<Ops>(a + 5, d);
+        Theta<Ops>(a + 10, d);
+        Theta<Ops>(a + 15, d);
+        Theta<Ops>(a + 20, d);
+
+        // Rho and pi: b[y + 5 * ((2 * x + 3 * y) % 5)] = rotl(a[x + 5 * y], r[x + 5 * y])
+        b[0] = a[0];
+        b[10] = Rotl<1, Ops>(a[1]);
+        b[20] = Rotl<62, Ops>(a[2]);
+        b[5] = Rotl<28, Ops>(a[3]);
+        b[15] = Rotl<27, Ops>(a[4]);
+        b[16] = Rotl<36, Ops>(a[5]);
+        b[1] = Rotl<44, Ops>(a[6]);
+        b[11] = Rotl<6, Ops>(a[7]);
+        b[21] = Rotl<55, Ops>(a[8]);
+        b[6] = Rotl<20, Ops>(a[9]);
+        b[7] = Rotl<3, Ops>(a[10]);
+        b[17] = Rotl<10, Ops>(a[11]);
+        b[2] = Rotl<43, Ops>(a[12]);
+        b[12] = Rotl<25, Ops>(a[13]);
+        b[22] = Rotl<39, Ops>(a[14]);
+        b[23] = Rotl<41, Ops>(a[15]);
+        b[8] = Rotl<45, Ops>(a[16]);
+        b[18] = Rotl<15, Ops>(a[17]);
+        b[3] = Rotl<21, Ops>(a[18]);
+        b[13] = Rotl<8, Ops>(a[19]);
+        b[14] = Rotl<18, Ops>(a[20]);
+        b[24] = Rotl<2, Ops>(a[21]);
+        b[9] = Rotl<61, Ops>(a[22]);
+        b[19] = Rotl<56, Ops>(a[23]);
+        b[4] = Rotl<14, Ops>(a[24]);
+
+        // Chi
+        Chi<Ops>(a + 0, b + 0);
+        Chi<Ops>(a + 5, b + 5);
+        Chi<Ops>(a + 10, b + 10);
+        Chi<Ops>(a + 15, b + 15);
+        Chi<Ops>(a + 20, b + 20);
+
+        // Iota
+        a[0] = Ops::Xor(a[0], Ops::Set1(RC[r]));
+    }
+}
+} // namespace keccak512
+
+namespace skein512
+{
+/** Chaining value after the configuration block of Skein-512-512 */
+static const uint64_t IV[8] = {
+    0x4903ADFF749C51CEULL, 0x0D95DE399746DF03ULL, 0x8FD1934127C79BCEULL, 0x9A255629FF352CB1ULL,
+    0x5DB62599DF6CA7B0ULL, 0xEABE394CA9D5C3F4ULL, 0x991112C71A75B523ULL, 0xAE18A40B660FCC33ULL};
+
+static const uint64_t C240 = 0x1BD11BDAA9FC1A22ULL;
+static const uint64_t T1_FIRST = 1ULL << 62;
+static const uint64_t T1_FINAL = 1ULL << 63;
+static const uint64_t T1_MSG = 48ULL << 56;
+static const uint64_t T1_OUT = 63ULL << 56;
+
+template <int r, typename Ops>
+inline void Mix(typename Ops::V& a, typename Ops::V& b)
+{
+    a = Ops::Add(a, b);
+    b = Ops::Xor(Rotl<r, Ops>(b), a);
+}
+
+/** One UBI block: h = Threefish-512(key = h, tweak = (t0, t1), m) ^ m */
+template <typename Ops>
+void UBI(typename Ops::V h[8], const typename Ops::V m[8], uint64_t t0, uint64_t t1)
+{
+    typedef typename Ops::V V;
+    const uint64_t t[3] = {t0, t1, t0 ^ t1};
+    V k[9];
+    k[8] = Ops::Set1(C240);
+    for (int i = 0; i < 8; i++) {
+        k[i] = h[i];
+        k[8] = Ops::Xor(k[8], h[i]);
+    }
+
+    V x[8];
+    for (int i = 0; i < 8; i++) x[i] = m[i];
+
+    for (int s = 0; s <= 18; s++) {
+        // Subkey injection
+        for (int i = 0; i < 8; i++) x[i] = Ops::Add(x[i], k[(s + i) % 9]);
+        x[5] = Ops::Add(x[5], Ops::Set1(t[s % 3]));
+        x[6] = Ops::Add(x[6], Ops::Set1(t[(s + 1) % 3]));
+        x[7] = Ops::Add(x[7], Ops::Set1((uint64_t)s));
+        if (s == 18) break;
+
+        // Four rounds, the word permutation folded into the choice of pairs
+        if ((s & 1) == 0) {
+            Mix<46, Ops>(x[0], x[1]); Mix<36, Ops>(x[2], x[3]); Mix<19, Ops>(x[4], x[5]); Mix<37, Ops>(x[6], x[7]);
+            Mix<33, Ops>(x[2], x[1]); Mix<27, Ops>(x[4], x[7]); Mix<14, Ops>(x[6], x[5]); Mix<42, Ops>(x[0], x[3]);
+            Mix<17, Ops>(x[4], x[1]); Mix<49, Ops>(x[6], x[3]); Mix<36, Ops>(x[0], x[5]); Mix<39, Ops>(x[2], x[7]);
+            Mix<44, Ops>(x[6], x[1]); Mix<9, Ops>(x[0], x[7]); Mix<54, Ops>(x[2], x[5]); Mix<56, Ops>(x[4], x[3]);
+        } else {
+            Mix<39, Ops>(x[0], x[1]); Mix<30, Ops>(x[2], x[3]); Mix<34, Ops>(x[4], x[5]); Mix<24, Ops>(x[6], x[7]);
+            Mix<13, Ops>(x[2], x[1]); Mix<50, Ops>(x[4], x[7]); Mix<10, Ops>(x[6], x[5]); Mix<17, Ops>(x[0], x[3]);
+            Mix<25, Ops>(x[4], x[1]); Mix<29, Ops>(x[6], x[3]); Mix<39, Ops>(x[0], x[5]); Mix<43, Ops>(x[2], x[7]);
+            Mix<8, Ops>(x[6], x[1]); Mix<35, Ops>(x[0], x[7]); Mix<56, Ops>(x[2], x[5]); Mix<22, Ops>(x[4], x[3]);
+        }
+    }
+
+    for (int i = 0; i < 8; i++) h[i] = Ops::Xor(x[i], m[i]);
+}
+} // namespace skein512
+
+/** sph_blake512 of four messages of len <= 111 bytes, a single padded block each */
+template <typename Ops>
+void Blake512(unsigned char* const out[4], const unsigned char* const in[4], size_t len)
+{
+    typedef typename Ops::V V;
+    assert(len <= 111);
+
+    uint64_t words[4][16];
+    for (int l = 0; l < 4; l++) {
+        unsigned char block[128] = {0};
+        memcpy(block, in[l], len);
+        block[len] = 0x80;
+        block[111] |= 0x01;
+        WriteBE64(block + 120, (uint64_t)len << 3);
+        for (int i = 0; i < 16; i++) words[l][i] = ReadBE64(block + 8 * i);
+    }
+
+    for (int base = 0; base < 4; base += Ops::LANES) {
+        V m[16], h[8];
+        for (int i = 0; i < 16; i++) m[i] = Gather<Ops>(words, base, i);
+        for (int i = 0; i < 8; i++) h[i] = Ops::Set1(blake512::IV[i]);
+        blake512::Compress<Ops>(h, m, (uint64_t)len << 3);
+        for (int i = 0; i < 8; i++) Scatter<Ops>(words, base, i, h[i]);
+    }
+
+    for (int l = 0; l < 4; l++) {
+        for (int i = 0; i < 8; i++) WriteBE64(out[l] + 8 * i, words[l][i]);
+    }
+}
+
+/** sph_keccak512 of four messages of len <= 71 bytes, a single padded block each */
+template <typename Ops>
+void Keccak512(unsigned char* const out[4], const unsigned char* const in[4], size_t len)
+{
+    typedef typename Ops::V V;
+    assert(len <= 71);
+
+    uint64_t words[4][16];
+    for (int l = 0; l < 4; l++) {
+        unsigned char block[72] = {0};
+        memcpy(block, in[l], len);
+        block[len] ^= 0x01;
+        block[71] ^= 0x80;
+        for (int i = 0; i < 9; i++) words[l][i] = ReadLE64(block + 8 * i);
+    }
+
+    for (int base = 0; base < 4; base += Ops::LANES) {
+        V a[25];
+        for (int i = 0; i < 9; i++) a[i] = Gather<Ops>(words, base, i);
+        for (int i = 9; i < 25; i++) a[i] = Ops::Set1(0);
+        keccak512::Permute<Ops>(a);
+        for (int i = 0; i < 8; i++) Scatter<Ops>(words, base, i, a[i]);
+    }
+
+    for (int l = 0; l < 4; l++) {
+        for (int i = 0; i < 8; i++) WriteLE64(out[l] + 8 * i, words[l][i]);
+    }
+}
+
+/** sph_skein512 of four messages of 1 to 64 bytes, a single message block each */
+template <typename Ops>
+void Skein512(unsigned char* const out[4], const unsigned char* const in[4], size_t len)
+{
+    typedef typename Ops::V V;
+    assert(len >= 1 && len <= 64);
+
+    uint64_t words[4][16];
+    for (int l = 0; l < 4; l++) {
+        unsigned char block[64] = {0};
+        memcpy(block, in[l], len);
+        for (int i = 0; i < 8; i++) words[l][i] = ReadLE64(block + 8 * i);
+    }
+
+    for (int base = 0; base < 4; base += Ops::LANES) {
+        V m[8], h[8], zero[8];
+        for (int i = 0; i < 8; i++) {
+            m[i] = Gather<Ops>(words, base, i);
+            h[i] = Ops::Set1(skein512::IV[i]);
+            zero[i] = Ops::Set1(0);
+        }
+        skein512::UBI<Ops>(h, m, len, skein512::T1_FIRST | skein512::T1_FINAL | skein512::T1_MSG);
+        skein512::UBI<Ops>(h, zero, 8, skein512::T1_FIRST | skein512::T1_FINAL | skein512::T1_OUT);
+        for (int i = 0; i < 8; i++) Scatter<Ops>(words, base, i, h[i]);
+    }
+
+    for (int l = 0; l < 4; l++) {
+        for (int i = 0; i < 8; i++) WriteLE64(out[l] + 8 * i, words[l][i]);
+    }
+}
+} // namespace sph_x4_impl
+
+#endif // DECENOMY_CRYPTO_SPH_X4_IMPL_H
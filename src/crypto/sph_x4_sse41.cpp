@@ -0,0 +1,57 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/pivx-config.h"
+#endif
+
+#ifdef ENABLE_SSE41
+
+#include "crypto/sph_x4_impl.h"
+
+#include <immintrin.h>
+
+namespace sph_x4_sse41
+{
+namespace
+{
+/** Two lanes per 128-bit register, each call runs the kernel twice */
+struct Ops {
+    typedef __m128i V;
+    static const int LANES = 2;
+
+    static inline V Set1(uint64_t x) { return _mm_set1_epi64x((long long)x); }
+    static inline V Load(const uint64_t* w) { return _mm_set_epi64x((long long)w[1], (long long)w[0]); }
+    static inline void Store(uint64_t* w, V x) { _mm_storeu_si128((__m128i*)w, x); }
+    static inline V Add(V a, V b) { return _mm_add_epi64(a, b); }
+    static inline V Xor(V a, V b) { return _mm_xor_si128(a, b); }
+    static inline V Or(V a, V b) { return _mm_or_si128(a, b); }
+    static inline V AndNot(V a, V b) { return _mm_andnot_si128(a, b); }
+    template <int n>
+    static inline V Rotr(V x) { return _mm_or_si128(_mm_srli_epi64(x, n), _mm_slli_epi64(x, 64 - n)); }
+};
+
+template <>
+inline Ops::V Ops::Rotr<32>(V x) { return _mm_shuffle_epi32(x, 0xB1); }
+template <>
+inline Ops::V Ops::Rotr<16>(V x) { return _mm_shuffle_epi8(x, _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9)); }
+} // namespace
+
+void Blake512(unsigned char* const out[4], const unsigned char* const in[4], size_t len)
+{
+    sph_x4_impl::Blake512<Ops>(out, in, len);
+}
+
+void Keccak512(unsigned char* const out[4], const unsigned char* const in[4], size_t len)
+{
+    sph_x4_impl::Keccak512<Ops>(out, in, len);
+}
+
+void Skein512(unsigned char* const out[4], const unsigned char* const in[4], size_t len)
+{
+    sph_x4_impl::Skein512<Ops>(out, in, len);
+}
+} // namespace sph_x4_sse41
+
+#endif
@@ -0,0 +1,288 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "hashx11kvs.h"
+
+#include "crypto/sha256.h"
+#include "crypto/sph_x4.h"
+#include "random.h"
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+#include <vector>
+
+CX11KVSCache::KeyHasher::KeyHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+CX11KVSCache::CX11KVSCache(size_t nMaxEntriesIn) : nMaxEntries(nMaxEntriesIn), nHits(0), nMisses(0), nEvictions(0) {}
+
+void CX11KVSCache::SetMaxEntries(size_t nMaxEntriesIn)
+{
+    nMaxEntries = nMaxEntriesIn;
+    Clear();
+}
+
+bool CX11KVSCache::Lookup(const uint256& prefix, uint32_t nonce, unsigned int level, uint256& hashRet, bool fCountMiss)
+{
+    if (nMaxEntries == 0) return false;
+
+    const Key key{prefix, nonce, level};
+    Shard& shard = GetShard(key);
+    {
+        std::lock_guard<std::mutex> lock(shard.cs);
+        auto it = shard.mapCurrent.find(key);
+        if (it != shard.mapCurrent.end()) {
+            hashRet = it->second;
+            nHits++;
+            return true;
+        }
+        it = shard.mapPrevious.find(key);
+        if (it != shard.mapPrevious.end()) {
+            // Promote to the current generation so it survives the next rotation
+            hashRet = it->second;
+            shard.mapCurrent.emplace(key, hashRet);
+            shard.mapPrevious.erase(it);
+            nHits++;
+            return true;
+        }
+    }
+    if (fCountMiss) nMisses++;
+    return false;
+}
+
+void CX11KVSCache::Insert(const uint256& prefix, uint32_t nonce, unsigned int level, const uint256& hash)
+{
+    // Each shard holds at most two generations of half its share of the bound
+    const size_t nMaxGeneration = nMaxEntries / (2 * NUM_SHARDS);
+    if (nMaxGeneration == 0) return;
+
+    const Key key{prefix, nonce, level};
+    Shard& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.cs);
+    if (shard.mapCurrent.size() >= nMaxGeneration) {
+        nEvictions += shard.mapPrevious.size();
+        shard.mapPrevious.clear();
+        shard.mapPrevious.swap(shard.mapCurrent);
+    }
+    shard.mapCurrent.emplace(key, hash);
+}
+
+void CX11KVSCache::Clear()
+{
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.cs);
+        shard.mapCurrent.clear();
+        shard.mapPrevious.clear();
+    }
+}
+
+CX11KVSCache::Stats CX11KVSCache::GetStats() const
+{
+    Stats stats;
+    stats.nHits = nHits;
+    stats.nMisses = nMisses;
+    stats.nEvictions = nEvictions;
+    stats.nEntries = 0;
+    for (const Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.cs);
+        stats.nEntries += shard.mapCurrent.size() + shard.mapPrevious.size();
+    }
+    return stats;
+}
+
+void CX11KVSCache::ResetStats()
+{
+    nHits = 0;
+    nMisses = 0;
+    nEvictions = 0;
+}
+
+uint256 GetX11KVSPrefixId(const unsigned char* header)
+{
+    uint256 id;
+    CSHA256().Write(header, 76).Finalize(id.begin());
+    return id;
+}
+
+typedef void (*X4Function)(unsigned char* const out[4], const unsigned char* const in[4], size_t len);
+
+/**
+ * Apply one X11KV iteration of the given algorithm to the listed lanes, in
+ * groups of SPH_X4_LANES. A short last group is padded by repeating its last
+ * lane, and a single leftover lane goes through the scalar code.
+ */
+static void HashX11KVLanes(unsigned int algo, X4Function fn, std::vector<uint512>& vState, const std::vector<size_t>& vLanes)
+{
+    size_t i = 0;
+    if (fn) {
+        for (; i + 1 < vLanes.size(); i += SPH_X4_LANES) {
+            unsigned char* p[SPH_X4_LANES];
+            for (int l = 0; l < SPH_X4_LANES; l++) {
+                p[l] = vState[vLanes[std::min(i + l, vLanes.size() - 1)]].begin();
+            }
+            fn(p, p, 64);
+        }
+    }
+    for (; i < vLanes.size(); i++) {
+        HashX11KVIteration(algo, vState[vLanes[i]]);
+    }
+}
+
+void HashX11KVBatch(const unsigned char* const headers[], size_t count, uint256 hashesRet[])
+{
+    std::vector<uint512> vState(count);
+
+    // Iteration 0 is blake512 of the header for every lane
+    for (size_t i = 0; i < count; i += SPH_X4_LANES) {
+        const unsigned char* in[SPH_X4_LANES];
+        unsigned char* out[SPH_X4_LANES];
+        for (int l = 0; l < SPH_X4_LANES; l++) {
+            const size_t lane = std::min(i + l, count - 1);
+            in[l] = headers[lane];
+            out[l] = vState[lane].begin();
+        }
+        sph_blake512_x4(out, in, 80);
+    }
+
+    std::vector<unsigned int> vIterations(count);
+    for (size_t i = 0; i < count; i++) {
+        vIterations[i] = HASHX11KV_MIN_NUMBER_ITERATIONS + (vState[i].begin()[63] % (HASHX11KV_MAX_NUMBER_ITERATIONS - HASHX11KV_MIN_NUMBER_ITERATIONS + 1));
+    }
+
+    // Every following iteration groups the lanes by the algorithm they run
+    std::vector<size_t> vLanes[HASHX11KV_NUMBER_ALGOS];
+    for (unsigned int it = 1; it < HASHX11KV_MAX_NUMBER_ITERATIONS; it++) {
+        for (std::vector<size_t>& v : vLanes) v.clear();
+        for (size_t i = 0; i < count; i++) {
+            if (it < vIterations[i]) vLanes[vState[i].begin()[it % 64] % HASHX11KV_NUMBER_ALGOS].push_back(i);
+        }
+        for (unsigned int algo = 0; algo < HASHX11KV_NUMBER_ALGOS; algo++) {
+            X4Function fn = nullptr;
+            if (algo == 0) fn = sph_blake512_x4;
+            if (algo == 3) fn = sph_skein512_x4;
+            if (algo == 5) fn = sph_keccak512_x4;
+            HashX11KVLanes(algo, fn, vState, vLanes[algo]);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        hashesRet[i] = vState[i].trim256();
+    }
+}
+
+/**
+ * Breadth first evaluation of the X11KVS tree: the X11KV of every node of a
+ * depth is computed by a single HashX11KVBatch call, then the nodes are
+ * combined bottom up. Subtrees found in the cache are not expanded.
+ */
+static uint256 HashX11KVSTree(const unsigned char* header, unsigned int level, CX11KVSCache* pcache, const uint256& prefix)
+{
+    struct Node {
+        uint32_t nonce;
+        unsigned int level;
+        bool fDone;
+        uint256 hash;   // X11KV of the node header
+        uint256 result; // X11KVS of the subtree
+        size_t nChild;  // index of the first of the two children
+    };
+
+    std::vector<Node> vNodes;
+    vNodes.reserve((size_t(1) << level) - 1);
+    vNodes.push_back(Node{le32dec(header + 76), level, false, uint256(), uint256(), 0});
+
+    std::vector<size_t> vPending;
+    std::vector<unsigned char> vHeaders;
+    std::vector<const unsigned char*> vHeaderPtrs;
+    std::vector<uint256> vHashes;
+
+    size_t nBegin = 0;
+    while (nBegin < vNodes.size()) {
+        const size_t nEnd = vNodes.size();
+
+        vPending.clear();
+        for (size_t i = nBegin; i < nEnd; i++) {
+            Node& node = vNodes[i];
+            // a node missing at both levels counts as a single miss
+            const bool fFallback = node.level != HASHX11KVS_MIN_LEVEL;
+            if (pcache && pcache->Lookup(prefix, node.nonce, node.level, node.result, !fFallback)) {
+                node.fDone = true;
+                continue;
+            }
+            if (pcache && fFallback && pcache->Lookup(prefix, node.nonce, HASHX11KVS_MIN_LEVEL, node.hash)) continue;
+            vPending.push_back(i);
+        }
+
+        if (!vPending.empty()) {
+            vHeaders.resize(vPending.size() * 80);
+            vHeaderPtrs.resize(vPending.size());
+            vHashes.resize(vPending.size());
+            for (size_t j = 0; j < vPending.size(); j++) {
+                unsigned char* nodeheader = &vHeaders[j * 80];
+                memcpy(nodeheader, header, 76);
+                le32enc(nodeheader + 76, vNodes[vPending[j]].nonce);
+                vHeaderPtrs[j] = nodeheader;
+            }
+            HashX11KVBatch(vHeaderPtrs.data(), vPending.size(), vHashes.data());
+            for (size_t j = 0; j < vPending.size(); j++) {
+                Node& node = vNodes[vPending[j]];
+                node.hash = vHashes[j];
+                if (pcache) pcache->Insert(prefix, node.nonce, HASHX11KVS_MIN_LEVEL, node.hash);
+            }
+        }
+
+        for (size_t i = nBegin; i < nEnd; i++) {
+            if (vNodes[i].fDone) continue;
+            if (vNodes[i].level == HASHX11KVS_MIN_LEVEL) {
+                vNodes[i].result = vNodes[i].hash;
+                vNodes[i].fDone = true;
+                continue;
+            }
+            const uint32_t nonce = vNodes[i].nonce;
+            const unsigned int nextlevel = vNodes[i].level - 1;
+            const uint32_t nextnonce1 = nonce + (le32dec(vNodes[i].hash.begin() + 24) % HASHX11KVS_MAX_DRIFT);
+            const uint32_t nextnonce2 = nonce + (le32dec(vNodes[i].hash.begin() + 28) % HASHX11KVS_MAX_DRIFT);
+            vNodes[i].nChild = vNodes.size();
+            vNodes.push_back(Node{nextnonce1, nextlevel, false, uint256(), uint256(), 0});
+            vNodes.push_back(Node{nextnonce2, nextlevel, false, uint256(), uint256(), 0});
+        }
+
+        nBegin = nEnd;
+    }
+
+    // Children always come after their parent
+    for (size_t i = vNodes.size(); i-- > 0;) {
+        Node& node = vNodes[i];
+        if (node.fDone) continue;
+        const uint256& hash1 = vNodes[node.nChild].result;
+        const uint256& hash2 = vNodes[node.nChild + 1].result;
+        node.result = Hash(
+            node.hash.begin(), node.hash.begin() + node.hash.size(),
+            hash1.begin(), hash1.begin() + hash1.size(),
+            hash2.begin(), hash2.begin() + hash2.size());
+        if (pcache) pcache->Insert(prefix, node.nonce, node.level, node.result);
+    }
+
+    return vNodes[0].result;
+}
+
+uint256 HashX11KVSBatched(const unsigned char* header, unsigned int level)
+{
+    return HashX11KVSTree(header, level, nullptr, uint256());
+}
+
+uint256 HashX11KVSCached(const unsigned char* header, CX11KVSCache& cache, unsigned int level)
+{
+    return HashX11KVSTree(header, level, &cache, GetX11KVSPrefixId(header));
+}
+
+uint256 HashX11KVSCached(const unsigned char* header, const uint256& prefix, CX11KVSCache& cache, unsigned int level)
+{
+    return HashX11KVSTree(header, level, &cache, prefix);
+}
+
+CX11KVSCache& GetX11KVSCache()
+{
+    static CX11KVSCache cache((DEFAULT_X11KVS_CACHE_SIZE << 20) / CX11KVSCache::ENTRY_SIZE);
+    return cache;
+}
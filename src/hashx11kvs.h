@@ -0,0 +1,143 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DECENOMY_HASHX11KVS_H
+#define DECENOMY_HASHX11KVS_H
+
+#include "hash.h"
+#include "uint256.h"
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <unordered_map>
+
+/** Default size of the shared X11KVS subtree cache, in megabytes */
+static const int64_t DEFAULT_X11KVS_CACHE_SIZE = 16;
+
+/**
+ * Bounded, thread-safe memo table for HashX11KVS subtrees.
+ *
+ * Every node of the X11KVS tree only depends on the constant 76-byte header
+ * prefix, on the nonce of that node and on its remaining level, so results are
+ * stored under (prefix id, nonce, level). Level 1 entries are the plain
+ * HashX11KV of a header and are shared by all the levels above them.
+ *
+ * The table is split in shards to keep lock contention low, and each shard
+ * keeps two generations of entries: once the current one is full the previous
+ * one is dropped, which approximates LRU eviction without per-entry bookkeeping.
+ */
+class CX11KVSCache
+{
+public:
+    struct Stats {
+        uint64_t nHits;
+        uint64_t nMisses;
+        uint64_t nEvictions;
+        size_t nEntries;
+
+        double HitRate() const { return (nHits + nMisses) ? (double)nHits / (nHits + nMisses) : 0.0; }
+    };
+
+    explicit CX11KVSCache(size_t nMaxEntriesIn);
+
+    /** Change the size bound, dropping everything cached so far */
+    void SetMaxEntries(size_t nMaxEntriesIn);
+    /** Change the size bound to roughly nBytes of memory */
+    void SetMaxSize(size_t nBytes) { SetMaxEntries(nBytes / ENTRY_SIZE); }
+    size_t GetMaxEntries() const { return nMaxEntries; }
+
+    /** fCountMiss false when the caller falls back to another lookup, which counts the miss */
+    bool Lookup(const uint256& prefix, uint32_t nonce, unsigned int level, uint256& hashRet, bool fCountMiss = true);
+    void Insert(const uint256& prefix, uint32_t nonce, unsigned int level, const uint256& hash);
+
+    void Clear();
+    Stats GetStats() const;
+    void ResetStats();
+
+    /** Approximate memory used by a single entry, including hash table overhead */
+    static const size_t ENTRY_SIZE = 128;
+
+private:
+    static const int NUM_SHARDS = 16;
+
+    struct Key {
+        uint256 prefix;
+        uint32_t nonce;
+        uint32_t level;
+
+        bool operator==(const Key& other) const
+        {
+            return nonce == other.nonce && level == other.level && prefix == other.prefix;
+        }
+    };
+
+    class KeyHasher
+    {
+    private:
+        /** Salt */
+        uint64_t k0, k1;
+
+    public:
+        KeyHasher();
+
+        size_t operator()(const Key& key) const
+        {
+            return SipHashUint256Extra(k0, k1, key.prefix, key.nonce ^ (key.level << 24));
+        }
+    };
+
+    typedef std::unordered_map<Key, uint256, KeyHasher> EntryMap;
+
+    struct Shard {
+        mutable std::mutex cs;
+        EntryMap mapCurrent;
+        EntryMap mapPrevious;
+    };
+
+    Shard shards[NUM_SHARDS];
+    KeyHasher hasher;
+    std::atomic<size_t> nMaxEntries;
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+    std::atomic<uint64_t> nEvictions;
+
+    Shard& GetShard(const Key& key) { return shards[hasher(key) % NUM_SHARDS]; }
+};
+
+/** Identifier of the constant part (the first 76 bytes) of an 80-byte header */
+uint256 GetX11KVSPrefixId(const unsigned char* header);
+
+/**
+ * HashX11KV of count independent 80-byte headers. At every iteration the
+ * headers that run the same algorithm are hashed together through the
+ * multi-lane sph functions where one exists (blake512, skein512, keccak512).
+ * Bit for bit identical to calling HashX11KV on each header.
+ */
+void HashX11KVBatch(const unsigned char* const headers[], size_t count, uint256 hashesRet[]);
+
+/**
+ * HashX11KVS of a serialized 80-byte header, evaluating all the nodes of a
+ * tree depth together through HashX11KVBatch.
+ * Bit for bit identical to HashX11KVS(header, header + 80, level).
+ */
+uint256 HashX11KVSBatched(const unsigned char* header, unsigned int level = HASHX11KVS_MAX_LEVEL);
+
+/**
+ * HashX11KVS of a serialized 80-byte header, reusing the subtrees already
+ * present in the cache and storing the ones it has to compute.
+ * Bit for bit identical to HashX11KVS(header, header + 80, level).
+ */
+uint256 HashX11KVSCached(const unsigned char* header, CX11KVSCache& cache, unsigned int level = HASHX11KVS_MAX_LEVEL);
+
+/**
+ * Same as above, with the prefix identifier of the header already known.
+ * Nonce scanning computes it once per header template.
+ */
+uint256 HashX11KVSCached(const unsigned char* header, const uint256& prefix, CX11KVSCache& cache, unsigned int level = HASHX11KVS_MAX_LEVEL);
+
+/** Cache shared by block header hashing */
+CX11KVSCache& GetX11KVSCache();
+
+#endif // DECENOMY_HASHX11KVS_H
@@ -20,10 +20,16 @@
 #include "activemasternodeconfig.h"
 #include "addrman.h"
 #include "amount.h"
+#include "blockcache.h"
+#include "blockpipeline.h"
 #include "checkpoints.h"
+#include "coinsprefetch.h"
 #include "compat/sanity.h"
 #include "consensus/upgrades.h"
+#include "crypto/sha256.h"
+#include "crypto/sph_x4.h"
 #include "fs.h"
+#include "hashx11kvs.h"
 #include "httpserver.h"
 #include "httprpc.h"
 #include "key.h"
@@ -47,6 +53,7 @@
 #include "guiinterfaceutil.h"
 #include "util.h"
 #include "utilmoneystr.h"
+#include "utxosnapshot.h"
 #include "util/threadnames.h"
 #include "validationinterface.h"
 
@@ -236,6 +243,8 @@ void PrepareShutdown()
         fFeeEstimatesInitialized = false;
     }
 
+    blockPipeline.Stop();
+    coinsPrefetcher.Stop();
     {
         LOCK(cs_main);
         if (pcoinsTip != NULL) {
@@ -374,6 +383,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-?", _("This help message"));
     strUsage += HelpMessageOpt("-version", _("Print version and exit"));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
+    strUsage += HelpMessageOpt("-assumevalid=<hex>", strprintf(_("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script and stake signature verification (0 to verify all, default: %s)"), Params(CBaseChainParams::MAIN).GetConsensus().defaultAssumeValid.IsNull() ? "0" : Params(CBaseChainParams::MAIN).GetConsensus().defaultAssumeValid.GetHex()));
+    strUsage += HelpMessageOpt("-blockcachesize=<n>", strprintf(_("Set the size in megabytes of the recent blocks kept deserialized in memory, read by the masternode payments, the peers and the RPC (0 to %d, 0 = disable, default: %d)"), MAX_BLOCK_CACHE_SIZE, DEFAULT_BLOCK_CACHE_SIZE));
+    strUsage += HelpMessageOpt("-blockcheckthreads=<n>", strprintf(_("Set the number of threads deserializing and checking blocks ahead of the one being connected (0 to %d, 0 = one per core, default: %d)"), MAX_BLOCK_CHECK_THREADS, DEFAULT_BLOCK_CHECK_THREADS));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
     strUsage += HelpMessageOpt("-blocksizenotify=<cmd>", _("Execute command when the best block changes and its size is over (%s in cmd is replaced by block hash, %d with the block size)"));
     strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), DEFAULT_CHECKBLOCKS));
@@ -388,14 +400,19 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-disablesystemnotifications", strprintf(_("Disable OS notifications for incoming transactions (default: %u)"), 0));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
+    strUsage += HelpMessageOpt("-loadutxosnapshot=<file>", _("Start from the UTXO set and block index in a file written by dumptxoutset instead of the genesis block, if the chainstate is empty. Blocks before the snapshot are not stored and can't be served or rescanned"));
     strUsage += HelpMessageOpt("-maxreorg=<n>", strprintf(_("Set the Maximum reorg depth (default: %u)"), DEFAULT_MAX_REORG_DEPTH));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf(_("Keep the transaction memory pool below <n> megabytes (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE));
     strUsage += HelpMessageOpt("-mempoolexpiry=<n>", strprintf(_("Do not keep transactions in the mempool longer than <n> hours (default: %u)"), DEFAULT_MEMPOOL_EXPIRY));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"), -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-prefetchthreads=<n>", strprintf(_("Set the number of threads reading the coins of the blocks about to be connected (0 to %d, default: %d)"), MAX_PREFETCH_THREADS, DEFAULT_PREFETCH_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), PIVX_PID_FILENAME));
 #endif
+    strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by pruning (deleting) old blocks. This mode disables the serving of blocks to peers and the rescans of the wallet "
+            "beyond the pruned blocks, and getblock and getrawtransaction refuse the pruned data. It turns off -txindex, which it is incompatible with. "
+            "(default: 0 = disable pruning blocks, >%u = target size in MiB to use for block files)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
     strUsage += HelpMessageOpt("-reindex", _("Rebuild block chain index from current blk000??.dat files") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-resync", _("Delete blockchain folders and resync from scratch") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-rewindblockindex[=<n or hash>]", _("When used without a value, rewinds blockchain to last checkpoint. When passing a number, rolls back the chain by the given number of blocks. When passing a block hash (as a hex string), rewind up to (not including) the block with the matching hash."));
@@ -403,6 +420,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
     strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), DEFAULT_TXINDEX));
+    strUsage += HelpMessageOpt("-utxosnapshothash=<hex>", _("Content hash the -loadutxosnapshot file must have, if it is not one compiled in"));
+    strUsage += HelpMessageOpt("-x11kvscache=<n>", strprintf(_("Set the X11KVS subtree cache size in megabytes, used to speed up block header hashing (0 to disable, default: %d)"), DEFAULT_X11KVS_CACHE_SIZE));
     
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open"));
@@ -830,6 +849,12 @@ void InitParameterInteraction()
             LogPrintf("%s : parameter interaction: -externalip set -> setting -discover=0\n", __func__);
     }
 
+    if (GetArg("-prune", 0) > 0) {
+        // the transactions of the pruned blocks can't be indexed
+        if (SoftSetBoolArg("-txindex", false))
+            LogPrintf("%s : parameter interaction: -prune set -> setting -txindex=0\n", __func__);
+    }
+
     if (GetBoolArg("-salvagewallet", false)) {
         // Rewrite just private keys: rescan to find transactions
         if (SoftSetBoolArg("-rescan", true))
@@ -1006,6 +1031,12 @@ bool AppInit2()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    hashAssumeValid = uint256S(GetArg("-assumevalid", Params().GetConsensus().defaultAssumeValid.GetHex()));
+    if (!hashAssumeValid.IsNull())
+        LogPrintf("Assuming ancestors of block %s have valid signatures.\n", hashAssumeValid.GetHex());
+    else
+        LogPrintf("Validating signatures for all blocks.\n");
+
     setvbuf(stdout, NULL, _IOLBF, 0); /// ***TODO*** do we still need this after -printtoconsole is gone?
 
     // Staking needs a CWallet instance, so make sure wallet is enabled
@@ -1057,11 +1088,31 @@ bool AppInit2()
 
     nMaxTipAge = GetArg("-maxtipage", DEFAULT_MAX_TIP_AGE);
 
+    // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
+    int64_t nSignedPruneTarget = GetArg("-prune", 0) * 1024 * 1024;
+    if (nSignedPruneTarget < 0) {
+        return UIError(_("Prune cannot be configured with a negative value."));
+    }
+    nPruneTarget = (uint64_t)nSignedPruneTarget;
+    if (nPruneTarget) {
+        if (nPruneTarget < MIN_DISK_SPACE_FOR_BLOCK_FILES) {
+            return UIError(strprintf(_("Prune configured below the minimum of %d MiB. Please use a higher number."), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
+        }
+        if (GetBoolArg("-txindex", DEFAULT_TXINDEX))
+            return UIError(_("Prune mode is incompatible with -txindex."));
+        LogPrintf("Prune configured to target %uMiB on disk for block and undo files.\n", nPruneTarget / 1024 / 1024);
+        fPruneMode = true;
+    }
+
     if (!InitNUParams())
         return false;
 
     // ********************************************************* Step 4: application initialization: dir lock, daemonize, pidfile, debug log
 
+    // Select the hash implementations before anything gets hashed
+    const std::string strSHA256Algo = SHA256AutoDetect();
+    const std::string strSphX4Algo = SphX4AutoDetect();
+
     // Initialize elliptic curve code
     RandomInit();
     ECC_Start();
@@ -1095,6 +1146,8 @@ bool AppInit2()
 #ifdef ENABLE_WALLET
     LogPrintf("Using BerkeleyDB version %s\n", DbEnv::version(0, 0, 0));
 #endif
+    LogPrintf("Using the '%s' SHA256 implementation\n", strSHA256Algo);
+    LogPrintf("Using the '%s' multi-lane X11KV implementation\n", strSphX4Algo);
     if (!g_logger->m_log_timestamps)
         LogPrintf("Startup time: %s\n", DateTimeStrFormat("%Y-%m-%d %H:%M:%S", GetTime()));
     LogPrintf("Default data directory %s\n", GetDefaultDataDir().string());
@@ -1111,6 +1164,11 @@ bool AppInit2()
             threadGroup.create_thread(&ThreadScriptCheck);
     }
 
+    int nBlockCheckThreads = GetArg("-blockcheckthreads", DEFAULT_BLOCK_CHECK_THREADS);
+    if (nBlockCheckThreads <= 0)
+        nBlockCheckThreads = GetNumCores();
+    blockPipeline.Start(std::min(nBlockCheckThreads, MAX_BLOCK_CHECK_THREADS));
+
     if (mapArgs.count("-sporkkey")) // spork priv key
     {
         if (!sporkManager.SetPrivKey(GetArg("-sporkkey", "")))
@@ -1417,6 +1475,12 @@ bool AppInit2()
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
+    int64_t nX11KVSCache = std::max((int64_t)0, GetArg("-x11kvscache", DEFAULT_X11KVS_CACHE_SIZE)) << 20;
+    GetX11KVSCache().SetMaxSize(nX11KVSCache);
+    LogPrintf("* Using %.1fMiB for X11KVS subtree cache\n", nX11KVSCache * (1.0 / 1024 / 1024));
+    int64_t nBlockCache = std::max((int64_t)0, std::min(GetArg("-blockcachesize", DEFAULT_BLOCK_CACHE_SIZE), MAX_BLOCK_CACHE_SIZE)) << 20;
+    blockCache.SetMaxSize(nBlockCache);
+    LogPrintf("* Using %.1fMiB for recent block cache\n", nBlockCache * (1.0 / 1024 / 1024));
 
     const CChainParams& chainparams = Params();
 
@@ -1429,6 +1493,7 @@ bool AppInit2()
             const int64_t load_block_index_start_time = GetTimeMillis();
 
             try {
+                coinsPrefetcher.Stop();
                 UnloadBlockIndex();
                 delete pcoinsTip;
                 delete pcoinsdbview;
@@ -1442,6 +1507,7 @@ bool AppInit2()
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
+                coinsPrefetcher.Start(pcoinscatcher, std::max(0, std::min((int)GetArg("-prefetchthreads", DEFAULT_PREFETCH_THREADS), MAX_PREFETCH_THREADS)));
 
                 if (fReindex) {
                     pblocktree->WriteReindexing(true);
@@ -1457,6 +1523,21 @@ bool AppInit2()
                 // End loop if shutdown was requested
                 if (ShutdownRequested()) break;
 
+                if (!fReindex && mapArgs.count("-loadutxosnapshot")) {
+                    if (pcoinsdbview->GetBestBlock().IsNull()) {
+                        uiInterface.InitMessage(_("Loading UTXO snapshot..."));
+                        std::string strSnapshotError;
+                        if (!LoadUTXOSnapshot(GetArg("-loadutxosnapshot", ""), uint256S(GetArg("-utxosnapshothash", "")), *pcoinsdbview, strSnapshotError)) {
+                            if (ShutdownRequested()) break;
+                            return UIError(strprintf(_("Error loading the UTXO snapshot: %s"), strSnapshotError));
+                        }
+                    } else {
+                        LogPrintf("The chainstate is not empty, -loadutxosnapshot ignored\n");
+                    }
+                } else if (!fReindex && IsUTXOSnapshotImportPending(*pcoinsdbview)) {
+                    return UIError(_("The import of a UTXO snapshot was interrupted: restart with the same -loadutxosnapshot, or with -reindex"));
+                }
+
                 // Mandike: load previous sessions sporks if we have them.
                 uiInterface.InitMessage(_("Loading sporks..."));
                 sporkManager.LoadSporksFromDB();
@@ -1697,6 +1778,18 @@ bool AppInit2()
             LogPrintf("file format is unknown or invalid, please fix it manually\n");
     }
 
+    // The payees the last paid times are looked up from, for the entries written before they were stored.
+    // The window of the payment queue first, the rest of the chain in the background
+    uiInterface.InitMessage(_("Loading masternode payees..."));
+    MigratePaidPayees(std::max((int)mnodeman.size() * 2, (int)MIN_BLOCKS_TO_KEEP));
+    threadGroup.create_thread(&ThreadMigratePaidPayees);
+
+    // Pruned once the masternode list is loaded, the blocks its last paid times are read from are kept
+    if (fPruneMode && !fReindex) {
+        uiInterface.InitMessage(_("Pruning blockstore..."));
+        PruneAndFlush();
+    }
+
     fMasterNode = GetBoolArg("-masternode", DEFAULT_MASTERNODE);
 
     if ((fMasterNode || masternodeConfig.getCount() > -1) && fTxIndex == false) {
@@ -1774,6 +1867,13 @@ bool AppInit2()
     // Map ports with UPnP
     MapPort(GetBoolArg("-upnp", DEFAULT_UPNP));
 
+    // The blocks of a UTXO snapshot, and the pruned ones, can't be served
+    {
+        LOCK(cs_main);
+        if (fPruneMode || fHavePruned || (chainActive.Genesis() && (chainActive.Genesis()->nStatus & BLOCK_SNAPSHOT)))
+            nLocalServices = ServiceFlags(nLocalServices & ~NODE_NETWORK);
+    }
+
     std::string strNodeError;
     CConnman::Options connOptions;
     connOptions.nLocalServices = nLocalServices;
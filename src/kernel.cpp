@@ -14,6 +14,7 @@
 #include "util.h"
 #include "policy/policy.h"
 #include "stakeinput.h"
+#include "undo.h"
 #include "utilmoneystr.h"
 
 #include <boost/assign/list_of.hpp>
@@ -27,42 +28,71 @@
  * @param[in]   nTimeTx         time of the kernel block
  */
 CStakeKernel::CStakeKernel(const CBlockIndex* const pindexPrev, CStakeInput* stakeInput, unsigned int nBits, int nTimeTx):
-    stakeUniqueness(stakeInput->GetUniqueness()),
     nTime(nTimeTx),
     nBits(nBits),
     stakeValue(stakeInput->GetValue())
+{
+    unsigned char vchUniqueness[CStakeInput::UNIQUENESS_SIZE];
+    stakeInput->GetUniqueness(vchUniqueness);
+    Init(pindexPrev, stakeInput->GetIndexFrom(), vchUniqueness);
+}
+
+CStakeKernel::CStakeKernel(const CBlockIndex* const pindexPrev, const CBlockIndex* pindexFrom, const unsigned char* pchUniqueness,
+                           CAmount nValue, unsigned int nBits, int nTimeTx):
+    nTime(nTimeTx),
+    nBits(nBits),
+    stakeValue(nValue)
+{
+    Init(pindexPrev, pindexFrom, pchUniqueness);
+}
+
+void CStakeKernel::Init(const CBlockIndex* const pindexPrev, const CBlockIndex* pindexFrom, const unsigned char* pchUniqueness)
 {
     // Set kernel stake modifier
     if (!Params().GetConsensus().NetworkUpgradeActive(pindexPrev->nHeight + 1, Consensus::UPGRADE_STAKE_MODIFIER_V2)) {
         uint64_t nStakeModifier = 0;
-        if (!GetOldStakeModifier(stakeInput, nStakeModifier))
+        if (!pindexFrom || !GetOldModifier(pindexFrom, nStakeModifier))
             LogPrintf("%s : ERROR: Failed to get kernel stake modifier\n", __func__);
         // Modifier v1
-        stakeModifier << nStakeModifier;
+        WriteLE64(vchPrefix, nStakeModifier);
+        nPrefixSize = 8;
     } else {
         // Modifier v2
-        stakeModifier << pindexPrev->GetStakeModifierV2();
+        const uint256 nStakeModifier = pindexPrev->GetStakeModifierV2();
+        memcpy(vchPrefix, nStakeModifier.begin(), nStakeModifier.size());
+        nPrefixSize = nStakeModifier.size();
     }
-    CBlockIndex* pindexFrom = stakeInput->GetIndexFrom();
-    nTimeBlockFrom = pindexFrom->nTime;
+    WriteLE32(vchPrefix + nPrefixSize, pindexFrom->nTime);
+    nPrefixSize += 4;
+    nUniquenessPos = nPrefixSize;
+    memcpy(vchPrefix + nPrefixSize, pchUniqueness, CStakeInput::UNIQUENESS_SIZE);
+    nPrefixSize += CStakeInput::UNIQUENESS_SIZE;
+
+    // Only the last, partial, block of the message depends on nTime
+    prefixState.Write(vchPrefix, nPrefixSize & ~size_t(63));
+
+    // Weighted target
+    bnTarget.SetCompact(nBits);
+    bnTarget *= (uint256(stakeValue) / 100);
 }
 
 // Return stake kernel hash
 uint256 CStakeKernel::GetHash() const
 {
-    CDataStream ss(stakeModifier);
-    ss << nTimeBlockFrom << stakeUniqueness << nTime;
-    return Hash(ss.begin(), ss.end());
+    const size_t nHashed = nPrefixSize & ~size_t(63);
+    unsigned char vchTail[64 + 4];
+    memcpy(vchTail, vchPrefix + nHashed, nPrefixSize - nHashed);
+    WriteLE32(vchTail + nPrefixSize - nHashed, nTime);
+
+    uint256 hash;
+    CSHA256(prefixState).Write(vchTail, nPrefixSize - nHashed + 4).Finalize(hash.begin());
+    CSHA256().Write(hash.begin(), hash.size()).Finalize(hash.begin());
+    return hash;
 }
 
 // Check that the kernel hash meets the target required
 bool CStakeKernel::CheckKernelHash(bool fSkipLog) const
 {
-    // Get weighted target
-    uint256 bnTarget;
-    bnTarget.SetCompact(nBits);
-    bnTarget *= (uint256(stakeValue) / 100);
-
     // Check PoS kernel hash
     const uint256& hashProofOfStake = GetHash();
     const bool res = hashProofOfStake < bnTarget;
@@ -75,7 +105,7 @@ bool CStakeKernel::CheckKernelHash(bool fSkipLog) const
                             "\nnBits=%d"
                             "\nweight=%d"
                             "\nbnTarget=%s (res: %d)\n\n",
-            __func__, HexStr(stakeUniqueness), nTime, hashProofOfStake.GetHex(),
+            __func__, HexStr(vchPrefix + nUniquenessPos, vchPrefix + nUniquenessPos + CStakeInput::UNIQUENESS_SIZE), nTime, hashProofOfStake.GetHex(),
             nBits, stakeValue, bnTarget.GetHex(), res);
     }
     return res;
@@ -86,6 +116,32 @@ bool CStakeKernel::CheckKernelHash(bool fSkipLog) const
  * PoS Validation
  */
 
+// Spent stake output, from the UTXO set or, for a block of the active chain, from its undo data.
+// Callers like rest_block reach it without cs_main, AccessCoin fills the cache.
+static bool GetStakeCoin(const CBlock& block, const COutPoint& prevout, Coin& coin)
+{
+    LOCK(cs_main);
+    const Coin& coinTip = pcoinsTip->AccessCoin(prevout);
+    if (!coinTip.IsSpent()) {
+        coin = coinTip;
+        return true;
+    }
+
+    BlockMap::const_iterator mi = mapBlockIndex.find(block.GetHash());
+    if (mi == mapBlockIndex.end() || !chainActive.Contains(mi->second))
+        return false;
+    const CBlockIndex* pindex = mi->second;
+    const CDiskBlockPos pos = pindex->GetUndoPos();
+    CBlockUndo blockUndo;
+    if (pos.IsNull() || !UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash()))
+        return false;
+    // No undo for the coinbase, the coinstake is the first entry
+    if (blockUndo.vtxundo.size() + 1 != block.vtx.size() || blockUndo.vtxundo[0].vprevout.empty())
+        return false;
+    coin = blockUndo.vtxundo[0].vprevout[0];
+    return true;
+}
+
 // helper function for CheckProofOfStake and GetStakeKernelHash
 bool LoadStakeInput(const CBlock& block, const CBlockIndex* pindexPrev, std::unique_ptr<CStakeInput>& stake)
 {
@@ -106,9 +162,17 @@ bool LoadStakeInput(const CBlock& block, const CBlockIndex* pindexPrev, std::uni
 
     // Construct the stakeinput object
     const CTxIn& txin = block.vtx[1].vin[0];
-    stake = std::unique_ptr<CStakeInput>(new CPivStake());
+    std::unique_ptr<CPivStake> pivStake(new CPivStake());
 
-    return stake->InitFromTxIn(txin);
+    // The spent output and its height are enough, the source transaction is
+    // only looked up when they can't be found without reading a block
+    Coin coin;
+    const bool fCoin = GetStakeCoin(block, txin.prevout, coin) && pivStake->InitFromCoin(txin.prevout, coin);
+    if (!fCoin && !pivStake->InitFromTxIn(txin))
+        return false;
+
+    stake = std::move(pivStake);
+    return true;
 }
 
 /*
@@ -124,14 +188,30 @@ bool Stake(const CBlockIndex* pindexPrev, CStakeInput* stakeInput, unsigned int
 {
     // Double check stake input contextual checks
     const int nHeightTx = pindexPrev->nHeight + 1;
+    nTimeTx = GetStakeTime(pindexPrev);
+
+    if (!stakeInput || !stakeInput->ContextCheck(nHeightTx, nTimeTx)) return false;
+
+    // The kernel message and target are built once, only nTime changes
+    CStakeKernel stakeKernel(pindexPrev, stakeInput, nBits, nTimeTx);
+    return SearchStakeKernel(pindexPrev, stakeKernel, nTimeTx);
+}
+
+int64_t GetStakeTime(const CBlockIndex* pindexPrev)
+{
+    const int nHeightTx = pindexPrev->nHeight + 1;
+    const bool fTimeProtocolV2 = Params().GetConsensus().IsTimeProtocolV2(nHeightTx) && !Params().IsRegTestNet();
+    return fTimeProtocolV2 ? pindexPrev->MinPastBlockTime() : GetAdjustedTime();
+}
+
+bool SearchStakeKernel(const CBlockIndex* pindexPrev, CStakeKernel& stakeKernel, int64_t& nTimeTx)
+{
+    const int nHeightTx = pindexPrev->nHeight + 1;
 
     // Get the new time slot (and verify it's not the same as previous block)
     const bool fRegTest = Params().IsRegTestNet();
     const bool fTimeProtocolV2 = Params().GetConsensus().IsTimeProtocolV2(nHeightTx) && !fRegTest;
     const int nTimeSlotLength = Params().GetConsensus().nTimeSlotLength;
-    nTimeTx = fTimeProtocolV2 ? pindexPrev->MinPastBlockTime() : GetAdjustedTime();
-
-    if (!stakeInput || !stakeInput->ContextCheck(nHeightTx, nTimeTx)) return false;
 
     int slotStep = fTimeProtocolV2 ? nTimeSlotLength : 1;
 
@@ -143,7 +223,7 @@ bool Stake(const CBlockIndex* pindexPrev, CStakeInput* stakeInput, unsigned int
 
     while(nTimeTx <= (fTimeProtocolV2 ? pindexPrev->MaxFutureBlockTime() : pindexPrev->GetBlockTime() + HASH_DRIFT)) {
         // Verify Proof Of Stake
-        CStakeKernel stakeKernel(pindexPrev, stakeInput, nBits, nTimeTx);
+        stakeKernel.SetTime(nTimeTx);
         if(stakeKernel.CheckKernelHash(true)) return true;
         nTimeTx += slotStep;
     }
@@ -159,9 +239,10 @@ bool Stake(const CBlockIndex* pindexPrev, CStakeInput* stakeInput, unsigned int
  * @param[out]  strError        string error (if any, else empty)
  * @param[in]   pindexPrev      index of the parent block
  *                              (if nullptr, it will be searched in mapBlockIndex)
+ * @param[in]   fCheckSignature whether to verify the signature of the coinstake input
  * @return      bool            true if the block has a valid proof of stake
  */
-bool CheckProofOfStake(const CBlock& block, std::string& strError, const CBlockIndex* pindexPrev)
+bool CheckProofOfStake(const CBlock& block, std::string& strError, const CBlockIndex* pindexPrev, bool fCheckSignature)
 {
     // if we have already a checkpoint newer than this block 
     // then it is OK
@@ -189,6 +270,10 @@ bool CheckProofOfStake(const CBlock& block, std::string& strError, const CBlockI
         return false;
     }
 
+    // Ancestors of the -assumevalid block skip the signature
+    if (!fCheckSignature)
+        return true;
+
     // Verify tx input signature
     CTxOut stakePrevout;
     if (!stakeInput->GetTxOutFrom(stakePrevout)) {
@@ -9,6 +9,7 @@
 #ifndef PIVX_KERNEL_H
 #define PIVX_KERNEL_H
 
+#include "crypto/sha256.h"
 #include "main.h"
 #include "stakeinput.h"
 
@@ -26,21 +27,46 @@ public:
      */
     CStakeKernel(const CBlockIndex* const pindexPrev, CStakeInput* stakeInput, unsigned int nBits, int nTimeTx);
 
+    /**
+     * CStakeKernel Constructor, from stake input data already resolved by the caller
+     *
+     * @param[in]   pindexPrev      index of the parent of the kernel block
+     * @param[in]   pindexFrom      index of the block containing the staked output
+     * @param[in]   pchUniqueness   stake uniqueness (CStakeInput::UNIQUENESS_SIZE bytes)
+     * @param[in]   nValue          value of the staked output
+     * @param[in]   nBits           target difficulty bits of the kernel block
+     * @param[in]   nTimeTx         time of the kernel block
+     */
+    CStakeKernel(const CBlockIndex* const pindexPrev, const CBlockIndex* pindexFrom, const unsigned char* pchUniqueness,
+                 CAmount nValue, unsigned int nBits, int nTimeTx);
+
     // Return stake kernel hash
     uint256 GetHash() const;
 
     // Check that the kernel hash meets the target required
     bool CheckKernelHash(bool fSkipLog = false) const;
 
+    // Move the kernel to another block time, the only part of the message that
+    // changes between the time slots searched by Stake()
+    void SetTime(int nTimeTx) { nTime = nTimeTx; }
+
 private:
-    // kernel message hashed
-    CDataStream stakeModifier{CDataStream(SER_GETHASH, 0)};
-    int nTimeBlockFrom{0};
-    CDataStream stakeUniqueness{CDataStream(SER_GETHASH, 0)};
+    void Init(const CBlockIndex* const pindexPrev, const CBlockIndex* pindexFrom, const unsigned char* pchUniqueness);
+
+    // Longest message prefix: v2 stake modifier, nTimeBlockFrom and uniqueness
+    static const size_t MAX_PREFIX_SIZE = 32 + 4 + CStakeInput::UNIQUENESS_SIZE;
+
+    // kernel message hashed: the serialized stake modifier, nTimeBlockFrom and
+    // stake uniqueness, followed by nTime
+    unsigned char vchPrefix[MAX_PREFIX_SIZE];
+    size_t nPrefixSize{0};
+    size_t nUniquenessPos{0};
+    CSHA256 prefixState;       // SHA-256 state after the whole 64-byte blocks of the prefix
     int nTime{0};
     // hash target
     unsigned int nBits{0};     // difficulty for the target
     CAmount stakeValue{0};     // target multiplier
+    uint256 bnTarget;          // weighted target
 };
 
 /* PoS Validation */
@@ -56,6 +82,25 @@ private:
  */
 bool Stake(const CBlockIndex* pindexPrev, CStakeInput* stakeInput, unsigned int nBits, int64_t& nTimeTx);
 
+/*
+ * GetStakeTime         Return the time at which a stake on top of pindexPrev is
+ *                      context checked, and from which its time slots are searched
+ *
+ * @param[in]   pindexPrev      index of the parent block of the block being staked
+ * @return      int64_t         time passed to CStakeInput::ContextCheck by Stake()
+ */
+int64_t GetStakeTime(const CBlockIndex* pindexPrev);
+
+/*
+ * SearchStakeKernel    Search the time slots after pindexPrev for a kernel meeting the target
+ *
+ * @param[in]   pindexPrev      index of the parent block of the block being staked
+ * @param[in]   stakeKernel     kernel of an input that passed the contextual checks
+ * @param[in,out] nTimeTx       in: GetStakeTime(pindexPrev), out: last time slot checked
+ * @return      bool            true if stake kernel hash meets target protocol at nTimeTx
+ */
+bool SearchStakeKernel(const CBlockIndex* pindexPrev, CStakeKernel& stakeKernel, int64_t& nTimeTx);
+
 /*
  * CheckProofOfStake    Check if block has valid proof of stake
  *
@@ -63,9 +108,10 @@ bool Stake(const CBlockIndex* pindexPrev, CStakeInput* stakeInput, unsigned int
  * @param[out]  strError        string returning error message (if any, else empty)
  * @param[in]   pindexPrev      index of the parent block
  *                              (if nullptr, it will be searched in mapBlockIndex)
+ * @param[in]   fCheckSignature whether to verify the signature of the coinstake input
  * @return      bool            true if the block has a valid proof of stake
  */
-bool CheckProofOfStake(const CBlock& block, std::string& strError, const CBlockIndex* pindexPrev = nullptr);
+bool CheckProofOfStake(const CBlock& block, std::string& strError, const CBlockIndex* pindexPrev = nullptr, bool fCheckSignature = true);
 
 /*
  * GetStakeKernelHash   Return stake kernel of a block
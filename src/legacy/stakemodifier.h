@@ -14,6 +14,7 @@
 
 // Old Modifier - Only for IBD
 bool GetOldStakeModifier(CStakeInput* stake, uint64_t& nStakeModifier);
+bool GetOldModifier(const CBlockIndex* pindexFrom, uint64_t& nStakeModifier);
 bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier);
 
 #endif // PIVX_LEGACY_MODIFIER_H
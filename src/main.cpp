@@ -13,10 +13,13 @@
 
 #include "addrman.h"
 #include "amount.h"
+#include "blockcache.h"
+#include "blockpipeline.h"
 #include "blocksignature.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
+#include "coinsprefetch.h"
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/tx_verify.h"
@@ -34,6 +37,7 @@
 #include "policy/policy.h"
 #include "pow.h"
 #include "reverse_iterate.h"
+#include "spentoutpointindex.h"
 #include "spork.h"
 #include "sporkdb.h"
 #include "txdb.h"
@@ -50,8 +54,10 @@
 #include <boost/thread.hpp>
 #include <boost/foreach.hpp>
 #include <atomic>
+#include <memory>
 #include <queue>
 #include <regex>
+#include <unordered_set>
 
 
 #if defined(NDEBUG)
@@ -78,6 +84,9 @@ RecursiveMutex cs_main;
 BlockMap mapBlockIndex;
 CChain chainActive;
 CBlockIndex* pindexBestHeader = NULL;
+uint256 hashAssumeValid;
+/** Blocks connected without checking their scripts, being ancestors of hashAssumeValid */
+static uint64_t nAssumedValidBlocks = 0;
 int64_t nTimeBestReceived = 0;
 CAmount nMoneySupply;
 // Best block section
@@ -90,6 +99,9 @@ std::atomic<bool> fImporting{false};
 std::atomic<bool> fReindex{false};
 bool fTxIndex = true;
 bool fCheckBlockIndex = false;
+bool fHavePruned = false;
+bool fPruneMode = false;
+uint64_t nPruneTarget = 0;
 bool fVerifyingBlocks = false;
 size_t nCoinCacheUsage = 5000 * 300;
 
@@ -113,6 +125,8 @@ std::map<uint256, std::set<uint256> > mapOrphanTransactionsByPrev GUARDED_BY(cs_
 std::map<uint256, int64_t> mapRejectedBlocks;
 
 void EraseOrphansFor(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+static void EraseOrphanBlocksFor(NodeId nodeid) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+static void ProcessOrphanBlocks(const uint256& hashParent, CConnman* connman);
 
 static void CheckBlockIndex();
 
@@ -210,6 +224,31 @@ struct QueuedBlock {
 };
 std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> > mapBlocksInFlight;
 
+/**
+ * Orphan blocks: blocks received ahead of their parent's data, the parent
+ * being unknown or only known by its header. A proof of stake can only be
+ * checked on top of a connected parent, so these wait in memory, by hash and
+ * by parent hash, and are processed in order as the parents connect instead
+ * of being downloaded again. The pool is bounded in count and size, in total
+ * and per peer. Protected by cs_main.
+ */
+struct COrphanBlock {
+    std::shared_ptr<const CBlock> pblock;
+    NodeId nodeid;
+    size_t nSize;
+    int64_t nTimeExpire;
+    //! Context-free checks, run by the block pipeline while the block waits
+    CBlockPipelineJobRef check;
+};
+std::map<uint256, COrphanBlock> mapOrphanBlocks;
+std::multimap<uint256, uint256> mapOrphanBlocksByPrev;
+std::map<NodeId, size_t> mapOrphanBlocksPeerSize;
+size_t nOrphanBlocksSize = 0;
+//! Orphan blocks accepted once their parent connected, without being downloaded again
+uint64_t nOrphanBlocksSaved = 0;
+//! Orphan blocks not kept, the pool or the peer's share of it being full
+uint64_t nOrphanBlocksDropped = 0;
+
 /** Number of blocks in flight with validated headers. */
 int nQueuedValidatedHeaders = 0;
 
@@ -221,6 +260,9 @@ std::set<CBlockIndex*> setDirtyBlockIndex;
 
 /** Dirty block file entries. */
 std::set<int> setDirtyFileInfo;
+
+/** Global flag to indicate we should check to see if there are block/undo files that should be deleted. Set on startup or if we allocate more file space when we're in prune mode */
+bool fCheckForPruning = false;
 } // anon namespace
 
 //////////////////////////////////////////////////////////////////////////////
@@ -340,6 +382,10 @@ struct CNodeState {
     CBlockIndex* pindexLastCommonBlock;
     //! Whether we've started headers synchronization with this peer.
     bool fSyncStarted;
+    //! The last header taken from this peer before its headers went past MAX_UNCHECKED_HEADERS_AHEAD, or NULL.
+    CBlockIndex* pindexHeadersPaused;
+    //! Number of unchecked headers from this peer in the block index.
+    int nUncheckedHeaders;
     //! Since when we're stalling block download progress (in microseconds), or 0.
     int64_t nStallingSince;
     std::list<QueuedBlock> vBlocksInFlight;
@@ -357,6 +403,8 @@ struct CNodeState {
         hashLastUnknownBlock.SetNull();
         pindexLastCommonBlock = NULL;
         fSyncStarted = false;
+        pindexHeadersPaused = NULL;
+        nUncheckedHeaders = 0;
         nStallingSince = 0;
         nBlocksInFlight = 0;
         fPreferredDownload = false;
@@ -433,6 +481,7 @@ void FinalizeNode(NodeId nodeid, bool& fUpdateConnectionTime)
     for (const QueuedBlock& entry : state->vBlocksInFlight)
         mapBlocksInFlight.erase(entry.hash);
     EraseOrphansFor(nodeid);
+    EraseOrphanBlocksFor(nodeid);
     nPreferredDownload -= state->fPreferredDownload;
 
     mapNodeState.erase(nodeid);
@@ -582,9 +631,11 @@ void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBl
                 // We consider the chain that this peer is on invalid.
                 return;
             }
-            if (pindex->nStatus & BLOCK_HAVE_DATA) {
+            if (pindex->nStatus & (BLOCK_HAVE_DATA | BLOCK_SNAPSHOT) || chainActive.Contains(pindex)) {
                 if (pindex->nChainTx)
                     state->pindexLastCommonBlock = pindex;
+            } else if (mapOrphanBlocks.count(pindex->GetBlockHash())) {
+                // Already downloaded, waiting for its parent to connect.
             } else if (mapBlocksInFlight.count(pindex->GetBlockHash()) == 0) {
                 // The block is not already downloaded, and not yet in flight.
                 if (pindex->nHeight > nWindowEnd) {
@@ -825,6 +876,30 @@ std::string FormatStateMessage(const CValidationState &state)
         state.GetRejectCode());
 }
 
+/**
+ * Whether tx spends a coin sent to an address burned before nHeight, which is then set in strAddress.
+ * vCoins are the coins spent by tx, as returned by CCoinsViewCache::GetInputs: they are resolved
+ * from the view the transaction is checked against, whether its blocks are on disk or not.
+ */
+static bool SpendsBurnedCoin(const CTransaction& tx, const std::vector<const Coin*>& vCoins, int nHeight, std::string& strAddress)
+{
+    const Consensus::Params& consensus = Params().GetConsensus();
+    if (consensus.mBurnAddresses.empty())
+        return false;
+    for (const Coin* pcoin : vCoins) {
+        CTxDestination source;
+        if (!ExtractDestination(pcoin->out.scriptPubKey, source))
+            continue;
+        const std::string addr = EncodeDestination(source);
+        auto it = consensus.mBurnAddresses.find(addr);
+        if (it != consensus.mBurnAddresses.end() && it->second < nHeight) {
+            strAddress = addr;
+            return true;
+        }
+    }
+    return false;
+}
+
 bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
                               bool* pfMissingInputs, bool fOverrideMempoolLimit, bool fRejectAbsurdFee, bool ignoreFees,
                               std::vector<COutPoint>& coins_to_uncache)
@@ -864,24 +939,6 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const C
         return state.Invalid(false, REJECT_ALREADY_KNOWN, "txn-already-in-mempool");
     }
 
-    // ----------- burn address scanning -----------
-    if (!consensus.mBurnAddresses.empty()) {
-        for (unsigned int i = 0; i < tx.vin.size(); ++i) {
-            uint256 hashBlock;
-            CTransaction txPrev;
-            if (GetTransaction(tx.vin[i].prevout.hash, txPrev, hashBlock, true)) { // get the vin's previous transaction
-                CTxDestination source;
-                if (ExtractDestination(txPrev.vout[tx.vin[i].prevout.n].scriptPubKey, source)) { // extract the destination of the previous transaction's vout[n]
-                    const std::string addr = EncodeDestination(source);
-                    if (consensus.mBurnAddresses.find(addr) != consensus.mBurnAddresses.end() &&
-                        consensus.mBurnAddresses.at(addr) < chainHeight) {
-                        return state.DoS(0, false, REJECT_INVALID, "bad-txns-invalid-outputs");
-                    }
-                }
-            }
-        }
-    }
-
     // Check for conflicts with in-memory transactions
     {
         LOCK(pool.cs); // protect pool.mapNextTx
@@ -935,6 +992,12 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const C
 
         nValueIn = view.GetValueIn(tx);
 
+        // ----------- burn address scanning -----------
+        std::vector<const Coin*> vCoins;
+        std::string strBurned;
+        if (view.GetInputs(tx, vCoins) && SpendsBurnedCoin(tx, vCoins, chainHeight, strBurned))
+            return state.DoS(0, false, REJECT_INVALID, "bad-txns-invalid-outputs");
+
         // we have all inputs cached now, so switch back to dummy, so we don't need to keep lock on mempool
         view.SetBackend(dummy);
 
@@ -1298,6 +1361,19 @@ bool GetOutput(const uint256& hash, unsigned int index, CValidationState& state,
     return true;
 }
 
+/** Hash of the block stored at pos, looked up through the block index when possible */
+static uint256 GetBlockHashAtPos(const CBlockHeader& header, const CDiskBlockPos& pos)
+{
+    AssertLockHeld(cs_main);
+    BlockMap::const_iterator it = mapBlockIndex.find(header.hashPrevBlock);
+    if (it != mapBlockIndex.end() && chainActive.Contains(it->second)) {
+        const CBlockIndex* pindex = chainActive.Next(it->second);
+        if (pindex && pindex->GetBlockPos() == pos)
+            return pindex->GetBlockHash();
+    }
+    return header.GetHash();
+}
+
 /** Return transaction in tx, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock, bool fAllowSlow, CBlockIndex* blockIndex)
 {
@@ -1313,6 +1389,9 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock
         if (fTxIndex) {
             CDiskTxPos postx;
             if (pblocktree->ReadTxIndex(hash, postx)) {
+                // The index keeps the positions of the transactions whose block file was pruned
+                if (IsBlockFilePruned(postx.nFile))
+                    return false;
                 CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
                 if (file.IsNull())
                     return error("%s: OpenBlockFile failed", __func__);
@@ -1324,7 +1403,8 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock
                 } catch (const std::exception& e) {
                     return error("%s : Deserialize or I/O error - %s", __func__, e.what());
                 }
-                hashBlock = header.GetHash();
+                // The transaction position identifies its block, no need to rehash the header
+                hashBlock = GetBlockHashAtPos(header, postx);
                 if (txOut.GetHash() != hash)
                     return error("%s : txid mismatch", __func__);
                 return true;
@@ -1340,10 +1420,10 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock
         }
     }
 
-    if (pindexSlow) {
-        CBlock block;
-        if (ReadBlockFromDisk(block, pindexSlow)) {
-            for (const CTransaction& tx : block.vtx) {
+    if (pindexSlow && (pindexSlow->nStatus & BLOCK_HAVE_DATA)) {
+        std::shared_ptr<const CBlock> pblock;
+        if (ReadBlockFromDisk(pblock, pindexSlow)) {
+            for (const CTransaction& tx : pblock->vtx) {
                 if (tx.GetHash() == hash) {
                     txOut = tx;
                     hashBlock = pindexSlow->GetBlockHash();
@@ -1383,7 +1463,7 @@ bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos)
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
+static bool DeserializeBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
 {
     block.SetNull();
 
@@ -1399,6 +1479,14 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
         return error("%s : Deserialize or I/O error - %s", __func__, e.what());
     }
 
+    return true;
+}
+
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
+{
+    if (!DeserializeBlockFromDisk(block, pos))
+        return false;
+
     // Check the header
     if (block.IsProofOfWork()) {
         if (!CheckProofOfWork(block.GetHash(), block.nBits))
@@ -1408,14 +1496,49 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
+static bool ReadBlockFromDiskUncached(CBlock& block, const CBlockIndex* pindex)
 {
-    if (!ReadBlockFromDisk(block, pindex->GetBlockPos()))
+    if (!DeserializeBlockFromDisk(block, pindex->GetBlockPos()))
         return false;
-    if (block.GetHash() != pindex->GetBlockHash()) {
+    // The index entry passed the header checks when it was accepted: if the header read from
+    // disk has the same fields, its hash is the one stored in the index.
+    const uint256 hashPrev = pindex->pprev ? pindex->pprev->GetBlockHash() : UINT256_ZERO;
+    const bool fCheckpoint = block.nVersion > 3 && block.nVersion < 7;
+    if (block.nVersion != pindex->nVersion ||
+        block.hashPrevBlock != hashPrev ||
+        block.hashMerkleRoot != pindex->hashMerkleRoot ||
+        block.nTime != pindex->nTime ||
+        block.nBits != pindex->nBits ||
+        block.nNonce != pindex->nNonce ||
+        (fCheckpoint && block.nAccumulatorCheckpoint != pindex->nAccumulatorCheckpoint)) {
         LogPrintf("%s : block=%s index=%s\n", __func__, block.GetHash().GetHex(), pindex->GetBlockHash().GetHex());
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*) : GetHash() doesn't match index");
     }
+    block.SetCachedHash(pindex->GetBlockHash());
+    return true;
+}
+
+bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
+{
+    std::shared_ptr<const CBlock> pblock = blockCache.Get(pindex->GetBlockHash());
+    if (pblock) {
+        block = *pblock;
+        return true;
+    }
+    return ReadBlockFromDiskUncached(block, pindex);
+}
+
+bool ReadBlockFromDisk(std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, bool fAddToCache)
+{
+    pblock = blockCache.Get(pindex->GetBlockHash());
+    if (pblock)
+        return true;
+    std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
+    if (!ReadBlockFromDiskUncached(*pblockNew, pindex))
+        return false;
+    if (fAddToCache)
+        blockCache.Insert(pindex->GetBlockHash(), pblockNew);
+    pblock = std::move(pblockNew);
     return true;
 }
 
@@ -1652,24 +1775,19 @@ int GetSpendHeight(const CCoinsViewCache& inputs)
 }
 
 namespace Consensus {
-bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, int nSpendHeight)
+/** vCoins are the coins spent by tx, as returned by CCoinsViewCache::GetInputs */
+static bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const std::vector<const Coin*>& vCoins, int nSpendHeight)
 {
     // if we have already a checkpoint newer than this block
     // then it is OK
     if (nSpendHeight <= Checkpoints::GetTotalBlocksEstimate())
         return true;
 
-    // This doesn't trigger the DoS code on purpose; if it did, it would make it easier
-    // for an attacker to attempt to split the network.
-    if (!inputs.HaveInputs(tx))
-        return state.Invalid(false, 0, "", "Inputs unavailable");
-
     const Consensus::Params& consensus = ::Params().GetConsensus();
     CAmount nValueIn = 0;
     CAmount nFees = 0;
     for (unsigned int i = 0; i < tx.vin.size(); i++) {
-        const COutPoint &prevout = tx.vin[i].prevout;
-        const Coin& coin = inputs.AccessCoin(prevout);
+        const Coin& coin = *vCoins[i];
         assert(!coin.IsSpent());
 
         // If prev is coinbase, check that it's matured
@@ -1703,10 +1821,24 @@ bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoins
 }// namespace Consensus
 
 bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck> *pvChecks)
+{
+    if (tx.IsCoinBase())
+        return true;
+
+    // This doesn't trigger the DoS code on purpose; if it did, it would make it easier
+    // for an attacker to attempt to split the network.
+    std::vector<const Coin*> vCoins;
+    if (!inputs.GetInputs(tx, vCoins))
+        return state.Invalid(false, 0, "", "Inputs unavailable");
+
+    return CheckInputs(tx, state, vCoins, GetSpendHeight(inputs), fScriptChecks, flags, cacheStore, precomTxData, pvChecks);
+}
+
+bool CheckInputs(const CTransaction& tx, CValidationState &state, const std::vector<const Coin*>& vCoins, int nSpendHeight, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck> *pvChecks)
 {
     if (!tx.IsCoinBase()) {
 
-        if (!Consensus::CheckTxInputs(tx, state, inputs, GetSpendHeight(inputs)))
+        if (!Consensus::CheckTxInputs(tx, state, vCoins, nSpendHeight))
             return false;
 
         if (pvChecks)
@@ -1721,8 +1853,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
         // still computed and checked, and any change will be caught at the next checkpoint.
         if (fScriptChecks) {
             for (unsigned int i = 0; i < tx.vin.size(); i++) {
-                const COutPoint& prevout = tx.vin[i].prevout;
-                const Coin& coin = inputs.AccessCoin(prevout);
+                const Coin& coin = *vCoins[i];
                 assert(!coin.IsSpent());
 
                 // We very carefully only pass in things to CScriptCheck which
@@ -1814,6 +1945,8 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
+} // anon namespace
+
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
 {
     // Open history file to read
@@ -1839,8 +1972,6 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uin
     return true;
 }
 
-} // anon namespace
-
 enum DisconnectResult
 {
     DISCONNECT_OK,      // All good.
@@ -1882,7 +2013,7 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
 
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  When UNCLEAN or FAILED is returned, view is left in an indeterminate state. */
-DisconnectResult DisconnectBlock(CBlock& block, CBlockIndex* pindex, CCoinsViewCache& view)
+DisconnectResult DisconnectBlock(const CBlock& block, CBlockIndex* pindex, CCoinsViewCache& view)
 {
     AssertLockHeld(cs_main);
 
@@ -1966,11 +2097,7 @@ DisconnectResult DisconnectBlock(CBlock& block, CBlockIndex* pindex, CCoinsViewC
     auto amount = CMasternode::GetMasternodePayment(pindex->nHeight);
     auto paidPayee = block.GetPaidPayee(amount);
     if(!paidPayee.empty()) {
-        auto pmn = mnodeman.Find(paidPayee);
-
-        if(pmn) {
-            pmn->lastPaid = INT64_MAX;
-        }
+        mnodeman.UpdateLastPaid(paidPayee, INT64_MAX);
     }
 
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
@@ -2011,6 +2138,7 @@ void ThreadScriptCheck()
 
 static int64_t nTimeVerify = 0;
 static int64_t nTimeConnect = 0;
+static int64_t nTimeResolve = 0;
 static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
@@ -2055,6 +2183,12 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             REJECT_INVALID, "PoW-ended");
 
     bool fScriptChecks = pindex->nHeight >= Checkpoints::GetTotalBlocksEstimate();
+    if (fScriptChecks && IsAssumedValid(pindex->pprev, block.GetHash())) {
+        // Inputs, amounts and the coins set are still checked and updated below
+        fScriptChecks = false;
+        if (!fJustCheck)
+            nAssumedValidBlocks++;
+    }
 
     // If scripts won't be checked anyways, don't bother seeing if CLTV is activated
     bool fCLTVIsActivated = false;
@@ -2067,6 +2201,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     int64_t nTimeStart = GetTimeMicros();
     CAmount nFees = 0;
     int nInputs = 0;
+    int64_t nTimeResolveBlock = 0;
     unsigned int nSigOps = 0;
     CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
     std::vector<std::pair<uint256, CDiskTxPos> > vPos;
@@ -2081,6 +2216,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     std::vector<PrecomputedTransactionData> precomTxData;
     precomTxData.reserve(block.vtx.size()); // Required so that pointers to individual precomTxData don't get invalidated
+    // The coins spent by each transaction, looked up once for all the checks below it
+    std::vector<const Coin*> vCoins;
     for (unsigned int i = 0; i < block.vtx.size(); i++) {
         const CTransaction& tx = block.vtx[i];
 
@@ -2089,15 +2226,26 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (nSigOps > nMaxBlockSigOps)
             return state.DoS(100, error("ConnectBlock() : too many sigops"), REJECT_INVALID, "bad-blk-sigops");
 
+        CAmount nTxValueIn = 0;
         if (!tx.IsCoinBase()) {
-            if (!view.HaveInputs(tx))
+            const int64_t nTimeResolveStart = GetTimeMicros();
+            if (!view.GetInputs(tx, vCoins))
                 return state.DoS(100, error("ConnectBlock() : inputs missing/spent"),
                     REJECT_INVALID, "bad-txns-inputs-missingorspent");
+            nTimeResolveBlock += GetTimeMicros() - nTimeResolveStart;
+            for (const Coin* pcoin : vCoins)
+                nTxValueIn += pcoin->out.nValue;
+
+            // ----------- burn address scanning -----------
+            std::string strBurned;
+            if (SpendsBurnedCoin(tx, vCoins, pindex->nHeight, strBurned))
+                return state.DoS(100, error("%s : Burned address %s tried to send a transaction %s (rejecting it).", __func__, strBurned, tx.GetHash().ToString()),
+                                 REJECT_INVALID, "bad-txns-banned");
 
             // Add in sigops done by pay-to-script-hash inputs;
             // this is to prevent a "rogue miner" from creating
             // an incredibly-expensive-to-validate block.
-            nSigOps += GetP2SHSigOpCount(tx, view);
+            nSigOps += GetP2SHSigOpCount(tx, vCoins);
             if (nSigOps > nMaxBlockSigOps)
                 return state.DoS(100, error("ConnectBlock() : too many sigops"), REJECT_INVALID, "bad-blk-sigops");
 
@@ -2108,8 +2256,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
         if (!tx.IsCoinBase()) {
             if (!tx.IsCoinStake())
-                nFees += view.GetValueIn(tx) - tx.GetValueOut();
-            nValueIn += view.GetValueIn(tx);
+                nFees += nTxValueIn - tx.GetValueOut();
+            nValueIn += nTxValueIn;
 
             std::vector<CScriptCheck> vChecks;
             unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG;
@@ -2117,7 +2265,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                 flags |= SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
 
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
-            if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, precomTxData[i], nScriptCheckThreads ? &vChecks : NULL))
+            if (!CheckInputs(tx, state, vCoins, pindex->nHeight, fScriptChecks, flags, fCacheResults, precomTxData[i], nScriptCheckThreads ? &vChecks : NULL))
                 return error("%s: Check inputs on %s failed with %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
             control.Add(vChecks);
         }
@@ -2139,7 +2287,9 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     int64_t nTime1 = GetTimeMicros();
     nTimeConnect += nTime1 - nTimeStart;
-    LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)block.vtx.size(), 0.001 * (nTime1 - nTimeStart), 0.001 * (nTime1 - nTimeStart) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime1 - nTimeStart) / (nInputs - 1), nTimeConnect * 0.000001);
+    nTimeResolve += nTimeResolveBlock;
+    LogPrint(BCLog::BENCH, "      - Resolve %u inputs: %.2fms [%.2fs]\n", (unsigned)nInputs, 0.001 * nTimeResolveBlock, nTimeResolve * 0.000001);
+    LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]%s\n", (unsigned)block.vtx.size(), 0.001 * (nTime1 - nTimeStart), 0.001 * (nTime1 - nTimeStart) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime1 - nTimeStart) / (nInputs - 1), nTimeConnect * 0.000001, fScriptChecks ? "" : " (scripts not checked)");
 
     //PoW phase redistributed fees to miner. PoS stage destroys fees.
     CAmount nExpectedMint = CMasternode::GetBlockValue(pindex->pprev->nHeight + 1);
@@ -2208,23 +2358,235 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     // Fill lastPaid
     auto amount = CMasternode::GetMasternodePayment(pindex->nHeight);
     auto paidPayee = block.GetPaidPayee(amount);
+    if (!pindex->paidPayee) {
+        pindex->paidPayee = paidPayee;
+        setDirtyBlockIndex.insert(pindex);
+    }
     if(!paidPayee.empty()) {
-        auto pmn = mnodeman.Find(paidPayee);
+        mnodeman.UpdateLastPaid(paidPayee, pindex->GetBlockTime());
+    }
+
+    return true;
+}
+
+uint64_t CalculateCurrentUsage()
+{
+    LOCK(cs_LastBlockFile);
+    uint64_t retval = 0;
+    for (const CBlockFileInfo& file : vinfoBlockFile) {
+        retval += file.nSize + file.nUndoSize;
+    }
+    return retval;
+}
+
+bool IsBlockFilePruned(int nFile)
+{
+    LOCK(cs_LastBlockFile);
+    return fHavePruned && nFile >= 0 && nFile < nLastBlockFile && vinfoBlockFile[nFile].nBlocks == 0;
+}
 
-        if(pmn) {
-            pmn->lastPaid = pindex->GetBlockTime();
+/** Prune a block file (modify associated database entries) */
+static void PruneOneBlockFile(const int fileNumber)
+{
+    AssertLockHeld(cs_main);
+    for (BlockMap::iterator it = mapBlockIndex.begin(); it != mapBlockIndex.end(); ++it) {
+        CBlockIndex* pindex = it->second;
+        if (pindex->nFile == fileNumber) {
+            pindex->nStatus &= ~BLOCK_HAVE_DATA;
+            pindex->nStatus &= ~BLOCK_HAVE_UNDO;
+            pindex->nFile = 0;
+            pindex->nDataPos = 0;
+            pindex->nUndoPos = 0;
+            setDirtyBlockIndex.insert(pindex);
+
+            // Prune from mapBlocksUnlinked -- any block we prune would have
+            // to be downloaded again in order to consider its chain, at which
+            // point it would be considered as a candidate for
+            // mapBlocksUnlinked or setBlockIndexCandidates.
+            std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> range = mapBlocksUnlinked.equal_range(pindex->pprev);
+            while (range.first != range.second) {
+                std::multimap<CBlockIndex*, CBlockIndex*>::iterator itUnlinked = range.first;
+                range.first++;
+                if (itUnlinked->second == pindex) {
+                    mapBlocksUnlinked.erase(itUnlinked);
+                }
+            }
         }
     }
 
-    return true;
+    vinfoBlockFile[fileNumber].SetNull();
+    setDirtyFileInfo.insert(fileNumber);
+}
+
+void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
+{
+    for (std::set<int>::const_iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
+        CDiskBlockPos pos(*it, 0);
+        fs::remove(GetBlockPosFilename(pos, "blk"));
+        fs::remove(GetBlockPosFilename(pos, "rev"));
+        LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
+    }
+}
+
+/**
+ * Blocks below the tip whose data is kept: those a reorg can disconnect,
+ * and those read back when the masternode last paid times are looked up.
+ */
+static unsigned int GetPruneKeepDepth()
+{
+    const int64_t nMaxReorg = GetArg("-maxreorg", DEFAULT_MAX_REORG_DEPTH);
+    const int64_t nMasternodes = 2 * (int64_t)mnodeman.size();
+    return (unsigned int)std::max<int64_t>(MIN_BLOCKS_TO_KEEP, std::max(nMaxReorg, nMasternodes));
+}
+
+/**
+ * Calculate the block/rev files that should be deleted to remain under target
+ * The files whose highest block is within the keep depth of the tip are never deleted.
+ */
+static void FindFilesToPrune(std::set<int>& setFilesToPrune)
+{
+    LOCK2(cs_main, cs_LastBlockFile);
+    if (chainActive.Tip() == NULL || nPruneTarget == 0) {
+        return;
+    }
+    const unsigned int nKeepDepth = GetPruneKeepDepth();
+    if ((unsigned int)chainActive.Height() <= nKeepDepth) {
+        return;
+    }
+
+    const unsigned int nLastBlockWeCanPrune = chainActive.Height() - nKeepDepth;
+    uint64_t nCurrentUsage = CalculateCurrentUsage();
+    // We don't check to prune until after we've allocated new space for files
+    // So we should leave a buffer under our target to account for another allocation
+    // before the next pruning.
+    const uint64_t nBuffer = BLOCKFILE_CHUNK_SIZE + UNDOFILE_CHUNK_SIZE;
+    uint64_t nBytesToPrune;
+    int count = 0;
+
+    if (nCurrentUsage + nBuffer >= nPruneTarget) {
+        for (int fileNumber = 0; fileNumber < nLastBlockFile; fileNumber++) {
+            nBytesToPrune = vinfoBlockFile[fileNumber].nSize + vinfoBlockFile[fileNumber].nUndoSize;
+
+            if (vinfoBlockFile[fileNumber].nSize == 0)
+                continue;
+
+            if (nCurrentUsage + nBuffer < nPruneTarget) // are we below our target?
+                break;
+
+            // don't prune files that could have a block within the keep depth of the tip
+            if (vinfoBlockFile[fileNumber].nHeightLast > nLastBlockWeCanPrune)
+                continue;
+
+            PruneOneBlockFile(fileNumber);
+            // Queue up the files for removal
+            setFilesToPrune.insert(fileNumber);
+            nCurrentUsage -= nBytesToPrune;
+            count++;
+        }
+    }
+
+    LogPrint(BCLog::PRUNE, "Prune: target=%dMiB actual=%dMiB diff=%dMiB max_prune_height=%d removed %d blk/rev pairs\n",
+        nPruneTarget / 1024 / 1024, nCurrentUsage / 1024 / 1024,
+        ((int64_t)nPruneTarget - (int64_t)nCurrentUsage) / 1024 / 1024,
+        nLastBlockWeCanPrune, count);
 }
 
 enum FlushStateMode {
+    FLUSH_STATE_NONE,
     FLUSH_STATE_IF_NEEDED,
     FLUSH_STATE_PERIODIC,
     FLUSH_STATE_ALWAYS
 };
 
+/**
+ * A proof of stake header whose block never arrived: nothing backs it, its stake
+ * being unchecked, so it is neither written to disk nor taken as best header.
+ */
+static bool IsUncheckedHeader(const CBlockIndex* pindex)
+{
+    return pindex->nTx == 0 && pindex->pprev &&
+           Params().GetConsensus().NetworkUpgradeActive(pindex->nHeight, Consensus::UPGRADE_POS);
+}
+
+/** An unchecked header, counted against the peer that sent it until its block arrives */
+struct CUncheckedHeader {
+    NodeId nodeid;
+    int64_t nTimeExpire;
+    //! Block index entries on top of it, which it can't be dropped before
+    int nChildren;
+};
+std::map<CBlockIndex*, CUncheckedHeader> mapUncheckedHeaders GUARDED_BY(cs_main);
+
+static void UntrackUncheckedHeader(std::map<CBlockIndex*, CUncheckedHeader>::iterator it)
+{
+    AssertLockHeld(cs_main);
+    CNodeState* nodestate = State(it->second.nodeid);
+    if (nodestate)
+        nodestate->nUncheckedHeaders--;
+    mapUncheckedHeaders.erase(it);
+}
+
+/** Stop counting pindex against its peer once its block arrived */
+static void ReleaseUncheckedHeader(CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    auto it = mapUncheckedHeaders.find(pindex);
+    if (it != mapUncheckedHeaders.end())
+        UntrackUncheckedHeader(it);
+}
+
+/**
+ * Remove an unchecked header from the block index and free it, unless something
+ * still refers to it: an entry on top of it, a download or an invalid mark.
+ */
+static bool FreeUncheckedHeader(std::map<CBlockIndex*, CUncheckedHeader>::iterator it)
+{
+    AssertLockHeld(cs_main);
+    CBlockIndex* pindex = it->first;
+    const uint256 hash = pindex->GetBlockHash();
+    if (it->second.nChildren > 0 || mapBlocksInFlight.count(hash) || (pindex->nStatus & BLOCK_FAILED_MASK))
+        return false;
+
+    for (auto& entry : mapNodeState) {
+        CNodeState& nodestate = entry.second;
+        if (nodestate.pindexBestKnownBlock == pindex)
+            nodestate.pindexBestKnownBlock = pindex->pprev;
+        if (nodestate.pindexLastCommonBlock == pindex)
+            nodestate.pindexLastCommonBlock = pindex->pprev;
+        if (nodestate.pindexHeadersPaused == pindex)
+            nodestate.pindexHeadersPaused = pindex->pprev;
+    }
+    if (pindexBestHeader == pindex)
+        pindexBestHeader = pindex->pprev;
+    auto itParent = mapUncheckedHeaders.find(pindex->pprev);
+    if (itParent != mapUncheckedHeaders.end())
+        itParent->second.nChildren--;
+    UntrackUncheckedHeader(it);
+    setDirtyBlockIndex.erase(pindex);
+    mapBlockIndex.erase(hash);
+    delete pindex;
+    return true;
+}
+
+/** Free the unchecked headers whose block didn't arrive in time, the highest first for their parents to follow */
+static void ExpireUncheckedHeaders(int64_t nNow)
+{
+    AssertLockHeld(cs_main);
+    std::vector<std::map<CBlockIndex*, CUncheckedHeader>::iterator> vExpired;
+    for (auto it = mapUncheckedHeaders.begin(); it != mapUncheckedHeaders.end(); ++it) {
+        if (it->second.nTimeExpire < nNow)
+            vExpired.push_back(it);
+    }
+    std::sort(vExpired.begin(), vExpired.end(), [](const std::map<CBlockIndex*, CUncheckedHeader>::iterator& a, const std::map<CBlockIndex*, CUncheckedHeader>::iterator& b) {
+        return a->first->nHeight > b->first->nHeight;
+    });
+    int nFreed = 0;
+    for (auto it : vExpired)
+        nFreed += FreeUncheckedHeader(it);
+    if (nFreed > 0)
+        LogPrint(BCLog::NET, "%s : dropped %d unchecked headers whose block didn't arrive\n", __func__, nFreed);
+}
+
 /**
  * Update the on-disk chain state.
  * The caches and indexes are flushed if either they're too large, forceWrite is set, or
@@ -2237,7 +2599,20 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
     static int64_t nLastWrite = 0;
     static int64_t nLastFlush = 0;
     static int64_t nLastSetChain = 0;
+    std::set<int> setFilesToPrune;
+    bool fFlushForPrune = false;
     try {
+        if (fPruneMode && fCheckForPruning && !fReindex) {
+            FindFilesToPrune(setFilesToPrune);
+            fCheckForPruning = false;
+            if (!setFilesToPrune.empty()) {
+                fFlushForPrune = true;
+                if (!fHavePruned) {
+                    pblocktree->WriteFlag("prunedblockfiles", true);
+                    fHavePruned = true;
+                }
+            }
+        }
         int64_t nNow = GetTimeMicros();
         // Avoid writing/flushing immediately after startup.
         if (nLastWrite == 0) {
@@ -2264,7 +2639,7 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
         // It's been very long since we flushed the cache. Do this infrequently, to optimize cache usage.
         bool fPeriodicFlush = mode == FLUSH_STATE_PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
         // Combine all conditions that result in a full cache flush.
-        bool fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush;
+        bool fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune;
         // Write blocks and block index to disk.
         if (fDoFullFlush || fPeriodicWrite) {
             // Depend on nMinDiskSpace to ensure we can write block index
@@ -2283,13 +2658,18 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
                 std::vector<const CBlockIndex*> vBlocks;
                 vBlocks.reserve(setDirtyBlockIndex.size());
                 for (std::set<CBlockIndex*>::iterator it = setDirtyBlockIndex.begin(); it != setDirtyBlockIndex.end(); ) {
-                    vBlocks.push_back(*it);
+                    // Written once its block arrives
+                    if (!IsUncheckedHeader(*it))
+                        vBlocks.push_back(*it);
                     setDirtyBlockIndex.erase(it++);
                 }
                 if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                     return AbortNode(state, "Files to write to block index database");
                 }
             }
+            // Finally remove any pruned files
+            if (fFlushForPrune)
+                UnlinkPrunedFiles(setFilesToPrune);
             nLastWrite = nNow;
         }
 
@@ -2303,7 +2683,11 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
             if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
             // Flush the chainstate (which may refer to block index entries).
-            if (!pcoinsTip->Flush())
+            // Coins being prefetched are read again once the database is written.
+            coinsPrefetcher.Invalidate();
+            const bool fFlushed = pcoinsTip->Flush();
+            coinsPrefetcher.Invalidate();
+            if (!fFlushed)
                 return AbortNode(state, "Failed to write to coin database");
             nLastFlush = nNow;
         }
@@ -2325,6 +2709,79 @@ void FlushStateToDisk()
     FlushStateToDisk(state, FLUSH_STATE_ALWAYS);
 }
 
+void PruneAndFlush()
+{
+    CValidationState state;
+    fCheckForPruning = true;
+    FlushStateToDisk(state, FLUSH_STATE_NONE);
+}
+
+int MigratePaidPayees(int nMaxDepth)
+{
+    // Entries written before the paid payee was stored, the most recent first
+    std::vector<CBlockIndex*> vMissing;
+    {
+        LOCK(cs_main);
+        const int nTipHeight = chainActive.Height();
+        for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->nHeight > 0; pindex = pindex->pprev) {
+            if (nMaxDepth >= 0 && nTipHeight - pindex->nHeight >= nMaxDepth)
+                break;
+            if (!pindex->paidPayee && (pindex->nStatus & BLOCK_HAVE_DATA))
+                vMissing.push_back(pindex);
+        }
+    }
+
+    int nMigrated = 0;
+    std::vector<std::pair<uint256, CDiskBlockIndex> > vBatch;
+    auto writeBatch = [&]() {
+        // Under cs_main, for a flush not to be overwritten by an older copy of the same entries
+        LOCK(cs_main);
+        if (!vBatch.empty() && !pblocktree->WriteBlockIndexes(vBatch, false))
+            return error("%s : failed to write the block index", __func__);
+        vBatch.clear();
+        return true;
+    };
+
+    for (CBlockIndex* pindex : vMissing) {
+        if (ShutdownRequested())
+            break;
+
+        CDiskBlockPos pos;
+        {
+            LOCK(cs_main);
+            // Pruned meanwhile
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA))
+                continue;
+            pos = pindex->GetBlockPos();
+        }
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pos) || block.GetHash() != pindex->GetBlockHash())
+            continue;
+        const CScript payee = block.GetPaidPayee(CMasternode::GetMasternodePayment(pindex->nHeight));
+
+        LOCK(cs_main);
+        if (pindex->paidPayee)
+            continue;
+        pindex->paidPayee = payee;
+        vBatch.emplace_back(pindex->GetBlockHash(), CDiskBlockIndex(pindex));
+        nMigrated++;
+        if (vBatch.size() >= PAYEE_MIGRATION_BATCH && !writeBatch())
+            return nMigrated;
+    }
+    writeBatch();
+
+    return nMigrated;
+}
+
+void ThreadMigratePaidPayees()
+{
+    util::ThreadRename("pivx-payees");
+    const int64_t nStart = GetTimeMillis();
+    const int nMigrated = MigratePaidPayees(-1);
+    if (nMigrated > 0)
+        LogPrintf("Stored the paid payee of %d older blocks in the block index in %dms\n", nMigrated, GetTimeMillis() - nStart);
+}
+
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex* pindexNew)
 {
@@ -2374,9 +2831,10 @@ bool static DisconnectTip(CValidationState& state)
     CBlockIndex* pindexDelete = chainActive.Tip();
     assert(pindexDelete);
     // Read block from disk.
-    CBlock block;
-    if (!ReadBlockFromDisk(block, pindexDelete))
+    std::shared_ptr<const CBlock> pblock;
+    if (!ReadBlockFromDisk(pblock, pindexDelete))
         return AbortNode(state, "Failed to read block");
+    const CBlock& block = *pblock;
     // Apply the block atomically to the chain state.
     int64_t nStart = GetTimeMicros();
     {
@@ -2422,6 +2880,7 @@ bool static DisconnectTip(CValidationState& state)
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
@@ -2440,17 +2899,23 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, const CB
 
     // Read block from disk.
     int64_t nTime1 = GetTimeMicros();
-    CBlock block;
+    std::shared_ptr<const CBlock> pblockRead;
     if (!pblock) {
-        if (!ReadBlockFromDisk(block, pindexNew))
+        if (!ReadBlockFromDisk(pblockRead, pindexNew))
             return AbortNode(state, "Failed to read block");
-        pblock = &block;
+        pblock = pblockRead.get();
     }
     // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros();
     nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
+    // Move the coins read in the background into the cache, reading the rest on all threads
+    const size_t nPrefetched = coinsPrefetcher.Apply(*pblock, *pcoinsTip);
+    int64_t nTimePrefetched = GetTimeMicros();
+    nTimePrefetch += nTimePrefetched - nTime2;
+    LogPrint(BCLog::BENCH, "  - Prefetch coins: %.2fms (%u coins) [%.2fs]\n", (nTimePrefetched - nTime2) * 0.001, (unsigned)nPrefetched, nTimePrefetch * 0.000001);
+    nTime2 = nTimePrefetched;
     {
         CCoinsViewCache view(pcoinsTip);
         bool rv = ConnectBlock(*pblock, state, pindexNew, view, false, fAlreadyChecked);
@@ -2574,7 +3039,7 @@ static CBlockIndex* FindMostWorkChain()
             // for the most work chain if we come across them; we can't switch
             // to a chain unless we have all the non-active-chain parent blocks.
             bool fFailedChain = pindexTest->nStatus & BLOCK_FAILED_MASK;
-            bool fMissingData = !(pindexTest->nStatus & BLOCK_HAVE_DATA);
+            bool fMissingData = !(pindexTest->nStatus & (BLOCK_HAVE_DATA | BLOCK_SNAPSHOT));
             if (fFailedChain || fMissingData) {
                 // Candidate chain is not usable (either invalid or missing data)
                 if (fFailedChain && (pindexBestInvalid == NULL || pindexNew->nChainWork > pindexBestInvalid->nChainWork))
@@ -2655,6 +3120,14 @@ static bool ActivateBestChainStep(CValidationState& state, CBlockIndex* pindexMo
         }
         nHeight = nTargetHeight;
 
+        // Read the coins spent by the blocks to connect while the first ones are being connected
+        BOOST_REVERSE_FOREACH (CBlockIndex* pindexConnect, vpindexToConnect) {
+            if (pindexConnect == pindexMostWork && pblock)
+                coinsPrefetcher.Prefetch(*pblock);
+            else if (pindexConnect->nStatus & BLOCK_HAVE_DATA)
+                coinsPrefetcher.Prefetch(pindexConnect->GetBlockHash(), pindexConnect->GetBlockPos());
+        }
+
         // Connect new blocks.
         BOOST_REVERSE_FOREACH (CBlockIndex* pindexConnect, vpindexToConnect) {
             if (!ConnectTip(state, pindexConnect, pindexConnect == pindexMostWork ? pblock : NULL, fAlreadyChecked, txConflicted, txChanged)) {
@@ -2876,6 +3349,20 @@ bool ReconsiderBlock(CValidationState& state, CBlockIndex* pindex)
     return true;
 }
 
+/** Compute and set the stake modifier of pindexNew, whose parent has its own already set */
+static void SetBlockStakeModifier(CBlockIndex* pindexNew, const CBlock& block)
+{
+    const Consensus::Params& consensus = Params().GetConsensus();
+    if (!consensus.NetworkUpgradeActive(pindexNew->nHeight, Consensus::UPGRADE_STAKE_MODIFIER_V2)) {
+        // compute and set new V1 stake modifier (entropy bits)
+        pindexNew->SetNewStakeModifier();
+
+    } else {
+        // compute and set new V2 stake modifier (hash of prevout and prevModifier)
+        pindexNew->SetNewStakeModifier(block.vtx[1].vin[0].prevout.hash);
+    }
+}
+
 CBlockIndex* AddToBlockIndex(const CBlock& block)
 {
     // Check for duplicate
@@ -2899,23 +3386,22 @@ CBlockIndex* AddToBlockIndex(const CBlock& block)
         pindexNew->pprev = (*miPrev).second;
         pindexNew->nHeight = pindexNew->pprev->nHeight + 1;
         pindexNew->BuildSkip();
+        auto itUnchecked = mapUncheckedHeaders.find(pindexNew->pprev);
+        if (itUnchecked != mapUncheckedHeaders.end())
+            itUnchecked->second.nChildren++;
 
-        const Consensus::Params& consensus = Params().GetConsensus();
-        if (!consensus.NetworkUpgradeActive(pindexNew->nHeight, Consensus::UPGRADE_STAKE_MODIFIER_V2)) {
-            // compute and set new V1 stake modifier (entropy bits)
-            pindexNew->SetNewStakeModifier();
-
-        } else {
-            // compute and set new V2 stake modifier (hash of prevout and prevModifier)
-            pindexNew->SetNewStakeModifier(block.vtx[1].vin[0].prevout.hash);
-        }
+        // A header alone can't give the stake modifier, it is set once the block arrives
+        if (!block.vtx.empty())
+            SetBlockStakeModifier(pindexNew, block);
     }
     pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew);
     pindexNew->RaiseValidity(BLOCK_VALID_TREE);
-    if (pindexBestHeader == NULL || pindexBestHeader->nChainWork < pindexNew->nChainWork)
-        pindexBestHeader = pindexNew;
-
-    setDirtyBlockIndex.insert(pindexNew);
+    // Left to ReceivedBlockTransactions for an unchecked header
+    if (!IsUncheckedHeader(pindexNew)) {
+        if (pindexBestHeader == NULL || pindexBestHeader->nChainWork < pindexNew->nChainWork)
+            pindexBestHeader = pindexNew;
+        setDirtyBlockIndex.insert(pindexNew);
+    }
 
     return pindexNew;
 }
@@ -2933,6 +3419,9 @@ bool ReceivedBlockTransactions(const CBlock& block, CValidationState& state, CBl
     pindexNew->nStatus |= BLOCK_HAVE_DATA;
     pindexNew->RaiseValidity(BLOCK_VALID_TRANSACTIONS);
     setDirtyBlockIndex.insert(pindexNew);
+    ReleaseUncheckedHeader(pindexNew);
+    if (pindexBestHeader == NULL || pindexBestHeader->nChainWork < pindexNew->nChainWork)
+        pindexBestHeader = pindexNew;
 
     if (pindexNew->pprev == NULL || pindexNew->pprev->nChainTx) {
         // If pindexNew is the genesis block or all parents are BLOCK_VALID_TRANSACTIONS.
@@ -3001,6 +3490,8 @@ bool FindBlockPos(CValidationState& state, CDiskBlockPos& pos, unsigned int nAdd
         unsigned int nOldChunks = (pos.nPos + BLOCKFILE_CHUNK_SIZE - 1) / BLOCKFILE_CHUNK_SIZE;
         unsigned int nNewChunks = (vinfoBlockFile[nFile].nSize + BLOCKFILE_CHUNK_SIZE - 1) / BLOCKFILE_CHUNK_SIZE;
         if (nNewChunks > nOldChunks) {
+            if (fPruneMode)
+                fCheckForPruning = true;
             if (CheckDiskSpace(nNewChunks * BLOCKFILE_CHUNK_SIZE - pos.nPos)) {
                 FILE* file = OpenBlockFile(pos);
                 if (file) {
@@ -3031,6 +3522,8 @@ bool FindUndoPos(CValidationState& state, int nFile, CDiskBlockPos& pos, unsigne
     unsigned int nOldChunks = (pos.nPos + UNDOFILE_CHUNK_SIZE - 1) / UNDOFILE_CHUNK_SIZE;
     unsigned int nNewChunks = (nNewSize + UNDOFILE_CHUNK_SIZE - 1) / UNDOFILE_CHUNK_SIZE;
     if (nNewChunks > nOldChunks) {
+        if (fPruneMode)
+            fCheckForPruning = true;
         if (CheckDiskSpace(nNewChunks * UNDOFILE_CHUNK_SIZE - pos.nPos)) {
             FILE* file = OpenUndoFile(pos);
             if (file) {
@@ -3054,9 +3547,9 @@ bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool f
     return true;
 }
 
-bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckSig)
+bool CheckBlockContextFree(const CBlock& block, CValidationState& state, bool fCheckPOW, bool fCheckMerkleRoot)
 {
-    if (block.fChecked)
+    if (block.fCheckedContextFree)
         return true;
 
     // These are checks that are independent of context.
@@ -3110,6 +3603,40 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
                 return state.DoS(100, false, REJECT_INVALID, "bad-cs-multiple", false, "more than one coinstake");
     }
 
+    // Check transactions
+    for (const CTransaction& tx : block.vtx) {
+        if (!CheckTransaction(
+                tx,
+                state
+        ))
+            return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
+                                             strprintf("Transaction check failed (tx hash %s) %s", tx.GetHash().ToString(), state.GetDebugMessage()));
+
+    }
+
+    unsigned int nSigOps = 0;
+    for (const CTransaction& tx : block.vtx) {
+        nSigOps += GetLegacySigOpCount(tx);
+    }
+    unsigned int nMaxBlockSigOps = MAX_BLOCK_SIGOPS_LEGACY;
+    if (nSigOps > nMaxBlockSigOps)
+        return state.DoS(100, error("%s : out-of-bounds SigOpCount", __func__),
+            REJECT_INVALID, "bad-blk-sigops", true);
+
+    if (fCheckPOW && fCheckMerkleRoot)
+        block.fCheckedContextFree = true;
+
+    return true;
+}
+
+bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckSig)
+{
+    if (block.fChecked)
+        return true;
+
+    if (!CheckBlockContextFree(block, state, fCheckPOW, fCheckMerkleRoot))
+        return false;
+
     // masternode payments / budgets
     CBlockIndex* pindexPrev = chainActive.Tip();
     int nHeight = 0;
@@ -3143,26 +3670,6 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
         }
     }
 
-    // Check transactions
-    for (const CTransaction& tx : block.vtx) {
-        if (!CheckTransaction(
-                tx,
-                state
-        ))
-            return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
-                                             strprintf("Transaction check failed (tx hash %s) %s", tx.GetHash().ToString(), state.GetDebugMessage()));
-
-    }
-
-    unsigned int nSigOps = 0;
-    for (const CTransaction& tx : block.vtx) {
-        nSigOps += GetLegacySigOpCount(tx);
-    }
-    unsigned int nMaxBlockSigOps = MAX_BLOCK_SIGOPS_LEGACY;
-    if (nSigOps > nMaxBlockSigOps)
-        return state.DoS(100, error("%s : out-of-bounds SigOpCount", __func__),
-            REJECT_INVALID, "bad-blk-sigops", true);
-
     if (fCheckPOW && fCheckMerkleRoot && fCheckSig)
         block.fChecked = true;
 
@@ -3306,7 +3813,6 @@ bool IsTransactionInChain(const uint256& txId, int& nHeightTx)
 bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIndex* const pindexPrev)
 {
     const int nHeight = pindexPrev == nullptr ? 0 : pindexPrev->nHeight + 1;
-    const Consensus::Params& consensus = Params().GetConsensus();
 
     // Check that all transactions are finalized
     for (const CTransaction& tx : block.vtx) {
@@ -3315,27 +3821,7 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIn
         }
     }
 
-    // ----------- burn address scanning -----------
-    if (!consensus.mBurnAddresses.empty()) {
-        for (const CTransaction& tx : block.vtx) {
-            if (!tx.IsCoinBase()) {
-                for (unsigned int i = 0; i < tx.vin.size(); ++i) {
-                    uint256 hashBlock;
-                    CTransaction txPrev;
-                    if (GetTransaction(tx.vin[i].prevout.hash, txPrev, hashBlock, true)) { // get the vin's previous transaction
-                        CTxDestination source;
-                        if (ExtractDestination(txPrev.vout[tx.vin[i].prevout.n].scriptPubKey, source)) { // extract the destination of the previous transaction's vout[n]
-                            const std::string addr = EncodeDestination(source);
-                            if (consensus.mBurnAddresses.find(addr) != consensus.mBurnAddresses.end() &&
-                                consensus.mBurnAddresses.at(addr) < nHeight) {
-                                return state.DoS(100, error("%s : Burned address %s tried to send a transaction %s (rejecting it).", __func__, addr.c_str(), txPrev.GetHash().ToString().c_str()), REJECT_INVALID, "bad-txns-banned");
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
+    // The spends of burned addresses are rejected by ConnectBlock, from the coins of the chain the block is on
 
     // // Enforce block.nVersion=2 rule that the coinbase starts with serialized block height
     // if (pindexPrev) { // pindexPrev is only null on the first block which is a version 1 block.
@@ -3364,7 +3850,59 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIn
     return true;
 }
 
-bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex** ppindex)
+static CSpentOutpointIndex spentOutpointIndex;
+static CForkStakeCheckStats forkStakeCheckStats;
+
+CForkStakeCheckStats GetForkStakeCheckStats()
+{
+    LOCK(cs_main);
+    return forkStakeCheckStats;
+}
+
+/** Time the best header chain must extend past a block, at the target spacing, for it to be assumed valid: two weeks */
+static const int64_t ASSUME_VALID_MIN_TIMESPAN = 14 * 24 * 60 * 60;
+
+bool IsAssumedValid(const CBlockIndex* pindexPrev, const uint256& hashBlock)
+{
+    AssertLockHeld(cs_main);
+    if (hashAssumeValid.IsNull() || !pindexPrev || !pindexBestHeader)
+        return false;
+    BlockMap::const_iterator it = mapBlockIndex.find(hashAssumeValid);
+    if (it == mapBlockIndex.end())
+        return false;
+    const CBlockIndex* pindexAssumed = it->second;
+    const int nHeight = pindexPrev->nHeight + 1;
+    if (nHeight > pindexAssumed->nHeight)
+        return false;
+    // The block is an ancestor of the assumed valid one...
+    const CBlockIndex* pindex = pindexAssumed->GetAncestor(nHeight);
+    if (pindex->GetBlockHash() != hashBlock || pindex->pprev != pindexPrev)
+        return false;
+    // ...which is itself in the best header chain, with enough headers on top to not be a fork made up for us
+    if (pindexBestHeader->GetAncestor(pindexAssumed->nHeight) != pindexAssumed)
+        return false;
+    const int64_t nSpacing = Params().GetConsensus().nTargetSpacing;
+    return (int64_t)(pindexBestHeader->nHeight - nHeight) * nSpacing >= ASSUME_VALID_MIN_TIMESPAN;
+}
+
+uint64_t GetAssumedValidBlocks()
+{
+    LOCK(cs_main);
+    return nAssumedValidBlocks;
+}
+
+COrphanBlockStats GetOrphanBlockStats()
+{
+    LOCK(cs_main);
+    COrphanBlockStats stats;
+    stats.nBlocks = mapOrphanBlocks.size();
+    stats.nBytes = nOrphanBlocksSize;
+    stats.nSaved = nOrphanBlocksSaved;
+    stats.nDropped = nOrphanBlocksDropped;
+    return stats;
+}
+
+bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex** ppindex, NodeId nodeid)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
@@ -3380,10 +3918,19 @@ bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex
             *ppindex = pindex;
         if (pindex->nStatus & BLOCK_FAILED_MASK)
             return state.Invalid(error("%s : block is marked invalid", __func__), 0, "duplicate");
+        // Announced again, its block may still come
+        auto itUnchecked = mapUncheckedHeaders.find(pindex);
+        if (itUnchecked != mapUncheckedHeaders.end())
+            itUnchecked->second.nTimeExpire = GetTime() + UNCHECKED_HEADER_EXPIRE_TIME;
         return true;
     }
 
-    if (!CheckBlockHeader(block, state, !block.IsProofOfStake())) {
+    // A bare header, received in a headers message, doesn't carry the coinstake
+    const bool fHeaderOnly = block.vtx.empty();
+    // Before the parent is looked up, it may be one of them
+    if (fHeaderOnly && mapUncheckedHeaders.size() >= MAX_UNCHECKED_HEADERS)
+        ExpireUncheckedHeaders(GetTime());
+    if (!fHeaderOnly && !CheckBlockHeader(block, state, !block.IsProofOfStake())) {
         return error("%s: CheckBlockHeader failed for block %s: %s", __func__, hash.ToString(), FormatStateMessage(state));
     }
 
@@ -3418,12 +3965,39 @@ bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex
 
     }
 
+    if (fHeaderOnly && pindexPrev) {
+        // Whether the header needs a proof of work is told by its height
+        const bool fPoS = Params().GetConsensus().NetworkUpgradeActive(pindexPrev->nHeight + 1, Consensus::UPGRADE_POS);
+        // Nothing backs a proof of stake header until its block arrives
+        if (fPoS && pindexPrev->nHeight + 1 > chainActive.Height() + (int)MAX_UNCHECKED_HEADERS_AHEAD)
+            return state.DoS(0, false, REJECT_INVALID, "header-too-far-ahead");
+        // Nor does anything bound their number but these limits: past its own, a peer sends headers no chain needs
+        CNodeState* nodestate = State(nodeid);
+        if (fPoS && nodestate && nodestate->nUncheckedHeaders >= (int)MAX_UNCHECKED_HEADERS_PER_PEER)
+            return state.DoS(20, error("%s : too many unchecked headers from peer=%d", __func__, nodeid),
+                             REJECT_INVALID, "too-many-unchecked-headers");
+        if (fPoS && mapUncheckedHeaders.size() >= MAX_UNCHECKED_HEADERS)
+            return state.DoS(0, false, REJECT_INVALID, "header-too-far-ahead");
+        if (!CheckBlockHeader(block, state, !fPoS))
+            return error("%s: CheckBlockHeader failed for block %s: %s", __func__, hash.ToString(), FormatStateMessage(state));
+        if (!CheckWork(block, pindexPrev))
+            return state.DoS(100, error("%s : incorrect difficulty for header %s", __func__, hash.ToString()),
+                             REJECT_INVALID, "bad-diffbits");
+    }
+
     if (!ContextualCheckBlockHeader(block, state, pindexPrev))
         return error("%s: ContextualCheckBlockHeader failed for block %s: %s", __func__, hash.ToString(), FormatStateMessage(state));
 
     if (pindex == NULL)
         pindex = AddToBlockIndex(block);
 
+    if (IsUncheckedHeader(pindex)) {
+        mapUncheckedHeaders[pindex] = {nodeid, GetTime() + UNCHECKED_HEADER_EXPIRE_TIME, 0};
+        CNodeState* nodestate = State(nodeid);
+        if (nodestate)
+            nodestate->nUncheckedHeaders++;
+    }
+
     if (ppindex)
         *ppindex = pindex;
 
@@ -3474,10 +4048,11 @@ bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockIndex** ppi
     bool isPoS = block.IsProofOfStake();
     if (isPoS) {
         std::string strError;
-        if (!CheckProofOfStake(block, strError, pindexPrev))
+        if (!CheckProofOfStake(block, strError, pindexPrev, !IsAssumedValid(pindexPrev, block.GetHash())))
             return state.DoS(100, error("%s: proof of stake check failed (%s)", __func__, strError));
     }
 
+    const bool fKnownHeader = mapBlockIndex.count(block.GetHash());
     if (!AcceptBlockHeader(block, state, &pindex))
         return false;
 
@@ -3496,6 +4071,10 @@ bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockIndex** ppi
         return error("%s: %s", __func__, FormatStateMessage(state));
     }
 
+    // The index entry may come from a headers message, without stake modifier
+    if (fKnownHeader && pindex->pprev)
+        SetBlockStakeModifier(pindex, block);
+
     int nHeight = pindex->nHeight;
 
     if (isPoS) {
@@ -3536,47 +4115,40 @@ bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockIndex** ppi
         // Check whether is a fork or not
         if (isBlockFromFork) {
 
-            // Start at the block we're adding on to
-            CBlockIndex *prev = pindexPrev;
-
-            CBlock bl;
-            if (!ReadBlockFromDisk(bl, prev))
-                return error("%s: previous block %s not on disk", __func__, prev->GetBlockHash().GetHex());
+            const int64_t nTimeStart = GetTimeMicros();
+            const int64_t nMaxReorg = GetArg("-maxreorg", DEFAULT_MAX_REORG_DEPTH);
 
+            std::vector<COutPoint> vStakePrevouts;
+            for (const CTxIn& stakeIn : pivInputs)
+                vStakePrevouts.push_back(stakeIn.prevout);
+            // Blocks accepted before the node started are only on disk
+            auto fnRead = [](const CBlockIndex* pindexRead, std::shared_ptr<const CBlock>& pblockRead) {
+                return ReadBlockFromDisk(pblockRead, pindexRead, true);
+            };
             int readBlock = 0;
-            // Go backwards on the forked chain up to the split
-            while (!chainActive.Contains(prev)) {
-
-                // Increase amount of read blocks
-                readBlock++;
-                // Check if the forked chain is longer than the max reorg limit
-                if (readBlock == GetArg("-maxreorg", DEFAULT_MAX_REORG_DEPTH)) {
-                    // TODO: Remove this chain from disk.
-                    return error("%s: forked chain longer than maximum reorg limit", __func__);
-                }
-
-                // Loop through every tx of this block
-                for (const CTransaction& t : bl.vtx) {
-                    // Loop through every input of this tx
-                    for (const CTxIn& in: t.vin) {
-
-                        // Loop through every input of the staking tx
-                        if (hasPIVInputs) {
-                            for (const CTxIn& stakeIn : pivInputs)
-                                // check if the tx input is double spending any coinstake input
-                                if (stakeIn.prevout == in.prevout)
-                                    return state.DoS(100, error("%s: input already spent on a previous block", __func__));
-                        }
-                    }
-                }
-
-                // Prev block
-                prev = prev->pprev;
-                if (!ReadBlockFromDisk(bl, prev))
-                    // Previous block not on disk
-                    return error("%s: previous block %s not on disk", __func__, prev->GetBlockHash().GetHex());
-
+            int nReads = 0;
+            const CSpentOutpointIndex::ForkSpend spend = spentOutpointIndex.CheckFork(pindexPrev, chainActive, vStakePrevouts, nMaxReorg, fnRead, readBlock, nReads);
+            forkStakeCheckStats.nDiskReads += nReads;
+            switch (spend) {
+            case CSpentOutpointIndex::FORK_TOO_DEEP:
+                // TODO: Remove this chain from disk.
+                return error("%s: forked chain longer than maximum reorg limit", __func__);
+            case CSpentOutpointIndex::FORK_NOT_ON_DISK:
+                return error("%s: previous block %s not on disk", __func__, pindexPrev->GetAncestor(pindexPrev->nHeight - readBlock + 1)->GetBlockHash().GetHex());
+            case CSpentOutpointIndex::FORK_SPENT:
+                return state.DoS(100, error("%s: input already spent on a previous block", __func__));
+            case CSpentOutpointIndex::FORK_NOT_SPENT:
+                break;
             }
+
+            const int64_t nTime = GetTimeMicros() - nTimeStart;
+            forkStakeCheckStats.nChecks++;
+            forkStakeCheckStats.nDepthSum += readBlock;
+            forkStakeCheckStats.nMaxDepth = std::max(forkStakeCheckStats.nMaxDepth, readBlock);
+            forkStakeCheckStats.nTimeMicros += nTime;
+            LogPrint(BCLog::BENCH, "    - Fork coinstake check: %d blocks, %.2fms [%.2fms avg over %u checks]\n",
+                     readBlock, nTime * 0.001, forkStakeCheckStats.nTimeMicros * 0.001 / forkStakeCheckStats.nChecks,
+                     forkStakeCheckStats.nChecks);
         }
 
         // If the stake is not a zPoS then let's check if the inputs were spent on the main chain
@@ -3603,6 +4175,14 @@ bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockIndex** ppi
                 return AbortNode(state, "Failed to write block");
         if (!ReceivedBlockTransactions(block, state, pindex, blockPos))
             return error("AcceptBlock() : ReceivedBlockTransactions failed");
+        if (!IsInitialBlockDownload()) {
+            // Served to peers and looked up for the masternode payments. Not during the initial
+            // download, where copying every block costs more than the reads it saves
+            blockCache.Insert(pindex->GetBlockHash(), std::make_shared<const CBlock>(block));
+            spentOutpointIndex.Add(pindex, block);
+        }
+        // Also drops the blocks read by the fork checks during the initial download
+        spentOutpointIndex.Prune(chainActive.Height() - GetArg("-maxreorg", DEFAULT_MAX_REORG_DEPTH));
     } catch (const std::runtime_error& e) {
         return AbortNode(state, std::string("System error: ") + e.what());
     }
@@ -3674,6 +4254,7 @@ bool ProcessNewBlock(CValidationState& state, CNode* pfrom, const CBlock* pblock
     // After 5.0, this can be removed and replaced by the enforcement block time.
     const int newHeight = chainActive.Height() + 1;
     const bool enableP2PKH = consensus.NetworkUpgradeActive(newHeight, Consensus::UPGRADE_P2PKH_BLOCK_SIGNATURES);
+    // Checked even below -assumevalid: it is what binds the block to its staker
     if (!CheckBlockSignature(*pblock, enableP2PKH))
         return error("%s : bad proof-of-stake block signature", __func__);
 
@@ -3748,6 +4329,9 @@ bool ProcessNewBlock(CValidationState& state, CNode* pfrom, const CBlock* pblock
     LogPrintf("%s : ACCEPTED Block %ld in %ld milliseconds with size=%d\n", __func__, newHeight, GetTimeMillis() - nStartTime,
               GetSerializeSize(*pblock, SER_DISK, CLIENT_VERSION));
 
+    // Whatever it came from (a peer, submitblock or the staker), it releases the blocks waiting for it
+    ProcessOrphanBlocks(pblock->GetHash(), connman);
+
     return true;
 }
 
@@ -3870,7 +4454,9 @@ bool static LoadBlockIndexDB(std::string& strError)
 
         CBlockIndex* pindex = item.second;
         pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
-        if (pindex->nStatus & BLOCK_HAVE_DATA) {
+        // We can link the chain of blocks for which we've received transactions at some point.
+        // Pruned nodes, and the blocks of a UTXO snapshot, may have deleted or never had the block data.
+        if (pindex->nTx > 0) {
             if (pindex->pprev) {
                 if (pindex->pprev->nChainTx) {
                     pindex->nChainTx = pindex->pprev->nChainTx + pindex->nTx;
@@ -3939,6 +4525,11 @@ bool static LoadBlockIndexDB(std::string& strError)
     pblocktree->ReadFlag("txindex", fTxIndex);
     LogPrintf("LoadBlockIndexDB(): transaction index %s\n", fTxIndex ? "enabled" : "disabled");
 
+    // Check whether we have ever pruned block & undo files
+    pblocktree->ReadFlag("prunedblockfiles", fHavePruned);
+    if (fHavePruned)
+        LogPrintf("LoadBlockIndexDB(): Block files have previously been pruned\n");
+
     // If this is written true before the next client init, then we know the shutdown process failed
     pblocktree->WriteFlag("shutdown", false);
 
@@ -3993,6 +4584,11 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth
         uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, (int)(((double)(chainHeight - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100)))));
         if (pindex->nHeight < chainHeight - nCheckDepth)
             break;
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            // Only go back as far as we have data, the blocks below were pruned or come from a UTXO snapshot
+            LogPrintf("%s: block verification stopping at height %d (no data)\n", __func__, pindex->nHeight);
+            break;
+        }
         CBlock block;
         // check level 0: read from disk
         if (!ReadBlockFromDisk(block, pindex))
@@ -4216,6 +4812,7 @@ void UnloadBlockIndex()
     nQueuedValidatedHeaders = 0;
     nPreferredDownload = 0;
     setDirtyBlockIndex.clear();
+    mapUncheckedHeaders.clear();
     setDirtyFileInfo.clear();
     mapNodeState.clear();
     recentRejects.reset(nullptr);
@@ -4277,94 +4874,151 @@ bool InitBlockIndex()
 }
 
 
+/** Map of disk positions for blocks with unknown parent (only used for reindex) */
+static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
+
+/** Accept a block read by LoadExternalBlockFile, then the blocks read before it that were waiting for it */
+static bool ProcessExternalBlock(const CBlock& block, CDiskBlockPos* dbp, int& nLoaded)
+{
+    // detect out of order blocks, and store them for later
+    uint256 hash = block.GetHash();
+    if (hash != Params().GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
+        LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__,
+                hash.GetHex(), block.hashPrevBlock.GetHex());
+        if (dbp)
+            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+        return true;
+    }
+
+    // process in case the block isn't known yet
+    if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
+        CValidationState state;
+        if (ProcessNewBlock(state, nullptr, &block, dbp, nullptr))
+            nLoaded++;
+        if (state.IsError())
+            return false;
+    } else if (hash != Params().GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
+        LogPrintf("Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
+    }
+
+    // Recursively process earlier encountered successors of this block
+    std::deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        uint256 head = queue.front();
+        queue.pop_front();
+        std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+        while (range.first != range.second) {
+            std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
+            CBlock blockChild;
+            if (ReadBlockFromDisk(blockChild, it->second)) {
+                LogPrintf("%s: Processing out of order child %s of %s\n", __func__, blockChild.GetHash().ToString(),
+                    head.ToString());
+                CValidationState dummy;
+                if (ProcessNewBlock(dummy, nullptr, &blockChild, &it->second, nullptr)) {
+                    nLoaded++;
+                    queue.push_back(blockChild.GetHash());
+                }
+            }
+            range.first++;
+            mapBlocksUnknownParent.erase(it);
+        }
+    }
+    return true;
+}
+
 bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp)
 {
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
     int64_t nStart = GetTimeMillis();
+    const CBlockPipelineStats statsStart = blockPipeline.GetStats();
 
     int nLoaded = 0;
+    // Blocks read from the file, deserialized and checked by the pipeline while the ones before them are connected
+    struct CQueuedRead {
+        CBlockPipelineJobRef job;
+        CDiskBlockPos pos;
+        uint64_t nRewind; // where to search again for a header if the block doesn't deserialize
+    };
+    std::deque<CQueuedRead> queueRead;
     try {
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SIZE_CURRENT, MAX_BLOCK_SIZE_CURRENT + 8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
+        bool fReading = true;
+        bool fContinue = true;
+        while (fContinue) {
             boost::this_thread::interruption_point();
 
-            blkdat.SetPos(nRewind);
-            nRewind++;         // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[MESSAGE_START_SIZE];
-                blkdat.FindByte(Params().MessageStart()[0]);
-                nRewind = blkdat.GetPos() + 1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
-            }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                CBlock block;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
-                if (hash != Params().GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
-                    LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__,
-                            hash.GetHex(), block.hashPrevBlock.GetHex());
-                    if (dbp)
-                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+            fReading = fReading && !blkdat.eof();
+            if (fReading && queueRead.size() < BLOCK_PIPELINE_DEPTH) {
+                blkdat.SetPos(nRewind);
+                nRewind++;         // start one byte further next time, in case of failure
+                blkdat.SetLimit(); // remove former limit
+                unsigned int nSize = 0;
+                uint64_t nRewindRecord = 0;
+                try {
+                    // locate a header
+                    unsigned char buf[MESSAGE_START_SIZE];
+                    blkdat.FindByte(Params().MessageStart()[0]);
+                    nRewind = blkdat.GetPos() + 1;
+                    nRewindRecord = nRewind;
+                    blkdat >> FLATDATA(buf);
+                    if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
+                        continue;
+                    // read size
+                    blkdat >> nSize;
+                    if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
+                        continue;
+                } catch (const std::exception&) {
+                    // no valid block header found; don't complain
+                    fReading = false;
                     continue;
                 }
-
-                // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    CValidationState state;
-                    if (ProcessNewBlock(state, nullptr, &block, dbp, nullptr))
-                        nLoaded++;
-                    if (state.IsError())
-                        break;
-                } else if (hash != Params().GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrintf("Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
-                }
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        if (ReadBlockFromDisk(block, it->second)) {
-                            LogPrintf("%s: Processing out of order child %s of %s\n", __func__, block.GetHash().ToString(),
-                                head.ToString());
-                            CValidationState dummy;
-                            if (ProcessNewBlock(dummy, nullptr, &block, &it->second, nullptr)) {
-                                nLoaded++;
-                                queue.push_back(block.GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
+                try {
+                    // read block, deserialized by the pipeline
+                    int64_t nTimeRead = GetTimeMicros();
+                    uint64_t nBlockPos = blkdat.GetPos();
+                    blkdat.SetLimit(nBlockPos + nSize);
+                    blkdat.SetPos(nBlockPos);
+                    std::vector<char> vData(nSize);
+                    // In pieces, a single read can't be larger than the buffer less its rewind margin
+                    for (size_t nRead = 0; nRead < nSize;) {
+                        const size_t nChunk = std::min<size_t>(nSize - nRead, MAX_BLOCK_SIZE_CURRENT / 2);
+                        blkdat.read(&vData[nRead], nChunk);
+                        nRead += nChunk;
                     }
+                    nRewind = blkdat.GetPos();
+                    blockPipeline.AddRead(nSize, GetTimeMicros() - nTimeRead);
+                    queueRead.push_back({blockPipeline.Push(std::move(vData), true), CDiskBlockPos(dbp ? dbp->nFile : -1, nBlockPos), nRewindRecord});
+                } catch (const std::exception& e) {
+                    LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
                 }
+                continue;
+            }
+            if (queueRead.empty())
+                break;
+
+            // Connect the oldest block read
+            CBlockPipelineJobRef job = queueRead.front().job;
+            CDiskBlockPos posBlock = queueRead.front().pos;
+            const uint64_t nRewindRecord = queueRead.front().nRewind;
+            queueRead.pop_front();
+            blockPipeline.Wait(job);
+            if (!job->pblock) {
+                LogPrintf("%s : Deserialize or I/O error - %s", __func__, job->strError);
+                // The size read may have been garbage: search for a header again one byte after
+                // this record's, and drop the reads made past it, which may be misaligned
+                queueRead.clear();
+                nRewind = nRewindRecord;
+                if (!blkdat.SetPos(nRewind))
+                    blkdat.Seek(nRewind); // further back than the buffer keeps
+                fReading = true;
+                continue;
+            }
+            try {
+                int64_t nTimeConnect = GetTimeMicros();
+                fContinue = ProcessExternalBlock(*job->pblock, dbp ? &posBlock : nullptr, nLoaded);
+                blockPipeline.AddConnect(GetTimeMicros() - nTimeConnect);
             } catch (const std::exception& e) {
                 LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
             }
@@ -4372,8 +5026,10 @@ bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp)
     } catch (const std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
     }
-    if (nLoaded > 0)
+    if (nLoaded > 0) {
         LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
+        LogPrintf("Block pipeline: %s\n", (blockPipeline.GetStats() - statsStart).ToString());
+    }
     return nLoaded > 0;
 }
 
@@ -4413,6 +5069,7 @@ void static CheckBlockIndex()
     int nHeight = 0;
     CBlockIndex* pindexFirstInvalid = NULL;         // Oldest ancestor of pindex which is invalid.
     CBlockIndex* pindexFirstMissing = NULL;         // Oldest ancestor of pindex which does not have BLOCK_HAVE_DATA.
+    CBlockIndex* pindexFirstNeverProcessed = NULL;  // Oldest ancestor of pindex for which nTx == 0.
     CBlockIndex* pindexFirstNotTreeValid = NULL;    // Oldest ancestor of pindex which does not have BLOCK_VALID_TREE (regardless of being valid or not).
     CBlockIndex* pindexFirstNotChainValid = NULL;   // Oldest ancestor of pindex which does not have BLOCK_VALID_CHAIN (regardless of being valid or not).
     CBlockIndex* pindexFirstNotScriptsValid = NULL; // Oldest ancestor of pindex which does not have BLOCK_VALID_SCRIPTS (regardless of being valid or not).
@@ -4420,6 +5077,7 @@ void static CheckBlockIndex()
         nNodes++;
         if (pindexFirstInvalid == NULL && pindex->nStatus & BLOCK_FAILED_VALID) pindexFirstInvalid = pindex;
         if (pindexFirstMissing == NULL && !(pindex->nStatus & BLOCK_HAVE_DATA)) pindexFirstMissing = pindex;
+        if (pindexFirstNeverProcessed == NULL && pindex->nTx == 0) pindexFirstNeverProcessed = pindex;
         if (pindex->pprev != NULL && pindexFirstNotTreeValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_TREE) pindexFirstNotTreeValid = pindex;
         if (pindex->pprev != NULL && pindexFirstNotChainValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_CHAIN) pindexFirstNotChainValid = pindex;
         if (pindex->pprev != NULL && pindexFirstNotScriptsValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_SCRIPTS) pindexFirstNotScriptsValid = pindex;
@@ -4430,12 +5088,21 @@ void static CheckBlockIndex()
             assert(pindex->GetBlockHash() == Params().GetConsensus().hashGenesisBlock); // Genesis block's hash must match.
             assert(pindex == chainActive.Genesis());                       // The current active chain's genesis block must be this block.
         }
-        // HAVE_DATA is equivalent to VALID_TRANSACTIONS and equivalent to nTx > 0 (we stored the number of transactions in the block)
-        assert(!(pindex->nStatus & BLOCK_HAVE_DATA) == (pindex->nTx == 0));
-        assert(((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_TRANSACTIONS) == (pindex->nTx > 0));
+        // VALID_TRANSACTIONS is equivalent to nTx > 0 for all nodes (whether or not pruning has occurred).
+        // HAVE_DATA is only equivalent to nTx > 0 (or VALID_TRANSACTIONS) if no pruning has occurred.
+        if (!fHavePruned) {
+            // If we've never pruned, then HAVE_DATA should be equivalent to nTx > 0
+            assert(!(pindex->nStatus & BLOCK_HAVE_DATA) == (pindex->nTx == 0));
+            assert(pindexFirstMissing == pindexFirstNeverProcessed);
+        } else {
+            // If we have pruned, then we can only say that HAVE_DATA implies nTx > 0
+            if (pindex->nStatus & BLOCK_HAVE_DATA) assert(pindex->nTx > 0);
+        }
+        if (pindex->nStatus & BLOCK_HAVE_UNDO) assert(pindex->nStatus & BLOCK_HAVE_DATA);
+        assert(((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_TRANSACTIONS) == (pindex->nTx > 0)); // This is pruning-independent.
         if (pindex->nChainTx == 0) assert(pindex->nSequenceId == 0); // nSequenceId can't be set for blocks that aren't linked
-        // All parents having data is equivalent to all parents being VALID_TRANSACTIONS, which is equivalent to nChainTx being set.
-        assert((pindexFirstMissing != NULL) == (pindex->nChainTx == 0));                                             // nChainTx == 0 is used to signal that all parent block's transaction data is available.
+        // All parents having had data (at some point) is equivalent to all parents being VALID_TRANSACTIONS, which is equivalent to nChainTx being set.
+        assert((pindexFirstNeverProcessed != NULL) == (pindex->nChainTx == 0));                                      // nChainTx != 0 is used to signal that all parent blocks have been processed (but may have been pruned).
         assert(pindex->nHeight == nHeight);                                                                          // nHeight must be consistent.
         assert(pindex->pprev == NULL || pindex->nChainWork >= pindex->pprev->nChainWork);                            // For every block except the genesis block, the chainwork must be larger than the parent's.
         assert(nHeight < 2 || (pindex->pskip && (pindex->pskip->nHeight < nHeight)));                                // The pskip pointer must point back for all but the first 2 blocks.
@@ -4447,11 +5114,20 @@ void static CheckBlockIndex()
             // Checks for not-invalid blocks.
             assert((pindex->nStatus & BLOCK_FAILED_MASK) == 0); // The failed mask cannot be set for blocks without invalid parents.
         }
-        if (!CBlockIndexWorkComparator()(pindex, chainActive.Tip()) && pindexFirstMissing == NULL) {
-            if (pindexFirstInvalid == NULL) { // If this block sorts at least as good as the current tip and is valid, it must be in setBlockIndexCandidates.
-                assert(setBlockIndexCandidates.count(pindex));
+        if (!CBlockIndexWorkComparator()(pindex, chainActive.Tip()) && pindexFirstNeverProcessed == NULL) {
+            if (pindexFirstInvalid == NULL) {
+                // If this block sorts at least as good as the current tip and
+                // is valid and we have all data for its parents, it must be in
+                // setBlockIndexCandidates. chainActive.Tip() must also be there
+                // even if some data has been pruned.
+                if (pindexFirstMissing == NULL || pindex == chainActive.Tip()) {
+                    assert(setBlockIndexCandidates.count(pindex));
+                }
+                // If some parent is missing, then it could be that this block was in
+                // setBlockIndexCandidates but had to be removed because of the missing data.
+                // In this case it must be in mapBlocksUnlinked -- see test below.
             }
-        } else { // If this block sorts worse than the current tip, it cannot be in setBlockIndexCandidates.
+        } else { // If this block sorts worse than the current tip or some ancestor's block has never been seen, it cannot be in setBlockIndexCandidates.
             assert(setBlockIndexCandidates.count(pindex) == 0);
         }
         // Check whether this block is in mapBlocksUnlinked.
@@ -4465,12 +5141,24 @@ void static CheckBlockIndex()
             }
             rangeUnlinked.first++;
         }
-        if (pindex->pprev && pindex->nStatus & BLOCK_HAVE_DATA && pindexFirstMissing != NULL) {
-            if (pindexFirstInvalid == NULL) { // If this block has block data available, some parent doesn't, and has no invalid parents, it must be in mapBlocksUnlinked.
-                assert(foundInUnlinked);
+        if (pindex->pprev && (pindex->nStatus & BLOCK_HAVE_DATA) && pindexFirstNeverProcessed != NULL && pindexFirstInvalid == NULL) {
+            // If this block has block data available, some parent was never received, and has no invalid parents, it must be in mapBlocksUnlinked.
+            assert(foundInUnlinked);
+        }
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA)) assert(!foundInUnlinked); // Can't be in mapBlocksUnlinked if we don't HAVE_DATA
+        if (pindexFirstMissing == NULL) assert(!foundInUnlinked);          // We aren't missing data for any parent -- cannot be in mapBlocksUnlinked.
+        if (pindex->pprev && (pindex->nStatus & BLOCK_HAVE_DATA) && pindexFirstNeverProcessed == NULL && pindexFirstMissing != NULL) {
+            // We HAVE_DATA for this block, have received data for all parents at some point, but we're currently missing data for some parent.
+            assert(fHavePruned); // We must have pruned.
+            // This block may have entered mapBlocksUnlinked if it has a descendant that at some point had more
+            // work than the tip, and we tried switching to that descendant but were missing data for some
+            // intermediate block between chainActive and the tip. So if this block is itself better than
+            // chainActive.Tip() and it wasn't in setBlockIndexCandidates, then it must be in mapBlocksUnlinked.
+            if (!CBlockIndexWorkComparator()(pindex, chainActive.Tip()) && setBlockIndexCandidates.count(pindex) == 0) {
+                if (pindexFirstInvalid == NULL) {
+                    assert(foundInUnlinked);
+                }
             }
-        } else { // If this block does not have block data available, or all parents do, it cannot be in mapBlocksUnlinked.
-            assert(!foundInUnlinked);
         }
         // assert(pindex->GetBlockHash() == pindex->GetBlockHeader().GetHash()); // Perhaps too slow
         // End: actual consistency checks.
@@ -4490,6 +5178,7 @@ void static CheckBlockIndex()
             // If pindex was the first with a certain property, unset the corresponding variable.
             if (pindex == pindexFirstInvalid) pindexFirstInvalid = NULL;
             if (pindex == pindexFirstMissing) pindexFirstMissing = NULL;
+            if (pindex == pindexFirstNeverProcessed) pindexFirstNeverProcessed = NULL;
             if (pindex == pindexFirstNotTreeValid) pindexFirstNotTreeValid = NULL;
             if (pindex == pindexFirstNotChainValid) pindexFirstNotChainValid = NULL;
             if (pindex == pindexFirstNotScriptsValid) pindexFirstNotScriptsValid = NULL;
@@ -4581,7 +5270,7 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     }
 
     case MSG_BLOCK:
-        return mapBlockIndex.count(inv.hash);
+        return mapBlockIndex.count(inv.hash) || mapOrphanBlocks.count(inv.hash);
     case MSG_SPORK:
         return mapSporks.count(inv.hash);
     case MSG_MASTERNODE_WINNER:
@@ -4678,10 +5367,11 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
                 }
                 // Don't send not-validated blocks
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA)) {
-                    // Send block from disk
-                    CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second))
+                    // Send block from disk, the recent ones are in the block cache
+                    std::shared_ptr<const CBlock> pblock;
+                    if (!ReadBlockFromDisk(pblock, (*mi).second))
                         assert(!"cannot load block from disk");
+                    const CBlock& block = *pblock;
                     if (inv.type == MSG_BLOCK)
                         connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, block));
                     else // MSG_FILTERED_BLOCK)
@@ -4808,6 +5498,194 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
 }
 
 bool fRequestedSporksIDB = false;
+/** Whether the chain is downloaded from this peer headers first */
+static bool IsHeadersFirstPeer(const CNode* pnode)
+{
+    return Params().HeadersFirstSyncingActive() && pnode->nVersion >= HEADERS_FIRST_VERSION;
+}
+
+/** Remove an orphan block from the pool and from its peer's share */
+static void EraseOrphanBlock(std::map<uint256, COrphanBlock>::iterator it)
+{
+    AssertLockHeld(cs_main);
+    auto itPeer = mapOrphanBlocksPeerSize.find(it->second.nodeid);
+    if (itPeer != mapOrphanBlocksPeerSize.end()) {
+        itPeer->second -= it->second.nSize;
+        if (itPeer->second == 0)
+            mapOrphanBlocksPeerSize.erase(itPeer);
+    }
+    nOrphanBlocksSize -= it->second.nSize;
+    mapOrphanBlocks.erase(it);
+}
+
+/** Remove an orphan block from the pool, from its peer's share and from the blocks by parent hash */
+static void UnlinkOrphanBlock(std::map<uint256, COrphanBlock>::iterator it)
+{
+    AssertLockHeld(cs_main);
+    auto range = mapOrphanBlocksByPrev.equal_range(it->second.pblock->hashPrevBlock);
+    for (auto itPrev = range.first; itPrev != range.second; ++itPrev) {
+        if (itPrev->second == it->first) {
+            mapOrphanBlocksByPrev.erase(itPrev);
+            break;
+        }
+    }
+    EraseOrphanBlock(it);
+}
+
+/** Drop the orphan blocks of a disconnecting peer, which could otherwise reconnect with an empty share */
+static void EraseOrphanBlocksFor(NodeId nodeid)
+{
+    AssertLockHeld(cs_main);
+    for (auto it = mapOrphanBlocks.begin(); it != mapOrphanBlocks.end();) {
+        if (it->second.nodeid == nodeid)
+            UnlinkOrphanBlock(it++);
+        else
+            ++it;
+    }
+}
+
+/** Drop the oldest orphan block of a peer, false if it has none */
+static bool EvictOrphanBlockOf(NodeId nodeid)
+{
+    AssertLockHeld(cs_main);
+    auto itOldest = mapOrphanBlocks.end();
+    for (auto it = mapOrphanBlocks.begin(); it != mapOrphanBlocks.end(); ++it) {
+        if (it->second.nodeid == nodeid && (itOldest == mapOrphanBlocks.end() || it->second.nTimeExpire < itOldest->second.nTimeExpire))
+            itOldest = it;
+    }
+    if (itOldest == mapOrphanBlocks.end())
+        return false;
+    UnlinkOrphanBlock(itOldest);
+    nOrphanBlocksDropped++;
+    return true;
+}
+
+/**
+ * Keep a block whose parent has no data yet, once its context-free checks pass.
+ * When the pool is full, the blocks whose parent never came are dropped first,
+ * then the oldest ones of the peer with the largest share, as for the orphan
+ * transactions no peer can keep the others' blocks out.
+ * False if the checks fail, with state invalid, or if the block is too large to fit.
+ */
+static bool AddOrphanBlock(const CBlock& block, NodeId nodeid, CValidationState& state)
+{
+    AssertLockHeld(cs_main);
+    const uint256 hash = block.GetHash();
+    if (mapOrphanBlocks.count(hash))
+        return true;
+    if (!CheckBlockContextFree(block, state))
+        return error("%s : orphan block %s failed its checks: %s", __func__, hash.GetHex(), FormatStateMessage(state));
+    const size_t nSize = ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION);
+    const int64_t nNow = GetTime();
+    if (mapOrphanBlocks.size() >= MAX_ORPHAN_BLOCKS || nOrphanBlocksSize + nSize > MAX_ORPHAN_BLOCKS_SIZE) {
+        // Make room by dropping the blocks whose parent never came
+        for (auto it = mapOrphanBlocks.begin(); it != mapOrphanBlocks.end();) {
+            if (it->second.nTimeExpire < nNow)
+                UnlinkOrphanBlock(it++);
+            else
+                ++it;
+        }
+    }
+    if (nSize > MAX_ORPHAN_BLOCKS_PEER_SIZE) {
+        nOrphanBlocksDropped++;
+        return false;
+    }
+    // A peer over its share replaces its own oldest blocks
+    while (mapOrphanBlocksPeerSize.count(nodeid) && mapOrphanBlocksPeerSize[nodeid] + nSize > MAX_ORPHAN_BLOCKS_PEER_SIZE) {
+        if (!EvictOrphanBlockOf(nodeid))
+            break;
+    }
+    while (!mapOrphanBlocks.empty() &&
+           (mapOrphanBlocks.size() >= MAX_ORPHAN_BLOCKS || nOrphanBlocksSize + nSize > MAX_ORPHAN_BLOCKS_SIZE)) {
+        auto itLargest = std::max_element(mapOrphanBlocksPeerSize.begin(), mapOrphanBlocksPeerSize.end(),
+            [](const std::pair<const NodeId, size_t>& a, const std::pair<const NodeId, size_t>& b) { return a.second < b.second; });
+        if (itLargest == mapOrphanBlocksPeerSize.end() || !EvictOrphanBlockOf(itLargest->first))
+            break;
+    }
+    auto itPeer = mapOrphanBlocksPeerSize.find(nodeid);
+    const size_t nPeerSize = itPeer != mapOrphanBlocksPeerSize.end() ? itPeer->second : 0;
+    std::shared_ptr<const CBlock> pblock = std::make_shared<const CBlock>(block);
+    mapOrphanBlocks[hash] = {pblock, nodeid, nSize, nNow + ORPHAN_BLOCK_EXPIRE_TIME, blockPipeline.Push(pblock)};
+    mapOrphanBlocksByPrev.emplace(block.hashPrevBlock, hash);
+    nOrphanBlocksSize += nSize;
+    mapOrphanBlocksPeerSize[nodeid] = nPeerSize + nSize;
+    return true;
+}
+
+/** Start reading the coins spent by the pooled blocks that come after hashParent */
+static void PrefetchOrphanBlocks(const uint256& hashParent)
+{
+    AssertLockHeld(cs_main);
+    std::deque<uint256> queue;
+    queue.push_back(hashParent);
+    size_t nQueued = 0;
+    while (!queue.empty() && nQueued < ORPHAN_BLOCKS_PREFETCH) {
+        auto range = mapOrphanBlocksByPrev.equal_range(queue.front());
+        queue.pop_front();
+        for (auto it = range.first; it != range.second && nQueued < ORPHAN_BLOCKS_PREFETCH; ++it) {
+            coinsPrefetcher.Prefetch(*mapOrphanBlocks[it->second].pblock);
+            queue.push_back(it->second);
+            nQueued++;
+        }
+    }
+}
+
+/** Process the blocks waiting for hashParent, and in turn for those, once it has been accepted */
+static void ProcessOrphanBlocks(const uint256& hashParent, CConnman* connman)
+{
+    // Called again by ProcessNewBlock for each child, whose own children are queued here instead
+    static thread_local bool fProcessing = false;
+    if (fProcessing)
+        return;
+    struct CProcessingGuard {
+        CProcessingGuard() { fProcessing = true; }
+        ~CProcessingGuard() { fProcessing = false; }
+    } guard;
+
+    std::deque<uint256> queue;
+    queue.push_back(hashParent);
+    while (!queue.empty()) {
+        std::vector<COrphanBlock> vChildren;
+        {
+            LOCK(cs_main);
+            BlockMap::iterator mi = mapBlockIndex.find(queue.front());
+            // Children of a block that didn't make it are dropped, they get downloaded again if needed.
+            const bool fParentOk = mi != mapBlockIndex.end() && (mi->second->nStatus & (BLOCK_HAVE_DATA | BLOCK_SNAPSHOT));
+            auto range = mapOrphanBlocksByPrev.equal_range(queue.front());
+            for (auto it = range.first; it != range.second; ++it) {
+                auto itBlock = mapOrphanBlocks.find(it->second);
+                if (fParentOk)
+                    vChildren.push_back(itBlock->second);
+                EraseOrphanBlock(itBlock);
+            }
+            mapOrphanBlocksByPrev.erase(range.first, range.second);
+            for (const COrphanBlock& child : vChildren)
+                PrefetchOrphanBlocks(child.pblock->GetHash());
+        }
+        queue.pop_front();
+
+        for (const COrphanBlock& child : vChildren) {
+            const uint256 hash = child.pblock->GetHash();
+            {
+                LOCK(cs_main);
+                mapBlockSource[hash] = child.nodeid;
+            }
+            blockPipeline.Wait(child.check);
+            CValidationState state;
+            int64_t nTimeConnect = GetTimeMicros();
+            const bool fAccepted = ProcessNewBlock(state, nullptr, child.pblock.get(), nullptr, connman);
+            blockPipeline.AddConnect(GetTimeMicros() - nTimeConnect);
+            int nDoS;
+            LOCK(cs_main);
+            if (fAccepted)
+                nOrphanBlocksSaved++;
+            else if (state.IsInvalid(nDoS) && nDoS > 0)
+                Misbehaving(child.nodeid, nDoS);
+            queue.push_back(hash);
+        }
+    }
+}
+
 bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vRecv, int64_t nTimeReceived, CConnman& connman, std::atomic<bool>& interruptMsgProc)
 {
     LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->id);
@@ -5097,6 +5975,13 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             if (inv.type == MSG_BLOCK) {
                 UpdateBlockAvailability(pfrom->GetId(), inv.hash);
                 if (!fAlreadyHave && !fImporting && !fReindex && !mapBlocksInFlight.count(inv.hash)) {
+                    if (IsHeadersFirstPeer(pfrom)) {
+                        // Get the headers up to it, the download scheduler fetches the blocks
+                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexBestHeader), inv.hash));
+                        LogPrint(BCLog::NET, "getheaders (%d) %s to peer=%d\n", pindexBestHeader->nHeight, inv.hash.ToString(), pfrom->id);
+                        if (IsInitialBlockDownload())
+                            continue;
+                    }
                     // Add this to the list of blocks to request
                     vToFetch.push_back(inv);
                     LogPrint(BCLog::NET, "getblocks (%d) %s to peer=%d\n", pindexBestHeader->nHeight, inv.hash.ToString(), pfrom->id);
@@ -5129,7 +6014,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
     }
 
 
-    else if (strCommand == NetMsgType::GETBLOCKS || strCommand == NetMsgType::GETHEADERS) {
+    else if (strCommand == NetMsgType::GETBLOCKS) {
         CBlockLocator locator;
         uint256 hashStop;
         vRecv >> locator >> hashStop;
@@ -5167,13 +6052,13 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
     }
 
 
-    else if (strCommand == NetMsgType::HEADERS && Params().HeadersFirstSyncingActive()) {
+    else if (strCommand == NetMsgType::GETHEADERS) {
         CBlockLocator locator;
         uint256 hashStop;
         vRecv >> locator >> hashStop;
 
         if (locator.vHave.size() > MAX_LOCATOR_SZ) {
-            LogPrint(BCLog::NET, "getblocks locator size %lld > %d, disconnect peer=%d\n", locator.vHave.size(), MAX_LOCATOR_SZ, pfrom->GetId());
+            LogPrint(BCLog::NET, "getheaders locator size %lld > %d, disconnect peer=%d\n", locator.vHave.size(), MAX_LOCATOR_SZ, pfrom->GetId());
             pfrom->fDisconnect = true;
             return true;
         }
@@ -5200,7 +6085,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         // we must use CBlocks, as CBlockHeaders won't include the 0x00 nTx count at the end
         std::vector<CBlock> vHeaders;
         int nLimit = MAX_HEADERS_RESULTS;
-        LogPrintf("getheaders %d to %s from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop.ToString(), pfrom->id);
+        LogPrint(BCLog::NET, "getheaders %d to %s from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop.ToString(), pfrom->id);
         for (; pindex; pindex = chainActive.Next(pindex)) {
             vHeaders.push_back(pindex->GetBlockHeader());
             if (--nLimit <= 0 || pindex->GetBlockHash() == hashStop)
@@ -5355,6 +6240,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             return true;
         }
         CBlockIndex* pindexLast = NULL;
+        bool fPaused = false;
         for (const CBlockHeader& header : headers) {
             CValidationState state;
             if (pindexLast != NULL && header.hashPrevBlock != pindexLast->GetBlockHash()) {
@@ -5362,10 +6248,14 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
                 return error("non-continuous headers sequence");
             }
 
-            /*TODO: this has a CBlock cast on it so that it will compile. There should be a solution for this
-             * before headers are reimplemented on mainnet
-             */
-            if (!AcceptBlockHeader((CBlock)header, state, &pindexLast)) {
+            if (!AcceptBlockHeader(CBlock(header), state, &pindexLast, pfrom->GetId())) {
+                if (state.GetRejectReason() == "header-too-far-ahead") {
+                    // Asked again from the last one taken as the tip moves up, see SendMessages
+                    BlockMap::iterator mi = mapBlockIndex.find(header.hashPrevBlock);
+                    State(pfrom->GetId())->pindexHeadersPaused = pindexLast ? pindexLast : (mi != mapBlockIndex.end() ? mi->second : NULL);
+                    fPaused = true;
+                    break;
+                }
                 int nDoS;
                 if (state.IsInvalid(nDoS)) {
                     if (nDoS > 0)
@@ -5379,11 +6269,11 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         if (pindexLast)
             UpdateBlockAvailability(pfrom->GetId(), pindexLast->GetBlockHash());
 
-        if (nCount == MAX_HEADERS_RESULTS && pindexLast) {
+        if (nCount == MAX_HEADERS_RESULTS && pindexLast && !fPaused) {
             // Headers message had its maximum size; the peer may have more headers.
             // TODO: optimize: if pindexLast is an ancestor of chainActive.Tip or pindexBestHeader, continue
             // from there instead.
-            LogPrintf("more getheaders (%d) to end to peer=%d (startheight:%d)\n", pindexLast->nHeight, pfrom->id, pfrom->nStartingHeight);
+            LogPrint(BCLog::NET, "more getheaders (%d) to end to peer=%d (startheight:%d)\n", pindexLast->nHeight, pfrom->id, pfrom->nStartingHeight);
             connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexLast), UINT256_ZERO));
         }
 
@@ -5400,7 +6290,20 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
 
         //sometimes we will be sent their most recent block and its not the one we want, in that case tell where we are
         if (!mapBlockIndex.count(block.hashPrevBlock)) {
-            if (find(pfrom->vBlockRequested.begin(), pfrom->vBlockRequested.end(), hashBlock) != pfrom->vBlockRequested.end()) {
+            {
+                // Keep it until its parent connects, rather than downloading it again
+                LOCK(cs_main);
+                MarkBlockAsReceived(hashBlock);
+                CValidationState state;
+                int nDoS = 0;
+                if (AddOrphanBlock(block, pfrom->GetId(), state))
+                    LogPrint(BCLog::NET, "%s : orphan block %s kept, parent %s unknown\n", __func__, hashBlock.GetHex(), block.hashPrevBlock.GetHex());
+                else if (state.IsInvalid(nDoS) && nDoS > 0)
+                    Misbehaving(pfrom->GetId(), nDoS);
+            }
+            if (IsHeadersFirstPeer(pfrom)) {
+                connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexBestHeader), hashBlock));
+            } else if (find(pfrom->vBlockRequested.begin(), pfrom->vBlockRequested.end(), hashBlock) != pfrom->vBlockRequested.end()) {
                 //we already asked for this block, so lets work backwards and ask for the previous block
                 connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::GETBLOCKS, chainActive.GetLocator(), block.hashPrevBlock));
                 pfrom->vBlockRequested.push_back(block.hashPrevBlock);
@@ -5413,7 +6316,31 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             pfrom->AddInventoryKnown(inv);
 
             CValidationState state;
-            if (!mapBlockIndex.count(block.GetHash())) {
+            // Headers first download can fetch a block before its parent's data
+            bool fNewBlock = false;
+            bool fAwaitParent = false;
+            {
+                LOCK(cs_main);
+                BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
+                fNewBlock = mi == mapBlockIndex.end() || !(mi->second->nStatus & BLOCK_HAVE_DATA);
+                if (fNewBlock && !(mapBlockIndex[block.hashPrevBlock]->nStatus & (BLOCK_HAVE_DATA | BLOCK_SNAPSHOT))) {
+                    fAwaitParent = true;
+                    MarkBlockAsReceived(hashBlock);
+                    // Only the blocks of the headers taken are kept
+                    int nDoS = 0;
+                    if (mi == mapBlockIndex.end()) {
+                        LogPrint(BCLog::NET, "%s : block %s ahead of its parent with an unknown header, dropped\n", __func__, hashBlock.GetHex());
+                    } else if (!AddOrphanBlock(block, pfrom->GetId(), state)) {
+                        if (state.IsInvalid(nDoS) && nDoS > 0)
+                            Misbehaving(pfrom->GetId(), nDoS);
+                        else
+                            LogPrint(BCLog::NET, "%s : block %s too large for the orphan block pool, dropped\n", __func__, hashBlock.GetHex());
+                    }
+                }
+            }
+            if (fAwaitParent) {
+                LogPrint(BCLog::NET, "%s : block %s waits for its parent %s\n", __func__, hashBlock.GetHex(), block.hashPrevBlock.GetHex());
+            } else if (fNewBlock) {
                 ProcessNewBlock(state, pfrom, &block, nullptr, &connman);
                 int nDoS;
                 if (state.IsInvalid(nDoS)) {
@@ -5427,8 +6354,11 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
                 }
                 //disconnect this node if its old protocol version
                 pfrom->DisconnectOldProtocol(pfrom->nVersion, ActiveProtocol(), strCommand);
+                // Drops the blocks waiting for it if it was rejected
+                ProcessOrphanBlocks(hashBlock, &connman);
             } else {
                 LogPrint(BCLog::NET, "%s : Already processed block %s, skipping ProcessNewBlock()\n", __func__, block.GetHash().GetHex());
+                ProcessOrphanBlocks(hashBlock, &connman);
             }
         }
     }
@@ -5864,13 +6794,23 @@ bool SendMessages(CNode* pto, CConnman& connman, std::atomic<bool>& interruptMsg
             if ((nSyncStarted == 0 && fFetch) || pindexBestHeader->GetBlockTime() > GetAdjustedTime() - 6 * 60 * 60) { // NOTE: was "close to today" and 24h in Bitcoin
                 state.fSyncStarted = true;
                 nSyncStarted++;
-                //CBlockIndex *pindexStart = pindexBestHeader->pprev ? pindexBestHeader->pprev : pindexBestHeader;
-                //LogPrint(BCLog::NET, "initial getheaders (%d) to peer=%d (startheight:%d)\n", pindexStart->nHeight, pto->id, pto->nStartingHeight);
-                //pto->PushMessage(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexStart), UINT256_ZERO);
-                connman.PushMessage(pto, msgMaker.Make(NetMsgType::GETBLOCKS, chainActive.GetLocator(chainActive.Tip()), UINT256_ZERO));
+                if (IsHeadersFirstPeer(pto)) {
+                    CBlockIndex *pindexStart = pindexBestHeader->pprev ? pindexBestHeader->pprev : pindexBestHeader;
+                    LogPrint(BCLog::NET, "initial getheaders (%d) to peer=%d (startheight:%d)\n", pindexStart->nHeight, pto->id, pto->nStartingHeight);
+                    connman.PushMessage(pto, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexStart), UINT256_ZERO));
+                } else {
+                    connman.PushMessage(pto, msgMaker.Make(NetMsgType::GETBLOCKS, chainActive.GetLocator(chainActive.Tip()), UINT256_ZERO));
+                }
             }
         }
 
+        // Resume the headers download paused by MAX_UNCHECKED_HEADERS_AHEAD once the tip caught up half of it
+        if (state.pindexHeadersPaused && state.pindexHeadersPaused->nHeight < chainActive.Height() + (int)MAX_UNCHECKED_HEADERS_AHEAD / 2) {
+            LogPrint(BCLog::NET, "resumed getheaders (%d) to peer=%d\n", state.pindexHeadersPaused->nHeight, pto->id);
+            connman.PushMessage(pto, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(state.pindexHeadersPaused), UINT256_ZERO));
+            state.pindexHeadersPaused = NULL;
+        }
+
         // Resend wallet transactions that haven't gotten in a block yet
         // Except during reindex, importing and IBD, when old wallet
         // transactions become unconfirmed and spams other nodes.
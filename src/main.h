@@ -38,6 +38,7 @@
 #include <atomic>
 #include <exception>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdint.h>
 #include <string>
@@ -91,6 +92,12 @@ static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 /** The pre-allocation chunk size for rev?????.dat files (since 0.8) */
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
+/** Blocks below the tip whose data is always kept in prune mode, two days worth of blocks */
+static const unsigned int MIN_BLOCKS_TO_KEEP = 2880;
+/** Minimum -prune target, in bytes. Leaves room for MIN_BLOCKS_TO_KEEP blocks and their undo data */
+static const uint64_t MIN_DISK_SPACE_FOR_BLOCK_FILES = 550 * 1024 * 1024;
+/** Block index entries written at once while their paid payee is migrated */
+static const size_t PAYEE_MIGRATION_BATCH = 1000;
 /** Maximum number of script-checking threads allowed */
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
@@ -107,6 +114,25 @@ static const unsigned int MAX_HEADERS_RESULTS = 2000;
  *  degree of disordering of blocks on disk (which make reindexing and in the future perhaps pruning
  *  harder). We'll probably want to make this a per-peer adaptive value at some point. */
 static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
+/** How far above the active tip a proof of stake header is accepted alone: its stake is only
+ *  checked once its block arrives, so only the headers the download window can reach are taken. */
+static const unsigned int MAX_UNCHECKED_HEADERS_AHEAD = BLOCK_DOWNLOAD_WINDOW;
+/** Maximum number of unchecked proof of stake headers a peer can have in the block index at once. */
+static const unsigned int MAX_UNCHECKED_HEADERS_PER_PEER = 2 * MAX_UNCHECKED_HEADERS_AHEAD;
+/** Maximum number of unchecked proof of stake headers in the block index. */
+static const unsigned int MAX_UNCHECKED_HEADERS = 8 * MAX_UNCHECKED_HEADERS_AHEAD;
+/** Time in seconds after which an unchecked header whose block didn't arrive can be dropped. */
+static const int64_t UNCHECKED_HEADER_EXPIRE_TIME = 20 * 60;
+/** Maximum number of orphan blocks, kept in memory until their parent connects. */
+static const unsigned int MAX_ORPHAN_BLOCKS = 2 * BLOCK_DOWNLOAD_WINDOW;
+/** Maximum total size of the orphan blocks. */
+static const size_t MAX_ORPHAN_BLOCKS_SIZE = 64 * 1024 * 1024;
+/** Maximum total size of the orphan blocks received from a single peer. */
+static const size_t MAX_ORPHAN_BLOCKS_PEER_SIZE = 16 * 1024 * 1024;
+/** Time in seconds after which an orphan block may be dropped to make room for others. */
+static const int64_t ORPHAN_BLOCK_EXPIRE_TIME = 20 * 60;
+/** Number of orphan blocks whose coins are read ahead while the ones before them are connected. */
+static const size_t ORPHAN_BLOCKS_PREFETCH = 16;
 /** Time to wait (in seconds) between writing blocks/block index to disk. */
 static const unsigned int DATABASE_WRITE_INTERVAL = 60 * 60;
 /** Time to wait (in seconds) between flushing chainstate to disk. */
@@ -161,6 +187,12 @@ extern std::atomic<bool> fReindex;
 extern int nScriptCheckThreads;
 extern bool fTxIndex;
 extern bool fCheckBlockIndex;
+/** True if any block files have ever been pruned, or the chain was loaded from a UTXO snapshot */
+extern bool fHavePruned;
+/** True if we're running in -prune mode */
+extern bool fPruneMode;
+/** Number of bytes of block and undo files to stay under in prune mode */
+extern uint64_t nPruneTarget;
 extern size_t nCoinCacheUsage;
 extern CFeeRate minRelayTxFee;
 extern int64_t nMaxTipAge;
@@ -174,6 +206,9 @@ extern std::map<uint256, int64_t> mapRejectedBlocks;
 /** Best header we've seen so far (used for getheaders queries' starting points). */
 extern CBlockIndex* pindexBestHeader;
 
+/** Block whose ancestors are connected without checking their scripts and stake signatures (-assumevalid) */
+extern uint256 hashAssumeValid;
+
 /** Minimum disk space required - used in CheckDiskSpace() */
 static const uint64_t nMinDiskSpace = 52428800;
 
@@ -250,6 +285,22 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats);
 void Misbehaving(NodeId nodeid, int howmuch) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 /** Flush all state, indexes and buffers to disk. */
 void FlushStateToDisk();
+/** Prune block files and flush state to disk. */
+void PruneAndFlush();
+/**
+ * Store the paid masternode payee of the blocks of the active chain, at most
+ * nMaxDepth from the tip or all of them if negative, whose block index
+ * entries were written without it. Returns the number of entries updated.
+ */
+int MigratePaidPayees(int nMaxDepth);
+/** Run MigratePaidPayees over the whole active chain */
+void ThreadMigratePaidPayees();
+/** Calculate the amount of disk space the block and undo files currently use */
+uint64_t CalculateCurrentUsage();
+/** Whether the block file nFile was deleted by pruning */
+bool IsBlockFilePruned(int nFile);
+/** Delete the block and undo files of setFilesToPrune */
+void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune);
 
 
 /** (try to) add transaction to memory pool **/
@@ -267,6 +318,36 @@ struct CNodeStateStats {
     std::vector<int> vHeightInFlight;
 };
 
+/** Counters of the double spend checks of coinstakes arriving on a fork */
+struct CForkStakeCheckStats {
+    uint64_t nChecks{0};
+    uint64_t nDepthSum{0};
+    int nMaxDepth{0};
+    int64_t nTimeMicros{0};
+    uint64_t nDiskReads{0};
+};
+
+CForkStakeCheckStats GetForkStakeCheckStats();
+
+/** State of the orphan block pool */
+struct COrphanBlockStats {
+    size_t nBlocks{0};
+    size_t nBytes{0};
+    uint64_t nSaved{0};
+    uint64_t nDropped{0};
+};
+
+COrphanBlockStats GetOrphanBlockStats();
+
+/**
+ * Whether the block hashBlock on top of pindexPrev is an ancestor of the -assumevalid block,
+ * itself buried in the best header chain: its scripts and stake signatures are then not checked.
+ * Requires cs_main.
+ */
+bool IsAssumedValid(const CBlockIndex* pindexPrev, const uint256& hashBlock);
+/** Number of blocks connected since startup without checking their scripts */
+uint64_t GetAssumedValidBlocks();
+
 CAmount GetMinRelayFee(const CTransaction& tx, const CTxMemPool& pool, unsigned int nBytes, bool fAllowFree);
 
 /**
@@ -287,6 +368,8 @@ CAmount GetMinRelayFee(const CTransaction& tx, const CTxMemPool& pool, unsigned
  * instead of being performed inline.
  */
 bool CheckInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& view, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck>* pvChecks = NULL);
+/** Same, from the coins spent by tx as returned by CCoinsViewCache::GetInputs, spent at nSpendHeight */
+bool CheckInputs(const CTransaction& tx, CValidationState& state, const std::vector<const Coin*>& vCoins, int nSpendHeight, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck>* pvChecks = NULL);
 
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight);
@@ -354,6 +437,9 @@ public:
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex);
+/** Read the block of pindex, from the recent block cache if it is there. Added to it if fAddToCache */
+bool ReadBlockFromDisk(std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, bool fAddToCache = false);
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock);
 
 
 /** Functions for validating blocks and updating the block tree */
@@ -373,6 +459,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
 /** Context-independent validity checks */
 bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool fCheckPOW = true);
+/** The checks of CheckBlock that don't depend on the chain, they may run without cs_main on any thread */
+bool CheckBlockContextFree(const CBlock& block, CValidationState& state, bool fCheckPOW = true, bool fCheckMerkleRoot = true);
 bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW = true, bool fCheckMerkleRoot = true, bool fCheckSig = true);
 bool CheckWork(const CBlock block, CBlockIndex* const pindexPrev);
 
@@ -385,7 +473,7 @@ bool TestBlockValidity(CValidationState& state, const CBlock& block, CBlockIndex
 
 /** Store block on disk. If dbp is provided, the file is known to already reside on disk */
 bool AcceptBlock(const CBlock& block, CValidationState& state, CBlockIndex** pindex, CDiskBlockPos* dbp = NULL, bool fAlreadyCheckedBlock = false);
-bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex** ppindex = NULL);
+bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex** ppindex = NULL, NodeId nodeid = -1);
 
 
 /** RAII wrapper for VerifyDB: Verify consistency of the block and coin databases */
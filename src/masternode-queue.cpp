@@ -0,0 +1,96 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternode-queue.h"
+
+#include "masternode.h"
+#include "timedata.h"
+
+int64_t SecondsSincePayment(int64_t nNow, int64_t nLastPaid, uint32_t nHash)
+{
+    int64_t sec = nNow - nLastPaid;
+    int64_t month = MONTH_IN_SECONDS;
+    if (sec < month) return sec; //if it's less than 30 days, give seconds
+
+    // return some deterministic value for unknown/unpaid but force it to be more than 30 days old
+    return month + nHash;
+}
+
+void CMasternodePaymentQueue::Update(CMasternode* pmn, int64_t nLastPaid, uint32_t nHash)
+{
+    const COutPoint& outpoint = pmn->vin.prevout;
+    auto it = mapEntries.find(outpoint);
+    if (it != mapEntries.end()) {
+        if (it->second.nLastPaid == nLastPaid && it->second.nHash == nHash && it->second.pmn == pmn)
+            return;
+        setByLastPaid.erase(std::make_pair(it->second.nLastPaid, outpoint));
+        setUnpaid.erase(std::make_pair(it->second.nHash, outpoint));
+        mapEntries.erase(it);
+    }
+    mapEntries.emplace(outpoint, CEntry{nLastPaid, nHash, pmn});
+    setByLastPaid.emplace(nLastPaid, outpoint);
+    if (nLastPaid <= nUnpaidBefore)
+        setUnpaid.emplace(nHash, outpoint);
+}
+
+void CMasternodePaymentQueue::Remove(const CMasternode* pmn)
+{
+    auto it = mapEntries.find(pmn->vin.prevout);
+    if (it == mapEntries.end() || it->second.pmn != pmn)
+        return;
+    setByLastPaid.erase(std::make_pair(it->second.nLastPaid, it->first));
+    setUnpaid.erase(std::make_pair(it->second.nHash, it->first));
+    mapEntries.erase(it);
+}
+
+void CMasternodePaymentQueue::Clear()
+{
+    mapEntries.clear();
+    setByLastPaid.clear();
+    setUnpaid.clear();
+}
+
+bool CMasternodePaymentQueue::Contains(const CMasternode* pmn) const
+{
+    auto it = mapEntries.find(pmn->vin.prevout);
+    return it != mapEntries.end() && it->second.pmn == pmn;
+}
+
+//! The first entry of setByLastPaid last paid after nTime
+static std::set<std::pair<int64_t, COutPoint> >::const_iterator PaidAfter(const std::set<std::pair<int64_t, COutPoint> >& setByLastPaid, int64_t nTime)
+{
+    if (nTime == INT64_MAX)
+        return setByLastPaid.end();
+    return setByLastPaid.lower_bound(std::make_pair(nTime + 1, COutPoint(UINT256_ZERO, 0)));
+}
+
+void CMasternodePaymentQueue::SetUnpaidBefore(int64_t nBefore) const
+{
+    if (nBefore > nUnpaidBefore) {
+        const auto itEnd = PaidAfter(setByLastPaid, nBefore);
+        for (auto it = PaidAfter(setByLastPaid, nUnpaidBefore); it != itEnd; ++it)
+            setUnpaid.emplace(mapEntries.at(it->second).nHash, it->second);
+    } else if (nBefore < nUnpaidBefore) {
+        const auto itEnd = PaidAfter(setByLastPaid, nUnpaidBefore);
+        for (auto it = PaidAfter(setByLastPaid, nBefore); it != itEnd; ++it)
+            setUnpaid.erase(std::make_pair(mapEntries.at(it->second).nHash, it->second));
+    }
+    nUnpaidBefore = nBefore;
+}
+
+void CMasternodePaymentQueue::ForEach(int64_t nNow, const std::function<bool(CMasternode*)>& fn) const
+{
+    // Unpaid for a month or more, by descending hash
+    SetUnpaidBefore(nNow - MONTH_IN_SECONDS);
+    for (const auto& unpaid : setUnpaid) {
+        if (!fn(mapEntries.at(unpaid.second).pmn))
+            return;
+    }
+
+    // Then the least recently paid first
+    for (auto it = PaidAfter(setByLastPaid, nUnpaidBefore); it != setByLastPaid.end(); ++it) {
+        if (!fn(mapEntries.at(it->second).pmn))
+            return;
+    }
+}
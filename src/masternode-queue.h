@@ -0,0 +1,79 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DECENOMY_MASTERNODE_QUEUE_H
+#define DECENOMY_MASTERNODE_QUEUE_H
+
+#include "primitives/transaction.h"
+
+#include <functional>
+#include <map>
+#include <set>
+
+class CMasternode;
+
+/**
+ * How long ago a masternode last paid at nLastPaid was paid, as of nNow:
+ * the seconds since then below a month, a month plus nHash, a deterministic
+ * per masternode value, beyond. The payment queue pays the highest first.
+ */
+int64_t SecondsSincePayment(int64_t nNow, int64_t nLastPaid, uint32_t nHash);
+
+/**
+ * The masternodes in the order they are paid, highest SecondsSincePayment
+ * first, kept as they are added, removed or paid instead of being sorted
+ * for each query.
+ *
+ * The entries last paid a month or more before the time of the query come
+ * first by descending hash, they are the prefix of the entries ordered by
+ * last paid time. The others follow, least recently paid first. Entries of
+ * equal SecondsSincePayment are ordered by collateral outpoint.
+ *
+ * The unpaid ones are also kept by hash, as of the time of the last query:
+ * as time goes by, the next query only moves the entries which crossed the
+ * month since.
+ */
+class CMasternodePaymentQueue
+{
+public:
+    /** Insert pmn or move it to its new place */
+    void Update(CMasternode* pmn, int64_t nLastPaid, uint32_t nHash);
+    void Remove(const CMasternode* pmn);
+    void Clear();
+
+    bool Contains(const CMasternode* pmn) const;
+    size_t size() const { return mapEntries.size(); }
+
+    /** Visit the masternodes in payment order as of nNow, until fn returns false */
+    void ForEach(int64_t nNow, const std::function<bool(CMasternode*)>& fn) const;
+
+private:
+    struct CEntry {
+        int64_t nLastPaid;
+        uint32_t nHash;
+        CMasternode* pmn;
+    };
+
+    //! Descending hash, then ascending outpoint
+    struct CompareUnpaid {
+        bool operator()(const std::pair<uint32_t, COutPoint>& a, const std::pair<uint32_t, COutPoint>& b) const
+        {
+            if (a.first != b.first)
+                return a.first > b.first;
+            return a.second < b.second;
+        }
+    };
+
+    std::map<COutPoint, CEntry> mapEntries;
+    //! Ascending last paid time
+    std::set<std::pair<int64_t, COutPoint> > setByLastPaid;
+    //! The entries last paid at nUnpaidBefore or earlier, updated by the queries
+    mutable std::set<std::pair<uint32_t, COutPoint>, CompareUnpaid> setUnpaid;
+    mutable int64_t nUnpaidBefore{INT64_MIN};
+
+    //! Move the entries in or out of setUnpaid for it to hold the ones last paid at nBefore or earlier
+    void SetUnpaidBefore(int64_t nBefore) const;
+};
+
+#endif // DECENOMY_MASTERNODE_QUEUE_H
@@ -0,0 +1,41 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternode-scores.h"
+
+#include "hash.h"
+#include "masternode.h"
+#include "version.h"
+
+#include <algorithm>
+
+uint256 CalculateMasternodeScore(const uint256& hashBlock, const uint256& hash2, const COutPoint& prevout)
+{
+    uint256 aux = prevout.hash + prevout.n;
+
+    CHashWriter ss2(SER_GETHASH, PROTOCOL_VERSION);
+    ss2 << hashBlock;
+    ss2 << aux;
+    uint256 hash3 = ss2.GetHash();
+
+    return (hash3 > hash2 ? hash3 - hash2 : hash2 - hash3);
+}
+
+CMasternodeScores::CMasternodeScores(const uint256& hashBlockIn, uint64_t nListVersionIn, const std::vector<CMasternode*>& vMasternodes) :
+    hashBlock(hashBlockIn),
+    nListVersion(nListVersionIn)
+{
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << hashBlock;
+    const uint256 hash2 = ss.GetHash();
+
+    vEntries.reserve(vMasternodes.size());
+    for (CMasternode* pmn : vMasternodes) {
+        const uint256 score = CalculateMasternodeScore(hashBlock, hash2, pmn->vin.prevout);
+        vEntries.push_back(CEntry{score.GetCompact(false), score, pmn});
+    }
+    std::stable_sort(vEntries.begin(), vEntries.end(), [](const CEntry& a, const CEntry& b) {
+        return a.nScore > b.nScore;
+    });
+}
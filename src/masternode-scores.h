@@ -0,0 +1,50 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DECENOMY_MASTERNODE_SCORES_H
+#define DECENOMY_MASTERNODE_SCORES_H
+
+#include "primitives/transaction.h"
+#include "uint256.h"
+
+#include <vector>
+
+class CMasternode;
+
+/** Score tables kept by the masternode manager, one per height */
+static const size_t MAX_MASTERNODE_SCORE_TABLES = 32;
+
+/**
+ * Score of the masternode of collateral prevout for the block hashBlock, see
+ * CMasternode::CalculateScore. hash2 is the hash of hashBlock, the same for
+ * every masternode.
+ */
+uint256 CalculateMasternodeScore(const uint256& hashBlock, const uint256& hash2, const COutPoint& prevout);
+
+/**
+ * The scores of the masternodes of the list for a block, highest compact
+ * score first. The block hash is hashed once and the list is sorted once,
+ * then the ranks and the winners at that height are read from it until the
+ * list or the block changes. Entries of the same compact score keep the
+ * order of the list, the first one of them won the score comparisons.
+ */
+class CMasternodeScores
+{
+public:
+    struct CEntry {
+        //! The compact score the masternodes are ranked by
+        int64_t nScore;
+        uint256 score;
+        CMasternode* pmn;
+    };
+
+    const uint256 hashBlock;
+    //! Version of the list the scores were computed for
+    const uint64_t nListVersion;
+    std::vector<CEntry> vEntries;
+
+    CMasternodeScores(const uint256& hashBlockIn, uint64_t nListVersionIn, const std::vector<CMasternode*>& vMasternodes);
+};
+
+#endif // DECENOMY_MASTERNODE_SCORES_H
@@ -9,6 +9,8 @@
 #include "addrman.h"
 #include "init.h"
 #include "masternode-payments.h"
+#include "masternode-queue.h"
+#include "masternode-scores.h"
 #include "masternode-sync.h"
 #include "masternodeman.h"
 #include "netbase.h"
@@ -132,12 +134,11 @@ std::string CMasternode::GetStrMessage() const
 bool CMasternode::UpdateFromNewBroadcast(CMasternodeBroadcast& mnb)
 {
     if (mnb.sigTime > sigTime) {
-        pubKeyMasternode = mnb.pubKeyMasternode;
-        pubKeyCollateralAddress = mnb.pubKeyCollateralAddress;
+        // the keys it is looked up by, updated in the masternode manager's maps
+        mnodeman.UpdateKeys(this, mnb.pubKeyMasternode, mnb.pubKeyCollateralAddress, mnb.addr);
         sigTime = mnb.sigTime;
         vchSig = mnb.vchSig;
         protocolVersion = mnb.protocolVersion;
-        addr = mnb.addr;
         lastTimeChecked = 0;
         lastTimeCollateralChecked = 0;
         int nDoS = 0;
@@ -145,6 +146,8 @@ bool CMasternode::UpdateFromNewBroadcast(CMasternodeBroadcast& mnb)
             lastPing = mnb.lastPing;
             mnodeman.mapSeenMasternodePing.insert(std::make_pair(lastPing.GetHash(), lastPing));
         }
+        // the new sigTime moves it in the payment queue
+        mnodeman.UpdatePaymentQueue(this);
         return true;
     }
     return false;
@@ -163,7 +166,6 @@ uint256 CMasternode::CalculateScore(int mod, int64_t nBlockHeight)
     }
 
     uint256 hash;
-    uint256 aux = vin.prevout.hash + vin.prevout.n;
 
     if (!GetBlockHash(hash, nBlockHeight)) {
         LogPrint(BCLog::MASTERNODE,"CalculateScore ERROR - nHeight %d - Returned 0\n", nBlockHeight);
@@ -174,14 +176,7 @@ uint256 CMasternode::CalculateScore(int mod, int64_t nBlockHeight)
     ss << hash;
     uint256 hash2 = ss.GetHash();
 
-    CHashWriter ss2(SER_GETHASH, PROTOCOL_VERSION);
-    ss2 << hash;
-    ss2 << aux;
-    uint256 hash3 = ss2.GetHash();
-
-    uint256 r = (hash3 > hash2 ? hash3 - hash2 : hash2 - hash3);
-
-    return r;
+    return CalculateMasternodeScore(hash, hash2, vin.prevout);
 }
 
 void CMasternode::Check(bool forceCheck)
@@ -252,6 +247,11 @@ void CMasternode::Check(bool forceCheck)
 }
 
 int64_t CMasternode::SecondsSincePayment(CBlockIndex* pblockindex)
+{
+    return ::SecondsSincePayment(GetAdjustedTime(), GetPaymentQueueTime(pblockindex), GetPaymentQueueHash());
+}
+
+int64_t CMasternode::GetPaymentQueueTime(CBlockIndex* pblockindex)
 {
     auto lp = GetLastPaid(pblockindex);
 
@@ -259,17 +259,15 @@ int64_t CMasternode::SecondsSincePayment(CBlockIndex* pblockindex)
         lp = sigTime;
     }
 
-    int64_t sec = (GetAdjustedTime() - lp);
-    int64_t month = MONTH_IN_SECONDS;
-    if (sec < month) return sec; //if it's less than 30 days, give seconds
+    return lp;
+}
 
+uint32_t CMasternode::GetPaymentQueueHash() const
+{
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
     ss << vin;
     ss << sigTime;
-    uint256 hash = ss.GetHash();
-
-    // return some deterministic value for unknown/unpaid but force it to be more than 30 days old
-    return month + hash.GetCompact(false);
+    return ss.GetHash().GetCompact(false);
 }
 
 int64_t CMasternode::GetLastPaidV1(CBlockIndex* pblockindex, const CScript& mnpayee)
@@ -316,6 +314,11 @@ int64_t CMasternode::GetLastPaidV2(CBlockIndex* pblockindex, const CScript& mnpa
 
     do
     {
+        // Older than the payees this node knows (e.g. the blocks of a UTXO snapshot
+        // past its payee window): not paid since this block, as far as it can tell
+        if (!pblockindex->paidPayee)
+            return pblockindex->GetBlockTime();
+
         auto paidpayee = pblockindex->GetPaidPayee();
         if(paidpayee && mnpayee == *paidpayee) {
             lastPaid = pblockindex->nTime;
@@ -224,6 +224,10 @@ public:
     }
 
     int64_t SecondsSincePayment(CBlockIndex* pblockindex);
+    //! The time SecondsSincePayment counts from
+    int64_t GetPaymentQueueTime(CBlockIndex* pblockindex);
+    //! The deterministic value ordering the masternodes unpaid for a month
+    uint32_t GetPaymentQueueHash() const;
 
     bool UpdateFromNewBroadcast(CMasternodeBroadcast& mnb);
 
@@ -26,30 +26,6 @@ CMasternodeMan mnodeman;
 /** Keep track of the active Masternode */
 CActiveMasternodeMan amnodeman;
 
-struct CompareLastPaid {
-    bool operator()(const std::pair<int64_t, CTxIn>& t1,
-        const std::pair<int64_t, CTxIn>& t2) const
-    {
-        return t1.first < t2.first;
-    }
-};
-
-struct CompareScoreTxIn {
-    bool operator()(const std::pair<int64_t, CTxIn>& t1,
-        const std::pair<int64_t, CTxIn>& t2) const
-    {
-        return t1.first < t2.first;
-    }
-};
-
-struct CompareScoreMN {
-    bool operator()(const std::pair<int64_t, CMasternode>& t1,
-        const std::pair<int64_t, CMasternode>& t2) const
-    {
-        return t1.first < t2.first;
-    }
-};
-
 //
 // CMasternodeDB
 //
@@ -221,6 +197,9 @@ bool CMasternodeMan::Add(CMasternode& mn)
     if(mnScript) {
         auto it = std::find(vMasternodes.begin(), vMasternodes.end(), mnScript);
         if(it != vMasternodes.end()) vMasternodes.erase(it);
+        RemoveFromIndexes(mnScript);
+        RemoveFromPaymentQueue(mnScript);
+        nListVersion++;
 
         return false;
     }
@@ -231,18 +210,10 @@ bool CMasternodeMan::Add(CMasternode& mn)
         LogPrint(BCLog::MASTERNODE, "CMasternodeMan: Adding new Masternode %s - count %i now\n", mn.vin.prevout.ToStringShort(), size() + 1);
         auto m = new CMasternode(mn);
         vMasternodes.push_back(m);
-        {
-            LOCK(cs_script);
-            mapScriptMasternodes[GetScriptForDestination(m->pubKeyCollateralAddress.GetID())] = m;
-        }
-        {
-            LOCK(cs_txin);
-            mapTxInMasternodes[m->vin] = m;
-        }
-        {
-            LOCK(cs_pubkey);
-            mapPubKeyMasternodes[m->pubKeyMasternode] = m;
-        }
+        AddToIndexes(m);
+        setPaymentQueueDirty.insert(m);
+        setPaymentQueueAheadDirty.insert(m);
+        nListVersion++;
         return true;
     }
 
@@ -311,18 +282,9 @@ void CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
                 }
             }
 
-            {
-                LOCK(cs_script);
-                mapScriptMasternodes.erase(GetScriptForDestination((*it)->pubKeyCollateralAddress.GetID()));
-            }
-            {
-                LOCK(cs_txin);
-                mapTxInMasternodes.erase((*it)->vin);
-            }
-            {
-                LOCK(cs_pubkey);
-                mapPubKeyMasternodes.erase((*it)->pubKeyMasternode);
-            }
+            RemoveFromIndexes(*it);
+            RemoveFromPaymentQueue(*it);
+            nListVersion++;
             delete *it;
             it = vMasternodes.erase(it);
         } else {
@@ -385,19 +347,22 @@ void CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
 void CMasternodeMan::Clear()
 {
     {
-        LOCK(cs_script);
+        boost::unique_lock<boost::shared_mutex> lock(cs_index);
         mapScriptMasternodes.clear();
-    }
-    {
-        LOCK(cs_txin);
         mapTxInMasternodes.clear();
-    }
-    {
-        LOCK(cs_pubkey);
         mapPubKeyMasternodes.clear();
+        mapAddrMasternodes.clear();
     }
 
     LOCK(cs);
+    paymentQueue.Clear();
+    setPaymentQueueDirty.clear();
+    fPaymentQueueRebuild = true;
+    paymentQueueAhead.Clear();
+    setPaymentQueueAheadDirty.clear();
+    fPaymentQueueAheadRebuild = true;
+    mapScores.clear();
+    nListVersion++;
     auto it = vMasternodes.begin();
     while (it != vMasternodes.end()) {
         delete *it;
@@ -500,9 +465,64 @@ void CMasternodeMan::DsegUpdate(CNode* pnode)
     mWeAskedForMasternodeList[pnode->addr] = askAgain;
 }
 
+void CMasternodeMan::IndexMasternode(CMasternode* pmn)
+{
+    mapScriptMasternodes[GetScriptForDestination(pmn->pubKeyCollateralAddress.GetID())] = pmn;
+    mapTxInMasternodes[pmn->vin] = pmn;
+    mapPubKeyMasternodes[pmn->pubKeyMasternode] = pmn;
+    mapAddrMasternodes.emplace(pmn->addr, pmn);
+}
+
+bool CMasternodeMan::UnindexMasternode(const CMasternode* pmn)
+{
+    // only the entries still pointing to it, another one may have taken its keys
+    auto itTxIn = mapTxInMasternodes.find(pmn->vin);
+    const bool fIndexed = itTxIn != mapTxInMasternodes.end() && itTxIn->second == pmn;
+    if (fIndexed) mapTxInMasternodes.erase(itTxIn);
+
+    auto itScript = mapScriptMasternodes.find(GetScriptForDestination(pmn->pubKeyCollateralAddress.GetID()));
+    if (itScript != mapScriptMasternodes.end() && itScript->second == pmn) mapScriptMasternodes.erase(itScript);
+
+    auto itPubKey = mapPubKeyMasternodes.find(pmn->pubKeyMasternode);
+    if (itPubKey != mapPubKeyMasternodes.end() && itPubKey->second == pmn) mapPubKeyMasternodes.erase(itPubKey);
+
+    auto range = mapAddrMasternodes.equal_range(pmn->addr);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == pmn) {
+            mapAddrMasternodes.erase(it);
+            break;
+        }
+    }
+
+    return fIndexed;
+}
+
+void CMasternodeMan::AddToIndexes(CMasternode* pmn)
+{
+    boost::unique_lock<boost::shared_mutex> lock(cs_index);
+    IndexMasternode(pmn);
+}
+
+void CMasternodeMan::RemoveFromIndexes(const CMasternode* pmn)
+{
+    boost::unique_lock<boost::shared_mutex> lock(cs_index);
+    UnindexMasternode(pmn);
+}
+
+void CMasternodeMan::UpdateKeys(CMasternode* pmn, const CPubKey& pubKeyMasternode, const CPubKey& pubKeyCollateralAddress, const CService& addr)
+{
+    boost::unique_lock<boost::shared_mutex> lock(cs_index);
+
+    const bool fIndexed = UnindexMasternode(pmn);
+    pmn->pubKeyMasternode = pubKeyMasternode;
+    pmn->pubKeyCollateralAddress = pubKeyCollateralAddress;
+    pmn->addr = addr;
+    if (fIndexed) IndexMasternode(pmn);
+}
+
 CMasternode* CMasternodeMan::Find(const CScript& payee)
 {
-    LOCK(cs_script);
+    boost::shared_lock<boost::shared_mutex> lock(cs_index);
 
     auto it = mapScriptMasternodes.find(payee);
     if (it != mapScriptMasternodes.end())
@@ -513,7 +533,7 @@ CMasternode* CMasternodeMan::Find(const CScript& payee)
 
 CMasternode* CMasternodeMan::Find(const CTxIn& vin)
 {
-    LOCK(cs_txin);
+    boost::shared_lock<boost::shared_mutex> lock(cs_index);
 
     auto it = mapTxInMasternodes.find(vin);
     if (it != mapTxInMasternodes.end())
@@ -525,7 +545,7 @@ CMasternode* CMasternodeMan::Find(const CTxIn& vin)
 
 CMasternode* CMasternodeMan::Find(const CPubKey& pubKeyMasternode)
 {
-    LOCK(cs_pubkey);
+    boost::shared_lock<boost::shared_mutex> lock(cs_index);
 
     auto it = mapPubKeyMasternodes.find(pubKeyMasternode);
     if (it != mapPubKeyMasternodes.end())
@@ -535,151 +555,279 @@ CMasternode* CMasternodeMan::Find(const CPubKey& pubKeyMasternode)
 }
 
 CMasternode* CMasternodeMan::Find(const CService &addr)
+{
+    boost::shared_lock<boost::shared_mutex> lock(cs_index);
+
+    auto it = mapAddrMasternodes.find(addr);
+    if (it != mapAddrMasternodes.end())
+        return it->second;
+
+    return NULL;
+}
+
+void CMasternodeMan::RefreshPaymentQueue(CBlockIndex* pindexPrev)
+{
+    AssertLockHeld(cs);
+
+    // The last paid times are only kept up to date by the connected blocks with SPORK_112,
+    // with the V1 lookup they depend on the payment votes received since
+    const bool fLastPaidV2 = sporkManager.IsSporkActive(SPORK_112_MASTERNODE_LAST_PAID_V2);
+    const int nSporks = (fLastPaidV2 ? 1 : 0) | (sporkManager.IsSporkActive(SPORK_114_MN_PAYMENT_V2) ? 2 : 0);
+    if (!fLastPaidV2 || nSporks != nPaymentQueueSporks) {
+        fPaymentQueueRebuild = true;
+        nPaymentQueueSporks = nSporks;
+    }
+
+    if (fPaymentQueueRebuild) {
+        paymentQueue.Clear();
+        setPaymentQueueDirty.clear();
+        setPaymentQueueDirty.insert(vMasternodes.begin(), vMasternodes.end());
+        fPaymentQueueRebuild = false;
+    }
+
+    for (auto mn : setPaymentQueueDirty) {
+        paymentQueue.Update(mn, mn->GetPaymentQueueTime(pindexPrev), mn->GetPaymentQueueHash());
+    }
+    setPaymentQueueDirty.clear();
+}
+
+void CMasternodeMan::RefreshPaymentQueueAhead()
+{
+    AssertLockHeld(cs);
+
+    // Without a block, the last paid times are the sigTimes with SPORK_114 and none without
+    const int nSporks = sporkManager.IsSporkActive(SPORK_114_MN_PAYMENT_V2) ? 1 : 0;
+    if (nSporks != nPaymentQueueAheadSporks) {
+        fPaymentQueueAheadRebuild = true;
+        nPaymentQueueAheadSporks = nSporks;
+    }
+
+    if (fPaymentQueueAheadRebuild) {
+        paymentQueueAhead.Clear();
+        setPaymentQueueAheadDirty.clear();
+        setPaymentQueueAheadDirty.insert(vMasternodes.begin(), vMasternodes.end());
+        fPaymentQueueAheadRebuild = false;
+    }
+
+    for (auto mn : setPaymentQueueAheadDirty) {
+        paymentQueueAhead.Update(mn, mn->GetPaymentQueueTime(nullptr), mn->GetPaymentQueueHash());
+    }
+    setPaymentQueueAheadDirty.clear();
+}
+
+void CMasternodeMan::RemoveFromPaymentQueue(CMasternode* pmn)
+{
+    AssertLockHeld(cs);
+
+    paymentQueue.Remove(pmn);
+    setPaymentQueueDirty.erase(pmn);
+    paymentQueueAhead.Remove(pmn);
+    setPaymentQueueAheadDirty.erase(pmn);
+}
+
+void CMasternodeMan::UpdateLastPaid(const CScript& payee, int64_t nLastPaid)
 {
     LOCK(cs);
 
-    for (auto mn : vMasternodes) {
-        if (mn->addr.ToStringIP() == addr.ToStringIP())
-            return mn;
+    CMasternode* pmn = Find(payee);
+    if (!pmn) return;
+
+    pmn->lastPaid = nLastPaid;
+    setPaymentQueueDirty.insert(pmn);
+}
+
+void CMasternodeMan::UpdatePaymentQueue(CMasternode* pmn)
+{
+    LOCK(cs);
+
+    if (Find(pmn->vin) == pmn) {
+        setPaymentQueueDirty.insert(pmn);
+        setPaymentQueueAheadDirty.insert(pmn);
     }
-    return NULL;
 }
 
 //
 // Deterministically select the oldest/best masternode to pay on the network
 //
+// The masternodes are visited in paymentQueue order, the order of their
+// SecondsSincePayment, and the eligibility filters, which depend on the
+// height and the time, are applied while walking it. The walk stops once
+// the eligible set is complete, nCount is the full count only if fJustCount.
+//
 CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCount, std::vector<CTxIn>& vEligibleTxIns, bool fJustCount, bool fCleanLastPaid)
 {
-
     CMasternode* pBestMasternode = nullptr;
-
-    /*
-        Make a vector with all of the last paid times
-    */
-
-    std::vector<std::pair<int64_t, CTxIn>> vecMasternodeLastPaid;
     vEligibleTxIns.clear();
-    int nMnCount = 0;
-    {
-        LOCK2(cs_main, cs);
+    nCount = 0;
 
-        nMnCount = CountEnabled();
-        for (auto mn : vMasternodes) {
-            mn->Check();
-            if (!mn->IsEnabled()) continue;
+    LOCK2(cs_main, cs);
 
-            //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
-            if (masternodePayments.IsScheduled(*mn, nBlockHeight)) continue;
+    CBlockIndex* pindexPrev = chainActive[nBlockHeight - 1];
+    const int nMnCount = CountEnabled();
+    const int64_t nNow = GetAdjustedTime();
+    const bool fPaymentV2 = sporkManager.IsSporkActive(SPORK_114_MN_PAYMENT_V2);
+    const bool fStakeModifierV2 = Params().GetConsensus().NetworkUpgradeActive(chainActive.Tip()->nHeight, Consensus::UPGRADE_STAKE_MODIFIER_V2);
+    const bool fCheckConfirmations = !sporkManager.IsSporkActive(SPORK_107_IGNORE_COLLATERAL_CONFIRMATIONS);
+
+    // paymentQueue holds the last paid times as of the tip, paymentQueueAhead the ones of the heights
+    // ahead of it that ProcessBlock asks for, which have no pindexPrev yet. Any other height, below
+    // the tip, gets a queue of its own
+    CMasternodePaymentQueue queueOther;
+    const bool fQueueOfTip = pindexPrev && pindexPrev == chainActive.Tip();
+    const bool fQueueAhead = !pindexPrev;
+    CMasternodePaymentQueue& queue = fQueueOfTip ? paymentQueue : fQueueAhead ? paymentQueueAhead : queueOther;
+    if (fQueueOfTip) {
+        RefreshPaymentQueue(pindexPrev);
+    } else if (fQueueAhead) {
+        RefreshPaymentQueueAhead();
+    } else {
+        for (auto mn : vMasternodes)
+            queueOther.Update(mn, mn->GetPaymentQueueTime(pindexPrev), mn->GetPaymentQueueHash());
+    }
 
-            //it's too new, wait for a cycle
-            if (Params().GetConsensus().NetworkUpgradeActive(chainActive.Tip()->nHeight, Consensus::UPGRADE_STAKE_MODIFIER_V2)) {
-                if (fFilterSigTime && mn->sigTime + (nMnCount * 60) > GetAdjustedTime()) continue;
-            } else {
-                if (fFilterSigTime && mn->sigTime + (nMnCount * 2.6 * 60) > GetAdjustedTime()) continue;
-            }
+    auto fnEligible = [&](CMasternode* mn, bool fSigTime) {
+        mn->Check();
+        if (!mn->IsEnabled()) return false;
 
-            //make sure it has as many confirmations as there are masternodes
-            if (!sporkManager.IsSporkActive(SPORK_107_IGNORE_COLLATERAL_CONFIRMATIONS)) {
-                if (pcoinsTip->GetCoinDepthAtHeight(mn->vin.prevout, nBlockHeight) < nMnCount) continue;
-            }
+        //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
+        if (masternodePayments.IsScheduled(*mn, nBlockHeight)) return false;
 
-            vecMasternodeLastPaid.push_back(std::make_pair(mn->SecondsSincePayment(chainActive[nBlockHeight - 1]), mn->vin));
+        //it's too new, wait for a cycle
+        if (fStakeModifierV2) {
+            if (fSigTime && mn->sigTime + (nMnCount * 60) > nNow) return false;
+        } else {
+            if (fSigTime && mn->sigTime + (nMnCount * 2.6 * 60) > nNow) return false;
+        }
+
+        //make sure it has as many confirmations as there are masternodes
+        if (fCheckConfirmations) {
+            if (pcoinsTip->GetCoinDepthAtHeight(mn->vin.prevout, nBlockHeight) < nMnCount) return false;
         }
-    }
 
-    nCount = (int)vecMasternodeLastPaid.size();
+        return true;
+    };
+
+    // count the eligible masternodes, stopping at nLimit if not negative
+    auto fnCount = [&](bool fSigTime, int nLimit) {
+        int n = 0;
+        queue.ForEach(nNow, [&](CMasternode* mn) {
+            if (fnEligible(mn, fSigTime)) n++;
+            return nLimit < 0 || n < nLimit;
+        });
+        return n;
+    };
 
     //when the network is in the process of upgrading, don't penalize nodes that recently restarted
-    if (fFilterSigTime && nCount < nMnCount / 3) return GetNextMasternodeInQueueForPayment(nBlockHeight, false, nCount, vEligibleTxIns, fJustCount, fCleanLastPaid);
+    bool fSigTime = fFilterSigTime;
+    if (fJustCount) {
+        nCount = fnCount(fSigTime, -1);
+        if (fSigTime && nCount < nMnCount / 3) nCount = fnCount(false, -1);
+        return pBestMasternode;
+    }
+    if (fSigTime && fnCount(true, nMnCount / 3) < nMnCount / 3) fSigTime = false;
 
-    if(!fJustCount) {
+    int nEligibleNetwork = nMnCount / 10;
 
-        // Sort them high to low
-        sort(vecMasternodeLastPaid.rbegin(), vecMasternodeLastPaid.rend(), CompareLastPaid());
+    if(fPaymentV2) {
+        nEligibleNetwork = std::max(10, nMnCount * 5 / 100); // oldest 5% or the minimal of 10 MNs
+    }
 
-        auto nEnabled = CountEnabled();
-        int nEligibleNetwork = nEnabled / 10; 
-        
-        if(sporkManager.IsSporkActive(SPORK_114_MN_PAYMENT_V2)) {
-            nEligibleNetwork = std::max(10, nEnabled * 5 / 100); // oldest 5% or the minimal of 10 MNs
+    // clean last paid and recalculate again
+    if(fCleanLastPaid && fPaymentV2) {
+        std::vector<CMasternode*> vClean;
+        queue.ForEach(nNow, [&](CMasternode* mn) {
+            if (!fnEligible(mn, fSigTime)) return true;
+            vClean.push_back(mn);
+            return (int)vClean.size() < nEligibleNetwork / 3;
+        });
+
+        for (auto mn : vClean) {
+            mn->lastPaid = INT64_MAX;
+            setPaymentQueueDirty.insert(mn);
+            // without pindexPrev the last paid times are not looked up, paymentQueueAhead stays as it is
+            if (!fQueueOfTip && !fQueueAhead)
+                queueOther.Update(mn, mn->GetPaymentQueueTime(pindexPrev), mn->GetPaymentQueueHash());
         }
+        if (fQueueOfTip)
+            RefreshPaymentQueue(pindexPrev);
+    }
 
-        int n = 0;
-        // clean last paid and recalculate again
-        if(fCleanLastPaid && sporkManager.IsSporkActive(SPORK_114_MN_PAYMENT_V2)) {
-            for (const auto& s : vecMasternodeLastPaid) {
-                CMasternode* pmn = Find(s.second);
-                if (!pmn) continue;
-
-                pmn->lastPaid = INT64_MAX;
+    uint256 nHigh;
+    int nCountEligible = 0;
+    queue.ForEach(nNow, [&](CMasternode* pmn) {
+        if (!fnEligible(pmn, fSigTime)) return true;
 
-                n++;
-                if (n >= nEligibleNetwork / 3) break;
+        if (fPaymentV2) {
+            if (pBestMasternode == nullptr) {
+                pBestMasternode = pmn; // get the MN that was paid the last
             }
+        } else {
+            uint256 n = pmn->CalculateScore(1, nBlockHeight - 100);
+            if (n > nHigh) {
+                nHigh = n;
+                pBestMasternode = pmn;
+            }
+        }
 
-            return GetNextMasternodeInQueueForPayment(nBlockHeight, fFilterSigTime, nCount, vEligibleTxIns, fJustCount, false);
+        vEligibleTxIns.push_back(pmn->vin);
+        if (fPaymentV2 && pmn->GetLastPaid(pindexPrev) != 0) {
+            nCountEligible++;
         }
+        return nCountEligible < nEligibleNetwork;
+    });
 
-        uint256 nHigh;
-        int nCountEligible = 0;
-        for (const auto& s : vecMasternodeLastPaid) {
-            CMasternode* pmn = Find(s.second);
-            if (!pmn) continue;
+    return pBestMasternode;
+}
 
-            if (sporkManager.IsSporkActive(SPORK_114_MN_PAYMENT_V2)) {
-                if (pBestMasternode == nullptr) {
-                    pBestMasternode = pmn; // get the MN that was paid the last
-                }
-            } else {
-                uint256 n = pmn->CalculateScore(1, nBlockHeight - 100);
-                if (n > nHigh) {
-                    nHigh = n;
-                    pBestMasternode = pmn;
-                }
-            }
+const CMasternodeScores* CMasternodeMan::GetScores(int64_t nBlockHeight, std::unique_ptr<CMasternodeScores>* pscoresUncached)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs);
 
-            vEligibleTxIns.push_back(s.second);
-            if (sporkManager.IsSporkActive(SPORK_114_MN_PAYMENT_V2) && 
-                pmn->GetLastPaid(chainActive[nBlockHeight - 1]) != 0
-            ) {
-                nCountEligible++;
-            }
-            if (nCountEligible >= nEligibleNetwork) break;
-        }
+    //make sure we know about this block
+    uint256 hash;
+    if (!chainActive.Tip() || !GetBlockHash(hash, nBlockHeight)) return nullptr;
+
+    auto it = mapScores.find(nBlockHeight);
+    if (it != mapScores.end() && it->second->hashBlock == hash && it->second->nListVersion == nListVersion)
+        return it->second.get();
+
+    if (pscoresUncached) {
+        pscoresUncached->reset(new CMasternodeScores(hash, nListVersion, vMasternodes));
+        return pscoresUncached->get();
     }
 
-    return pBestMasternode;
+    // the lowest heights are the least likely to be asked for again
+    if (it == mapScores.end() && mapScores.size() >= MAX_MASTERNODE_SCORE_TABLES)
+        mapScores.erase(mapScores.begin());
+
+    std::unique_ptr<CMasternodeScores>& pscores = mapScores[nBlockHeight];
+    pscores.reset(new CMasternodeScores(hash, nListVersion, vMasternodes));
+    return pscores.get();
 }
 
 CMasternode* CMasternodeMan::GetCurrentMasterNode(int mod, int64_t nBlockHeight)
 {
-    int64_t score = 0;
-    CMasternode* winner = NULL;
-
     LOCK2(cs_main, cs);
 
-    // scan for winner
-    for (auto mn : vMasternodes) {
-        mn->Check();
-        if (!mn->IsEnabled()) continue;
+    const CMasternodeScores* pscores = GetScores(nBlockHeight);
+    if (!pscores) return NULL;
 
-        // calculate the score for each Masternode
-        uint256 n = mn->CalculateScore(mod, nBlockHeight);
-        int64_t n2 = n.GetCompact(false);
+    // scan for winner, the highest score of the enabled ones
+    for (const auto& entry : pscores->vEntries) {
+        if (entry.nScore <= 0) break;
 
-        // determine the winner
-        if (n2 > score) {
-            score = n2;
-            winner = mn;
-        }
+        entry.pmn->Check();
+        if (!entry.pmn->IsEnabled()) continue;
+
+        return entry.pmn;
     }
 
-    return winner;
+    return NULL;
 }
 
 int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight)
 {
-    std::vector<std::pair<int64_t, CTxIn>> vecMasternodeScores;
     int64_t nMasternode_Min_Age = MN_WINNER_MINIMUM_AGE;
     int64_t nMasternode_Age = 0;
     bool masternodeRankV2 = Params().GetConsensus().NetworkUpgradeActive(chainActive.Height(), Consensus::UPGRADE_MASTERNODE_RANK_V2);
@@ -688,39 +836,31 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight)
         INT_MAX :
         -1;
 
-    //make sure we know about this block
-    uint256 hash;
-    if (!GetBlockHash(hash, nBlockHeight)) return defaultValue;
-
     LOCK2(cs_main, cs);
 
-    // scan for winner
-    for (auto mn : vMasternodes) {
-        if (sporkManager.IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT) &&
-            sporkManager.IsSporkActive(SPORK_108_FORCE_MASTERNODE_MIN_AGE)) 
-        {
+    const CMasternodeScores* pscores = GetScores(nBlockHeight);
+    if (!pscores) return defaultValue;
+
+    const bool fMinAge = sporkManager.IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT) &&
+                         sporkManager.IsSporkActive(SPORK_108_FORCE_MASTERNODE_MIN_AGE);
+
+    int rank = 0;
+    for (const auto& entry : pscores->vEntries) {
+        CMasternode* mn = entry.pmn;
+
+        if (fMinAge) {
             nMasternode_Age = GetAdjustedTime() - mn->sigTime;
             if ((nMasternode_Age) < nMasternode_Min_Age) {
                 LogPrint(BCLog::MASTERNODE,"Skipping just activated Masternode. Age: %ld\n", nMasternode_Age);
                 continue;                                                   // Skip masternodes younger than (default) 1 hour
             }
         }
-        
+
         mn->Check();
         if (!mn->IsEnabled()) continue;
 
-        uint256 n = mn->CalculateScore(1, nBlockHeight);
-        int64_t n2 = n.GetCompact(false);
-
-        vecMasternodeScores.push_back(std::make_pair(n2, mn->vin));
-    }
-
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreTxIn());
-
-    int rank = 0;
-    for (PAIRTYPE(int64_t, CTxIn) & s : vecMasternodeScores) {
         rank++;
-        if (s.second.prevout == vin.prevout) {
+        if (mn->vin.prevout == vin.prevout) {
             return rank;
         }
     }
@@ -728,49 +868,51 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight)
     return defaultValue;
 }
 
-std::vector<std::pair<int, CMasternode>> CMasternodeMan::GetMasternodeRanks(int64_t nBlockHeight)
+std::vector<std::pair<int, CTxIn>> CMasternodeMan::GetMasternodeRanks(int64_t nBlockHeight)
 {
-    std::vector<std::pair<int64_t, CMasternode> > vecMasternodeScores;
-    std::vector<std::pair<int, CMasternode> > vecMasternodeRanks;
+    std::vector<std::pair<int, CTxIn> > vecMasternodeRanks;
 
-    //make sure we know about this block
-    uint256 hash;
-    if (!GetBlockHash(hash, nBlockHeight)) return vecMasternodeRanks;
+    LOCK2(cs_main, cs);
 
-    {
-        std::vector<CMasternode> vmn;
-        {
-            LOCK(cs);
+    const CMasternodeScores* pscores = GetScores(nBlockHeight);
+    if (!pscores) return vecMasternodeRanks;
 
-            for(auto mn : vMasternodes) { // the below code takes too long, copy and go
-                vmn.push_back(*mn);
-            }
+    // the ones not enabled first, as if of the highest score, then the enabled ones by score
+    int rank = 0;
+    for (const bool fEnabled : {false, true}) {
+        for (const auto& entry : pscores->vEntries) {
+            if (entry.pmn->IsEnabled() != fEnabled) continue;
+            rank++;
+            vecMasternodeRanks.push_back(std::make_pair(rank, entry.pmn->vin));
         }
+    }
 
-        // scan for winner
-        for (CMasternode& mn : vmn) {
-
-            if (!mn.IsEnabled()) {
-                vecMasternodeScores.push_back(std::make_pair(INT_MAX, mn));
-                continue;
-            }
+    return vecMasternodeRanks;
+}
 
-            uint256 n = mn.CalculateScore(1, nBlockHeight);
-            int64_t n2 = n.GetCompact(false);
+bool CMasternodeMan::GetHighestScore(int64_t nBlockHeight, CTxIn& vinRet)
+{
+    LOCK2(cs_main, cs);
 
-            vecMasternodeScores.push_back(std::make_pair(n2, mn));
+    // only asked for by getmasternodescores, whose range of heights would evict the tables of the payments
+    std::unique_ptr<CMasternodeScores> pscoresUncached;
+    const CMasternodeScores* pscores = GetScores(nBlockHeight, &pscoresUncached);
+    if (!pscores || pscores->vEntries.empty()) return false;
+
+    // the highest full score is among the ones of the highest compact score
+    uint256 nHigh;
+    const CMasternodeScores::CEntry* pbest = nullptr;
+    for (const auto& entry : pscores->vEntries) {
+        if (entry.nScore != pscores->vEntries.front().nScore) break;
+        if (entry.score > nHigh) {
+            nHigh = entry.score;
+            pbest = &entry;
         }
     }
+    if (!pbest) return false;
 
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
-
-    int rank = 0;
-    for (PAIRTYPE(int64_t, CMasternode) & s : vecMasternodeScores) {
-        rank++;
-        vecMasternodeRanks.push_back(std::make_pair(rank, s.second));
-    }
-
-    return vecMasternodeRanks;
+    vinRet = pbest->pmn->vin;
+    return true;
 }
 
 void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv)
@@ -936,18 +1078,9 @@ void CMasternodeMan::Remove(CTxIn vin)
     while (it != vMasternodes.end()) {
         if ((**it).vin == vin) {
             LogPrint(BCLog::MASTERNODE, "CMasternodeMan: Removing Masternode %s - %i now\n", (**it).vin.prevout.ToStringShort(), size() - 1);
-            {
-                LOCK(cs_script);
-                mapScriptMasternodes.erase(GetScriptForDestination((*it)->pubKeyCollateralAddress.GetID()));
-            }
-            {
-                LOCK(cs_txin);
-                mapTxInMasternodes.erase((*it)->vin);
-            }
-            {
-                LOCK(cs_pubkey);
-                mapPubKeyMasternodes.erase((*it)->pubKeyMasternode);
-            }
+            RemoveFromIndexes(*it);
+            RemoveFromPaymentQueue(*it);
+            nListVersion++;
             delete *it;
             vMasternodes.erase(it);
             break;
@@ -13,10 +13,14 @@
 #include "key.h"
 #include "main.h"
 #include "masternode.h"
+#include "masternode-queue.h"
+#include "masternode-scores.h"
 #include "net.h"
 #include "sync.h"
 #include "util.h"
 
+#include <boost/thread/shared_mutex.hpp>
+
 #define MASTERNODES_DUMP_SECONDS (15 * 60)
 #define MASTERNODES_DSEG_SECONDS (3 * 60 * 60)
 
@@ -58,9 +62,8 @@ class CMasternodeMan
 private:
     // critical section to protect the inner data structures
     mutable RecursiveMutex cs;
-    mutable RecursiveMutex cs_script;
-    mutable RecursiveMutex cs_txin;
-    mutable RecursiveMutex cs_pubkey;
+    // readers-writer lock of the lookup maps, taken last: the lookups share it
+    mutable boost::shared_mutex cs_index;
 
     // critical section to protect the inner data structures specifically on messaging
     mutable RecursiveMutex cs_process_message;
@@ -71,8 +74,10 @@ private:
     std::unordered_map<CScript, CMasternode*, CScriptCheapHasher> mapScriptMasternodes;
     // map MNs by CTxIn
     std::unordered_map<CTxIn, CMasternode*, CTxInCheapHasher> mapTxInMasternodes;
-    // map MNs by CTxIn
+    // map MNs by CPubKey
     std::unordered_map<CPubKey, CMasternode*, CPubKeyCheapHasher> mapPubKeyMasternodes;
+    // map MNs by CNetAddr, more than one with SPORK_111_ALLOW_DUPLICATE_MN_IPS
+    std::unordered_multimap<CNetAddr, CMasternode*, CNetAddrCheapHasher> mapAddrMasternodes;
     // who's asked for the Masternode list and the last time
     std::map<CNetAddr, int64_t> mAskedUsForMasternodeList;
     // who we asked for the Masternode list and the last time
@@ -80,6 +85,45 @@ private:
     // which Masternodes we've asked for
     std::map<COutPoint, int64_t> mWeAskedForMasternodeListEntry;
 
+    // the masternodes in payment order
+    CMasternodePaymentQueue paymentQueue;
+    // the ones whose place in paymentQueue is computed again at the next query
+    std::set<CMasternode*> setPaymentQueueDirty;
+    // whether all of them are
+    bool fPaymentQueueRebuild{true};
+    // the payment sporks paymentQueue was built with
+    int nPaymentQueueSporks{-1};
+    // the same for the heights past the one after the tip, which have no block to look the last
+    // paid times up from: only the list and SPORK_114 change their order, not the blocks
+    CMasternodePaymentQueue paymentQueueAhead;
+    std::set<CMasternode*> setPaymentQueueAheadDirty;
+    bool fPaymentQueueAheadRebuild{true};
+    int nPaymentQueueAheadSporks{-1};
+
+    // the score tables by height
+    std::map<int64_t, std::unique_ptr<CMasternodeScores> > mapScores;
+    // bumped as masternodes are added or removed, the score tables of another version are outdated
+    uint64_t nListVersion{0};
+
+    // add a masternode to the lookup maps, or remove it, cs_index held
+    void IndexMasternode(CMasternode* pmn);
+    bool UnindexMasternode(const CMasternode* pmn);
+    // add a masternode of the list to the lookup maps
+    void AddToIndexes(CMasternode* pmn);
+    // remove a masternode from the lookup maps before it leaves the list
+    void RemoveFromIndexes(const CMasternode* pmn);
+
+    // the score table of nBlockHeight, computed again if the list or the block changed. nullptr if the block is unknown.
+    // With pscoresUncached, a table not cached yet is computed into it, leaving mapScores as it is
+    const CMasternodeScores* GetScores(int64_t nBlockHeight, std::unique_ptr<CMasternodeScores>* pscoresUncached = nullptr);
+
+    // place the masternodes of setPaymentQueueDirty in paymentQueue, their last paid times looked up from pindexPrev, the tip
+    void RefreshPaymentQueue(CBlockIndex* pindexPrev);
+    // place the masternodes of setPaymentQueueAheadDirty in paymentQueueAhead
+    void RefreshPaymentQueueAhead();
+    // remove a masternode from the payment queues before it is deleted
+    void RemoveFromPaymentQueue(CMasternode* pmn);
+
     // find an entry in the masternode list that is next to be paid (internally)
     CMasternode* GetNextMasternodeInQueueForPayment(
         int nBlockHeight, bool fFilterSigTime, 
@@ -116,23 +160,13 @@ public:
                 if(mnScript) {
                     auto it = std::find(vMasternodes.begin(), vMasternodes.end(), mnScript);
                     if(it != vMasternodes.end()) vMasternodes.erase(it);
+                    RemoveFromIndexes(mnScript);
 
                     break;
                 }
 
                 vMasternodes.push_back(mn);
-                {
-                    LOCK(cs_script);
-                    mapScriptMasternodes[GetScriptForDestination(mn->pubKeyCollateralAddress.GetID())] = mn;
-                }
-                {
-                    LOCK(cs_txin);
-                    mapTxInMasternodes[mn->vin] = mn;
-                }
-                {
-                    LOCK(cs_pubkey);
-                    mapPubKeyMasternodes[mn->pubKeyMasternode] = mn;
-                }
+                AddToIndexes(mn);
             }
         } else {
             for(auto mn : vMasternodes) {
@@ -146,6 +180,12 @@ public:
 
         READWRITE(mapSeenMasternodeBroadcast);
         READWRITE(mapSeenMasternodePing);
+
+        if (ser_action.ForRead()) {
+            fPaymentQueueRebuild = true;
+            fPaymentQueueAheadRebuild = true;
+            nListVersion++;
+        }
     }
 
     CMasternodeMan();
@@ -217,8 +257,10 @@ public:
         return result;
     }
 
-    std::vector<std::pair<int, CMasternode> > GetMasternodeRanks(int64_t nBlockHeight);
+    std::vector<std::pair<int, CTxIn> > GetMasternodeRanks(int64_t nBlockHeight);
     int GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight);
+    /// The masternode of highest score for nBlockHeight, enabled or not
+    bool GetHighestScore(int64_t nBlockHeight, CTxIn& vinRet);
 
     void ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
 
@@ -234,6 +276,15 @@ public:
 
     /// Update masternode list and maps using provided CMasternodeBroadcast
     void UpdateMasternodeList(CMasternodeBroadcast mnb);
+
+    /// Set the keys a masternode is looked up by, moving it in the lookup maps if it is in the list
+    void UpdateKeys(CMasternode* pmn, const CPubKey& pubKeyMasternode, const CPubKey& pubKeyCollateralAddress, const CService& addr);
+
+    /// Set the last paid time of the masternode paid to payee, INT64_MAX to have it looked up again
+    void UpdateLastPaid(const CScript& payee, int64_t nLastPaid);
+
+    /// Place the masternode in the payment queue again at the next query
+    void UpdatePaymentQueue(CMasternode* pmn);
 };
 
 void ThreadCheckMasternodes();
@@ -419,7 +419,7 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet,
     return pblocktemplate.release();
 }
 
-void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
+void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int& nExtraNonce, CBlockMerkleTree* pMerkleTree)
 {
     // Update nExtraNonce
     static uint256 hashPrevBlock;
@@ -434,7 +434,41 @@ void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int&
     assert(txCoinbase.vin[0].scriptSig.size() <= 100);
 
     pblock->vtx[0] = txCoinbase;
-    pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+    if (pMerkleTree && pMerkleTree->GetLeafCount() == pblock->vtx.size()) {
+        pMerkleTree->UpdateLeaf(0, pblock->vtx[0].GetHash());
+    } else if (pMerkleTree) {
+        pMerkleTree->Build(BlockMerkleLeaves(*pblock));
+    }
+    pblock->hashMerkleRoot = pMerkleTree ? pMerkleTree->GetRoot() : BlockMerkleRoot(*pblock);
+}
+
+CNonceRanges::CNonceRanges(int nThreads, uint64_t nEnd)
+{
+    // [0, nEnd) split in nThreads ranges of (almost) equal size
+    for (int i = 0; i < nThreads; i++) {
+        vRanges.emplace_back(nEnd * i / nThreads, nEnd * (i + 1) / nThreads);
+    }
+}
+
+bool CNonceRanges::Claim(int nThread, uint32_t& nBeginRet, uint32_t& nCountRet)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    std::pair<uint64_t, uint64_t>& own = vRanges[nThread];
+    if (own.first == own.second) {
+        // Steal the upper half of the largest remaining range
+        std::pair<uint64_t, uint64_t>* victim = &vRanges[0];
+        for (std::pair<uint64_t, uint64_t>& range : vRanges) {
+            if (range.second - range.first > victim->second - victim->first) victim = &range;
+        }
+        if (victim->first == victim->second) return false;
+        const uint64_t nMiddle = victim->first + (victim->second - victim->first) / 2;
+        own = std::make_pair(nMiddle, victim->second);
+        victim->second = nMiddle;
+    }
+    nBeginRet = (uint32_t)own.first;
+    nCountRet = (uint32_t)std::min<uint64_t>(own.second - own.first, MINER_NONCE_CHUNK);
+    own.first += nCountRet;
+    return true;
 }
 
 #ifdef ENABLE_WALLET
@@ -513,6 +547,59 @@ void SleepUntilNexSlot()
     MilliSleep((GetNextTimeSlot() - GetAdjustedTime()) * 1000);
 }
 
+/**
+ * Wakes the staking thread up on validation and wallet events. Between two
+ * attempts the staker waits on it for the next time slot, and a new tip or a
+ * wallet transaction ends the wait, so the kernel search starts as soon as a
+ * block is connected instead of at the next poll.
+ */
+class CStakerWakeup : public CValidationInterface
+{
+private:
+    boost::mutex cs;
+    boost::condition_variable cond;
+    uint64_t nEvents{0};
+    boost::signals2::scoped_connection connWalletTx;
+
+    void Notify()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            nEvents++;
+        }
+        cond.notify_all();
+    }
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindex) override { Notify(); }
+
+public:
+    explicit CStakerWakeup(CWallet* pwallet)
+    {
+        RegisterValidationInterface(this);
+        connWalletTx = pwallet->NotifyTransactionChanged.connect(boost::bind(&CStakerWakeup::Notify, this));
+    }
+    ~CStakerWakeup() { UnregisterValidationInterface(this); }
+
+    //! Number of events so far
+    uint64_t GetEvents()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        return nEvents;
+    }
+
+    //! Sleep until the adjusted time nTime, or until there are more than nEventsSeen events (interruptible)
+    void WaitUntil(int64_t nTime, uint64_t nEventsSeen)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        while (nEvents == nEventsSeen) {
+            const int64_t nWait = nTime - GetAdjustedTime();
+            if (nWait <= 0) break;
+            cond.wait_for(lock, boost::chrono::seconds(nWait));
+        }
+    }
+};
+
 uint64_t GetNetworkHashPS()
 {
     CBlockIndex *pb = chainActive.Tip();
@@ -544,48 +631,278 @@ uint64_t GetNetworkHashPS()
     return (int64_t)(workDiff.getdouble() / timeDiff);
 }
 
-void BitcoinMiner(CWallet* pwallet, bool fProofOfStake)
+/** Seconds after which the header time of a mining job is refreshed */
+static const int64_t MINER_TIME_REFRESH = 10;
+
+/**
+ * PoW miner run by the GenerateBitcoins threads. The threads share one block
+ * template, split its nonce space through CNonceRanges, and hash it through a
+ * CBlockHeaderScanner. The template is rebuilt when the tip or the mempool
+ * changes, and otherwise rolled (new extranonce and time, same transactions)
+ * when its nonce space is exhausted or its time gets old.
+ */
+class CPowMiner
+{
+public:
+    CPowMiner(CWallet* pwalletIn, int nThreadsIn);
+
+    /** Body of mining thread nThread, in [0, nThreads) */
+    void Run(int nThread);
+
+private:
+    struct Job {
+        std::unique_ptr<CBlockTemplate> pblocktemplate;
+        CBlockMerkleTree merkleTree;
+        CBlockIndex* pindexPrev;
+        unsigned int nTransactionsUpdatedLast;
+        int64_t nStart;                 // when the transactions were selected
+        int64_t nTime;                  // when the header was last updated
+        uint256 hashTarget;
+        std::unique_ptr<CBlockHeaderScanner> scanner;
+        CNonceRanges ranges;
+        std::atomic<bool> fDone;        // solved, stale or out of nonces
+        std::atomic<bool> fSolved;
+
+        explicit Job(int nThreads) : ranges(nThreads), fDone(false), fSolved(false) {}
+    };
+
+    std::mutex cs;
+    CWallet* const pwallet;
+    const int nThreads;
+    Optional<CReserveKey> reservekey;
+    unsigned int nExtraNonce;
+    std::shared_ptr<Job> job;
+
+    /** Current job for the given tip, building or rolling one if needed */
+    std::shared_ptr<Job> GetJob(CBlockIndex* pindexPrev);
+    /** Process the block of pjob with the given nonce, once per job */
+    bool SubmitSolution(const std::shared_ptr<Job>& pjob, uint32_t nNonce);
+};
+
+static RecursiveMutex cs_hashmeter;
+static std::vector<double> vThreadHashesPerSec;
+
+static void ResetHashMeter(int nThreads)
+{
+    LOCK(cs_hashmeter);
+    vThreadHashesPerSec.assign(nThreads, 0.0);
+    dHashesPerSec = 0.0;
+    nHPSTimerStart = 0;
+}
+
+/** Record the hash rate measured by one mining thread, and update the total */
+static void UpdateHashMeter(int nThread, double dThreadHashesPerSec)
+{
+    LOCK(cs_hashmeter);
+    if (nThread >= (int)vThreadHashesPerSec.size()) vThreadHashesPerSec.resize(nThread + 1, 0.0);
+    vThreadHashesPerSec[nThread] = dThreadHashesPerSec;
+    dHashesPerSec = 0.0;
+    for (double d : vThreadHashesPerSec) dHashesPerSec += d;
+    nHPSTimerStart = GetTimeMillis();
+
+    static int64_t nLogTime;
+    if (GetTime() - nLogTime > 30 * 60) {
+        nLogTime = GetTime();
+        LogPrintf("hashmeter %6.0f khash/s\n", dHashesPerSec / 1000.0);
+    }
+}
+
+std::vector<double> GetThreadHashesPerSec()
+{
+    LOCK(cs_hashmeter);
+    return vThreadHashesPerSec;
+}
+
+CPowMiner::CPowMiner(CWallet* pwalletIn, int nThreadsIn) :
+    pwallet(pwalletIn),
+    nThreads(std::max(nThreadsIn, 1)),
+    reservekey(CReserveKey(pwalletIn)),
+    nExtraNonce(0)
+{
+}
+
+std::shared_ptr<CPowMiner::Job> CPowMiner::GetJob(CBlockIndex* pindexPrev)
+{
+    std::lock_guard<std::mutex> lock(cs);
+
+    const bool fSameTemplate = job && !job->fSolved && job->pindexPrev == pindexPrev &&
+                               !(mempool.GetTransactionsUpdated() != job->nTransactionsUpdatedLast && GetTime() - job->nStart > 60);
+    if (fSameTemplate && !job->fDone) return job;
+
+    std::shared_ptr<Job> next = std::make_shared<Job>(nThreads);
+    next->pindexPrev = pindexPrev;
+    if (fSameTemplate) {
+        // Nonce space exhausted or header time outdated: keep the
+        // transactions, roll the extranonce and refresh the time
+        next->pblocktemplate.reset(new CBlockTemplate(*job->pblocktemplate));
+        next->merkleTree = job->merkleTree;
+        next->nTransactionsUpdatedLast = job->nTransactionsUpdatedLast;
+        next->nStart = job->nStart;
+        UpdateTime(&next->pblocktemplate->block, pindexPrev);
+    } else {
+        next->nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
+        next->nStart = GetTime();
+        next->pblocktemplate.reset(CreateNewBlockWithKey(*reservekey, pwallet));
+        if (!next->pblocktemplate) return nullptr;
+        LogPrintf("Running Miner with %u transactions in block (%u bytes)\n", next->pblocktemplate->block.vtx.size(),
+            ::GetSerializeSize(next->pblocktemplate->block, SER_NETWORK, PROTOCOL_VERSION));
+    }
+    CBlock* pblock = &next->pblocktemplate->block;
+    IncrementExtraNonce(pblock, pindexPrev, nExtraNonce, &next->merkleTree);
+    pblock->nNonce = 0;
+    next->nTime = GetTime();
+    next->hashTarget = uint256().SetCompact(pblock->nBits);
+    next->scanner.reset(new CBlockHeaderScanner(*pblock));
+
+    job = next;
+    return job;
+}
+
+bool CPowMiner::SubmitSolution(const std::shared_ptr<Job>& pjob, uint32_t nNonce)
+{
+    // Only the first thread to solve a template submits it
+    if (pjob->fSolved.exchange(true)) return false;
+    pjob->fDone = true;
+
+    CBlock block(pjob->pblocktemplate->block);
+    block.nNonce = nNonce;
+
+    SetThreadPriority(THREAD_PRIORITY_NORMAL);
+    LogPrintf("%s:\n", __func__);
+    LogPrintf("proof-of-work found  \n  hash: %s  \ntarget: %s\n", block.GetHash().GetHex(), pjob->hashTarget.GetHex());
+    bool fAccepted;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fAccepted = ProcessBlockFound(&block, *pwallet, reservekey);
+    }
+    SetThreadPriority(THREAD_PRIORITY_LOWEST);
+    return fAccepted;
+}
+
+void CPowMiner::Run(int nThread)
 {
     LogPrintf("Miner started\n");
     SetThreadPriority(THREAD_PRIORITY_LOWEST);
     util::ThreadRename("pivx-miner");
     const Consensus::Params& consensus = Params().GetConsensus();
 
-    // Each thread has its own key and counter
-    Optional<CReserveKey> opReservekey{nullopt};
+    int64_t nMeterStart = GetTimeMillis();
+    uint64_t nMeterHashes = 0;
+
+    while (fGenerateBitcoins) {
+        boost::this_thread::interruption_point();
+
+        CBlockIndex* pindexPrev = GetChainTip();
+        if (!pindexPrev) {
+            SleepUntilNexSlot();               // sleep a time slot and try again
+            continue;
+        }
+        if (pindexPrev->nHeight > 6 && consensus.NetworkUpgradeActive(pindexPrev->nHeight - 6, Consensus::UPGRADE_POS)) {
+            // Late PoW: run for a little while longer, just in case there is a rewind on the chain.
+            LogPrintf("%s: Exiting PoW Mining Thread at height: %d\n", __func__, pindexPrev->nHeight);
+            return;
+        }
+        if (g_connman && g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL) == 0 && Params().MiningRequiresPeers()) {
+            MilliSleep(1000);                  // Regtest mode doesn't require peers
+            continue;
+        }
+
+        std::shared_ptr<Job> pjob = GetJob(pindexPrev);
+        if (!pjob) continue;
+
+        //
+        // Search, a chunk of nonces at a time
+        //
+        uint32_t nBegin, nCount;
+        while (!pjob->fDone) {
+            if (!pjob->ranges.Claim(nThread, nBegin, nCount)) {
+                pjob->fDone = true;            // nonce space exhausted
+                break;
+            }
+            for (uint32_t i = 0; i < nCount; i++) {
+                if (pjob->scanner->GetHash(nBegin + i) <= pjob->hashTarget) {
+                    SubmitSolution(pjob, nBegin + i);
+
+                    // In regression test mode, stop mining after a block is found. This
+                    // allows developers to controllably generate a block on demand.
+                    if (Params().IsRegTestNet())
+                        throw boost::thread_interrupted();
+                    break;
+                }
+                if (pjob->fDone) break;
+            }
+            nMeterHashes += nCount;
+
+            // Meter hashes/sec
+            const int64_t nNow = GetTimeMillis();
+            if (nNow - nMeterStart > 4000) {
+                UpdateHashMeter(nThread, 1000.0 * nMeterHashes / (nNow - nMeterStart));
+                nMeterStart = nNow;
+                nMeterHashes = 0;
+            }
+
+            // Check for stop or if the template needs to be rebuilt
+            boost::this_thread::interruption_point();
+            if (!fGenerateBitcoins || pindexPrev != chainActive.Tip() ||
+                (mempool.GetTransactionsUpdated() != pjob->nTransactionsUpdatedLast && GetTime() - pjob->nStart > 60) ||
+                GetTime() - pjob->nTime > MINER_TIME_REFRESH) {
+                pjob->fDone = true;
+            }
+        }
+    }
+}
+
+void BitcoinMiner(CWallet* pwallet, bool fProofOfStake)
+{
     if (!fProofOfStake) {
-        opReservekey = CReserveKey(pwallet);
+        CPowMiner(pwallet, 1).Run(0);
+        return;
     }
 
-    // Available UTXO set
+    LogPrintf("Miner started\n");
+    SetThreadPriority(THREAD_PRIORITY_LOWEST);
+    util::ThreadRename("pivx-miner");
+    const Consensus::Params& consensus = Params().GetConsensus();
+
+    // Coinstakes pay to the staked output, no key is reserved
+    Optional<CReserveKey> opReservekey{nullopt};
+
+    // Available UTXO set, reloaded only after a tip or wallet event
     std::vector<COutput> availableCoins;
-    unsigned int nExtraNonce = 0;
+    bool fCoinsLoaded = false;
+    uint64_t nCoinsEvents = 0;
+
+    // New tips and wallet transactions cut the waits short
+    CStakerWakeup wakeup(pwallet);
 
     while (fGenerateBitcoins || fProofOfStake) {
 
+        // Events seen before this pass, a wait returns at once if a newer one came in meanwhile
+        const uint64_t nEvents = wakeup.GetEvents();
+
         fMasternodeSync = sporkManager.IsSporkActive(SPORK_106_STAKING_SKIP_MN_SYNC) || !masternodeSync.NotCompleted();
 
         CBlockIndex* pindexPrev = GetChainTip();
         if (!pindexPrev) {
-            SleepUntilNexSlot();               // sleep a time slot and try again
+            wakeup.WaitUntil(GetNextTimeSlot(), nEvents);   // wait a time slot and try again
             continue;
         }
         if (fProofOfStake) {
 
             if (!fStakingActive) {             // if not active then
-                SleepUntilNexSlot();           // sleep a time slot and try again
+                wakeup.WaitUntil(GetNextTimeSlot(), nEvents);  // wait a time slot and try again
                 fStakingStatus = false;
                 continue;
             }
 
             if (!fMasternodeSync) {            // if not in sync with masternode second layer then 
-                SleepUntilNexSlot();           // sleep a time slot and try again
+                wakeup.WaitUntil(GetNextTimeSlot(), nEvents);  // wait a time slot and try again
                 fStakingStatus = false;
                 continue;
             }
 
             if (pwallet->IsLocked()) {         // if the wallet is locked then
-                SleepUntilNexSlot();           // sleep a time slot and try again
+                wakeup.WaitUntil(GetNextTimeSlot(), nEvents);  // wait a time slot and try again
                 fStakingStatus = false;
                 continue;
             }
@@ -593,7 +910,7 @@ void BitcoinMiner(CWallet* pwallet, bool fProofOfStake)
             if (g_connman && 
                 g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL) == 0 && 
                 Params().MiningRequiresPeers()) {      // if there is no connections to other peers then
-                SleepUntilNexSlot();                   // sleep a time slot and try again
+                wakeup.WaitUntil(GetNextTimeSlot(), nEvents);  // wait a time slot and try again
                 fStakingStatus = false;
                 continue;
             }
@@ -602,46 +919,34 @@ void BitcoinMiner(CWallet* pwallet, bool fProofOfStake)
             if (pwallet->pStakerStatus &&
                 pwallet->pStakerStatus->GetLastHash() == pindexPrev->GetBlockHash() &&
                 pwallet->pStakerStatus->GetLastTime() >= GetCurrentTimeSlot()) {
-
-                for(int i = 0; i < (GetNextTimeSlot() - GetAdjustedTime()); i++) {
-                    if(pwallet->pStakerStatus->GetLastHash() == pindexPrev->GetBlockHash() &&
-                       pwallet->pStakerStatus->GetLastTime() >= GetCurrentTimeSlot()) {
-                        MilliSleep(1000);
-                    } else {
-                        break;
-                    }
-                }
+                // until the next time slot opens, unless a new block arrives first
+                wakeup.WaitUntil(GetNextTimeSlot(), nEvents);
                 continue;
             }
 
             if (!consensus.NetworkUpgradeActive(pindexPrev->nHeight + 1, Consensus::UPGRADE_POS)) {
                 // The last PoW block hasn't even been mined yet.
-                SleepUntilNexSlot();                   // sleep a time slot and try again
+                wakeup.WaitUntil(GetNextTimeSlot(), nEvents);  // wait a time slot and try again
                 continue;
             }
 
-            // update fStakeableCoins
-            CheckForCoins(pwallet, &availableCoins);
+            // update fStakeableCoins, the stakeable set only changes with the tip or the wallet
+            if (!fCoinsLoaded || nCoinsEvents != nEvents) {
+                CheckForCoins(pwallet, &availableCoins);
+                fCoinsLoaded = true;
+                nCoinsEvents = nEvents;
+            }
             if (!fStakeableCoins) {                    // if there is no coins to stake then
-                SleepUntilNexSlot();                   // sleep a time slot and try again
+                wakeup.WaitUntil(GetNextTimeSlot(), nEvents);  // wait a time slot and try again
                 fStakingStatus = false;
                 continue;
             }
-
-        } else if (pindexPrev->nHeight > 6 && consensus.NetworkUpgradeActive(pindexPrev->nHeight - 6, Consensus::UPGRADE_POS)) {
-            // Late PoW: run for a little while longer, just in case there is a rewind on the chain.
-            LogPrintf("%s: Exiting PoW Mining Thread at height: %d\n", __func__, pindexPrev->nHeight);
-            return;
         }
 
         //
         // Create new block
         //
-        unsigned int nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
-
-        std::unique_ptr<CBlockTemplate> pblocktemplate((fProofOfStake ?
-                                                            CreateNewBlock(CScript(), pwallet, true, &availableCoins) :
-                                                            CreateNewBlockWithKey(*opReservekey, pwallet)));
+        std::unique_ptr<CBlockTemplate> pblocktemplate(CreateNewBlock(CScript(), pwallet, true, &availableCoins));
 
         fStakingStatus = true;
         
@@ -649,102 +954,21 @@ void BitcoinMiner(CWallet* pwallet, bool fProofOfStake)
         CBlock* pblock = &pblocktemplate->block;
 
         // POS - block found: process it
-        if (fProofOfStake) {
-            LogPrintf("%s : proof-of-stake block was signed %s \n", __func__, pblock->GetHash().ToString().c_str());
-            SetThreadPriority(THREAD_PRIORITY_NORMAL);
-            if (!ProcessBlockFound(pblock, *pwallet, opReservekey)) {
-                LogPrintf("%s: New block orphaned\n", __func__);
-                continue;
-            }
-            SetThreadPriority(THREAD_PRIORITY_LOWEST);
+        LogPrintf("%s : proof-of-stake block was signed %s \n", __func__, pblock->GetHash().ToString().c_str());
+        SetThreadPriority(THREAD_PRIORITY_NORMAL);
+        if (!ProcessBlockFound(pblock, *pwallet, opReservekey)) {
+            LogPrintf("%s: New block orphaned\n", __func__);
             continue;
         }
-
-        // POW - miner main
-        IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
-
-        LogPrintf("Running Miner with %u transactions in block (%u bytes)\n", pblock->vtx.size(),
-            ::GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION));
-
-        //
-        // Search
-        //
-        int64_t nStart = GetTime();
-        uint256 hashTarget = uint256().SetCompact(pblock->nBits);
-        while (true) {
-            unsigned int nHashesDone = 0;
-
-            uint256 hash;
-            while (true) {
-                hash = pblock->GetHash();
-                if (hash <= hashTarget) {
-                    // Found a solution
-                    SetThreadPriority(THREAD_PRIORITY_NORMAL);
-                    LogPrintf("%s:\n", __func__);
-                    LogPrintf("proof-of-work found  \n  hash: %s  \ntarget: %s\n", hash.GetHex(), hashTarget.GetHex());
-                    ProcessBlockFound(pblock, *pwallet, opReservekey);
-                    SetThreadPriority(THREAD_PRIORITY_LOWEST);
-
-                    // In regression test mode, stop mining after a block is found. This
-                    // allows developers to controllably generate a block on demand.
-                    if (Params().IsRegTestNet())
-                        throw boost::thread_interrupted();
-
-                    break;
-                }
-                pblock->nNonce += 1;
-                nHashesDone += 1;
-                if ((pblock->nNonce & 0xFF) == 0)
-                    break;
-            }
-
-            // Meter hashes/sec
-            static int64_t nHashCounter;
-            if (nHPSTimerStart == 0) {
-                nHPSTimerStart = GetTimeMillis();
-                nHashCounter = 0;
-            } else
-                nHashCounter += nHashesDone;
-            if (GetTimeMillis() - nHPSTimerStart > 4000) {
-                static RecursiveMutex cs;
-                {
-                    LOCK(cs);
-                    if (GetTimeMillis() - nHPSTimerStart > 4000) {
-                        dHashesPerSec = 1000.0 * nHashCounter / (GetTimeMillis() - nHPSTimerStart);
-                        nHPSTimerStart = GetTimeMillis();
-                        nHashCounter = 0;
-                        static int64_t nLogTime;
-                        if (GetTime() - nLogTime > 30 * 60) {
-                            nLogTime = GetTime();
-                            LogPrintf("hashmeter %6.0f khash/s\n", dHashesPerSec / 1000.0);
-                        }
-                    }
-                }
-            }
-
-            // Check for stop or if block needs to be rebuilt
-            boost::this_thread::interruption_point();
-            if ((g_connman && g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL) == 0 && Params().MiningRequiresPeers()) || // Regtest mode doesn't require peers
-                (pblock->nNonce >= 0xffff0000) ||
-                (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 60) ||
-                (pindexPrev != chainActive.Tip())) break;
-
-            // Update nTime every few seconds
-            UpdateTime(pblock, pindexPrev);
-            if (Params().GetConsensus().fPowAllowMinDifficultyBlocks) {
-                // Changing pblock->nTime can change work required on testnet:
-                hashTarget.SetCompact(pblock->nBits);
-            }
-        }
+        SetThreadPriority(THREAD_PRIORITY_LOWEST);
     }
 }
 
-void static ThreadBitcoinMiner(void* parg)
+void static ThreadBitcoinMiner(std::shared_ptr<CPowMiner> miner, int nThread)
 {
     boost::this_thread::interruption_point();
-    CWallet* pwallet = (CWallet*)parg;
     try {
-        BitcoinMiner(pwallet, false);
+        miner->Run(nThread);
         boost::this_thread::interruption_point();
     } catch (const std::exception& e) {
         LogPrintf("Miner exception");
@@ -766,12 +990,16 @@ void GenerateBitcoins(bool fGenerate, CWallet* pwallet, int nThreads)
         minerThreads = NULL;
     }
 
+    ResetHashMeter(fGenerate ? std::max(nThreads, 0) : 0);
+
     if (nThreads == 0 || !fGenerate)
         return;
 
+    // The threads share the block template and split its nonce space
+    std::shared_ptr<CPowMiner> miner = std::make_shared<CPowMiner>(pwallet, nThreads);
     minerThreads = new boost::thread_group();
     for (int i = 0; i < nThreads; i++)
-        minerThreads->create_thread(boost::bind(&ThreadBitcoinMiner, pwallet));
+        minerThreads->create_thread(boost::bind(&ThreadBitcoinMiner, miner, i));
 }
 
 // ppcoin: stake minter thread
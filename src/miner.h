@@ -10,27 +10,54 @@
 
 #include "primitives/block.h"
 
+#include <mutex>
 #include <stdint.h>
+#include <vector>
 
 class CBlock;
 class CBlockHeader;
 class CBlockIndex;
+class CBlockMerkleTree;
 class COutput;
 class CReserveKey;
 class CScript;
 class CWallet;
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Nonces are claimed by the mining threads MINER_NONCE_CHUNK at a time */
+static const uint32_t MINER_NONCE_CHUNK = 256;
 
 struct CBlockTemplate;
 
 /** Generate a new block, without valid proof-of-work */
 CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet, bool fProofOfStake, std::vector<COutput>* availableCoins = nullptr);
-/** Modify the extranonce in a block */
-void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
+/**
+ * Modify the extranonce in a block. When pMerkleTree holds the tree of the
+ * block's transactions, only the coinbase path is rehashed.
+ */
+void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int& nExtraNonce, CBlockMerkleTree* pMerkleTree = nullptr);
 /** Check mined block */
 void UpdateTime(CBlockHeader* block, const CBlockIndex* pindexPrev);
 
+/**
+ * Nonce space of a block template, split in one range per mining thread. A
+ * thread claims nonces from its own range a chunk at a time and, once it is
+ * exhausted, steals the upper half of the largest range left.
+ */
+class CNonceRanges
+{
+public:
+    explicit CNonceRanges(int nThreads, uint64_t nEnd = uint64_t(1) << 32);
+
+    /** Claim the next nonces of thread nThread, false once the whole space has been claimed */
+    bool Claim(int nThread, uint32_t& nBeginRet, uint32_t& nCountRet);
+
+private:
+    std::mutex cs;
+    //! [begin, end) of the nonces left to each thread
+    std::vector<std::pair<uint64_t, uint64_t> > vRanges;
+};
+
 #ifdef ENABLE_WALLET
     /** Run the miner threads */
     void GenerateBitcoins(bool fGenerate, CWallet* pwallet, int nThreads);
@@ -44,6 +71,11 @@ void UpdateTime(CBlockHeader* block, const CBlockIndex* pindexPrev);
 extern double dHashesPerSec;
 extern int64_t nHPSTimerStart;
 
+#ifdef ENABLE_WALLET
+    /** Recent hashes per second of each PoW mining thread */
+    std::vector<double> GetThreadHashesPerSec();
+#endif // ENABLE_WALLET
+
 struct CBlockTemplate {
     CBlock block;
     std::vector<CAmount> vTxFees;
@@ -93,6 +93,16 @@ public:
     friend class CSubNet;
 };
 
+struct CNetAddrCheapHasher {
+    int operator()(const CNetAddr& addr) const {
+        int hash = 16;
+        for (int i = 0; i < 16; i++) {
+            hash ^= addr.GetByte(i) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        }
+        return hash;
+    }
+};
+
 class CSubNet
 {
 protected:
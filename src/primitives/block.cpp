@@ -7,33 +7,110 @@
 
 #include "primitives/block.h"
 
+#include "crypto/common.h"
 #include "hash.h"
+#include "hashx11kvs.h"
 #include "script/standard.h"
 #include "script/sign.h"
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 #include "util.h"
 
+CHeaderHashCache& CHeaderHashCache::operator=(const CHeaderHashCache& other)
+{
+    if (this == &other) return *this;
+    std::unique_lock<std::mutex> lock(cs, std::defer_lock);
+    std::unique_lock<std::mutex> lockOther(other.cs, std::defer_lock);
+    std::lock(lock, lockOther);
+    fValid = other.fValid;
+    memcpy(vchHeader, other.vchHeader, HEADER_SIZE);
+    hash = other.hash;
+    return *this;
+}
+
+bool CHeaderHashCache::Get(const unsigned char* header, uint256& hashRet) const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    if (!fValid || memcmp(vchHeader, header, HEADER_SIZE) != 0)
+        return false;
+    hashRet = hash;
+    return true;
+}
+
+void CHeaderHashCache::Set(const unsigned char* header, const uint256& hashIn)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    memcpy(vchHeader, header, HEADER_SIZE);
+    hash = hashIn;
+    fValid = true;
+}
+
+// The first 80 bytes are the little endian header hashed by X11KVS
+void CBlockHeader::GetHeaderFields(unsigned char* header) const
+{
+    WriteLE32(&header[0], nVersion);
+    memcpy(&header[4], hashPrevBlock.begin(), hashPrevBlock.size());
+    memcpy(&header[36], hashMerkleRoot.begin(), hashMerkleRoot.size());
+    WriteLE32(&header[68], nTime);
+    WriteLE32(&header[72], nBits);
+    WriteLE32(&header[76], nNonce);
+    memcpy(&header[80], nAccumulatorCheckpoint.begin(), nAccumulatorCheckpoint.size());
+}
+
 // TODO: Change X11KVS algorithm call to whatever the coin being adapted is used.
 uint256 CBlockHeader::GetHash() const
 {
-     if (nVersion < 4)  { // nVersion = 1, 2, 3
-#if defined(WORDS_BIGENDIAN)
-        uint8_t data[80];
-        WriteLE32(&data[0], nVersion);
-        memcpy(&data[4], hashPrevBlock.begin(), hashPrevBlock.size());
-        memcpy(&data[36], hashMerkleRoot.begin(), hashMerkleRoot.size());
-        WriteLE32(&data[68], nTime);
-        WriteLE32(&data[72], nBits);
-        WriteLE32(&data[76], nNonce);
-
-        return HashX11KVS(data, data + 80);
-#else // Can take shortcut for little endian
-        return HashX11KVS(BEGIN(nVersion), END(nNonce));
-#endif
+    unsigned char header[CHeaderHashCache::HEADER_SIZE];
+    GetHeaderFields(header);
+
+    uint256 hash;
+    if (cachedHash.Get(header, hash))
+        return hash;
+
+    if (nVersion < 4)  { // nVersion = 1, 2, 3
+        hash = HashX11KVSCached(header, GetX11KVSCache());
+    } else {
+        hash = SerializeHash(*this); // nVersion >= 4
+    }
+
+    cachedHash.Set(header, hash);
+    return hash;
+}
+
+void CBlockHeader::SetCachedHash(const uint256& hash) const
+{
+    unsigned char header[CHeaderHashCache::HEADER_SIZE];
+    GetHeaderFields(header);
+    cachedHash.Set(header, hash);
+}
+
+CBlockHeaderScanner::CBlockHeaderScanner(const CBlockHeader& header)
+{
+    header.GetHeaderFields(vchHeader);
+    fX11KVS = header.nVersion < 4;
+    // Serialized size, nAccumulatorCheckpoint is only there for versions 4 to 6
+    nSize = (header.nVersion > 3 && header.nVersion < 7) ? CHeaderHashCache::HEADER_SIZE : 80;
+    if (fX11KVS) {
+        prefix = GetX11KVSPrefixId(vchHeader);
+    } else {
+        midstate.Write(vchHeader, 64);
     }
-	
-    return SerializeHash(*this); // nVersion >= 4
+}
+
+uint256 CBlockHeaderScanner::GetHash(uint32_t nNonce) const
+{
+    unsigned char header[CHeaderHashCache::HEADER_SIZE];
+    memcpy(header, vchHeader, nSize);
+    WriteLE32(&header[76], nNonce);
+
+    if (fX11KVS) {
+        return HashX11KVSCached(header, prefix, GetX11KVSCache());
+    }
+
+    uint256 hash;
+    CSHA256(midstate).Write(header + 64, nSize - 64).Finalize(hash.begin());
+    CSHA256().Write(hash.begin(), 32).Finalize(hash.begin());
+    return hash;
 }
 
 CScript CBlock::GetPaidPayee(CAmount nAmount) const
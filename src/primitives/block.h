@@ -8,11 +8,56 @@
 #ifndef BITCOIN_PRIMITIVES_BLOCK_H
 #define BITCOIN_PRIMITIVES_BLOCK_H
 
+#include "crypto/sha256.h"
 #include "primitives/transaction.h"
 #include "keystore.h"
 #include "serialize.h"
 #include "uint256.h"
 
+#include <atomic>
+#include <mutex>
+
+/**
+ * (memory only) Flag of a block checked once, which may be shared between
+ * threads through the block cache: copied like a bool, set and read atomically.
+ */
+class CCheckedFlag
+{
+public:
+    CCheckedFlag() {}
+    CCheckedFlag(const CCheckedFlag& other) : fSet(other.fSet.load()) {}
+    CCheckedFlag& operator=(const CCheckedFlag& other) { fSet = other.fSet.load(); return *this; }
+    CCheckedFlag& operator=(bool fSetIn) { fSet = fSetIn; return *this; }
+    operator bool() const { return fSet; }
+
+private:
+    std::atomic<bool> fSet{false};
+};
+
+/** (memory only) Hash of a block header, along with the header fields it was
+ * computed from. The header fields are public and get modified in place (e.g.
+ * by the miner), so the cached value is only returned while they still match.
+ */
+class CHeaderHashCache
+{
+public:
+    //! nVersion, hashPrevBlock, hashMerkleRoot, nTime, nBits, nNonce and nAccumulatorCheckpoint
+    static const size_t HEADER_SIZE = 112;
+
+    CHeaderHashCache() {}
+    CHeaderHashCache(const CHeaderHashCache& other) { *this = other; }
+    CHeaderHashCache& operator=(const CHeaderHashCache& other);
+
+    bool Get(const unsigned char* header, uint256& hashRet) const;
+    void Set(const unsigned char* header, const uint256& hashIn);
+
+private:
+    mutable std::mutex cs;
+    bool fValid{false};
+    unsigned char vchHeader[HEADER_SIZE];
+    uint256 hash;
+};
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -72,10 +117,44 @@ public:
 
     uint256 GetHash() const;
 
+    /** Remember the hash of the current header fields, as known from a trusted
+     * source (e.g. the block index), so that GetHash() doesn't recompute it. */
+    void SetCachedHash(const uint256& hash) const;
+
     int64_t GetBlockTime() const
     {
         return (int64_t)nTime;
     }
+
+private:
+    friend class CBlock;
+    friend class CBlockHeaderScanner;
+
+    // memory only
+    mutable CHeaderHashCache cachedHash;
+
+    void GetHeaderFields(unsigned char* header) const;
+};
+
+/** Hashes a block header for successive nonces, doing the nonce independent
+ * work once: the SHA-256 midstate of the first 64 bytes for version 4 and
+ * later headers, and the X11KVS prefix identifier for older ones, whose
+ * subtrees are shared between neighbouring nonces through the X11KVS cache.
+ */
+class CBlockHeaderScanner
+{
+public:
+    explicit CBlockHeaderScanner(const CBlockHeader& header);
+
+    /** Same as GetHash() of the header with its nNonce set to nNonce */
+    uint256 GetHash(uint32_t nNonce) const;
+
+private:
+    bool fX11KVS;
+    size_t nSize;
+    unsigned char vchHeader[CHeaderHashCache::HEADER_SIZE];
+    CSHA256 midstate;
+    uint256 prefix;
 };
 
 
@@ -89,7 +168,8 @@ public:
     std::vector<unsigned char> vchBlockSig;
 
     // memory only
-    mutable bool fChecked;
+    mutable CCheckedFlag fChecked;
+    mutable CCheckedFlag fCheckedContextFree;
 
     CBlock()
     {
@@ -117,6 +197,7 @@ public:
         CBlockHeader::SetNull();
         vtx.clear();
         fChecked = false;
+        fCheckedContextFree = false;
         vchBlockSig.clear();
     }
 
@@ -131,6 +212,7 @@ public:
         block.nNonce         = nNonce;
         if(nVersion > 3 && nVersion < 7)
             block.nAccumulatorCheckpoint = nAccumulatorCheckpoint;
+        block.cachedHash = cachedHash;
         return block;
     }
 
@@ -7,6 +7,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "base58.h"
+#include "blockcache.h"
+#include "blockpipeline.h"
 #include "checkpoints.h"
 #include "clientversion.h"
 #include "consensus/upgrades.h"
@@ -20,6 +22,7 @@
 #include "util.h"
 #include "utilmoneystr.h"
 #include "utilstrencodings.h"
+#include "utxosnapshot.h"
 #include "hash.h"
 #include "wallet/wallet.h"
 
@@ -525,11 +528,15 @@ UniValue getblock(const JSONRPCRequest& request)
     if (mapBlockIndex.count(hash) == 0)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlock block;
+    std::shared_ptr<const CBlock> pblock;
     CBlockIndex* pblockindex = mapBlockIndex[hash];
 
-    if (!ReadBlockFromDisk(block, pblockindex))
+    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
+
+    if (!ReadBlockFromDisk(pblock, pblockindex))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+    const CBlock& block = *pblock;
 
     if (!fVerbose) {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
@@ -750,6 +757,47 @@ UniValue gettxoutsetinfo(const JSONRPCRequest& request)
     return ret;
 }
 
+UniValue dumptxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "dumptxoutset \"path\"\n"
+            "\nWrites the unspent transaction output set, and the block index up to its best block, to a file\n"
+            "that a new node can start from with -loadutxosnapshot.\n"
+            "Note this call may take some time.\n"
+
+            "\nArguments:\n"
+            "1. \"path\"     (string, required) The file to write, relative to the data directory if not absolute\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"path\": \"path\",       (string) The absolute path of the file\n"
+            "  \"bestblock\": \"hex\",   (string) The block the snapshot was taken at\n"
+            "  \"height\": n,          (numeric) The height of that block\n"
+            "  \"payeewindow\": n,     (numeric) The number of last blocks whose paid payee is written\n"
+            "  \"coins\": n,           (numeric) The number of unspent outputs written\n"
+            "  \"hash\": \"hash\",       (string) The content hash, to pass to -utxosnapshothash\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("dumptxoutset", "\"utxo.dat\"") + HelpExampleRpc("dumptxoutset", "\"utxo.dat\""));
+
+    const fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    CUTXOSnapshotHeader header;
+    std::string strError;
+    if (!DumpUTXOSnapshot(path, header, strError))
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("path", path.string()));
+    ret.push_back(Pair("bestblock", header.hashBlock.GetHex()));
+    ret.push_back(Pair("height", (int64_t)header.nHeight));
+    ret.push_back(Pair("payeewindow", (int64_t)header.nPayeeWindow));
+    ret.push_back(Pair("coins", (uint64_t)header.nCoins));
+    ret.push_back(Pair("hash", header.hashContent.GetHex()));
+    return ret;
+}
+
 UniValue gettxout(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
@@ -999,12 +1047,53 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
             "  \"difficulty\": xxxxxx,     (numeric) the current difficulty\n"
             "  \"verificationprogress\": xxxx, (numeric) estimate of verification progress [0..1]\n"
             "  \"chainwork\": \"xxxx\"     (string) total amount of work in active chain, in hexadecimal\n"
+            "  \"pruned\": xx,             (boolean) if the blocks are subject to pruning\n"
+            "  \"pruneheight\": xxxxxx,    (numeric) lowest-height complete block stored, if block files were pruned\n"
+            "  \"size_on_disk\": xxxxxx,   (numeric) the estimated size of the block and undo files on disk\n"
             "  \"upgrades\": {                (object) status of network upgrades\n"
             "     \"name\" : {                (string) name of upgrade\n"
             "        \"activationheight\": xxxxxx,  (numeric) block height of activation\n"
             "        \"status\": \"xxxx\",      (string) status of upgrade\n"
             "        \"info\": \"xxxx\",        (string) additional information about upgrade\n"
             "     }, ...\n"
+            "  },\n"
+            "  \"forkstakechecks\": {        (object) double spend checks of coinstakes received on a fork\n"
+            "     \"checks\": xxxxxx,         (numeric) number of checks done\n"
+            "     \"avgdepth\": x.xxx,        (numeric) average number of fork blocks checked\n"
+            "     \"maxdepth\": xxxxxx,       (numeric) largest number of fork blocks checked\n"
+            "     \"avgtime_ms\": x.xxx,      (numeric) average duration of a check, in milliseconds\n"
+            "     \"diskreads\": xxxxxx,      (numeric) fork blocks read from disk, not found in memory\n"
+            "  },\n"
+            "  \"orphanblocks\": {           (object) blocks received ahead of their parent, kept in memory\n"
+            "     \"count\": xxxxxx,          (numeric) number of orphan blocks in the pool\n"
+            "     \"bytes\": xxxxxx,          (numeric) total size of the orphan blocks in the pool\n"
+            "     \"saved\": xxxxxx,          (numeric) orphan blocks accepted once their parent connected, without downloading them again\n"
+            "     \"dropped\": xxxxxx,        (numeric) orphan blocks not kept, the pool being full\n"
+            "  },\n"
+            "  \"blockpipeline\": {          (object) time spent by each stage of block validation, since startup\n"
+            "     \"threads\": xxxxxx,        (numeric) threads deserializing and checking blocks\n"
+            "     \"read_blocks\": xxxxxx,    (numeric) blocks read from external or reindexed files\n"
+            "     \"read_ms\": xxxxxx,        (numeric) time spent reading them, in milliseconds\n"
+            "     \"check_blocks\": xxxxxx,   (numeric) blocks deserialized and checked ahead of connecting them\n"
+            "     \"check_ms\": xxxxxx,       (numeric) time spent checking them, summed over the threads\n"
+            "     \"wait_ms\": xxxxxx,        (numeric) time spent waiting for a block still being checked\n"
+            "     \"connect_blocks\": xxxxxx, (numeric) blocks accepted and connected after going through the pipeline\n"
+            "     \"connect_ms\": xxxxxx,     (numeric) time spent accepting and connecting them\n"
+            "  },\n"
+            "  \"blockcache\": {             (object) recent blocks kept deserialized in memory, since startup\n"
+            "     \"blocks\": xxxxxx,         (numeric) number of blocks in the cache\n"
+            "     \"bytes\": xxxxxx,          (numeric) serialized size of the blocks in the cache\n"
+            "     \"maxbytes\": xxxxxx,       (numeric) size the cache is kept under, see -blockcachesize\n"
+            "     \"hits\": xxxxxx,           (numeric) block reads served from the cache\n"
+            "     \"misses\": xxxxxx,         (numeric) block reads that went to disk\n"
+            "     \"inserts\": xxxxxx,        (numeric) blocks added to the cache\n"
+            "     \"evictions\": xxxxxx,      (numeric) blocks dropped to make room for others\n"
+            "  },\n"
+            "  \"assumevalid\": {            (object) the block whose ancestors are connected without script and stake signature checks\n"
+            "     \"hash\": \"xxxx\",           (string) hash of the block, zero if all scripts are checked\n"
+            "     \"height\": xxxxxx,         (numeric) height of the block, -1 if its header is not known yet\n"
+            "     \"blocks\": xxxxxx,         (numeric) blocks connected since startup without checking their scripts\n"
+            "  }\n"
             "}\n"
 
             "\nExamples:\n" +
@@ -1024,6 +1113,14 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
     obj.push_back(Pair("difficulty", (double)GetDifficulty()));
     obj.push_back(Pair("verificationprogress", Checkpoints::GuessVerificationProgress(pChainTip)));
     obj.push_back(Pair("chainwork", pChainTip ? pChainTip->nChainWork.GetHex() : ""));
+    obj.push_back(Pair("pruned", fPruneMode));
+    if (fHavePruned && pChainTip) {
+        const CBlockIndex* pindex = pChainTip;
+        while (pindex->pprev && (pindex->pprev->nStatus & BLOCK_HAVE_DATA))
+            pindex = pindex->pprev;
+        obj.push_back(Pair("pruneheight", pindex->nHeight));
+    }
+    obj.push_back(Pair("size_on_disk", CalculateCurrentUsage()));
     UniValue upgrades(UniValue::VOBJ);
 
     if(nTipHeight >= 0) {
@@ -1034,6 +1131,53 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
 
     obj.push_back(Pair("upgrades", upgrades));
 
+    const CForkStakeCheckStats forkStats = GetForkStakeCheckStats();
+    UniValue forkChecks(UniValue::VOBJ);
+    forkChecks.push_back(Pair("checks", (uint64_t)forkStats.nChecks));
+    forkChecks.push_back(Pair("avgdepth", forkStats.nChecks ? (double)forkStats.nDepthSum / forkStats.nChecks : 0.0));
+    forkChecks.push_back(Pair("maxdepth", forkStats.nMaxDepth));
+    forkChecks.push_back(Pair("avgtime_ms", forkStats.nChecks ? forkStats.nTimeMicros * 0.001 / forkStats.nChecks : 0.0));
+    forkChecks.push_back(Pair("diskreads", (uint64_t)forkStats.nDiskReads));
+    obj.push_back(Pair("forkstakechecks", forkChecks));
+
+    const COrphanBlockStats orphanStats = GetOrphanBlockStats();
+    UniValue orphans(UniValue::VOBJ);
+    orphans.push_back(Pair("count", (uint64_t)orphanStats.nBlocks));
+    orphans.push_back(Pair("bytes", (uint64_t)orphanStats.nBytes));
+    orphans.push_back(Pair("saved", (uint64_t)orphanStats.nSaved));
+    orphans.push_back(Pair("dropped", (uint64_t)orphanStats.nDropped));
+    obj.push_back(Pair("orphanblocks", orphans));
+
+    const CBlockPipelineStats pipelineStats = blockPipeline.GetStats();
+    UniValue pipeline(UniValue::VOBJ);
+    pipeline.push_back(Pair("threads", pipelineStats.nThreads));
+    pipeline.push_back(Pair("read_blocks", (uint64_t)pipelineStats.nReadBlocks));
+    pipeline.push_back(Pair("read_ms", pipelineStats.nReadMicros / 1000));
+    pipeline.push_back(Pair("check_blocks", (uint64_t)pipelineStats.nCheckBlocks));
+    pipeline.push_back(Pair("check_ms", pipelineStats.nCheckMicros / 1000));
+    pipeline.push_back(Pair("wait_ms", pipelineStats.nWaitMicros / 1000));
+    pipeline.push_back(Pair("connect_blocks", (uint64_t)pipelineStats.nConnectBlocks));
+    pipeline.push_back(Pair("connect_ms", pipelineStats.nConnectMicros / 1000));
+    obj.push_back(Pair("blockpipeline", pipeline));
+
+    const CBlockCacheStats cacheStats = blockCache.GetStats();
+    UniValue cache(UniValue::VOBJ);
+    cache.push_back(Pair("blocks", (uint64_t)cacheStats.nBlocks));
+    cache.push_back(Pair("bytes", (uint64_t)cacheStats.nBytes));
+    cache.push_back(Pair("maxbytes", (uint64_t)cacheStats.nMaxBytes));
+    cache.push_back(Pair("hits", cacheStats.nHits));
+    cache.push_back(Pair("misses", cacheStats.nMisses));
+    cache.push_back(Pair("inserts", cacheStats.nInserts));
+    cache.push_back(Pair("evictions", cacheStats.nEvictions));
+    obj.push_back(Pair("blockcache", cache));
+
+    UniValue assumeValid(UniValue::VOBJ);
+    BlockMap::const_iterator itAssumed = mapBlockIndex.find(hashAssumeValid);
+    assumeValid.push_back(Pair("hash", hashAssumeValid.GetHex()));
+    assumeValid.push_back(Pair("height", itAssumed != mapBlockIndex.end() ? itAssumed->second->nHeight : -1));
+    assumeValid.push_back(Pair("blocks", (uint64_t)GetAssumedValidBlocks()));
+    obj.push_back(Pair("assumevalid", assumeValid));
+
     return obj;
 }
 
@@ -1375,6 +1519,8 @@ UniValue getblockindexstats(const JSONRPCRequest& request) {
 
     while (true) {
         CBlock block;
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA))
+            throw JSONRPCError(RPC_MISC_ERROR, strprintf("Block %d not available (pruned data)", pindex->nHeight));
         if (!ReadBlockFromDisk(block, pindex)) {
             throw JSONRPCError(RPC_DATABASE_ERROR, "failed to read block from disk");
         }
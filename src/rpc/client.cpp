@@ -34,6 +34,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
         {"setgenerate", 0},
         {"setgenerate", 1},
         {"generate", 0},
+        {"gethashespersec", 0},
         {"getnetworkhashps", 0},
         {"getnetworkhashps", 1},
         {"delegatestake", 1},
@@ -870,19 +870,11 @@ UniValue getmasternodescores (const JSONRPCRequest& request)
     if (sporkManager.IsSporkActive(SPORK_114_MN_PAYMENT_V2)) return "{}"; // voting is disabled
 
     UniValue obj(UniValue::VOBJ);
-    std::vector<CMasternode> vMasternodes = mnodeman.GetFullMasternodeVector();
+    mnodeman.Check();
     for (int nHeight = nChainHeight - nLast; nHeight < nChainHeight + 20; nHeight++) {
-        uint256 nHigh;
-        CMasternode* pBestMasternode = NULL;
-        for (CMasternode& mn : vMasternodes) {
-            uint256 n = mn.CalculateScore(1, nHeight - 100);
-            if (n > nHigh) {
-                nHigh = n;
-                pBestMasternode = &mn;
-            }
-        }
-        if (pBestMasternode)
-            obj.push_back(Pair(strprintf("%d", nHeight), pBestMasternode->vin.prevout.hash.ToString().c_str()));
+        CTxIn vinBest;
+        if (mnodeman.GetHighestScore(nHeight - 100, vinBest))
+            obj.push_back(Pair(strprintf("%d", nHeight), vinBest.prevout.hash.ToString().c_str()));
     }
 
     return obj;
@@ -10,6 +10,7 @@
 #include "base58.h"
 #include "chainparams.h"
 #include "core_io.h"
+#include "hashx11kvs.h"
 #include "init.h"
 #include "main.h"
 #include "miner.h"
@@ -178,8 +179,9 @@ UniValue generate(const JSONRPCRequest& request)
                 LOCK(cs_main);
                 IncrementExtraNonce(pblock, chainActive.Tip(), nExtraNonce);
             }
+            CBlockHeaderScanner scanner(*pblock);
             while (pblock->nNonce < std::numeric_limits<uint32_t>::max() &&
-                    !CheckProofOfWork(pblock->GetHash(), pblock->nBits)) {
+                    !CheckProofOfWork(scanner.GetHash(pblock->nNonce), pblock->nBits)) {
                 ++pblock->nNonce;
             }
             if (ShutdownRequested()) break;
@@ -255,21 +257,42 @@ UniValue setgenerate(const JSONRPCRequest& request)
 
 UniValue gethashespersec(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 0)
+    if (request.fHelp || request.params.size() > 1)
         throw std::runtime_error(
-            "gethashespersec\n"
+            "gethashespersec ( verbose )\n"
             "\nReturns a recent hashes per second performance measurement while generating.\n"
             "See the getgenerate and setgenerate calls to turn generation on and off.\n"
 
-            "\nResult:\n"
+            "\nArguments:\n"
+            "1. verbose    (boolean, optional, default=false) Also return the hash rate of each mining thread\n"
+
+            "\nResult (for verbose = false):\n"
             "n            (numeric) The recent hashes per second when generation is on (will return 0 if generation is off)\n"
 
+            "\nResult (for verbose = true):\n"
+            "{\n"
+            "  \"hashespersec\": n,     (numeric) The recent hashes per second of all the mining threads\n"
+            "  \"threads\": [           (array) The recent hashes per second of each mining thread\n"
+            "     n,                  (numeric)\n"
+            "     ...\n"
+            "  ]\n"
+            "}\n"
+
             "\nExamples:\n" +
-            HelpExampleCli("gethashespersec", "") + HelpExampleRpc("gethashespersec", ""));
+            HelpExampleCli("gethashespersec", "") + HelpExampleCli("gethashespersec", "true") + HelpExampleRpc("gethashespersec", ""));
+
+    const bool fStale = GetTimeMillis() - nHPSTimerStart > 8000;
+    if (request.params.size() == 0 || !request.params[0].get_bool())
+        return fStale ? (int64_t)0 : (int64_t)dHashesPerSec;
 
-    if (GetTimeMillis() - nHPSTimerStart > 8000)
-        return (int64_t)0;
-    return (int64_t)dHashesPerSec;
+    UniValue threads(UniValue::VARR);
+    for (double d : GetThreadHashesPerSec()) {
+        threads.push_back(fStale ? (int64_t)0 : (int64_t)d);
+    }
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("hashespersec", fStale ? (int64_t)0 : (int64_t)dHashesPerSec));
+    obj.push_back(Pair("threads", threads));
+    return obj;
 }
 #endif
 
@@ -294,6 +317,13 @@ UniValue getmininginfo(const JSONRPCRequest& request)
             "  \"pooledtx\": n              (numeric) The size of the mem pool\n"
             "  \"testnet\": true|false      (boolean) If using testnet or not\n"
             "  \"chain\": \"xxxx\",         (string) current network name as defined in BIP70 (main, test, regtest)\n"
+            "  \"x11kvscache\": {           (json object) X11KVS subtree cache statistics\n"
+            "     \"entries\": n,           (numeric) The number of cached subtrees\n"
+            "     \"hits\": n,              (numeric) The number of subtrees reused\n"
+            "     \"misses\": n,            (numeric) The number of subtrees computed\n"
+            "     \"evictions\": n,         (numeric) The number of subtrees dropped to honor the size bound\n"
+            "     \"hitrate\": x.xxx        (numeric) hits / (hits + misses)\n"
+            "  }\n"
             "}\n"
 
             "\nExamples:\n" +
@@ -312,6 +342,14 @@ UniValue getmininginfo(const JSONRPCRequest& request)
     obj.push_back(Pair("pooledtx", (uint64_t)mempool.size()));
     obj.push_back(Pair("testnet", Params().NetworkID() == CBaseChainParams::TESTNET));
     obj.push_back(Pair("chain", Params().NetworkIDString()));
+    const CX11KVSCache::Stats x11kvsStats = GetX11KVSCache().GetStats();
+    UniValue x11kvsObj(UniValue::VOBJ);
+    x11kvsObj.push_back(Pair("entries", (uint64_t)x11kvsStats.nEntries));
+    x11kvsObj.push_back(Pair("hits", x11kvsStats.nHits));
+    x11kvsObj.push_back(Pair("misses", x11kvsStats.nMisses));
+    x11kvsObj.push_back(Pair("evictions", x11kvsStats.nEvictions));
+    x11kvsObj.push_back(Pair("hitrate", x11kvsStats.HitRate()));
+    obj.push_back(Pair("x11kvscache", x11kvsObj));
 #ifdef ENABLE_WALLET
     obj.push_back(Pair("generate", getgenerate(request)));
     obj.push_back(Pair("hashespersec", gethashespersec(request)));
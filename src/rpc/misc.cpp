@@ -693,6 +693,11 @@ UniValue getstakingstatus(const JSONRPCRequest& request)
             "  \"lastattempt_hash\": xxx            (hex string) hash of the block on top of which the last stake attempt was made\n"
             "  \"lastattempt_coins\": n             (numeric) number of stakeable coins available during last stake attempt\n"
             "  \"lastattempt_tries\": n             (numeric) number of stakeable coins checked during last stake attempt\n"
+            "  \"lastattempt_threads\": [           (array) kernel search threads of the last stake attempt\n"
+            "    n,                              (numeric) coins checked per second by this thread\n"
+            "    ...\n"
+            "  ],\n"
+            "  \"tip_latency_ms\": n                (numeric) mean time from a new tip to the first kernel search on it, in milliseconds\n"
             "}\n"
 
             "\nExamples:\n" +
@@ -722,6 +727,12 @@ UniValue getstakingstatus(const JSONRPCRequest& request)
             obj.push_back(Pair("lastattempt_hash", ss->GetLastHash().GetHex()));
             obj.push_back(Pair("lastattempt_coins", ss->GetLastCoins()));
             obj.push_back(Pair("lastattempt_tries", ss->GetLastTries()));
+            UniValue threads(UniValue::VARR);
+            for (double dRate : ss->GetThreadTriesPerSec()) {
+                threads.push_back(UniValue(dRate));
+            }
+            obj.push_back(Pair("lastattempt_threads", threads));
+            obj.push_back(Pair("tip_latency_ms", ss->GetTipLatency()));
         }
         return obj;
     }
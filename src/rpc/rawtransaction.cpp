@@ -181,9 +181,11 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
         std::string errmsg;
         if (blockindex) {
             if (!(blockindex->nStatus & BLOCK_HAVE_DATA)) {
-                throw JSONRPCError(RPC_MISC_ERROR, "Block not available");
+                throw JSONRPCError(RPC_MISC_ERROR, blockindex->nTx > 0 ? "Block not available (pruned data)" : "Block not available");
             }
             errmsg = "No such transaction found in the provided block";
+        } else if (fTxIndex && fHavePruned) {
+            errmsg = "No such mempool or blockchain transaction, or its block was pruned";
         } else {
             errmsg = fTxIndex
               ? "No such mempool or blockchain transaction"
@@ -315,6 +315,7 @@ static const CRPCCommand vRPCCommands[] =
         {"blockchain", "getrawmempool", &getrawmempool, true },
         {"blockchain", "gettxout", &gettxout, true },
         {"blockchain", "gettxoutsetinfo", &gettxoutsetinfo, true },
+        {"blockchain", "dumptxoutset", &dumptxoutset, true },
         {"blockchain", "invalidateblock", &invalidateblock, true },
         {"blockchain", "reconsiderblock", &reconsiderblock, true },
         {"blockchain", "verifychain", &verifychain, true },
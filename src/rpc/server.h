@@ -241,6 +241,7 @@ extern UniValue getblock(const JSONRPCRequest& request);
 extern UniValue getblockheader(const JSONRPCRequest& request);
 extern UniValue getfeeinfo(const JSONRPCRequest& request);
 extern UniValue gettxoutsetinfo(const JSONRPCRequest& request);
+extern UniValue dumptxoutset(const JSONRPCRequest& request);
 extern UniValue gettxout(const JSONRPCRequest& request);
 extern UniValue verifychain(const JSONRPCRequest& request);
 extern UniValue getchaintips(const JSONRPCRequest& request);
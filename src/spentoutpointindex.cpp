@@ -0,0 +1,65 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "spentoutpointindex.h"
+
+#include "chain.h"
+#include "primitives/block.h"
+
+void CSpentOutpointIndex::Add(const CBlockIndex* pindex, const CBlock& block)
+{
+    auto ret = mapSpent.emplace(pindex, OutpointSet());
+    if (!ret.second)
+        return;
+    setByHeight.emplace(pindex->nHeight, pindex);
+
+    OutpointSet& setSpent = ret.first->second;
+    for (const CTransaction& tx : block.vtx) {
+        if (tx.IsCoinBase()) continue;
+        for (const CTxIn& in : tx.vin)
+            setSpent.insert(in.prevout);
+    }
+}
+
+const CSpentOutpointIndex::OutpointSet* CSpentOutpointIndex::Get(const CBlockIndex* pindex) const
+{
+    auto it = mapSpent.find(pindex);
+    return it != mapSpent.end() ? &it->second : nullptr;
+}
+
+void CSpentOutpointIndex::Prune(int nHeightMin)
+{
+    while (!setByHeight.empty() && setByHeight.begin()->first < nHeightMin) {
+        mapSpent.erase(setByHeight.begin()->second);
+        setByHeight.erase(setByHeight.begin());
+    }
+}
+
+CSpentOutpointIndex::ForkSpend CSpentOutpointIndex::CheckFork(const CBlockIndex* pindexPrev, const CChain& chain,
+    const std::vector<COutPoint>& vPrevouts, int nMaxReorg, const BlockReader& fnRead, int& nDepth, int& nReads)
+{
+    nDepth = 0;
+    nReads = 0;
+    // Go backwards on the forked chain up to the split
+    for (const CBlockIndex* pindex = pindexPrev; !chain.Contains(pindex); pindex = pindex->pprev) {
+        if (++nDepth == nMaxReorg)
+            return FORK_TOO_DEEP;
+
+        const OutpointSet* pSpent = Get(pindex);
+        if (!pSpent) {
+            std::shared_ptr<const CBlock> pblock;
+            if (!fnRead(pindex, pblock))
+                return FORK_NOT_ON_DISK;
+            nReads++;
+            Add(pindex, *pblock);
+            pSpent = Get(pindex);
+        }
+
+        for (const COutPoint& prevout : vPrevouts) {
+            if (pSpent->count(prevout))
+                return FORK_SPENT;
+        }
+    }
+    return FORK_NOT_SPENT;
+}
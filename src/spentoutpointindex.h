@@ -0,0 +1,66 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DECENOMY_SPENTOUTPOINTINDEX_H
+#define DECENOMY_SPENTOUTPOINTINDEX_H
+
+#include "coins.h"
+#include "primitives/transaction.h"
+
+#include <functional>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+class CChain;
+
+/**
+ * Outpoints spent by the recently accepted blocks, on the active chain or not.
+ * A coinstake arriving on a fork is checked against the blocks between its
+ * parent and the fork point with hash lookups; a block is read from disk only
+ * if it was accepted before the node started. Blocks deeper than -maxreorg
+ * below the tip are dropped, a fork can not reach them.
+ */
+class CSpentOutpointIndex
+{
+public:
+    typedef std::unordered_set<COutPoint, SaltedOutpointHasher> OutpointSet;
+    //! Reads a block that is not indexed yet, false if it is not on disk
+    typedef std::function<bool(const CBlockIndex*, std::shared_ptr<const CBlock>&)> BlockReader;
+
+    enum ForkSpend {
+        FORK_NOT_SPENT,
+        FORK_SPENT,      //!< a block of the fork spends one of the outpoints
+        FORK_TOO_DEEP,   //!< the fork point is -maxreorg blocks or more below
+        FORK_NOT_ON_DISK //!< a block of the fork can't be read
+    };
+
+    //! Index the outpoints spent by block, once
+    void Add(const CBlockIndex* pindex, const CBlock& block);
+    const OutpointSet* Get(const CBlockIndex* pindex) const;
+    //! Drop the blocks below nHeightMin
+    void Prune(int nHeightMin);
+    size_t size() const { return mapSpent.size(); }
+
+    /**
+     * Check vPrevouts against the blocks from pindexPrev back to the fork
+     * point with chain, indexing the ones read through fnRead. nDepth is the
+     * number of blocks walked, the last one being the block that spends or
+     * can't be read, and nReads the number of blocks read.
+     */
+    ForkSpend CheckFork(const CBlockIndex* pindexPrev, const CChain& chain, const std::vector<COutPoint>& vPrevouts,
+        int nMaxReorg, const BlockReader& fnRead, int& nDepth, int& nReads);
+
+private:
+    std::unordered_map<const CBlockIndex*, OutpointSet> mapSpent;
+    //! The same blocks by height, pruned from the lowest
+    std::set<std::pair<int, const CBlockIndex*> > setByHeight;
+};
+
+#endif // DECENOMY_SPENTOUTPOINTINDEX_H
@@ -6,6 +6,7 @@
 #include "stakeinput.h"
 
 #include "chain.h"
+#include "crypto/common.h"
 #include "main.h"
 #include "txdb.h"
 #include "wallet/wallet.h"
@@ -32,10 +33,36 @@ bool CPivStake::InitFromTxIn(const CTxIn& txin)
     return true;
 }
 
+bool CPivStake::InitFromCoin(const COutPoint& prevout, const Coin& coin)
+{
+    if (coin.IsSpent())
+        return error("%s : spent coin %s", __func__, prevout.ToString());
+    // Undo data of old versions has no height for the non-final spends of a transaction,
+    // the genesis outputs can't be staked: the caller looks the transaction up instead
+    if (coin.nHeight == 0)
+        return false;
+    hashFrom = prevout.hash;
+    nPosition = prevout.n;
+    outFrom = coin.out;
+
+    // The coin height is the one of its block in the active chain
+    pindexFrom = chainActive[coin.nHeight];
+    if (!pindexFrom)
+        return error("%s : Failed to find the block index for stake origin", __func__);
+
+    // All good
+    return true;
+}
+
 bool CPivStake::SetPrevout(CTransaction txPrev, unsigned int n)
 {
     this->txFrom = txPrev;
+    this->hashFrom = txPrev.GetHash();
     this->nPosition = n;
+    if (n < txPrev.vout.size())
+        this->outFrom = txPrev.vout[n];
+    else
+        this->outFrom.SetNull();
     return true;
 }
 
@@ -49,28 +76,28 @@ bool CPivStake::GetTxFrom(CTransaction& tx) const
 
 bool CPivStake::GetTxOutFrom(CTxOut& out) const
 {
-    if (txFrom.IsNull() || nPosition >= txFrom.vout.size())
+    if (outFrom.IsNull())
         return false;
-    out = txFrom.vout[nPosition];
+    out = outFrom;
     return true;
 }
 
 bool CPivStake::CreateTxIn(CWallet* pwallet, CTxIn& txIn, uint256 hashTxOut)
 {
-    txIn = CTxIn(txFrom.GetHash(), nPosition);
+    txIn = CTxIn(hashFrom, nPosition);
     return true;
 }
 
 CAmount CPivStake::GetValue() const
 {
-    return txFrom.vout[nPosition].nValue;
+    return outFrom.nValue;
 }
 
 bool CPivStake::CreateTxOuts(CWallet* pwallet, std::vector<CTxOut>& vout, CAmount nTotal, const bool onlyP2PK)
 {
     std::vector<valtype> vSolutions;
     txnouttype whichType;
-    CScript scriptPubKeyKernel = txFrom.vout[nPosition].scriptPubKey;
+    CScript scriptPubKeyKernel = outFrom.scriptPubKey;
     if (!Solver(scriptPubKeyKernel, whichType, vSolutions))
         return error("%s: failed to parse kernel", __func__);
 
@@ -115,12 +142,16 @@ bool CPivStake::CreateTxOuts(CWallet* pwallet, std::vector<CTxOut>& vout, CAmoun
     return true;
 }
 
-CDataStream CPivStake::GetUniqueness() const
+void CPivStake::GetUniqueness(unsigned char* pchRet) const
+{
+    GetUniqueness(COutPoint(hashFrom, nPosition), pchRet);
+}
+
+void CPivStake::GetUniqueness(const COutPoint& outpoint, unsigned char* pchRet)
 {
-    //The unique identifier for a XMD stake is the outpoint
-    CDataStream ss(SER_NETWORK, 0);
-    ss << nPosition << txFrom.GetHash();
-    return ss;
+    //The unique identifier for a XMD stake is the outpoint, serialized as position and txid
+    WriteLE32(pchRet, outpoint.n);
+    memcpy(pchRet + 4, outpoint.hash.begin(), outpoint.hash.size());
 }
 
 //The block that the UTXO was added to the chain
@@ -130,7 +161,7 @@ CBlockIndex* CPivStake::GetIndexFrom()
         return pindexFrom;
     uint256 hashBlock = UINT256_ZERO;
     CTransaction tx;
-    if (GetTransaction(txFrom.GetHash(), tx, hashBlock, true)) {
+    if (GetTransaction(hashFrom, tx, hashBlock, true)) {
         // If the index is in the chain, then set it as the "index from"
         if (mapBlockIndex.count(hashBlock)) {
             CBlockIndex* pindex = mapBlockIndex.at(hashBlock);
@@ -138,7 +169,7 @@ CBlockIndex* CPivStake::GetIndexFrom()
                 pindexFrom = pindex;
         }
     } else {
-        LogPrintf("%s : failed to find tx %s\n", __func__, txFrom.GetHash().GetHex());
+        LogPrintf("%s : failed to find tx %s\n", __func__, hashFrom.GetHex());
     }
 
     return pindexFrom;
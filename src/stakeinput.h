@@ -7,6 +7,7 @@
 #define PIVX_STAKEINPUT_H
 
 #include "chain.h"
+#include "coins.h"
 #include "streams.h"
 #include "uint256.h"
 
@@ -20,6 +21,9 @@ protected:
     CBlockIndex* pindexFrom = nullptr;
 
 public:
+    //! Size of the unique identifier of a stake input, see GetUniqueness
+    static const size_t UNIQUENESS_SIZE = 36;
+
     virtual ~CStakeInput(){};
     virtual bool InitFromTxIn(const CTxIn& txin) = 0;
     virtual CBlockIndex* GetIndexFrom() = 0;
@@ -28,7 +32,8 @@ public:
     virtual bool GetTxOutFrom(CTxOut& out) const = 0;
     virtual CAmount GetValue() const = 0;
     virtual bool CreateTxOuts(CWallet* pwallet, std::vector<CTxOut>& vout, CAmount nTotal, const bool onlyP2PK) = 0;
-    virtual CDataStream GetUniqueness() const = 0;
+    //! Write the UNIQUENESS_SIZE bytes that identify the stake input in the kernel to pchRet
+    virtual void GetUniqueness(unsigned char* pchRet) const = 0;
     virtual bool ContextCheck(int nHeight, uint32_t nTime) = 0;
 };
 
@@ -36,20 +41,25 @@ public:
 class CPivStake : public CStakeInput
 {
 private:
-    CTransaction txFrom{CTransaction()};
+    CTransaction txFrom{CTransaction()};    // only known when set through SetPrevout
+    uint256 hashFrom;
     unsigned int nPosition{0};
+    CTxOut outFrom;
 
 public:
     CPivStake() {}
 
     bool InitFromTxIn(const CTxIn& txin) override;
+    // Init from the spent output as found in the UTXO set or in undo data, false if its height is not known
+    bool InitFromCoin(const COutPoint& prevout, const Coin& coin);
     bool SetPrevout(CTransaction txPrev, unsigned int n);
 
     CBlockIndex* GetIndexFrom() override;
     bool GetTxFrom(CTransaction& tx) const override;
     bool GetTxOutFrom(CTxOut& out) const override;
     CAmount GetValue() const override;
-    CDataStream GetUniqueness() const override;
+    void GetUniqueness(unsigned char* pchRet) const override;
+    static void GetUniqueness(const COutPoint& outpoint, unsigned char* pchRet);
     bool CreateTxIn(CWallet* pwallet, CTxIn& txIn, uint256 hashTxOut = UINT256_ZERO) override;
     bool CreateTxOuts(CWallet* pwallet, std::vector<CTxOut>& vout, CAmount nTotal, const bool onlyP2PK) override;
     bool ContextCheck(int nHeight, uint32_t nTime) override;
@@ -0,0 +1,156 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "checkpoints.h"
+#include "key.h"
+#include "main.h"
+#include "script/standard.h"
+#include "test/test_pivx.h"
+
+#include <list>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(assumevalid_tests, BasicTestingSetup)
+
+/** A header chain with a fork, in mapBlockIndex for as long as it lives */
+class HeaderChain
+{
+public:
+    std::vector<CBlockIndex*> vChain;
+    std::vector<CBlockIndex*> vFork;
+
+    HeaderChain(int nHeight, int nForkHeight, int nForkLength)
+    {
+        for (int i = 0; i <= nHeight; i++)
+            vChain.push_back(Add(i ? vChain.back() : nullptr));
+        vFork.push_back(vChain[nForkHeight]);
+        for (int i = 0; i < nForkLength; i++)
+            vFork.push_back(Add(vFork.back()));
+    }
+
+    ~HeaderChain()
+    {
+        LOCK(cs_main);
+        for (const CBlockIndex& index : indexes)
+            mapBlockIndex.erase(index.GetBlockHash());
+    }
+
+private:
+    std::list<CBlockIndex> indexes;
+
+    CBlockIndex* Add(CBlockIndex* pprev)
+    {
+        LOCK(cs_main);
+        indexes.emplace_back();
+        CBlockIndex* pindex = &indexes.back();
+        pindex->pprev = pprev;
+        pindex->nHeight = pprev ? pprev->nHeight + 1 : 0;
+        pindex->phashBlock = &mapBlockIndex.emplace(InsecureRand256(), pindex).first->first;
+        pindex->BuildSkip();
+        return pindex;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(assumevalid_ancestors)
+{
+    // Two weeks of headers at the target spacing
+    const int nBuried = 14 * 24 * 60 * 60 / Params().GetConsensus().nTargetSpacing;
+    HeaderChain headers(1000 + nBuried + 10, 400, 700);
+    const std::vector<CBlockIndex*>& vChain = headers.vChain;
+    const std::vector<CBlockIndex*>& vFork = headers.vFork;
+
+    LOCK(cs_main);
+    CBlockIndex* pindexBestHeaderOld = pindexBestHeader;
+    const uint256 hashAssumeValidOld = hashAssumeValid;
+    pindexBestHeader = vChain.back();
+
+    // Everything is checked without an assumed valid block
+    hashAssumeValid = UINT256_ZERO;
+    BOOST_CHECK(!IsAssumedValid(vChain[499], vChain[500]->GetBlockHash()));
+
+    // Its ancestors and itself skip the checks, the blocks above it don't
+    hashAssumeValid = vChain[1000]->GetBlockHash();
+    BOOST_CHECK(IsAssumedValid(vChain[0], vChain[1]->GetBlockHash()));
+    BOOST_CHECK(IsAssumedValid(vChain[499], vChain[500]->GetBlockHash()));
+    BOOST_CHECK(IsAssumedValid(vChain[999], vChain[1000]->GetBlockHash()));
+    BOOST_CHECK(!IsAssumedValid(vChain[1000], vChain[1001]->GetBlockHash()));
+    BOOST_CHECK(!IsAssumedValid(nullptr, vChain[0]->GetBlockHash()));
+
+    // Not an ancestor: a fork block, or one claiming another parent
+    BOOST_CHECK(!IsAssumedValid(vFork[100], vFork[101]->GetBlockHash()));
+    BOOST_CHECK(!IsAssumedValid(vChain[499], InsecureRand256()));
+    BOOST_CHECK(!IsAssumedValid(vFork[99], vChain[500]->GetBlockHash()));
+
+    // Not buried two weeks deep in the best header chain
+    pindexBestHeader = vChain[1000 + nBuried - 1];
+    BOOST_CHECK(!IsAssumedValid(vChain[999], vChain[1000]->GetBlockHash()));
+    BOOST_CHECK(IsAssumedValid(vChain[0], vChain[1]->GetBlockHash()));
+
+    // The best header chain doesn't contain it
+    pindexBestHeader = vFork.back();
+    BOOST_CHECK(!IsAssumedValid(vChain[0], vChain[1]->GetBlockHash()));
+
+    // Unknown block
+    pindexBestHeader = vChain.back();
+    hashAssumeValid = InsecureRand256();
+    BOOST_CHECK(!IsAssumedValid(vChain[0], vChain[1]->GetBlockHash()));
+
+    pindexBestHeader = pindexBestHeaderOld;
+    hashAssumeValid = hashAssumeValidOld;
+}
+
+BOOST_AUTO_TEST_CASE(assumevalid_accounting)
+{
+    // Below the last checkpoint the inputs are not checked at all, whatever -assumevalid says
+    const int nSpendHeight = Checkpoints::GetTotalBlocksEstimate() + 1000;
+    CKey key;
+    key.MakeNewKey(true);
+    const Coin coin(CTxOut(10 * COIN, GetScriptForDestination(key.GetPubKey().GetID())), nSpendHeight - 200, false, false);
+    const std::vector<const Coin*> vCoins = {&coin};
+
+    // A spend with a bad signature
+    CMutableTransaction mtx;
+    mtx.vin.emplace_back(InsecureRand256(), 0);
+    mtx.vin[0].scriptSig << std::vector<unsigned char>(72, 1) << ToByteVector(key.GetPubKey());
+    mtx.vout.emplace_back(9 * COIN, CScript() << OP_TRUE);
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG;
+
+    // The script is checked for blocks that are not ancestors of the assumed valid one...
+    CTransaction tx(mtx);
+    PrecomputedTransactionData txdata(tx);
+    CValidationState state;
+    BOOST_CHECK(!CheckInputs(tx, state, vCoins, nSpendHeight, true, flags, false, txdata));
+    BOOST_CHECK(state.GetRejectReason().find("mandatory-script-verify-flag-failed") == 0);
+
+    // ...and skipped for the ancestors
+    state = CValidationState();
+    BOOST_CHECK(CheckInputs(tx, state, vCoins, nSpendHeight, false, flags, false, txdata));
+
+    // The amounts are still checked for them
+    mtx.vout[0].nValue = 11 * COIN;
+    CTransaction txOverspend(mtx);
+    PrecomputedTransactionData txdataOverspend(txOverspend);
+    state = CValidationState();
+    BOOST_CHECK(!CheckInputs(txOverspend, state, vCoins, nSpendHeight, false, flags, false, txdataOverspend));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-txns-in-belowout");
+
+    // So is the maturity of the coinstake spent
+    const Coin coinStake(CTxOut(10 * COIN, CScript() << OP_TRUE), nSpendHeight - 1, false, true);
+    state = CValidationState();
+    BOOST_CHECK(!CheckInputs(tx, state, {&coinStake}, nSpendHeight, false, flags, false, txdata));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-txns-premature-spend-of-coinbase-coinstake");
+
+    // And the coins set: a missing or spent input fails before any check
+    CCoinsView viewDummy;
+    CCoinsViewCache view(&viewDummy);
+    std::vector<const Coin*> vMissing;
+    BOOST_CHECK(!view.GetInputs(tx, vMissing));
+    view.AddCoin(tx.vin[0].prevout, Coin(coin), false);
+    BOOST_CHECK(view.GetInputs(tx, vMissing));
+    view.SpendCoin(tx.vin[0].prevout);
+    BOOST_CHECK(!view.GetInputs(tx, vMissing));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,90 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockcache.h"
+#include "primitives/transaction.h"
+#include "random.h"
+#include "serialize.h"
+#include "test/test_pivx.h"
+#include "version.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockcache_tests, BasicTestingSetup)
+
+static std::shared_ptr<const CBlock> MakeBlock(uint32_t nNonce)
+{
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+    pblock->nNonce = nNonce;
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << std::vector<unsigned char>(200, (unsigned char)nNonce);
+    pblock->vtx.push_back(CTransaction(tx));
+    return pblock;
+}
+
+BOOST_AUTO_TEST_CASE(blockcache_hits_and_misses)
+{
+    CBlockCache cache;
+    std::shared_ptr<const CBlock> pblock = MakeBlock(1);
+    const uint256 hash = pblock->GetHash();
+
+    BOOST_CHECK(cache.Get(hash) == nullptr);
+    cache.Insert(hash, pblock);
+    BOOST_CHECK(cache.Get(hash) == pblock);
+    // Inserted again, the same entry is kept
+    cache.Insert(hash, MakeBlock(1));
+    BOOST_CHECK(cache.Get(hash) == pblock);
+
+    CBlockCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nHits, 2U);
+    BOOST_CHECK_EQUAL(stats.nMisses, 1U);
+    BOOST_CHECK_EQUAL(stats.nInserts, 1U);
+    BOOST_CHECK_EQUAL(stats.nBlocks, 1U);
+    BOOST_CHECK_EQUAL(stats.nBytes, ::GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION));
+
+    cache.Erase(hash);
+    BOOST_CHECK(cache.Get(hash) == nullptr);
+    BOOST_CHECK_EQUAL(cache.GetStats().nBytes, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(blockcache_lru_eviction)
+{
+    std::vector<std::shared_ptr<const CBlock> > vBlocks;
+    for (uint32_t i = 0; i < 4; i++)
+        vBlocks.push_back(MakeBlock(i));
+    const size_t nSize = ::GetSerializeSize(*vBlocks[0], SER_NETWORK, PROTOCOL_VERSION);
+
+    // Room for three blocks
+    CBlockCache cache;
+    cache.SetMaxSize(3 * nSize);
+    for (size_t i = 0; i < 3; i++)
+        cache.Insert(vBlocks[i]->GetHash(), vBlocks[i]);
+
+    // Used last, the first block is kept and the second one makes room for the fourth
+    BOOST_CHECK(cache.Get(vBlocks[0]->GetHash()) != nullptr);
+    cache.Insert(vBlocks[3]->GetHash(), vBlocks[3]);
+    BOOST_CHECK(cache.Get(vBlocks[0]->GetHash()) != nullptr);
+    BOOST_CHECK(cache.Get(vBlocks[1]->GetHash()) == nullptr);
+    BOOST_CHECK(cache.Get(vBlocks[2]->GetHash()) != nullptr);
+    BOOST_CHECK(cache.Get(vBlocks[3]->GetHash()) != nullptr);
+    CBlockCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nEvictions, 1U);
+    BOOST_CHECK_EQUAL(stats.nBlocks, 3U);
+    BOOST_CHECK(stats.nBytes <= stats.nMaxBytes);
+
+    // Shrunk, the least recently used blocks go first
+    cache.SetMaxSize(nSize);
+    BOOST_CHECK(cache.Get(vBlocks[3]->GetHash()) != nullptr);
+    BOOST_CHECK_EQUAL(cache.GetStats().nBlocks, 1U);
+
+    // Disabled, nothing is kept
+    cache.SetMaxSize(0);
+    cache.Insert(vBlocks[1]->GetHash(), vBlocks[1]);
+    BOOST_CHECK(cache.Get(vBlocks[1]->GetHash()) == nullptr);
+    BOOST_CHECK_EQUAL(cache.GetStats().nBlocks, 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
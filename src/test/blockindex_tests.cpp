@@ -0,0 +1,187 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chain.h"
+#include "clientversion.h"
+#include "main.h"
+#include "masternode.h"
+#include "streams.h"
+#include "txdb.h"
+#include "test/test_pivx.h"
+
+#include <list>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockindex_tests, TestingSetup)
+
+namespace {
+
+CBlockIndex MakeIndex()
+{
+    CBlockIndex index;
+    index.nHeight = 1000;
+    index.nStatus = BLOCK_VALID_SCRIPTS | BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO;
+    index.nFile = 3;
+    index.nDataPos = 1234;
+    index.nUndoPos = 567;
+    index.nTx = 5;
+    index.nVersion = CBlockHeader::CURRENT_VERSION;
+    index.hashMerkleRoot = InsecureRand256();
+    index.nTime = 1600000000;
+    index.nBits = 0x1e0ffff0;
+    index.nNonce = 42;
+    index.SetProofOfStake();
+    return index;
+}
+
+/** Write index as the block tree database does, returning the serialization version it was written with */
+int RoundTrip(const CBlockIndex& index, CDiskBlockIndex& diskindexRet)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << CDiskBlockIndex(&index);
+    CDataStream ssVersion(ss);
+    int nSerVersion = 0;
+    ssVersion >> VARINT(nSerVersion);
+    ss >> diskindexRet;
+    BOOST_CHECK(ss.empty());
+    BOOST_CHECK(diskindexRet.hashMerkleRoot == index.hashMerkleRoot);
+    BOOST_CHECK_EQUAL(diskindexRet.nHeight, index.nHeight);
+    BOOST_CHECK_EQUAL(diskindexRet.nDataPos, index.nDataPos);
+    BOOST_CHECK_EQUAL(diskindexRet.nUndoPos, index.nUndoPos);
+    BOOST_CHECK_EQUAL(diskindexRet.nTime, index.nTime);
+    BOOST_CHECK_EQUAL(diskindexRet.nNonce, index.nNonce);
+    BOOST_CHECK(diskindexRet.IsProofOfStake());
+    return nSerVersion;
+}
+
+/** Proof of stake blocks on top of the genesis block, on disk and made the active chain, without their paid payee */
+class PayeeChain
+{
+public:
+    std::vector<CScript> vPayees;
+
+    explicit PayeeChain(int nHeight)
+    {
+        LOCK(cs_main);
+        CBlockIndex* pindex = chainActive.Genesis();
+        CDiskBlockPos pos(1, 0);
+        for (int i = 1; i <= nHeight; i++) {
+            vPayees.push_back(CScript() << OP_DUP << OP_HASH160 << ToByteVector(InsecureRand256()) << OP_EQUALVERIFY << OP_CHECKSIG);
+
+            CMutableTransaction coinbase;
+            coinbase.vin.resize(1);
+            coinbase.vin[0].prevout.SetNull();
+            coinbase.vout.emplace_back();
+            coinbase.vout[0].SetEmpty();
+            CMutableTransaction coinstake;
+            coinstake.vin.emplace_back(InsecureRand256(), 0);
+            coinstake.vout.emplace_back();
+            coinstake.vout[0].SetEmpty();
+            coinstake.vout.emplace_back(100 * COIN, CScript() << OP_TRUE);
+            coinstake.vout.emplace_back(CMasternode::GetMasternodePayment(i), vPayees.back());
+
+            CBlock block;
+            block.hashPrevBlock = pindex->GetBlockHash();
+            block.nTime = pindex->nTime + 60;
+            block.vtx.emplace_back(coinbase);
+            block.vtx.emplace_back(coinstake);
+            BOOST_REQUIRE(block.IsProofOfStake());
+            BOOST_REQUIRE(WriteBlockToDisk(block, pos));
+
+            indexes.emplace_back(block);
+            CBlockIndex* pindexNew = &indexes.back();
+            pindexNew->pprev = pindex;
+            pindexNew->nHeight = i;
+            pindexNew->nTx = block.vtx.size();
+            pindexNew->nStatus = BLOCK_VALID_SCRIPTS | BLOCK_HAVE_DATA;
+            pindexNew->nFile = pos.nFile;
+            pindexNew->nDataPos = pos.nPos;
+            pindexNew->phashBlock = &mapBlockIndex.emplace(block.GetHash(), pindexNew).first->first;
+            pindexNew->BuildSkip();
+            pindex = pindexNew;
+
+            pos.nPos += ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+        }
+        chainActive.SetTip(pindex);
+    }
+
+    ~PayeeChain()
+    {
+        LOCK(cs_main);
+        chainActive.SetTip(chainActive.Genesis());
+        for (const CBlockIndex& index : indexes)
+            mapBlockIndex.erase(index.GetBlockHash());
+    }
+
+    const CBlockIndex* Get(int nHeight) const { return chainActive[nHeight]; }
+
+private:
+    std::list<CBlockIndex> indexes;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(blockindex_payee_serialization)
+{
+    CBlockIndex index = MakeIndex();
+    CDiskBlockIndex diskindex;
+
+    // Not known yet: written as before, and read back unknown
+    BOOST_CHECK_EQUAL(RoundTrip(index, diskindex), CLIENT_VERSION);
+    BOOST_CHECK(!diskindex.paidPayee);
+    BOOST_CHECK(diskindex.GetPaidPayee() == nullptr);
+
+    // Known: appended under its own version
+    const CScript payee = CScript() << OP_DUP << OP_HASH160 << ToByteVector(InsecureRand256()) << OP_EQUALVERIFY << OP_CHECKSIG;
+    index.paidPayee = payee;
+    BOOST_CHECK_EQUAL(RoundTrip(index, diskindex), DBI_SER_VERSION_PAYEE);
+    BOOST_CHECK(diskindex.paidPayee && *diskindex.paidPayee == payee);
+    BOOST_CHECK(diskindex.GetPaidPayee() && *diskindex.GetPaidPayee() == payee);
+
+    // A block that paid no masternode is known too, and not taken for an unknown one
+    index.paidPayee = CScript();
+    BOOST_CHECK_EQUAL(RoundTrip(index, diskindex), DBI_SER_VERSION_PAYEE);
+    BOOST_CHECK(diskindex.paidPayee && diskindex.paidPayee->empty());
+    BOOST_CHECK(diskindex.GetPaidPayee() == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(blockindex_payee_migration)
+{
+    PayeeChain chain(30);
+
+    // Only the last ones, as a snapshot asks for
+    BOOST_CHECK_EQUAL(MigratePaidPayees(10), 10);
+    {
+        LOCK(cs_main);
+        for (int nHeight = 1; nHeight <= 30; nHeight++) {
+            const CBlockIndex* pindex = chain.Get(nHeight);
+            BOOST_CHECK_EQUAL((bool)pindex->paidPayee, nHeight > 20);
+            if (pindex->paidPayee)
+                BOOST_CHECK(*pindex->paidPayee == chain.vPayees[nHeight - 1]);
+        }
+    }
+    // Nothing left to do in that window
+    BOOST_CHECK_EQUAL(MigratePaidPayees(10), 0);
+
+    // Then the rest, once
+    BOOST_CHECK_EQUAL(MigratePaidPayees(-1), 20);
+    BOOST_CHECK_EQUAL(MigratePaidPayees(-1), 0);
+
+    // Written to the block tree database, where they are loaded from on the next start
+    std::map<uint256, CBlockIndex> mapLoaded;
+    BOOST_CHECK(pblocktree->LoadBlockIndexGuts([&](const uint256& hash) -> CBlockIndex* {
+        return hash.IsNull() ? nullptr : &mapLoaded[hash];
+    }));
+    LOCK(cs_main);
+    for (int nHeight = 1; nHeight <= 30; nHeight++) {
+        const CBlockIndex* pindex = chain.Get(nHeight);
+        BOOST_REQUIRE(mapLoaded.count(pindex->GetBlockHash()));
+        const CBlockIndex& loaded = mapLoaded[pindex->GetBlockHash()];
+        BOOST_CHECK_EQUAL(loaded.nHeight, nHeight);
+        BOOST_CHECK(loaded.paidPayee && *loaded.paidPayee == chain.vPayees[nHeight - 1]);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,209 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "coinsprefetch.h"
+#include "main.h"
+#include "random.h"
+#include "test/test_pivx.h"
+#include "utiltime.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(coinsprefetch_tests, BasicTestingSetup)
+
+/** A coins database read by the prefetch threads, counting the reads */
+class CCoinsViewCounting : public CCoinsView
+{
+public:
+    mutable std::atomic<int> nReads{0};
+
+    bool GetCoin(const COutPoint& outpoint, Coin& coin) const override
+    {
+        nReads++;
+        std::lock_guard<std::mutex> lock(cs);
+        auto it = mapCoins.find(outpoint);
+        if (it == mapCoins.end())
+            return false;
+        coin = it->second;
+        return true;
+    }
+
+    bool HaveCoin(const COutPoint& outpoint) const override
+    {
+        Coin coin;
+        return GetCoin(outpoint, coin);
+    }
+
+    uint256 GetBestBlock() const override { return hashBestBlock; }
+
+    bool BatchWrite(CCoinsMap& mapWrite, const uint256& hashBlock) override
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        for (auto it = mapWrite.begin(); it != mapWrite.end(); it = mapWrite.erase(it)) {
+            if (!(it->second.flags & CCoinsCacheEntry::DIRTY))
+                continue;
+            if (it->second.coin.IsSpent())
+                mapCoins.erase(it->first);
+            else
+                mapCoins[it->first] = it->second.coin;
+        }
+        if (!hashBlock.IsNull())
+            hashBestBlock = hashBlock;
+        return true;
+    }
+
+    void Add(const COutPoint& outpoint, const CAmount nValue)
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        CTxOut out(nValue, CScript() << OP_TRUE);
+        mapCoins[outpoint] = Coin(std::move(out), 1, false, false);
+    }
+
+    //! Wait for the prefetch threads to have read nCount coins
+    bool WaitReads(int nCount) const
+    {
+        for (int i = 0; i < 1000 && nReads < nCount; i++)
+            MilliSleep(5);
+        return nReads >= nCount;
+    }
+
+private:
+    mutable std::mutex cs;
+    std::map<COutPoint, Coin> mapCoins;
+    uint256 hashBestBlock;
+};
+
+/** A block with one transaction spending vPrevouts, and one spending an output of the first */
+static CBlock SpendingBlock(const std::vector<COutPoint>& vPrevouts)
+{
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.emplace_back(0, CScript());
+    block.vtx.emplace_back(coinbase);
+    CMutableTransaction tx;
+    for (const COutPoint& prevout : vPrevouts)
+        tx.vin.emplace_back(prevout);
+    tx.vout.emplace_back(1, CScript() << OP_TRUE);
+    block.vtx.emplace_back(tx);
+    CMutableTransaction txChild;
+    txChild.vin.emplace_back(block.vtx[1].GetHash(), 0);
+    block.vtx.emplace_back(txChild);
+    block.nTime = InsecureRand32();
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(coinsprefetch_warm_hit)
+{
+    CCoinsViewCounting base;
+    std::vector<COutPoint> vPrevouts;
+    for (int i = 0; i < 100; i++) {
+        vPrevouts.emplace_back(InsecureRand256(), i);
+        base.Add(vPrevouts.back(), 1000 + i);
+    }
+    // Spent or never created
+    vPrevouts.emplace_back(InsecureRand256(), 0);
+    const CBlock block = SpendingBlock(vPrevouts);
+
+    CCoinsPrefetcher prefetcher;
+    prefetcher.Start(&base, 3);
+    prefetcher.Prefetch(block);
+    // The output created in the block itself is not read
+    BOOST_CHECK(base.WaitReads(101));
+    MilliSleep(20);
+    BOOST_CHECK_EQUAL(base.nReads, 101);
+
+    CCoinsViewCache view(&base);
+    // An entry the view has already is not replaced
+    view.AddCoin(vPrevouts[0], Coin(CTxOut(5, CScript()), 2, false, false), false);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(prefetcher.Apply(block, view), 99U);
+    }
+    BOOST_CHECK_EQUAL(base.nReads, 101);
+
+    // Every lookup of ConnectBlock is a hit
+    std::vector<const Coin*> vCoins;
+    BOOST_CHECK(!view.GetInputs(block.vtx[1], vCoins));
+    BOOST_CHECK_EQUAL(base.nReads, 102);
+    for (int i = 1; i < 100; i++) {
+        BOOST_CHECK(view.HaveCoinInCache(vPrevouts[i]));
+        BOOST_CHECK_EQUAL(view.AccessCoin(vPrevouts[i]).out.nValue, 1000 + i);
+    }
+    BOOST_CHECK_EQUAL(view.AccessCoin(vPrevouts[0]).out.nValue, 5);
+    BOOST_CHECK_EQUAL(base.nReads, 102);
+
+    // Applied again, nothing is added over the coins the view has
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(prefetcher.Apply(block, view), 0U);
+    }
+    prefetcher.Stop();
+
+    // Without threads, nothing is read ahead
+    const int nReads = base.nReads;
+    CCoinsViewCache view2(&base);
+    prefetcher.Prefetch(block);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(prefetcher.Apply(block, view2), 0U);
+    }
+    BOOST_CHECK_EQUAL(base.nReads, nReads);
+}
+
+BOOST_AUTO_TEST_CASE(coinsprefetch_invalidate_flush)
+{
+    CCoinsViewCounting base;
+    CCoinsViewCache tip(&base);
+    std::vector<COutPoint> vPrevouts;
+    for (int i = 0; i < 40; i++) {
+        vPrevouts.emplace_back(InsecureRand256(), 0);
+        base.Add(vPrevouts.back(), 1000 + i);
+    }
+    const CBlock block = SpendingBlock(vPrevouts);
+    const CBlock blockStale = SpendingBlock(vPrevouts);
+
+    CCoinsPrefetcher prefetcher;
+    prefetcher.Start(&base, 2);
+
+    // Both blocks are read ahead, then a block connected meanwhile spends the first coin
+    prefetcher.Prefetch(block);
+    prefetcher.Prefetch(blockStale);
+    BOOST_CHECK(base.WaitReads(80));
+    {
+        LOCK(cs_main);
+        tip.SpendCoin(vPrevouts[0]);
+        tip.Flush();
+    }
+    BOOST_CHECK(!base.HaveCoin(vPrevouts[0]));
+
+    // Skipping the invalidation, the stale read brings the spent coin back
+    CCoinsViewCache viewStale(&base);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(prefetcher.Apply(blockStale, viewStale), 40U);
+    }
+    BOOST_CHECK(!viewStale.AccessCoin(vPrevouts[0]).IsSpent());
+
+    // The flush invalidates: the coins are read again and the spent one is left out
+    {
+        LOCK(cs_main);
+        prefetcher.Invalidate();
+    }
+    CCoinsViewCache view(&tip);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(prefetcher.Apply(block, view), 39U);
+    }
+    BOOST_CHECK(view.AccessCoin(vPrevouts[0]).IsSpent());
+    for (int i = 1; i < 40; i++)
+        BOOST_CHECK(view.HaveCoinInCache(vPrevouts[i]));
+    prefetcher.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -13,6 +13,7 @@
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "hash.h"
 #include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_pivx.h"
@@ -270,6 +271,42 @@ BOOST_AUTO_TEST_CASE(sha256_testvectors) {
     TestSHA256(test1, "a316d55510b49662420f49d145d42fb83f31ef8dc016aa4e32df049991a91e26");
 }
 
+static void TestSHA256D64(int maxblocks)
+{
+    for (int i = 0; i <= maxblocks; ++i) {
+        std::vector<unsigned char> in(64 * i), out1(32 * i), out2(32 * i);
+        for (int j = 0; j < 64 * i; ++j) in[j] = InsecureRandBits(8);
+        for (int j = 0; j < i; ++j) CHash256().Write(&in[64 * j], 64).Finalize(&out1[32 * j]);
+        SHA256D64(out2.data(), in.data(), i);
+        BOOST_CHECK(out1 == out2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sha256d64)
+{
+    TestSHA256D64(32);
+}
+
+BOOST_AUTO_TEST_CASE(sha256_implementations)
+{
+    const sha256_implementation::UseImplementation impls[] = {
+        sha256_implementation::STANDARD,
+        sha256_implementation::USE_SSE41,
+        sha256_implementation::USE_AVX2,
+        sha256_implementation::USE_SHANI,
+    };
+    for (const sha256_implementation::UseImplementation impl : impls) {
+        SHA256AutoDetect(impl);
+        TestSHA256("abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        TestSHA256("This is exactly 64 bytes long, not counting the terminating byte",
+                   "ab64eff7e88e2e46165e29f2bce41826bd4c7b3552f6b382a9e7d3af47c245f8");
+        TestSHA256(std::string(1000000, 'a'),
+                   "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+        TestSHA256D64(17);
+    }
+    SHA256AutoDetect();
+}
+
 BOOST_AUTO_TEST_CASE(sha512_testvectors) {
     TestSHA512("",
                "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
@@ -0,0 +1,191 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "hashx11kvs.h"
+#include "crypto/sph_x4.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "utilstrencodings.h"
+#include "test/test_pivx.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(hashx11kvs_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(hashx11kvs_cached_equivalence)
+{
+    CX11KVSCache cache(1 << 16);
+    unsigned char header[80];
+    for (int i = 0; i < 8; i++) {
+        GetRandBytes(header, sizeof(header));
+        for (unsigned int level = HASHX11KVS_MIN_LEVEL; level <= 4; level++) {
+            BOOST_CHECK(HashX11KVSCached(header, cache, level) == HashX11KVS(header, header + 80, level));
+        }
+    }
+
+    // A full depth hash, computed twice: the second time is a single hit
+    GetRandBytes(header, sizeof(header));
+    const uint256 expected = HashX11KVS(header, header + 80);
+    BOOST_CHECK(HashX11KVSCached(header, cache) == expected);
+    const CX11KVSCache::Stats before = cache.GetStats();
+    BOOST_CHECK(HashX11KVSCached(header, cache) == expected);
+    const CX11KVSCache::Stats after = cache.GetStats();
+    BOOST_CHECK_EQUAL(after.nHits, before.nHits + 1);
+    BOOST_CHECK_EQUAL(after.nMisses, before.nMisses);
+
+    // A level 2 tree on an empty cache: one miss per node, the fallback
+    // lookup of the root included
+    CX11KVSCache cacheEmpty(1 << 16);
+    GetRandBytes(header, sizeof(header));
+    HashX11KVSCached(header, cacheEmpty, 2);
+    BOOST_CHECK_EQUAL(cacheEmpty.GetStats().nMisses, 3U);
+    BOOST_CHECK_EQUAL(cacheEmpty.GetStats().nHits, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(hashx11kvs_cached_nonce_scan)
+{
+    // Tiny cache, so that generations rotate and entries get evicted
+    CX11KVSCache cache(64);
+    unsigned char header[80];
+    GetRandBytes(header, sizeof(header));
+    for (uint32_t nonce = 0; nonce < 16; nonce++) {
+        le32enc(header + 76, nonce);
+        BOOST_CHECK(HashX11KVSCached(header, cache, 3) == HashX11KVS(header, header + 80, 3));
+    }
+    const CX11KVSCache::Stats stats = cache.GetStats();
+    BOOST_CHECK(stats.nEntries <= 64);
+    BOOST_CHECK(stats.nEvictions > 0);
+
+    // A disabled cache still hashes correctly and never stores anything
+    cache.SetMaxEntries(0);
+    BOOST_CHECK(HashX11KVSCached(header, cache, 3) == HashX11KVS(header, header + 80, 3));
+    BOOST_CHECK_EQUAL(cache.GetStats().nEntries, 0U);
+}
+
+typedef void (*X4Function)(unsigned char* const out[4], const unsigned char* const in[4], size_t len);
+
+template <typename Context>
+static void CheckX4(X4Function fn, void (*init)(void*), void (*update)(void*, const void*, size_t), void (*close)(void*, void*), size_t minlen, size_t maxlen)
+{
+    unsigned char in[4][128];
+    unsigned char out[4][64];
+    unsigned char* pout[4] = {out[0], out[1], out[2], out[3]};
+    const unsigned char* pin[4] = {in[0], in[1], in[2], in[3]};
+    for (size_t len = minlen; len <= maxlen; len++) {
+        GetRandBytes(&in[0][0], sizeof(in));
+        fn(pout, pin, len);
+        for (int l = 0; l < 4; l++) {
+            Context ctx;
+            unsigned char expected[64];
+            init(&ctx);
+            update(&ctx, in[l], len);
+            close(&ctx, expected);
+            BOOST_CHECK_MESSAGE(memcmp(out[l], expected, 64) == 0, strprintf("len=%u lane=%d", len, l));
+        }
+    }
+
+    // In place, on the 64-byte blocks X11KV chains
+    unsigned char expected[4][64];
+    for (int l = 0; l < 4; l++) {
+        Context ctx;
+        init(&ctx);
+        update(&ctx, in[l], 64);
+        close(&ctx, expected[l]);
+        pout[l] = in[l];
+    }
+    fn(pout, pin, 64);
+    for (int l = 0; l < 4; l++) {
+        BOOST_CHECK(memcmp(in[l], expected[l], 64) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sph_x4_scalar_equivalence)
+{
+    CheckX4<sph_blake512_context>(sph_blake512_x4, sph_blake512_init, sph_blake512, sph_blake512_close, 0, 111);
+    CheckX4<sph_keccak512_context>(sph_keccak512_x4, sph_keccak512_init, sph_keccak512, sph_keccak512_close, 0, 71);
+    CheckX4<sph_skein512_context>(sph_skein512_x4, sph_skein512_init, sph_skein512, sph_skein512_close, 1, 64);
+}
+
+BOOST_AUTO_TEST_CASE(hashx11kvs_batched_equivalence)
+{
+    // Enough headers for every algorithm to show up with full and partial lane groups
+    std::vector<unsigned char> vHeaders(37 * 80);
+    GetRandBytes(vHeaders.data(), vHeaders.size());
+    std::vector<const unsigned char*> vPtrs;
+    for (size_t i = 0; i < vHeaders.size(); i += 80) vPtrs.push_back(&vHeaders[i]);
+    for (size_t count = 1; count <= vPtrs.size(); count += 6) {
+        std::vector<uint256> vHashes(count);
+        HashX11KVBatch(vPtrs.data(), count, vHashes.data());
+        for (size_t i = 0; i < count; i++) {
+            BOOST_CHECK(vHashes[i] == HashX11KV(vPtrs[i], vPtrs[i] + 80));
+        }
+    }
+
+    unsigned char header[80];
+    for (int i = 0; i < 4; i++) {
+        GetRandBytes(header, sizeof(header));
+        for (unsigned int level = HASHX11KVS_MIN_LEVEL; level <= HASHX11KVS_MAX_LEVEL; level += 3) {
+            BOOST_CHECK(HashX11KVSBatched(header, level) == HashX11KVS(header, header + 80, level));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(blockheader_hash_cache)
+{
+    CBlockHeader header;
+    header.nVersion = 3;
+    header.hashPrevBlock = GetRandHash();
+    header.hashMerkleRoot = GetRandHash();
+    header.nTime = 1600000000;
+    header.nBits = 0x1e0ffff0;
+    header.nNonce = 1;
+    const uint256 hash1 = header.GetHash();
+    BOOST_CHECK(hash1 == HashX11KVS(BEGIN(header.nVersion), END(header.nNonce)));
+
+    // Mutating any field invalidates the cached hash
+    header.nNonce++;
+    const uint256 hash2 = header.GetHash();
+    BOOST_CHECK(hash2 != hash1);
+    BOOST_CHECK(hash2 == HashX11KVS(BEGIN(header.nVersion), END(header.nNonce)));
+
+    // Copies carry the cached hash along
+    CBlock block(header);
+    BOOST_CHECK(block.GetHash() == hash2);
+    BOOST_CHECK(block.GetBlockHeader().GetHash() == hash2);
+
+    // Version 4+ headers hash their serialization
+    header.nVersion = CBlockHeader::CURRENT_VERSION;
+    BOOST_CHECK(header.GetHash() == SerializeHash(header));
+
+    // A trusted hash is returned until the header changes
+    const uint256 trusted = GetRandHash();
+    header.SetCachedHash(trusted);
+    BOOST_CHECK(header.GetHash() == trusted);
+    header.nTime++;
+    BOOST_CHECK(header.GetHash() == SerializeHash(header));
+}
+
+BOOST_AUTO_TEST_CASE(blockheader_scanner)
+{
+    CBlockHeader header;
+    header.hashPrevBlock = GetRandHash();
+    header.hashMerkleRoot = GetRandHash();
+    header.nAccumulatorCheckpoint = GetRandHash();
+    header.nTime = 1600000000;
+    header.nBits = 0x1e0ffff0;
+
+    // X11KVS (3), with an accumulator checkpoint (4 to 6) and without one (7)
+    for (int32_t nVersion : {3, 4, 6, 7}) {
+        header.nVersion = nVersion;
+        header.nNonce = InsecureRand32();
+        const CBlockHeaderScanner scanner(header);
+        const uint32_t nFirst = InsecureRand32();
+        for (uint32_t n = nFirst; n != nFirst + (nVersion == 3 ? 4 : 64); n++) {
+            header.nNonce = n;
+            BOOST_CHECK(scanner.GetHash(n) == header.GetHash());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
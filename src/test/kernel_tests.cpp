@@ -0,0 +1,74 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "kernel.h"
+#include "chainparams.h"
+#include "stakeinput.h"
+#include "streams.h"
+#include "test/test_pivx.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(kernel_tests, BasicTestingSetup)
+
+// Stake input with a known block from, instead of one found through the txindex
+class TestStake : public CPivStake
+{
+public:
+    explicit TestStake(CBlockIndex* pindex) { pindexFrom = pindex; }
+};
+
+// Kernel hash as computed from a serialized stream, for comparison
+static uint256 ReferenceKernelHash(const uint256& nStakeModifier, int nTimeBlockFrom, unsigned int nPosition, const uint256& txid, int nTime)
+{
+    CDataStream ss(SER_GETHASH, 0);
+    ss << nStakeModifier << nTimeBlockFrom << nPosition << txid << nTime;
+    return Hash(ss.begin(), ss.end());
+}
+
+BOOST_AUTO_TEST_CASE(stake_kernel_hash)
+{
+    const int nHeightV2 = Params().GetConsensus().vUpgrades[Consensus::UPGRADE_STAKE_MODIFIER_V2].nActivationHeight;
+
+    CBlockIndex indexFrom;
+    indexFrom.nHeight = nHeightV2 + 10;
+    indexFrom.nTime = 1600000000;
+    CBlockIndex indexPrev;
+    indexPrev.nHeight = nHeightV2 + 100;
+    const uint256 nStakeModifier = InsecureRand256();
+    indexPrev.SetStakeModifier(nStakeModifier);
+
+    for (int i = 0; i < 16; i++) {
+        CMutableTransaction txPrev;
+        txPrev.nLockTime = InsecureRand32();
+        txPrev.vout.resize(2);
+        txPrev.vout[1].nValue = (1 + InsecureRandRange(100000)) * COIN;
+        TestStake stake(&indexFrom);
+        stake.SetPrevout(CTransaction(txPrev), 1);
+
+        const unsigned int nBits = 0x1e0ffff0 - i;
+        const int nTime = 1600001000 + InsecureRandRange(100000);
+        CStakeKernel kernel(&indexPrev, &stake, nBits, nTime);
+        BOOST_CHECK(kernel.GetHash() == ReferenceKernelHash(nStakeModifier, indexFrom.nTime, 1, txPrev.GetHash(), nTime));
+
+        // Same kernel from the data cached by the staker
+        unsigned char vchUniqueness[CStakeInput::UNIQUENESS_SIZE];
+        CPivStake::GetUniqueness(COutPoint(txPrev.GetHash(), 1), vchUniqueness);
+        BOOST_CHECK(kernel.GetHash() == CStakeKernel(&indexPrev, &indexFrom, vchUniqueness, stake.GetValue(), nBits, nTime).GetHash());
+
+        // Moving through the time slots gives the kernel of a fresh object
+        uint256 bnTarget;
+        bnTarget.SetCompact(nBits);
+        bnTarget *= (uint256(stake.GetValue()) / 100);
+        for (int nSlot = nTime + 1; nSlot < nTime + 64; nSlot += 1 + InsecureRandRange(8)) {
+            kernel.SetTime(nSlot);
+            const uint256 hash = ReferenceKernelHash(nStakeModifier, indexFrom.nTime, 1, txPrev.GetHash(), nSlot);
+            BOOST_CHECK(kernel.GetHash() == hash);
+            BOOST_CHECK(kernel.GetHash() == CStakeKernel(&indexPrev, &stake, nBits, nSlot).GetHash());
+            BOOST_CHECK_EQUAL(kernel.CheckKernelHash(true), hash < bnTarget);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,474 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternode-queue.h"
+#include "key.h"
+#include "main.h"
+#include "masternode-payments.h"
+#include "masternode.h"
+#include "masternodeman.h"
+#include "netbase.h"
+#include "random.h"
+#include "script/standard.h"
+#include "spork.h"
+#include "streams.h"
+#include "test/test_pivx.h"
+#include "timedata.h"
+#include "utiltime.h"
+
+#include <algorithm>
+#include <list>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternode_queue_tests, BasicTestingSetup)
+
+namespace {
+
+struct CQueueEntry {
+    CMasternode* pmn;
+    int64_t nLastPaid;
+    uint32_t nHash;
+};
+
+// A list as found on a network: paid in the last days, never paid (0),
+// paid over a month ago, and some paid in the same second
+std::vector<CQueueEntry> MakeList(std::list<CMasternode>& mns, size_t nSize, int64_t nNow)
+{
+    std::vector<CQueueEntry> vEntries;
+    for (size_t i = 0; i < nSize; i++) {
+        mns.emplace_back();
+        CMasternode& mn = mns.back();
+        mn.vin = CTxIn(COutPoint(InsecureRand256(), InsecureRandRange(4)));
+        int64_t nLastPaid;
+        switch (InsecureRandRange(5)) {
+        case 0: nLastPaid = 0; break;
+        case 1: nLastPaid = nNow - MONTH_IN_SECONDS - InsecureRandRange(MONTH_IN_SECONDS); break;
+        case 2: nLastPaid = vEntries.empty() ? nNow : vEntries.back().nLastPaid; break;
+        default: nLastPaid = nNow - InsecureRandRange(10 * DAY_IN_SECONDS); break;
+        }
+        vEntries.push_back({&mn, nLastPaid, (uint32_t)InsecureRand32()});
+    }
+    return vEntries;
+}
+
+// The order GetNextMasternodeInQueueForPayment sorted the list in: by
+// SecondsSincePayment, high to low
+std::vector<std::pair<int64_t, CMasternode*> > SortList(const std::vector<CQueueEntry>& vEntries, int64_t nNow)
+{
+    std::vector<std::pair<int64_t, CMasternode*> > vLastPaid;
+    for (const CQueueEntry& entry : vEntries)
+        vLastPaid.emplace_back(SecondsSincePayment(nNow, entry.nLastPaid, entry.nHash), entry.pmn);
+    std::sort(vLastPaid.rbegin(), vLastPaid.rend(), [](const std::pair<int64_t, CMasternode*>& a, const std::pair<int64_t, CMasternode*>& b) {
+        return a.first < b.first;
+    });
+    return vLastPaid;
+}
+
+void CheckOrder(const CMasternodePaymentQueue& queue, const std::vector<CQueueEntry>& vEntries, int64_t nNow)
+{
+    std::map<CMasternode*, int64_t> mapSeconds;
+    for (const CQueueEntry& entry : vEntries)
+        mapSeconds[entry.pmn] = SecondsSincePayment(nNow, entry.nLastPaid, entry.nHash);
+
+    std::vector<std::pair<int64_t, CMasternode*> > vQueue;
+    queue.ForEach(nNow, [&](CMasternode* pmn) {
+        vQueue.emplace_back(mapSeconds.at(pmn), pmn);
+        return true;
+    });
+
+    // The same masternodes, in the same order but for the ones of equal
+    // SecondsSincePayment which the sort left unspecified
+    const std::vector<std::pair<int64_t, CMasternode*> > vSorted = SortList(vEntries, nNow);
+    BOOST_REQUIRE_EQUAL(vQueue.size(), vSorted.size());
+    for (size_t i = 0; i < vQueue.size(); i++)
+        BOOST_CHECK_EQUAL(vQueue[i].first, vSorted[i].first);
+    std::vector<std::pair<int64_t, CMasternode*> > vQueueSorted = vQueue;
+    std::vector<std::pair<int64_t, CMasternode*> > vSortedSorted = vSorted;
+    std::sort(vQueueSorted.begin(), vQueueSorted.end());
+    std::sort(vSortedSorted.begin(), vSortedSorted.end());
+    BOOST_CHECK(vQueueSorted == vSortedSorted);
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(queue_matches_sorted_list)
+{
+    const int64_t nNow = 1650000000;
+    for (size_t nSize : {0, 1, 10, 200, 2000}) {
+        std::list<CMasternode> mns;
+        const std::vector<CQueueEntry> vEntries = MakeList(mns, nSize, nNow);
+
+        CMasternodePaymentQueue queue;
+        for (const CQueueEntry& entry : vEntries)
+            queue.Update(entry.pmn, entry.nLastPaid, entry.nHash);
+        BOOST_CHECK_EQUAL(queue.size(), nSize);
+
+        CheckOrder(queue, vEntries, nNow);
+        // Later, more of them are unpaid for a month
+        CheckOrder(queue, vEntries, nNow + 5 * DAY_IN_SECONDS);
+        // And back, as the adjusted time may go
+        CheckOrder(queue, vEntries, nNow);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(queue_month_boundary)
+{
+    std::list<CMasternode> mns;
+    const int64_t nNow = 1650000000;
+    std::vector<CQueueEntry> vEntries = MakeList(mns, 3, nNow);
+    vEntries[0].nLastPaid = nNow - MONTH_IN_SECONDS;
+    vEntries[1].nLastPaid = nNow - MONTH_IN_SECONDS + 1;
+    vEntries[2].nLastPaid = nNow - MONTH_IN_SECONDS - 1;
+    vEntries[0].nHash = 0;
+    vEntries[2].nHash = 1;
+
+    CMasternodePaymentQueue queue;
+    for (const CQueueEntry& entry : vEntries)
+        queue.Update(entry.pmn, entry.nLastPaid, entry.nHash);
+
+    // A month counts as unpaid, the higher hash first
+    std::vector<CMasternode*> vOrder;
+    queue.ForEach(nNow, [&](CMasternode* pmn) {
+        vOrder.push_back(pmn);
+        return true;
+    });
+    BOOST_REQUIRE_EQUAL(vOrder.size(), 3);
+    BOOST_CHECK(vOrder[0] == vEntries[2].pmn);
+    BOOST_CHECK(vOrder[1] == vEntries[0].pmn);
+    BOOST_CHECK(vOrder[2] == vEntries[1].pmn);
+
+    // Stopped by the visitor
+    int nVisited = 0;
+    queue.ForEach(nNow, [&](CMasternode* pmn) { return ++nVisited < 2; });
+    BOOST_CHECK_EQUAL(nVisited, 2);
+}
+
+BOOST_AUTO_TEST_CASE(queue_incremental_updates)
+{
+    std::list<CMasternode> mns;
+    int64_t nNow = 1650000000;
+    std::vector<CQueueEntry> vEntries = MakeList(mns, 500, nNow);
+
+    CMasternodePaymentQueue queue;
+    for (const CQueueEntry& entry : vEntries)
+        queue.Update(entry.pmn, entry.nLastPaid, entry.nHash);
+
+    // Blocks paying the first of the queue, masternodes joining and leaving,
+    // payments disconnected and last paid times looked up again
+    for (int i = 0; i < 2000; i++) {
+        nNow += 60;
+        switch (InsecureRandRange(4)) {
+        case 0: {
+            CMasternode* pmnFirst = nullptr;
+            queue.ForEach(nNow, [&](CMasternode* pmn) {
+                pmnFirst = pmn;
+                return false;
+            });
+            for (CQueueEntry& entry : vEntries) {
+                if (entry.pmn == pmnFirst) {
+                    entry.nLastPaid = nNow;
+                    queue.Update(entry.pmn, entry.nLastPaid, entry.nHash);
+                }
+            }
+            break;
+        }
+        case 1: {
+            std::vector<CQueueEntry> vNew = MakeList(mns, 1, nNow);
+            queue.Update(vNew[0].pmn, vNew[0].nLastPaid, vNew[0].nHash);
+            vEntries.push_back(vNew[0]);
+            break;
+        }
+        case 2: {
+            if (vEntries.empty()) break;
+            const size_t n = InsecureRandRange(vEntries.size());
+            queue.Remove(vEntries[n].pmn);
+            BOOST_CHECK(!queue.Contains(vEntries[n].pmn));
+            vEntries.erase(vEntries.begin() + n);
+            break;
+        }
+        default: {
+            if (vEntries.empty()) break;
+            CQueueEntry& entry = vEntries[InsecureRandRange(vEntries.size())];
+            entry.nLastPaid = InsecureRandBool() ? 0 : nNow - InsecureRandRange(2 * MONTH_IN_SECONDS);
+            queue.Update(entry.pmn, entry.nLastPaid, entry.nHash);
+            break;
+        }
+        }
+        if (i % 100 == 0)
+            CheckOrder(queue, vEntries, nNow);
+    }
+    BOOST_CHECK_EQUAL(queue.size(), vEntries.size());
+    CheckOrder(queue, vEntries, nNow);
+
+    queue.Clear();
+    BOOST_CHECK_EQUAL(queue.size(), 0);
+}
+
+namespace {
+
+// The body of GetNextMasternodeInQueueForPayment before the payment queue, which
+// sorted all of the eligible masternodes for every query
+struct CompareLastPaid {
+    bool operator()(const std::pair<int64_t, CTxIn>& t1,
+        const std::pair<int64_t, CTxIn>& t2) const
+    {
+        return t1.first < t2.first;
+    }
+};
+
+CMasternode* OldNextMasternodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCount, std::vector<CTxIn>& vEligibleTxIns, bool fJustCount, bool fCleanLastPaid)
+{
+    CMasternode* pBestMasternode = nullptr;
+
+    std::vector<std::pair<int64_t, CTxIn>> vecMasternodeLastPaid;
+    vEligibleTxIns.clear();
+    int nMnCount = 0;
+    {
+        LOCK(cs_main);
+
+        nMnCount = mnodeman.CountEnabled();
+        for (const CMasternode& mnCopy : mnodeman.GetFullMasternodeVector()) {
+            CMasternode* mn = mnodeman.Find(mnCopy.vin);
+            mn->Check();
+            if (!mn->IsEnabled()) continue;
+
+            //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
+            if (masternodePayments.IsScheduled(*mn, nBlockHeight)) continue;
+
+            //it's too new, wait for a cycle
+            if (Params().GetConsensus().NetworkUpgradeActive(chainActive.Tip()->nHeight, Consensus::UPGRADE_STAKE_MODIFIER_V2)) {
+                if (fFilterSigTime && mn->sigTime + (nMnCount * 60) > GetAdjustedTime()) continue;
+            } else {
+                if (fFilterSigTime && mn->sigTime + (nMnCount * 2.6 * 60) > GetAdjustedTime()) continue;
+            }
+
+            //make sure it has as many confirmations as there are masternodes
+            if (!sporkManager.IsSporkActive(SPORK_107_IGNORE_COLLATERAL_CONFIRMATIONS)) {
+                if (pcoinsTip->GetCoinDepthAtHeight(mn->vin.prevout, nBlockHeight) < nMnCount) continue;
+            }
+
+            vecMasternodeLastPaid.push_back(std::make_pair(mn->SecondsSincePayment(chainActive[nBlockHeight - 1]), mn->vin));
+        }
+    }
+
+    nCount = (int)vecMasternodeLastPaid.size();
+
+    //when the network is in the process of upgrading, don't penalize nodes that recently restarted
+    if (fFilterSigTime && nCount < nMnCount / 3) return OldNextMasternodeInQueueForPayment(nBlockHeight, false, nCount, vEligibleTxIns, fJustCount, fCleanLastPaid);
+
+    if (!fJustCount) {
+        // Sort them high to low
+        sort(vecMasternodeLastPaid.rbegin(), vecMasternodeLastPaid.rend(), CompareLastPaid());
+
+        auto nEnabled = mnodeman.CountEnabled();
+        int nEligibleNetwork = nEnabled / 10;
+
+        if (sporkManager.IsSporkActive(SPORK_114_MN_PAYMENT_V2)) {
+            nEligibleNetwork = std::max(10, nEnabled * 5 / 100); // oldest 5% or the minimal of 10 MNs
+        }
+
+        int n = 0;
+        // clean last paid and recalculate again
+        if (fCleanLastPaid && sporkManager.IsSporkActive(SPORK_114_MN_PAYMENT_V2)) {
+            for (const auto& s : vecMasternodeLastPaid) {
+                CMasternode* pmn = mnodeman.Find(s.second);
+                if (!pmn) continue;
+
+                pmn->lastPaid = INT64_MAX;
+
+                n++;
+                if (n >= nEligibleNetwork / 3) break;
+            }
+
+            return OldNextMasternodeInQueueForPayment(nBlockHeight, fFilterSigTime, nCount, vEligibleTxIns, fJustCount, false);
+        }
+
+        uint256 nHigh;
+        int nCountEligible = 0;
+        for (const auto& s : vecMasternodeLastPaid) {
+            CMasternode* pmn = mnodeman.Find(s.second);
+            if (!pmn) continue;
+
+            if (sporkManager.IsSporkActive(SPORK_114_MN_PAYMENT_V2)) {
+                if (pBestMasternode == nullptr) {
+                    pBestMasternode = pmn; // get the MN that was paid the last
+                }
+            } else {
+                uint256 n = pmn->CalculateScore(1, nBlockHeight - 100);
+                if (n > nHigh) {
+                    nHigh = n;
+                    pBestMasternode = pmn;
+                }
+            }
+
+            vEligibleTxIns.push_back(s.second);
+            if (sporkManager.IsSporkActive(SPORK_114_MN_PAYMENT_V2) &&
+                pmn->GetLastPaid(chainActive[nBlockHeight - 1]) != 0) {
+                nCountEligible++;
+            }
+            if (nCountEligible >= nEligibleNetwork) break;
+        }
+    }
+
+    return pBestMasternode;
+}
+
+// Turn the payment sporks on or off, as if received from the network
+void SetPaymentSporks(bool fPaymentV2, bool fLastPaidV2, bool fIgnoreConfirmations)
+{
+    std::map<SporkId, CSporkMessage> mapSporksActive;
+    auto fnSet = [&](SporkId nSporkID, bool fActive) {
+        mapSporksActive[nSporkID] = CSporkMessage(nSporkID, fActive ? 0 : 4070908800LL, 0);
+    };
+    fnSet(SPORK_114_MN_PAYMENT_V2, fPaymentV2);
+    fnSet(SPORK_112_MASTERNODE_LAST_PAID_V2, fLastPaidV2);
+    fnSet(SPORK_107_IGNORE_COLLATERAL_CONFIRMATIONS, fIgnoreConfirmations);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << mapSporksActive;
+    ss >> sporkManager;
+}
+
+/**
+ * Masternodes in mnodeman with their collateral in pcoinsTip, and blocks on
+ * top of the genesis block paying some of them. The block times are even and
+ * the sigTimes odd, and the queue hashes differ, for no two masternodes to
+ * tie: the old sort left the order of those unspecified.
+ */
+class PaymentNetwork
+{
+public:
+    int64_t nNow;
+    std::vector<CTxIn> vVins;
+    std::vector<CScript> vPayees;
+
+    PaymentNetwork(int64_t nNowIn, int nMasternodes, int nYoung, int nBlocks) : nNow(nNowIn)
+    {
+        SetMockTime(nNow);
+        std::vector<CMasternode> vMasternodes(nMasternodes);
+        std::set<uint32_t> setHashes;
+        for (int i = 0; i < nMasternodes; i++) {
+            CKey key;
+            key.MakeNewKey(true);
+            CMasternode& mn = vMasternodes[i];
+            mn.pubKeyCollateralAddress = key.GetPubKey();
+            mn.addr = LookupNumeric(strprintf("10.%d.%d.1", i / 256, i % 256).c_str(), 12345);
+            // Some too new to be paid, yet pinging for long enough to be enabled, the others from hours to months old
+            mn.sigTime = i < nYoung ? nNow - MASTERNODE_MIN_MNP_SECONDS - 1 - 40 * i : nNow - 60000 * (i + 1) - 1;
+            mn.unitTest = true;
+            do {
+                mn.vin = CTxIn(COutPoint(InsecureRand256(), 0));
+            } while (!setHashes.insert(mn.GetPaymentQueueHash()).second);
+            mn.lastPing.vin = mn.vin;
+            mn.lastPing.blockHash = Params().GetConsensus().hashGenesisBlock;
+            // Some not pinged anymore
+            mn.lastPing.sigTime = IsExpired(i) ? nNow - MASTERNODE_EXPIRATION_SECONDS - 1 : nNow;
+            vVins.push_back(mn.vin);
+            vPayees.push_back(GetScriptForDestination(mn.pubKeyCollateralAddress.GetID()));
+        }
+
+        // Blocks paying a random one of them, or none, before they are known
+        for (int i = 1; i <= nBlocks; i++)
+            AddBlock(i % 5 == 0 ? CScript() : vPayees[InsecureRandRange(nMasternodes)], nNow - 120 * (nBlocks - i));
+
+        LOCK(cs_main);
+        for (CMasternode& mn : vMasternodes) {
+            BOOST_REQUIRE(mnodeman.Add(mn));
+            // Some with fewer confirmations than there are masternodes
+            pcoinsTip->AddCoin(mn.vin.prevout, Coin(CTxOut(10000 * COIN, GetScriptForDestination(mn.pubKeyCollateralAddress.GetID())), 1 + InsecureRandRange(nBlocks), false, false), false);
+        }
+    }
+
+    ~PaymentNetwork()
+    {
+        LOCK(cs_main);
+        mnodeman.Clear();
+        for (const CTxIn& vin : vVins)
+            pcoinsTip->SpendCoin(vin.prevout);
+        chainActive.SetTip(chainActive.Genesis());
+        for (const CBlockIndex& index : indexes)
+            mapBlockIndex.erase(index.GetBlockHash());
+        sporkManager.Clear();
+        SetMockTime(0);
+    }
+
+    // A block at nTime paying payee, the last paid time updated as ConnectBlock does
+    void AddBlock(const CScript& payee, int64_t nTime)
+    {
+        LOCK(cs_main);
+        indexes.emplace_back();
+        CBlockIndex* pindexNew = &indexes.back();
+        pindexNew->pprev = chainActive.Tip();
+        pindexNew->nHeight = chainActive.Height() + 1;
+        pindexNew->nTime = nTime;
+        pindexNew->paidPayee = payee;
+        pindexNew->phashBlock = &mapBlockIndex.emplace(InsecureRand256(), pindexNew).first->first;
+        pindexNew->BuildSkip();
+        chainActive.SetTip(pindexNew);
+        if (!payee.empty())
+            mnodeman.UpdateLastPaid(payee, nTime);
+    }
+
+    // Time goes by, the masternodes still pinging
+    void SetTime(int64_t nNowIn)
+    {
+        nNow = nNowIn;
+        SetMockTime(nNow);
+        for (size_t i = 0; i < vVins.size(); i++) {
+            if (!IsExpired(i))
+                mnodeman.Find(vVins[i])->lastPing.sigTime = nNow;
+        }
+    }
+
+private:
+    std::list<CBlockIndex> indexes;
+
+    static bool IsExpired(size_t i) { return i % 7 == 3; }
+};
+
+// The winner, the eligible masternodes and the count as the old body had them
+void CheckSameAsOld(int nBlockHeight)
+{
+    int nCountOld = 0;
+    std::vector<CTxIn> vEligibleOld;
+    OldNextMasternodeInQueueForPayment(nBlockHeight, true, nCountOld, vEligibleOld, true, true);
+    BOOST_CHECK_EQUAL(mnodeman.GetNextMasternodeInQueueCount(nBlockHeight), nCountOld);
+
+    const std::pair<CMasternode*, std::vector<CTxIn> > next = mnodeman.GetNextMasternodeInQueueEligible(nBlockHeight);
+    CMasternode* pmnOld = OldNextMasternodeInQueueForPayment(nBlockHeight, true, nCountOld, vEligibleOld, false, true);
+    BOOST_CHECK(next.first == pmnOld);
+    BOOST_CHECK(next.second == vEligibleOld);
+}
+
+} // anonymous namespace
+
+BOOST_FIXTURE_TEST_CASE(queue_matches_old_selection, TestingSetup)
+{
+    // V1 and V2 payments and last paid lookups, with and without the collateral confirmations
+    const bool vSporks[][3] = {{false, false, false}, {true, true, false}, {true, true, true}, {true, false, true}};
+    for (const auto& sporks : vSporks) {
+        // Most masternodes old enough, or so many too new that the sigTime filter is dropped
+        for (const int nYoung : {5, 50}) {
+            SetPaymentSporks(sporks[0], sporks[1], sporks[2]);
+            PaymentNetwork network(1650000000, 60, nYoung, 150);
+            const int nTip = chainActive.Height();
+
+            // The next block, the ones ahead that ProcessBlock asks for, and one below the tip
+            CheckSameAsOld(nTip + 1);
+            CheckSameAsOld(nTip + 10);
+            CheckSameAsOld(nTip - 20);
+
+            // Blocks paying the winner as it goes, sometimes days apart for masternodes to cross a month unpaid
+            for (int i = 0; i < 20; i++) {
+                network.SetTime(network.nNow + (i % 5 == 4 ? 10 * DAY_IN_SECONDS : 120));
+                CMasternode* pmn = mnodeman.GetNextMasternodeInQueueForPayment(chainActive.Height() + 1);
+                network.AddBlock(pmn ? GetScriptForDestination(pmn->pubKeyCollateralAddress.GetID()) : CScript(), network.nNow);
+                CheckSameAsOld(chainActive.Height() + 1);
+                CheckSameAsOld(chainActive.Height() + 10);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
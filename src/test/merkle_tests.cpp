@@ -134,4 +134,50 @@ BOOST_AUTO_TEST_CASE(merkle_test)
     }
 }
 
-BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
+BOOST_AUTO_TEST_CASE(merkle_tree_incremental_test)
+{
+    for (int i = 0; i < 24; i++) {
+        // All sizes from 0 to 16 inclusive, then random ones.
+        int ntx = (i <= 16) ? i : 17 + (InsecureRandRange(4000));
+        std::vector<uint256> leaves(ntx);
+        for (int j = 0; j < ntx; j++) {
+            leaves[j] = InsecureRand256();
+        }
+        CBlockMerkleTree tree(leaves);
+        bool mutated = true;
+        BOOST_CHECK(tree.GetLeafCount() == leaves.size());
+        BOOST_CHECK(tree.GetRoot() == ComputeMerkleRoot(leaves, &mutated));
+        BOOST_CHECK(!tree.IsMutated() && !mutated);
+        if (ntx == 0) continue;
+
+        // Replace the coinbase and, when present, the coinstake.
+        for (int loop = 0; loop < 8; loop++) {
+            size_t pos = (ntx > 1) ? (loop & 1) : 0;
+            leaves[pos] = InsecureRand256();
+            tree.UpdateLeaf(pos, leaves[pos]);
+            BOOST_CHECK(tree.GetRoot() == ComputeMerkleRoot(leaves, &mutated));
+            BOOST_CHECK(tree.IsMutated() == mutated);
+        }
+
+        // A duplicated pair is detected, and forgotten once it goes away.
+        if (ntx > 1) {
+            const uint256 old = leaves[1];
+            leaves[1] = leaves[0];
+            tree.UpdateLeaf(1, leaves[1]);
+            BOOST_CHECK(tree.GetRoot() == ComputeMerkleRoot(leaves, &mutated));
+            BOOST_CHECK(tree.IsMutated() && mutated);
+            leaves[1] = old;
+            tree.UpdateLeaf(1, leaves[1]);
+            BOOST_CHECK(tree.GetRoot() == ComputeMerkleRoot(leaves, &mutated));
+            BOOST_CHECK(!tree.IsMutated() && !mutated);
+        }
+
+        // A random leaf, against a full rebuild.
+        size_t pos = InsecureRandRange(ntx);
+        leaves[pos] = InsecureRand256();
+        tree.UpdateLeaf(pos, leaves[pos]);
+        BOOST_CHECK(tree.GetRoot() == CBlockMerkleTree(leaves).GetRoot());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
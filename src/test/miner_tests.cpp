@@ -276,4 +276,26 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     Checkpoints::fEnabled = true;
 }
 
+BOOST_AUTO_TEST_CASE(nonce_ranges_work_stealing)
+{
+    // Every nonce is claimed exactly once, whatever the order of the threads
+    for (int nThreads : {1, 3, 8}) {
+        const uint64_t nEnd = 10 * MINER_NONCE_CHUNK + 7;
+        CNonceRanges ranges(nThreads, nEnd);
+        std::vector<int> vClaimed(nEnd, 0);
+        uint32_t nBegin, nCount;
+        int nThread = 0;
+        // Thread 0 claims twice as often as the others, so it has to steal
+        while (ranges.Claim(nThread, nBegin, nCount)) {
+            BOOST_CHECK(nCount > 0 && nCount <= MINER_NONCE_CHUNK);
+            BOOST_CHECK(nBegin + nCount <= nEnd);
+            for (uint32_t n = nBegin; n < nBegin + nCount; n++) vClaimed[n]++;
+            nThread = (nThread == 0 && InsecureRandBool()) ? 0 : InsecureRandRange(nThreads);
+        }
+        BOOST_CHECK(std::count(vClaimed.begin(), vClaimed.end(), 1) == (int)nEnd);
+        // Exhausted for every thread
+        for (int i = 0; i < nThreads; i++) BOOST_CHECK(!ranges.Claim(i, nBegin, nCount));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
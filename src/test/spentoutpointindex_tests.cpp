@@ -0,0 +1,154 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "spentoutpointindex.h"
+#include "chain.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "test/test_pivx.h"
+
+#include <list>
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(spentoutpointindex_tests, BasicTestingSetup)
+
+/** A main chain and a fork of it, each block spending a few random outpoints */
+class ForkSetup
+{
+public:
+    CChain chain;
+    std::map<const CBlockIndex*, CBlock> mapBlocks;
+    std::vector<COutPoint> vSpent;
+    CBlockIndex* pindexFork{nullptr};
+
+    ForkSetup(int nHeight, int nForkHeight, int nForkLength)
+    {
+        CBlockIndex* pindex = AddBlock(nullptr);
+        for (int i = 1; i <= nHeight; i++)
+            pindex = AddBlock(pindex);
+        chain.SetTip(pindex);
+        pindexFork = chain[nForkHeight];
+        for (int i = 0; i < nForkLength; i++)
+            pindexFork = AddBlock(pindexFork);
+    }
+
+    // The fork walk as it was before the index, over the transactions of every block
+    CSpentOutpointIndex::ForkSpend ReferenceCheckFork(const CBlockIndex* pindexPrev, const std::vector<COutPoint>& vPrevouts, int nMaxReorg) const
+    {
+        int readBlock = 0;
+        for (const CBlockIndex* prev = pindexPrev; !chain.Contains(prev); prev = prev->pprev) {
+            readBlock++;
+            if (readBlock == nMaxReorg)
+                return CSpentOutpointIndex::FORK_TOO_DEEP;
+            for (const CTransaction& t : mapBlocks.at(prev).vtx)
+                for (const CTxIn& in : t.vin)
+                    for (const COutPoint& prevout : vPrevouts)
+                        if (prevout == in.prevout)
+                            return CSpentOutpointIndex::FORK_SPENT;
+        }
+        return CSpentOutpointIndex::FORK_NOT_SPENT;
+    }
+
+    bool Read(const CBlockIndex* pindex, std::shared_ptr<const CBlock>& pblock) const
+    {
+        auto it = mapBlocks.find(pindex);
+        if (it == mapBlocks.end()) return false;
+        pblock = std::make_shared<const CBlock>(it->second);
+        return true;
+    }
+
+private:
+    std::list<CBlockIndex> indexes;
+
+    CBlockIndex* AddBlock(CBlockIndex* pprev)
+    {
+        indexes.emplace_back();
+        CBlockIndex* pindex = &indexes.back();
+        pindex->pprev = pprev;
+        pindex->nHeight = pprev ? pprev->nHeight + 1 : 0;
+        CBlock& block = mapBlocks[pindex];
+        CMutableTransaction coinbase;
+        coinbase.vin.resize(1);
+        block.vtx.emplace_back(coinbase);
+        for (int i = 0; i < 3; i++) {
+            CMutableTransaction tx;
+            for (int j = 0; j < 2; j++) {
+                tx.vin.emplace_back(GetRandHash(), InsecureRandRange(4));
+                vSpent.push_back(tx.vin.back().prevout);
+            }
+            block.vtx.emplace_back(tx);
+        }
+        return pindex;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(spentoutpointindex_verdicts)
+{
+    ForkSetup setup(30, 20, 8);
+    CSpentOutpointIndex index;
+    auto fnRead = [&](const CBlockIndex* pindex, std::shared_ptr<const CBlock>& pblock) { return setup.Read(pindex, pblock); };
+
+    // Outpoints spent on the fork, on the main chain and nowhere, from every block of the fork
+    for (int nRound = 0; nRound < 200; nRound++) {
+        std::vector<COutPoint> vPrevouts;
+        for (int i = InsecureRandRange(3); i > 0; i--)
+            vPrevouts.push_back(setup.vSpent[InsecureRandRange(setup.vSpent.size())]);
+        if (InsecureRandBool())
+            vPrevouts.emplace_back(GetRandHash(), 0);
+        const CBlockIndex* pindexPrev = setup.pindexFork->GetAncestor(20 + InsecureRandRange(9));
+        const int nMaxReorg = 2 + InsecureRandRange(10);
+
+        int nDepth = 0;
+        int nReads = 0;
+        BOOST_CHECK_EQUAL(index.CheckFork(pindexPrev, setup.chain, vPrevouts, nMaxReorg, fnRead, nDepth, nReads),
+            setup.ReferenceCheckFork(pindexPrev, vPrevouts, nMaxReorg));
+    }
+
+    // Every fork block was read once at most, then looked up in the index
+    BOOST_CHECK(index.size() <= 8);
+    int nDepth = 0;
+    int nReads = 0;
+    const std::vector<COutPoint> vNone = {COutPoint(GetRandHash(), 0)};
+    BOOST_CHECK_EQUAL(index.CheckFork(setup.pindexFork, setup.chain, vNone, 100, fnRead, nDepth, nReads), CSpentOutpointIndex::FORK_NOT_SPENT);
+    BOOST_CHECK_EQUAL(nDepth, 8);
+    BOOST_CHECK_EQUAL(index.size(), 8U);
+    BOOST_CHECK_EQUAL(index.CheckFork(setup.pindexFork, setup.chain, vNone, 100, fnRead, nDepth, nReads), CSpentOutpointIndex::FORK_NOT_SPENT);
+    BOOST_CHECK_EQUAL(nReads, 0);
+
+    // A block that can't be read
+    CSpentOutpointIndex indexEmpty;
+    auto fnFail = [](const CBlockIndex*, std::shared_ptr<const CBlock>&) { return false; };
+    BOOST_CHECK_EQUAL(indexEmpty.CheckFork(setup.pindexFork, setup.chain, vNone, 100, fnFail, nDepth, nReads), CSpentOutpointIndex::FORK_NOT_ON_DISK);
+    BOOST_CHECK_EQUAL(nDepth, 1);
+}
+
+BOOST_AUTO_TEST_CASE(spentoutpointindex_prune)
+{
+    ForkSetup setup(30, 20, 8);
+    CSpentOutpointIndex index;
+    for (const auto& entry : setup.mapBlocks)
+        index.Add(entry.first, entry.second);
+    BOOST_CHECK_EQUAL(index.size(), setup.mapBlocks.size());
+
+    // Indexed once
+    index.Add(setup.chain.Tip(), setup.mapBlocks.at(setup.chain.Tip()));
+    BOOST_CHECK_EQUAL(index.size(), setup.mapBlocks.size());
+
+    // Main chain heights 25 to 30 and fork heights 25 to 28 are left
+    index.Prune(25);
+    BOOST_CHECK_EQUAL(index.size(), 10U);
+    BOOST_CHECK(!index.Get(setup.chain[24]));
+    BOOST_CHECK(index.Get(setup.chain[25]));
+    BOOST_CHECK(index.Get(setup.pindexFork));
+    BOOST_CHECK(index.Get(setup.chain[25])->count(setup.mapBlocks.at(setup.chain[25]).vtx[1].vin[0].prevout));
+    // The coinbase spends nothing
+    BOOST_CHECK(!index.Get(setup.chain[25])->count(COutPoint()));
+
+    index.Prune(100);
+    BOOST_CHECK_EQUAL(index.size(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
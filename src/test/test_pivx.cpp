@@ -8,6 +8,8 @@
 
 #include "test_pivx.h"
 
+#include "crypto/sha256.h"
+#include "crypto/sph_x4.h"
 #include "main.h"
 #include "random.h"
 #include "script/sigcache.h"
@@ -28,6 +30,8 @@ extern void noui_connect();
 
 BasicTestingSetup::BasicTestingSetup()
 {
+        SHA256AutoDetect();
+        SphX4AutoDetect();
         RandomInit();
         ECC_Start();
         SetupEnvironment();
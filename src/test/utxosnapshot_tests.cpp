@@ -0,0 +1,286 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "utxosnapshot.h"
+#include "checkpoints.h"
+#include "hash.h"
+#include "main.h"
+#include "streams.h"
+#include "txdb.h"
+#include "test/test_pivx.h"
+
+#include <list>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(utxosnapshot_tests, TestingSetup)
+
+/** Block index entries on top of the genesis block, made the active chain with coins at its tip */
+class SnapshotChain
+{
+public:
+    std::vector<std::pair<COutPoint, Coin> > vCoins;
+
+    SnapshotChain(int nHeight, int nTxs)
+    {
+        LOCK(cs_main);
+        CBlockIndex* pindex = chainActive.Genesis();
+        for (int i = 1; i <= nHeight; i++) {
+            indexes.emplace_back();
+            CBlockIndex* pindexNew = &indexes.back();
+            pindexNew->pprev = pindex;
+            pindexNew->nHeight = i;
+            pindexNew->nTx = 1;
+            pindexNew->nTime = pindex->nTime + 60;
+            pindexNew->nStatus = BLOCK_VALID_SCRIPTS;
+            pindexNew->paidPayee = CScript() << OP_DUP << OP_HASH160 << ToByteVector(InsecureRand256()) << OP_EQUALVERIFY;
+            pindexNew->phashBlock = &mapBlockIndex.emplace(InsecureRand256(), pindexNew).first->first;
+            pindexNew->BuildSkip();
+            pindex = pindexNew;
+        }
+        chainActive.SetTip(pindex);
+
+        // Some transactions with a few unspent outputs each
+        for (int i = 0; i < nTxs; i++) {
+            const uint256 txid = InsecureRand256();
+            const uint32_t nOutputs = 1 + InsecureRandRange(3);
+            for (uint32_t n = 0; n < nOutputs; n++) {
+                CScript script = CScript() << OP_DUP << OP_HASH160 << ToByteVector(InsecureRand256()) << OP_EQUALVERIFY << OP_CHECKSIG;
+                vCoins.emplace_back(COutPoint(txid, n * 2), Coin(CTxOut(1 + InsecureRandRange(COIN), script), 1 + InsecureRandRange(nHeight), false, false));
+                pcoinsTip->AddCoin(vCoins.back().first, Coin(vCoins.back().second), false);
+            }
+        }
+        pcoinsTip->SetBestBlock(pindex->GetBlockHash());
+    }
+
+    ~SnapshotChain()
+    {
+        LOCK(cs_main);
+        for (const auto& coin : vCoins)
+            pcoinsTip->SpendCoin(coin.first);
+        pcoinsTip->SetBestBlock(chainActive.Genesis()->GetBlockHash());
+        pcoinsTip->Flush();
+        chainActive.SetTip(chainActive.Genesis());
+        for (const CBlockIndex& index : indexes)
+            mapBlockIndex.erase(index.GetBlockHash());
+    }
+
+    const CBlockIndex* Tip() const { return &indexes.back(); }
+
+private:
+    std::list<CBlockIndex> indexes;
+};
+
+/** The contents of a snapshot file, to be written again altered */
+struct SnapshotContents {
+    CUTXOSnapshotHeader header;
+    std::vector<std::pair<uint256, CDiskBlockIndex> > vIndex;
+    std::vector<std::pair<uint256, std::vector<std::pair<uint32_t, Coin> > > > vTxs;
+
+    void Read(const fs::path& path)
+    {
+        CAutoFile filein(fsbridge::fopen(path, "rb"), SER_DISK, DBI_SER_VERSION_NO_MS);
+        filein >> header;
+        vIndex.resize(header.nHeight + 1);
+        for (auto& entry : vIndex)
+            filein >> entry.first >> entry.second;
+        for (uint64_t nCoins = 0; nCoins < header.nCoins;) {
+            uint256 txid;
+            uint64_t nOutputs = 0;
+            filein >> txid >> VARINT(nOutputs);
+            vTxs.emplace_back(txid, std::vector<std::pair<uint32_t, Coin> >(nOutputs));
+            for (auto& output : vTxs.back().second)
+                filein >> VARINT(output.first) >> output.second;
+            nCoins += nOutputs;
+        }
+    }
+
+    //! Write it to path with a hash matching its contents, which is returned
+    uint256 Write(const fs::path& path)
+    {
+        CAutoFile fileout(fsbridge::fopen(path, "wb"), SER_DISK, DBI_SER_VERSION_NO_MS);
+        CHashWriter hasher(SER_DISK, DBI_SER_VERSION_NO_MS);
+        for (const auto& entry : vIndex)
+            hasher << entry.first << entry.second;
+        for (const auto& tx : vTxs) {
+            uint64_t nOutputs = tx.second.size();
+            hasher << tx.first << VARINT(nOutputs);
+            for (const auto& output : tx.second)
+                hasher << VARINT(output.first) << output.second;
+        }
+        hasher << FLATDATA(header.pchMessageStart) << header.nVersion << header.hashBlock << header.nHeight << header.nPayeeWindow << header.nCoins;
+        header.hashContent = hasher.GetHash();
+
+        fileout << header;
+        for (const auto& entry : vIndex)
+            fileout << entry.first << entry.second;
+        for (const auto& tx : vTxs) {
+            uint64_t nOutputs = tx.second.size();
+            fileout << tx.first << VARINT(nOutputs);
+            for (const auto& output : tx.second)
+                fileout << VARINT(output.first) << output.second;
+        }
+        return header.hashContent;
+    }
+};
+
+/** Load the snapshot at path into an empty chainstate, returning the error if it fails */
+static std::string LoadSnapshot(const fs::path& path, const uint256& hashExpected)
+{
+    CCoinsViewDB coinsdb(1 << 20, true);
+    std::string strError;
+    if (LoadUTXOSnapshot(path, hashExpected, coinsdb, strError))
+        return "";
+    // Nothing was made the chainstate
+    BOOST_CHECK(coinsdb.GetBestBlock().IsNull());
+    BOOST_CHECK(!strError.empty());
+    return strError;
+}
+
+BOOST_AUTO_TEST_CASE(utxosnapshot_roundtrip)
+{
+    // Longer than the window of the paid payees
+    SnapshotChain chain(MIN_BLOCKS_TO_KEEP + 20, 50);
+    const fs::path path = GetDataDir() / "utxo.dat";
+    CUTXOSnapshotHeader header;
+    std::string strError;
+    BOOST_CHECK_MESSAGE(DumpUTXOSnapshot(path, header, strError), strError);
+    BOOST_CHECK(header.hashBlock == chain.Tip()->GetBlockHash());
+    BOOST_CHECK_EQUAL(header.nHeight, chain.Tip()->nHeight);
+    BOOST_CHECK_EQUAL(header.nCoins, chain.vCoins.size());
+    BOOST_CHECK_EQUAL(header.nVersion, UTXO_SNAPSHOT_VERSION);
+    // No masternodes, the least window
+    BOOST_CHECK_EQUAL(header.nPayeeWindow, (int)MIN_BLOCKS_TO_KEEP);
+
+    // Not written over
+    CUTXOSnapshotHeader header2;
+    BOOST_CHECK(!DumpUTXOSnapshot(path, header2, strError));
+
+    // The same chainstate hashes the same
+    const fs::path path2 = GetDataDir() / "utxo2.dat";
+    BOOST_CHECK_MESSAGE(DumpUTXOSnapshot(path2, header2, strError), strError);
+    BOOST_CHECK(header2.hashContent == header.hashContent);
+
+    // Only the entries of the last nPayeeWindow blocks carry their payee
+    SnapshotContents contents;
+    contents.Read(path);
+    for (const auto& entry : contents.vIndex) {
+        const int nDepth = header.nHeight - entry.second.nHeight;
+        BOOST_CHECK_EQUAL((bool)entry.second.paidPayee, entry.second.nHeight > 0 && nDepth < header.nPayeeWindow);
+        BOOST_CHECK_EQUAL(entry.second.nStatus & ~BLOCK_VALID_MASK, BLOCK_SNAPSHOT);
+    }
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(*contents.vIndex.back().second.paidPayee == *chain.Tip()->paidPayee);
+    }
+    // Written again as read, it hashes the same
+    BOOST_CHECK(contents.Write(GetDataDir() / "utxo3.dat") == header.hashContent);
+
+    // A hash that doesn't match, or no hash known for the block
+    BOOST_CHECK_EQUAL(LoadSnapshot(path, InsecureRand256()).find("snapshot hash"), 0U);
+    BOOST_CHECK_EQUAL(LoadSnapshot(path, UINT256_ZERO).find("no known hash"), 0U);
+
+    // Loaded, the coins and the block index are those of the chain
+    CCoinsViewDB coinsdb(1 << 20, true);
+    BOOST_CHECK_MESSAGE(LoadUTXOSnapshot(path, header.hashContent, coinsdb, strError), strError);
+    BOOST_CHECK(coinsdb.GetBestBlock() == header.hashBlock);
+    BOOST_CHECK(!IsUTXOSnapshotImportPending(coinsdb));
+    for (const auto& coin : chain.vCoins) {
+        Coin coinRead;
+        BOOST_CHECK(coinsdb.GetCoin(coin.first, coinRead));
+        BOOST_CHECK(coinRead.out == coin.second.out);
+        BOOST_CHECK_EQUAL(coinRead.nHeight, coin.second.nHeight);
+    }
+    for (const auto& entry : contents.vIndex) {
+        CDiskBlockIndex diskindex;
+        BOOST_CHECK(pblocktree->Read(std::make_pair('b', entry.first), diskindex));
+        BOOST_CHECK_EQUAL(diskindex.nHeight, entry.second.nHeight);
+        BOOST_CHECK(diskindex.hashPrev == entry.second.hashPrev);
+        BOOST_CHECK(diskindex.paidPayee == entry.second.paidPayee);
+    }
+
+    // Not over an existing chainstate
+    BOOST_CHECK(!LoadUTXOSnapshot(path, header.hashContent, coinsdb, strError));
+    BOOST_CHECK_EQUAL(strError, "the chainstate is not empty");
+}
+
+BOOST_AUTO_TEST_CASE(utxosnapshot_tampered)
+{
+    SnapshotChain chain(MIN_BLOCKS_TO_KEEP + 20, 20);
+    const fs::path path = GetDataDir() / "utxo.dat";
+    CUTXOSnapshotHeader header;
+    std::string strError;
+    BOOST_CHECK_MESSAGE(DumpUTXOSnapshot(path, header, strError), strError);
+
+    // A coin changed after the hash was taken
+    std::vector<unsigned char> vData(fs::file_size(path));
+    {
+        FILE* file = fsbridge::fopen(path, "rb");
+        BOOST_CHECK_EQUAL(fread(vData.data(), 1, vData.size(), file), vData.size());
+        fclose(file);
+    }
+    vData.back() ^= 1;
+    const fs::path pathCoin = GetDataDir() / "utxo_coin.dat";
+    {
+        FILE* file = fsbridge::fopen(pathCoin, "wb");
+        fwrite(vData.data(), 1, vData.size(), file);
+        fclose(file);
+    }
+    BOOST_CHECK_EQUAL(LoadSnapshot(pathCoin, header.hashContent), "the snapshot content does not match its hash");
+
+    // Trailing data
+    vData.back() ^= 1;
+    vData.push_back(0);
+    {
+        FILE* file = fsbridge::fopen(pathCoin, "wb");
+        fwrite(vData.data(), 1, vData.size(), file);
+        fclose(file);
+    }
+    BOOST_CHECK_EQUAL(LoadSnapshot(pathCoin, header.hashContent), "unexpected data at the end of the snapshot");
+
+    // Block index entries that don't pass the checks, even with a hash of their own
+    SnapshotContents contents;
+    contents.Read(path);
+    const int nLast = header.nHeight;
+    const int nOld = nLast - header.nPayeeWindow;
+    auto fnAltered = [&](const std::function<void(SnapshotContents&)>& fnAlter) {
+        SnapshotContents altered = contents;
+        fnAlter(altered);
+        const fs::path pathAltered = GetDataDir() / "utxo_altered.dat";
+        const uint256 hash = altered.Write(pathAltered);
+        return LoadSnapshot(pathAltered, hash);
+    };
+    auto badEntry = [&](int nHeight) { return strprintf("bad block index entry %s", contents.vIndex[nHeight].first.GetHex()); };
+
+    // Unaltered, it loads
+    BOOST_CHECK_EQUAL(fnAltered([](SnapshotContents&) {}), "");
+    // Not the genesis block
+    const uint256 hashBad = InsecureRand256();
+    BOOST_CHECK_EQUAL(fnAltered([&](SnapshotContents& c) { c.vIndex[0].first = hashBad; }),
+        strprintf("bad block index entry %s", hashBad.GetHex()));
+    // Not linked to the previous entry
+    BOOST_CHECK_EQUAL(fnAltered([](SnapshotContents& c) { c.vIndex[10].second.hashPrev = InsecureRand256(); }), badEntry(10));
+    // Out of order
+    BOOST_CHECK_EQUAL(fnAltered([](SnapshotContents& c) { c.vIndex[10].second.nHeight = 11; }), badEntry(10));
+    // With block data, or without the snapshot mark
+    BOOST_CHECK_EQUAL(fnAltered([](SnapshotContents& c) { c.vIndex[10].second.nStatus |= BLOCK_HAVE_UNDO; }), badEntry(10));
+    BOOST_CHECK_EQUAL(fnAltered([](SnapshotContents& c) { c.vIndex[10].second.nStatus &= ~BLOCK_SNAPSHOT; }), badEntry(10));
+    // Not fully validated, or without transactions
+    BOOST_CHECK_EQUAL(fnAltered([](SnapshotContents& c) { c.vIndex[10].second.nStatus = BLOCK_VALID_TREE | BLOCK_SNAPSHOT; }), badEntry(10));
+    BOOST_CHECK_EQUAL(fnAltered([](SnapshotContents& c) { c.vIndex[10].second.nTx = 0; }), badEntry(10));
+    // A payee missing in the window, or one outside of it
+    BOOST_CHECK_EQUAL(fnAltered([&](SnapshotContents& c) { c.vIndex[nLast].second.paidPayee = nullopt; }), badEntry(nLast));
+    BOOST_CHECK_EQUAL(fnAltered([&](SnapshotContents& c) { c.vIndex[nOld].second.paidPayee = CScript() << OP_TRUE; }), badEntry(nOld));
+    // A window wider than the payees written, or too short for the last paid lookups
+    BOOST_CHECK_EQUAL(fnAltered([](SnapshotContents& c) { c.header.nPayeeWindow += 10; }), badEntry(nOld - 9));
+    BOOST_CHECK_EQUAL(fnAltered([](SnapshotContents& c) { c.header.nPayeeWindow = 100; }), "payee window of 100 blocks is too short");
+    // Entries that don't lead to the snapshot block
+    BOOST_CHECK_EQUAL(fnAltered([](SnapshotContents& c) { c.header.hashBlock = InsecureRand256(); }),
+        "the block index entries do not lead to the snapshot block");
+    // A transaction with no outputs
+    BOOST_CHECK_EQUAL(fnAltered([&](SnapshotContents& c) { c.vTxs[0].second.clear(); c.header.nCoins -= contents.vTxs[0].second.size(); }),
+        strprintf("bad output count for transaction %s", contents.vTxs[0].first.GetHex()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -100,6 +100,16 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
     return ret;
 }
 
+bool CCoinsViewDB::WriteCoins(const std::vector<std::pair<COutPoint, Coin> >& vCoins, const uint256& hashBlock)
+{
+    CDBBatch batch;
+    for (const std::pair<COutPoint, Coin>& item : vCoins)
+        batch.Write(CoinEntry(&item.first), item.second);
+    if (!hashBlock.IsNull())
+        batch.Write(DB_BEST_BLOCK, hashBlock);
+    return db.WriteBatch(batch, !hashBlock.IsNull());
+}
+
 size_t CCoinsViewDB::EstimateSize() const
 {
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
@@ -114,6 +124,14 @@ bool CBlockTreeDB::WriteBlockIndex(const CDiskBlockIndex& blockindex)
     return Write(std::make_pair(DB_BLOCK_INDEX, blockindex.GetBlockHash()), blockindex);
 }
 
+bool CBlockTreeDB::WriteBlockIndexes(const std::vector<std::pair<uint256, CDiskBlockIndex> >& list, bool fSync)
+{
+    CDBBatch batch;
+    for (const std::pair<uint256, CDiskBlockIndex>& item : list)
+        batch.Write(std::make_pair(DB_BLOCK_INDEX, item.first), item.second);
+    return WriteBatch(batch, fSync);
+}
+
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo& info)
 {
     return Read(std::make_pair(DB_BLOCK_FILES, nFile), info);
@@ -289,6 +307,7 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
                 // }
 
                 pindexNew->nMoneySupply = diskindex.nMoneySupply;
+                pindexNew->paidPayee = diskindex.paidPayee;
 
                 pcursor->Next();
             } else {
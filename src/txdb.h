@@ -77,6 +77,8 @@ public:
     uint256 GetBestBlock() const override;
     bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock) override;
     CCoinsViewCursor* Cursor() const override;
+    //! Write coins directly to the database, setting the best block and syncing if hashBlock is not null
+    bool WriteCoins(const std::vector<std::pair<COutPoint, Coin> >& vCoins, const uint256& hashBlock);
 
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
@@ -117,6 +119,7 @@ private:
 
 public:
     bool WriteBlockIndex(const CDiskBlockIndex& blockindex);
+    bool WriteBlockIndexes(const std::vector<std::pair<uint256, CDiskBlockIndex> >& list, bool fSync);
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
     bool EraseBatchSync(const std::vector<const CBlockIndex*>& blockinfo);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo& fileinfo);
@@ -0,0 +1,399 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "utxosnapshot.h"
+
+#include "chainparams.h"
+#include "checkpoints.h"
+#include "hash.h"
+#include "init.h"
+#include "main.h"
+#include "masternodeman.h"
+#include "streams.h"
+#include "txdb.h"
+#include "util.h"
+
+#include <functional>
+#include <memory>
+
+#include <boost/thread.hpp>
+
+/** Block index entries copied at once under cs_main while a snapshot is written */
+static const size_t DUMP_INDEX_CHUNK = 1000;
+/** Serialization version of the snapshot content, so that its hash doesn't depend on the client version */
+static const int SNAPSHOT_SER_VERSION = DBI_SER_VERSION_NO_MS;
+
+CUTXOSnapshotHeader::CUTXOSnapshotHeader()
+{
+    memcpy(pchMagic, "utxo", sizeof(pchMagic));
+    memcpy(pchMessageStart, Params().MessageStart(), sizeof(pchMessageStart));
+    nVersion = UTXO_SNAPSHOT_VERSION;
+    nHeight = 0;
+    nPayeeWindow = MIN_BLOCKS_TO_KEEP;
+    nCoins = 0;
+}
+
+//! Serialize obj to the file and to the content hash
+template <typename T>
+static void WriteContent(CAutoFile& fileout, CHashWriter& hasher, const T& obj)
+{
+    fileout << obj;
+    hasher << obj;
+}
+
+template <typename T>
+static void ReadContent(CAutoFile& filein, CHashWriter& hasher, T& obj)
+{
+    filein >> obj;
+    hasher << obj;
+}
+
+/**
+ * Whether the block index entry at nHeight carries its paid payee in the snapshot
+ * of header. Older entries are left without it, not being migrated on every node.
+ */
+static bool HasSnapshotPayee(int nHeight, const CUTXOSnapshotHeader& header)
+{
+    return nHeight > 0 && header.nHeight - nHeight < header.nPayeeWindow;
+}
+
+/**
+ * Blocks whose payee a snapshot carries: as many as the last paid lookup walks back
+ * over, in whole multiples of MIN_BLOCKS_TO_KEEP so that nodes whose masternode
+ * lists differ by a few entries still write the same content.
+ */
+static int GetSnapshotPayeeWindow()
+{
+    const int nBlocks = (int)MIN_BLOCKS_TO_KEEP;
+    return (mnodeman.CountEnabled() * 2 / nBlocks + 1) * nBlocks;
+}
+
+static uint256 GetContentHash(CHashWriter& hasher, const CUTXOSnapshotHeader& header)
+{
+    hasher << FLATDATA(header.pchMessageStart) << header.nVersion << header.hashBlock << header.nHeight << header.nPayeeWindow << header.nCoins;
+    return hasher.GetHash();
+}
+
+bool DumpUTXOSnapshot(const fs::path& path, CUTXOSnapshotHeader& header, std::string& strError)
+{
+    if (fs::exists(path)) {
+        strError = strprintf("%s already exists", path.string());
+        return false;
+    }
+
+    // The payees of the last blocks are part of the content, for it to hash the same on every node
+    header.nPayeeWindow = GetSnapshotPayeeWindow();
+    MigratePaidPayees(header.nPayeeWindow);
+    // The cursor reads the database as of its creation, which matches the tip as long as cs_main is held
+    FlushStateToDisk();
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    std::vector<const CBlockIndex*> vIndex;
+    {
+        LOCK(cs_main);
+        pcursor.reset(pcoinsTip->Cursor());
+        BlockMap::iterator mi = mapBlockIndex.find(pcursor->GetBestBlock());
+        if (mi == mapBlockIndex.end()) {
+            strError = "the best block of the chainstate is not in the block index";
+            return false;
+        }
+        vIndex.resize(mi->second->nHeight + 1);
+        for (const CBlockIndex* pindex = mi->second; pindex; pindex = pindex->pprev)
+            vIndex[pindex->nHeight] = pindex;
+    }
+    header.hashBlock = vIndex.back()->GetBlockHash();
+    header.nHeight = vIndex.size() - 1;
+    header.nCoins = 0;
+
+    const fs::path pathTemp = path.string() + ".incomplete";
+    CAutoFile fileout(fsbridge::fopen(pathTemp, "wb"), SER_DISK, SNAPSHOT_SER_VERSION);
+    if (fileout.IsNull()) {
+        strError = strprintf("unable to open %s", pathTemp.string());
+        return false;
+    }
+
+    CHashWriter hasher(SER_DISK, SNAPSHOT_SER_VERSION);
+    try {
+        // Written again once nCoins and hashContent are known
+        fileout << header;
+
+        std::vector<CDiskBlockIndex> vChunk;
+        for (size_t nStart = 0; nStart < vIndex.size(); nStart += DUMP_INDEX_CHUNK) {
+            vChunk.clear();
+            {
+                LOCK(cs_main);
+                for (size_t i = nStart; i < std::min(nStart + DUMP_INDEX_CHUNK, vIndex.size()); i++)
+                    vChunk.emplace_back(vIndex[i]);
+            }
+            for (CDiskBlockIndex& diskindex : vChunk) {
+                diskindex.nStatus = (diskindex.nStatus & BLOCK_VALID_MASK) | BLOCK_SNAPSHOT;
+                diskindex.nFile = 0;
+                diskindex.nDataPos = 0;
+                diskindex.nUndoPos = 0;
+                if (!HasSnapshotPayee(diskindex.nHeight, header))
+                    diskindex.paidPayee = nullopt;
+                else if (!diskindex.paidPayee)
+                    throw std::runtime_error(strprintf("the paid payee of block %s is not known", vIndex[diskindex.nHeight]->GetBlockHash().GetHex()));
+                WriteContent(fileout, hasher, vIndex[diskindex.nHeight]->GetBlockHash());
+                WriteContent(fileout, hasher, diskindex);
+            }
+        }
+
+        uint256 txid;
+        std::vector<std::pair<uint32_t, Coin> > vOutputs;
+        auto writeOutputs = [&]() {
+            uint64_t nOutputs = vOutputs.size();
+            WriteContent(fileout, hasher, txid);
+            WriteContent(fileout, hasher, VARINT(nOutputs));
+            for (const std::pair<uint32_t, Coin>& output : vOutputs) {
+                WriteContent(fileout, hasher, VARINT(output.first));
+                WriteContent(fileout, hasher, output.second);
+            }
+            header.nCoins += vOutputs.size();
+            vOutputs.clear();
+        };
+        while (pcursor->Valid()) {
+            boost::this_thread::interruption_point();
+            COutPoint key;
+            Coin coin;
+            if (!pcursor->GetKey(key) || !pcursor->GetValue(coin))
+                throw std::runtime_error("unable to read the chainstate");
+            if (!vOutputs.empty() && key.hash != txid)
+                writeOutputs();
+            txid = key.hash;
+            vOutputs.emplace_back(key.n, std::move(coin));
+            pcursor->Next();
+        }
+        if (!vOutputs.empty())
+            writeOutputs();
+
+        header.hashContent = GetContentHash(hasher, header);
+        if (fseek(fileout.Get(), 0, SEEK_SET) != 0)
+            throw std::runtime_error("unable to rewind the snapshot file");
+        fileout << header;
+        FileCommit(fileout.Get());
+    } catch (const std::exception& e) {
+        fileout.fclose();
+        fs::remove(pathTemp);
+        strError = strprintf("failed to write the snapshot: %s", e.what());
+        return false;
+    }
+    fileout.fclose();
+
+    if (!RenameOver(pathTemp, path)) {
+        strError = strprintf("unable to rename %s", pathTemp.string());
+        return false;
+    }
+    LogPrintf("%s: wrote %u coins at block %s (height %d) to %s, hash %s\n", __func__,
+        header.nCoins, header.hashBlock.GetHex(), header.nHeight, path.string(), header.hashContent.GetHex());
+    return true;
+}
+
+/**
+ * Read what follows the header, adding it to hasher and handing every block
+ * index entry, from the genesis block on, then every coin to the callbacks.
+ */
+static bool ReadContents(CAutoFile& filein, const CUTXOSnapshotHeader& header, CHashWriter& hasher,
+    const std::function<bool(const uint256&, CDiskBlockIndex&)>& fnIndex,
+    const std::function<bool(const COutPoint&, Coin&&)>& fnCoin, std::string& strError)
+{
+    try {
+        for (int nHeight = 0; nHeight <= header.nHeight; nHeight++) {
+            uint256 hash;
+            CDiskBlockIndex diskindex;
+            ReadContent(filein, hasher, hash);
+            ReadContent(filein, hasher, diskindex);
+            if (!fnIndex(hash, diskindex))
+                return false;
+        }
+
+        uint64_t nCoins = 0;
+        while (nCoins < header.nCoins) {
+            uint256 txid;
+            uint64_t nOutputs = 0;
+            ReadContent(filein, hasher, txid);
+            ReadContent(filein, hasher, VARINT(nOutputs));
+            if (nOutputs == 0 || nOutputs > header.nCoins - nCoins) {
+                strError = strprintf("bad output count for transaction %s", txid.GetHex());
+                return false;
+            }
+            for (uint64_t i = 0; i < nOutputs; i++) {
+                uint32_t n = 0;
+                Coin coin;
+                ReadContent(filein, hasher, VARINT(n));
+                ReadContent(filein, hasher, coin);
+                if (!fnCoin(COutPoint(txid, n), std::move(coin)))
+                    return false;
+            }
+            nCoins += nOutputs;
+        }
+    } catch (const std::exception& e) {
+        strError = strprintf("failed to read the snapshot: %s", e.what());
+        return false;
+    }
+    if (fgetc(filein.Get()) != EOF) {
+        strError = "unexpected data at the end of the snapshot";
+        return false;
+    }
+    return true;
+}
+
+bool IsUTXOSnapshotImportPending(const CCoinsViewDB& coinsdb)
+{
+    bool fPending = false;
+    return pblocktree->ReadFlag("utxosnapshotimport", fPending) && fPending && coinsdb.GetBestBlock().IsNull();
+}
+
+bool LoadUTXOSnapshot(const fs::path& path, const uint256& hashExpected, CCoinsViewDB& coinsdb, std::string& strError)
+{
+    const Consensus::Params& consensus = Params().GetConsensus();
+    if (!coinsdb.GetBestBlock().IsNull()) {
+        strError = "the chainstate is not empty";
+        return false;
+    }
+
+    CAutoFile filein(fsbridge::fopen(path, "rb"), SER_DISK, SNAPSHOT_SER_VERSION);
+    if (filein.IsNull()) {
+        strError = strprintf("unable to open %s", path.string());
+        return false;
+    }
+    CUTXOSnapshotHeader header;
+    const CUTXOSnapshotHeader headerExpected;
+    try {
+        filein >> header;
+    } catch (const std::exception& e) {
+        strError = strprintf("failed to read the snapshot header: %s", e.what());
+        return false;
+    }
+    if (memcmp(header.pchMagic, headerExpected.pchMagic, sizeof(header.pchMagic)) != 0 ||
+        memcmp(header.pchMessageStart, headerExpected.pchMessageStart, sizeof(header.pchMessageStart)) != 0) {
+        strError = "not a UTXO snapshot of this network";
+        return false;
+    }
+    if (header.nVersion != UTXO_SNAPSHOT_VERSION || header.nHeight < 0) {
+        strError = strprintf("unsupported snapshot version %u", header.nVersion);
+        return false;
+    }
+    if (header.nPayeeWindow < (int)MIN_BLOCKS_TO_KEEP) {
+        strError = strprintf("payee window of %d blocks is too short", header.nPayeeWindow);
+        return false;
+    }
+
+    uint256 hashCheck = hashExpected;
+    if (hashCheck.IsNull()) {
+        std::map<uint256, uint256>::const_iterator it = consensus.mUTXOSnapshots.find(header.hashBlock);
+        if (it == consensus.mUTXOSnapshots.end()) {
+            strError = strprintf("no known hash for a snapshot at block %s, use -utxosnapshothash", header.hashBlock.GetHex());
+            return false;
+        }
+        hashCheck = it->second;
+    }
+    if (header.hashContent != hashCheck) {
+        strError = strprintf("snapshot hash %s does not match %s", header.hashContent.GetHex(), hashCheck.GetHex());
+        return false;
+    }
+
+    // Check it all before anything is written
+    LogPrintf("%s: checking the snapshot of block %s (height %d, %u coins)\n", __func__, header.hashBlock.GetHex(), header.nHeight, header.nCoins);
+    uint256 hashPrev;
+    int nHeight = 0;
+    auto fnCheckIndex = [&](const uint256& hash, CDiskBlockIndex& diskindex) {
+        if (diskindex.nHeight != nHeight || diskindex.hashPrev != hashPrev ||
+            (nHeight == 0 && hash != consensus.hashGenesisBlock) ||
+            (diskindex.nStatus & ~BLOCK_VALID_MASK) != BLOCK_SNAPSHOT || !diskindex.IsValid(BLOCK_VALID_TRANSACTIONS) || diskindex.nTx == 0 ||
+            (bool)diskindex.paidPayee != HasSnapshotPayee(nHeight, header)) {
+            strError = strprintf("bad block index entry %s", hash.GetHex());
+            return false;
+        }
+        // The genesis block is checked above, its checkpoint is only a placeholder
+        if (nHeight > 0 && !Checkpoints::CheckBlock(diskindex.nHeight, hash)) {
+            strError = strprintf("block %s at height %d does not match the checkpoints", hash.GetHex(), diskindex.nHeight);
+            return false;
+        }
+        hashPrev = hash;
+        nHeight++;
+        return !ShutdownRequested();
+    };
+    CHashWriter hasherCheck(SER_DISK, SNAPSHOT_SER_VERSION);
+    if (!ReadContents(filein, header, hasherCheck, fnCheckIndex, [](const COutPoint&, Coin&&) { return true; }, strError)) {
+        if (strError.empty())
+            strError = "interrupted";
+        return false;
+    }
+    if (hashPrev != header.hashBlock) {
+        strError = "the block index entries do not lead to the snapshot block";
+        return false;
+    }
+    if (GetContentHash(hasherCheck, header) != header.hashContent) {
+        strError = "the snapshot content does not match its hash";
+        return false;
+    }
+
+    // Interrupted, the import starts over with the same snapshot: the coins have no best block until the end
+    LogPrintf("%s: loading the snapshot\n", __func__);
+    if (fseek(filein.Get(), ::GetSerializeSize(header, SER_DISK, SNAPSHOT_SER_VERSION), SEEK_SET) != 0) {
+        strError = "unable to rewind the snapshot file";
+        return false;
+    }
+    // The blocks of the snapshot have no data, as if they were pruned
+    if (!pblocktree->WriteFlag("utxosnapshotimport", true) || !pblocktree->WriteFlag("txindex", GetBoolArg("-txindex", DEFAULT_TXINDEX)) ||
+        !pblocktree->WriteFlag("prunedblockfiles", true)) {
+        strError = "failed to write the block index";
+        return false;
+    }
+
+    std::vector<std::pair<uint256, CDiskBlockIndex> > vIndex;
+    size_t nBatchSize = 0;
+    auto fnWriteIndex = [&](const uint256& hash, CDiskBlockIndex& diskindex) {
+        nBatchSize += sizeof(hash) + ::GetSerializeSize(diskindex, SER_DISK, SNAPSHOT_SER_VERSION);
+        vIndex.emplace_back(hash, diskindex);
+        // All of the block index is on disk before the coins
+        const bool fLast = diskindex.nHeight == header.nHeight;
+        if (nBatchSize < UTXO_SNAPSHOT_BATCH_SIZE && !fLast)
+            return true;
+        if (!pblocktree->WriteBlockIndexes(vIndex, fLast)) {
+            strError = "failed to write the block index";
+            return false;
+        }
+        vIndex.clear();
+        nBatchSize = 0;
+        return !ShutdownRequested();
+    };
+
+    std::vector<std::pair<COutPoint, Coin> > vCoins;
+    uint64_t nCoinsWritten = 0;
+    auto fnWriteCoin = [&](const COutPoint& outpoint, Coin&& coin) {
+        nBatchSize += sizeof(outpoint) + ::GetSerializeSize(coin, SER_DISK, SNAPSHOT_SER_VERSION);
+        vCoins.emplace_back(outpoint, std::move(coin));
+        if (nBatchSize < UTXO_SNAPSHOT_BATCH_SIZE)
+            return true;
+        if (!coinsdb.WriteCoins(vCoins, UINT256_ZERO)) {
+            strError = "failed to write the coins";
+            return false;
+        }
+        nCoinsWritten += vCoins.size();
+        LogPrintf("%s: %u/%u coins written\n", __func__, nCoinsWritten, header.nCoins);
+        vCoins.clear();
+        nBatchSize = 0;
+        return !ShutdownRequested();
+    };
+    CHashWriter hasher(SER_DISK, SNAPSHOT_SER_VERSION);
+    if (!ReadContents(filein, header, hasher, fnWriteIndex, fnWriteCoin, strError)) {
+        if (strError.empty())
+            strError = "interrupted";
+        return false;
+    }
+    // The file may have changed since it was checked: the coins only get a best block if what was written matches too
+    if (GetContentHash(hasher, header) != header.hashContent) {
+        strError = "the snapshot content changed while it was loaded";
+        return false;
+    }
+    if (!coinsdb.WriteCoins(vCoins, header.hashBlock)) {
+        strError = "failed to write the coins";
+        return false;
+    }
+    pblocktree->WriteFlag("utxosnapshotimport", false);
+
+    LogPrintf("%s: loaded %u coins, the chain continues from block %s (height %d)\n", __func__, header.nCoins, header.hashBlock.GetHex(), header.nHeight);
+    return true;
+}
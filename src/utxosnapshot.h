@@ -0,0 +1,73 @@
+// Copyright (c) 2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef DECENOMY_UTXOSNAPSHOT_H
+#define DECENOMY_UTXOSNAPSHOT_H
+
+#include "fs.h"
+#include "protocol.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <string>
+
+class CCoinsViewDB;
+
+/** Format version of the files written by dumptxoutset */
+static const uint32_t UTXO_SNAPSHOT_VERSION = 3;
+/** Bytes of coins or block index entries written to the databases at once while a snapshot is loaded */
+static const size_t UTXO_SNAPSHOT_BATCH_SIZE = 16 << 20;
+
+/**
+ * Fixed size header of a UTXO snapshot file. It is followed by the block
+ * index entries from the genesis block to hashBlock, the last nPayeeWindow
+ * of them with their paid payee, then by the coins of
+ * the chainstate at hashBlock grouped by transaction, in database order.
+ * hashContent covers the header fields and everything after the header.
+ */
+struct CUTXOSnapshotHeader {
+    char pchMagic[4];
+    CMessageHeader::MessageStartChars pchMessageStart;
+    uint32_t nVersion;
+    uint256 hashBlock;
+    int32_t nHeight;
+    int32_t nPayeeWindow;
+    uint64_t nCoins;
+    uint256 hashContent;
+
+    CUTXOSnapshotHeader();
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(FLATDATA(pchMagic));
+        READWRITE(FLATDATA(pchMessageStart));
+        READWRITE(nVersion);
+        READWRITE(hashBlock);
+        READWRITE(nHeight);
+        READWRITE(nPayeeWindow);
+        READWRITE(nCoins);
+        READWRITE(hashContent);
+    }
+};
+
+/** Write the chainstate and the block index of the active chain up to its tip to path */
+bool DumpUTXOSnapshot(const fs::path& path, CUTXOSnapshotHeader& header, std::string& strError);
+
+/**
+ * Import the snapshot at path into an empty chainstate, and its block index
+ * entries into pblocktree, once its content hash was checked against
+ * hashExpected or, if null, against the one compiled in for its base block.
+ * The blocks of the snapshot are marked BLOCK_SNAPSHOT: they are part of
+ * the active chain without their data, and the blocks after them are
+ * downloaded and connected as usual. Called before LoadBlockIndex.
+ */
+bool LoadUTXOSnapshot(const fs::path& path, const uint256& hashExpected, CCoinsViewDB& coinsdb, std::string& strError);
+
+/** Whether an import was interrupted, leaving the chainstate incomplete */
+bool IsUTXOSnapshotImportPending(const CCoinsViewDB& coinsdb);
+
+#endif // DECENOMY_UTXOSNAPSHOT_H
@@ -12,10 +12,10 @@
  * network protocol versioning
  */
 
-static const int PROTOCOL_VERSION = 70401;
+static const int PROTOCOL_VERSION = 70402;
 
 //! disconnect from peers older than this proto version
-static const int MIN_PEER_PROTO_VERSION = PROTOCOL_VERSION;
+static const int MIN_PEER_PROTO_VERSION = 70401;
 
 //! initial proto version, to be increased after version/verack negotiation
 static const int INIT_PROTO_VERSION = 209;
@@ -23,6 +23,9 @@ static const int INIT_PROTO_VERSION = 209;
 //! In this version, 'getheaders' was introduced.
 static const int GETHEADERS_VERSION = 70000;
 
+//! 'getheaders' is answered with 'headers' and the chain is downloaded headers first, starting with this version
+static const int HEADERS_FIRST_VERSION = 70402;
+
 //! masternodes older than this proto version use old strMessage format for mnannounce
 static const int MIN_PEER_MNANNOUNCE = 70017;
 
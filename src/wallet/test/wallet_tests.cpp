@@ -471,4 +471,54 @@ BOOST_AUTO_TEST_CASE(cached_balances_tests)
 
 }
 
+BOOST_AUTO_TEST_CASE(stake_cache_tests)
+{
+    CStakeCache cache;
+    const CBlockIndex* pindexGenesis = WITH_LOCK(cs_main, return chainActive.Tip());
+
+    CMutableTransaction tx;
+    tx.vout.resize(2);
+    tx.vout[0].nValue = 10 * COIN;
+    tx.vout[1].nValue = 20 * COIN;
+    std::unique_ptr<CWalletTx> pwtx(new CWalletTx(pwalletMain, tx));
+    pwtx->hashBlock = pindexGenesis->GetBlockHash();
+    std::vector<COutput> vOutputs = {COutput(pwtx.get(), 0, 1, true, true), COutput(pwtx.get(), 1, 1, true, true)};
+
+    // New outputs are looked up in the block index
+    std::vector<CStakeableCoin> vStakeable = cache.Refresh(pindexGenesis, pindexGenesis->GetBlockTime(), vOutputs);
+    BOOST_CHECK_EQUAL(vStakeable.size(), 2U);
+    BOOST_CHECK_EQUAL(cache.size(), 2U);
+    BOOST_CHECK(vStakeable[0].pindexFrom == pindexGenesis);
+    BOOST_CHECK_EQUAL(vStakeable[1].nValue, 20 * COIN);
+
+    // The wallet tx loaded again after being erased: the cached outputs point to the new one
+    std::unique_ptr<CWalletTx> pwtxReloaded(new CWalletTx(*pwtx));
+    pwtx.reset();
+    for (COutput& out : vOutputs) out.tx = pwtxReloaded.get();
+    vStakeable = cache.Refresh(pindexGenesis, pindexGenesis->GetBlockTime(), vOutputs);
+    BOOST_CHECK_EQUAL(cache.size(), 2U);
+    for (const CStakeableCoin& coin : vStakeable)
+        BOOST_CHECK(coin.pwtx == pwtxReloaded.get());
+
+    // A wallet transaction spending one of them drops it
+    CMutableTransaction txSpend;
+    txSpend.vin.emplace_back(COutPoint(pwtxReloaded->GetHash(), 1));
+    cache.SyncTransaction(txSpend);
+    BOOST_CHECK_EQUAL(cache.size(), 1U);
+
+    // The block of the output left the active chain: evicted on the next tip, and not cached again
+    CBlockIndex indexFork;
+    const uint256 hashFork = GetRandHash();
+    indexFork.pprev = const_cast<CBlockIndex*>(pindexGenesis);
+    indexFork.nHeight = 1;
+    indexFork.phashBlock = &hashFork;
+    WITH_LOCK(cs_main, mapBlockIndex.emplace(hashFork, &indexFork));
+    pwtxReloaded->hashBlock = hashFork;
+    vOutputs.resize(1);
+    vStakeable = cache.Refresh(&indexFork, pindexGenesis->GetBlockTime(), vOutputs);
+    BOOST_CHECK(vStakeable.empty());
+    BOOST_CHECK_EQUAL(cache.size(), 0U);
+    WITH_LOCK(cs_main, mapBlockIndex.erase(hashFork));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
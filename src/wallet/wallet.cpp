@@ -23,6 +23,9 @@
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
 
+#include <deque>
+#include <thread>
+
 CWallet* pwalletMain = nullptr;
 /**
  * Settings
@@ -1079,6 +1082,15 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex,
         if (mapWallet.count(txin.prevout.hash))
             mapWallet[txin.prevout.hash].MarkDirty();
     }
+
+    // Spent outputs can't stake anymore
+    stakeCache.SyncTransaction(tx);
+}
+
+void CWallet::UpdatedBlockTip(const CBlockIndex *pindex)
+{
+    stakeCache.UpdatedBlockTip();
+    if (pStakerStatus) pStakerStatus->SetTipNotified(pindex);
 }
 
 void CWallet::EraseFromWallet(const uint256& hash)
@@ -2459,6 +2471,187 @@ bool CWallet::CreateTransaction(CScript scriptPubKey, const CAmount& nValue, CWa
     return CreateTransaction(vecSend, wtxNew, reservekey, nFeeRet, nChangePosInOut, strFailReason, coinControl, coin_type, true, nFeePay);
 }
 
+namespace {
+
+/** A coin of the search snapshot and the time slot at which its kernel meets the target */
+struct CStakeCandidate {
+    size_t nCoin;
+    int64_t nTime;
+};
+
+/**
+ * Kernel search over a snapshot of the stake cache, split across worker threads.
+ * Coins are handed out one at a time through a shared cursor. The first hit,
+ * a tip change, a locked wallet or a shutdown stops the workers before their
+ * next claim, so every claimed coin is checked over all of its time slots and
+ * a later Next() resumes exactly where the previous round stopped.
+ * Tip changes are seen through the cache notification counter, so the
+ * workers never take cs_main.
+ */
+class CStakeSearch
+{
+public:
+    CStakeSearch(const CWallet* pwalletIn, const CBlockIndex* pindexPrevIn, unsigned int nBitsIn, int64_t nTimeStartIn,
+                 uint64_t nTipUpdatesIn, const std::vector<CStakeableCoin>& vCoinsIn, int nThreadsIn) :
+        pwallet(pwalletIn), pindexPrev(pindexPrevIn), nBits(nBitsIn), nTimeStart(nTimeStartIn),
+        nTipUpdates(nTipUpdatesIn), vCoins(vCoinsIn),
+        nThreads(std::max(1, std::min(nThreadsIn, (int) vCoinsIn.size()))),
+        vThreadTries(nThreads, 0), vThreadMicros(nThreads, 0) {}
+
+    //! Next kernel hit, searching further if none is pending. False when cancelled or out of coins.
+    bool Next(CStakeCandidate& candidateRet)
+    {
+        while (vCandidates.empty()) {
+            if (fCancelled || nNextCoin >= vCoins.size()) return false;
+            Run();
+        }
+        candidateRet = vCandidates.front();
+        vCandidates.pop_front();
+        return true;
+    }
+
+    int GetTries() const { return nTries; }
+    int64_t GetLastTime() const { return nLastTime; }
+    std::vector<double> GetThreadTriesPerSec() const
+    {
+        std::vector<double> vRates(nThreads, 0);
+        for (int i = 0; i < nThreads; i++) {
+            if (vThreadMicros[i] > 0) vRates[i] = vThreadTries[i] * 1e6 / vThreadMicros[i];
+        }
+        return vRates;
+    }
+
+private:
+    const CWallet* pwallet;
+    const CBlockIndex* pindexPrev;
+    const unsigned int nBits;
+    const int64_t nTimeStart;
+    const uint64_t nTipUpdates;
+    const std::vector<CStakeableCoin>& vCoins;
+    const int nThreads;
+
+    std::atomic<size_t> nNextCoin{0};
+    std::atomic<bool> fStop{false};
+    std::atomic<bool> fCancelled{false};
+    std::atomic<int> nTries{0};
+    std::atomic<int64_t> nLastTime{0};
+
+    Mutex cs_candidates;
+    std::deque<CStakeCandidate> vCandidates;
+    // Written by each worker into its own slot, read once the workers are joined
+    std::vector<int> vThreadTries;
+    std::vector<int64_t> vThreadMicros;
+
+    void Run()
+    {
+        fStop = false;
+        // The staking thread is worker 0, so a single thread spawns nothing
+        std::vector<std::thread> vWorkers;
+        for (int i = 1; i < nThreads; i++) {
+            vWorkers.emplace_back(&CStakeSearch::Worker, this, i);
+        }
+        Worker(0);
+        for (std::thread& t : vWorkers) t.join();
+    }
+
+    void Worker(int nThread)
+    {
+        const int64_t nStart = GetTimeMicros();
+        while (!fStop) {
+            const size_t nCoin = nNextCoin++;
+            if (nCoin >= vCoins.size()) break;
+
+            // new block came in, the wallet got locked or we are shutting down: cancel the search
+            if (pwallet->stakeCache.GetTipUpdates() != nTipUpdates ||
+                    pwallet->IsLocked() || ShutdownRequested()) {
+                fCancelled = true;
+                fStop = true;
+                break;
+            }
+
+            const CStakeableCoin& coin = vCoins[nCoin];
+            int64_t nTimeTx = nTimeStart;
+            bool fFound = false;
+            if (coin.fContextOk) {
+                CStakeKernel stakeKernel(pindexPrev, coin.pindexFrom, coin.vchUniqueness, coin.nValue, nBits, nTimeTx);
+                fFound = SearchStakeKernel(pindexPrev, stakeKernel, nTimeTx);
+            }
+
+            nTries++;
+            vThreadTries[nThread]++;
+            int64_t nLast = nLastTime;
+            while (nTimeTx > nLast && !nLastTime.compare_exchange_weak(nLast, nTimeTx)) {}
+
+            if (fFound) {
+                LOCK(cs_candidates);
+                vCandidates.push_back({nCoin, nTimeTx});
+                fStop = true;
+            }
+        }
+        vThreadMicros[nThread] += GetTimeMicros() - nStart;
+    }
+};
+
+} // anonymous namespace
+
+std::vector<CStakeableCoin> CStakeCache::Refresh(const CBlockIndex* pindexPrev, int64_t nTimeTx, const std::vector<COutput>& vCoins)
+{
+    const Consensus::Params& consensus = Params().GetConsensus();
+    const int nHeightTx = pindexPrev->nHeight + 1;
+    std::vector<CStakeableCoin> vRet;
+    vRet.reserve(vCoins.size());
+
+    LOCK2(cs_main, cs);
+    // After a reorg the block of a cached output may have left the chain
+    const bool fNewTip = (pindexTip != pindexPrev);
+    pindexTip = pindexPrev;
+
+    for (const COutput& out : vCoins) {
+        const COutPoint outpoint(out.tx->GetHash(), out.i);
+        auto it = mapCoins.find(outpoint);
+        if (it != mapCoins.end() && fNewTip &&
+                (!chainActive.Contains(it->second.pindexFrom) || out.tx->hashBlock != it->second.pindexFrom->GetBlockHash())) {
+            mapCoins.erase(it);
+            it = mapCoins.end();
+        }
+        if (it == mapCoins.end()) {
+            // The wallet tx knows its block, no need to look the transaction up
+            BlockMap::const_iterator mi = mapBlockIndex.find(out.tx->hashBlock);
+            if (mi == mapBlockIndex.end() || !chainActive.Contains(mi->second)) continue;
+            CStakeableCoin coin;
+            coin.pwtx = out.tx;
+            coin.nPosition = out.i;
+            coin.nValue = out.Value();
+            coin.pindexFrom = mi->second;
+            coin.nHeightBlockFrom = mi->second->nHeight;
+            coin.nTimeBlockFrom = mi->second->nTime;
+            CPivStake::GetUniqueness(outpoint, coin.vchUniqueness);
+            it = mapCoins.emplace(outpoint, coin).first;
+        }
+        CStakeableCoin& coin = it->second;
+        // The wallet tx may have been erased and loaded again since the output was cached
+        coin.pwtx = out.tx;
+        coin.fContextOk = consensus.HasStakeMinAgeOrDepth(nHeightTx, nTimeTx, coin.nHeightBlockFrom, coin.nTimeBlockFrom);
+        vRet.push_back(coin);
+    }
+    return vRet;
+}
+
+void CStakeCache::SyncTransaction(const CTransaction& tx)
+{
+    LOCK(cs);
+    for (const CTxIn& txin : tx.vin) {
+        mapCoins.erase(txin.prevout);
+    }
+}
+
+static int GetStakeThreads()
+{
+    int nThreads = GetArg("-stakethreads", DEFAULT_STAKETHREADS);
+    if (nThreads <= 0) nThreads = GetNumCores();
+    return std::max(1, nThreads);
+}
+
 bool CWallet::CreateCoinStake(
         const CKeyStore& keystore,
         const CBlockIndex* pindexPrev,
@@ -2485,9 +2678,7 @@ bool CWallet::CreateCoinStake(
 
     // Kernel Search
     CAmount nCredit;
-    CScript scriptPubKeyKernel;
     bool fKernelFound = false;
-    int nAttempts = 0;
 
     CAmount nStakedValue = 0;
     for (const COutput &out : *availableCoins) {
@@ -2495,30 +2686,26 @@ bool CWallet::CreateCoinStake(
     }
     pStakerStatus->SetLastValue(nStakedValue);
 
-    for (const COutput &out : *availableCoins) {
-        CPivStake stakeInput;
-        stakeInput.SetPrevout((CTransaction) *out.tx, out.i);
-
-        //new block came in, move on
-        if (WITH_LOCK(cs_main, return chainActive.Height()) != pindexPrev->nHeight) return false;
-
-        // Make sure the wallet is unlocked and shutdown hasn't been requested
-        if (IsLocked() || ShutdownRequested()) return false;
+    // Stake cache snapshot, taken after checking that pindexPrev is still the tip
+    const uint64_t nTipUpdates = stakeCache.GetTipUpdates();
+    if (WITH_LOCK(cs_main, return chainActive.Tip()) != pindexPrev) return false;
+    const int64_t nTimeStart = GetStakeTime(pindexPrev);
+    const std::vector<CStakeableCoin> vStakeable = stakeCache.Refresh(pindexPrev, nTimeStart, *availableCoins);
 
-        nCredit = 0;
+    pStakerStatus->SetSearchStarted(pindexPrev);
 
-        nAttempts++;
-        fKernelFound = Stake(pindexPrev, &stakeInput, nBits, nTxNewTime);
-
-        // update staker status (time, attempts)
-        pStakerStatus->SetLastTime(nTxNewTime);
-        pStakerStatus->SetLastTries(nAttempts);
-
-        if (!fKernelFound) continue;
+    // The workers only look for kernels, the coinstake is assembled and signed here
+    CStakeSearch search(this, pindexPrev, nBits, nTimeStart, nTipUpdates, vStakeable, GetStakeThreads());
+    CStakeCandidate candidate;
+    while (search.Next(candidate)) {
+        const CStakeableCoin& coin = vStakeable[candidate.nCoin];
+        CPivStake stakeInput;
+        stakeInput.SetPrevout((CTransaction) *coin.pwtx, coin.nPosition);
+        nTxNewTime = candidate.nTime;
 
         // Found a kernel
         LogPrintf("CreateCoinStake : kernel found\n");
-        nCredit += stakeInput.GetValue();
+        nCredit = stakeInput.GetValue();
 
         // Add block reward to the credit
         nCredit += CMasternode::GetBlockValue(pindexPrev->nHeight + 1);
@@ -2565,9 +2752,15 @@ bool CWallet::CreateCoinStake(
         }
         txNew.vin.emplace_back(in);
 
+        fKernelFound = true;
         break;
     }
-    LogPrint(BCLog::STAKING, "%s: attempted staking %d times\n", __func__, nAttempts);
+
+    // update staker status (time, attempts)
+    pStakerStatus->SetLastTime(fKernelFound ? nTxNewTime : search.GetLastTime());
+    pStakerStatus->SetLastTries(search.GetTries());
+    pStakerStatus->SetThreadTriesPerSec(search.GetThreadTriesPerSec());
+    LogPrint(BCLog::STAKING, "%s: attempted staking %d times\n", __func__, search.GetTries());
 
     if (!fKernelFound)
         return false;
@@ -3487,6 +3680,7 @@ std::string CWallet::GetWalletHelpString(bool showDebug)
     strUsage += HelpMessageOpt("-genproclimit=<n>", strprintf(_("Set the number of threads for coin generation if enabled (-1 = all cores, default: %d)"), DEFAULT_GENERATE_PROCLIMIT));
     strUsage += HelpMessageOpt("-minstakesplit=<amt>", strprintf(_("Minimum positive amount (in XMD) allowed by GUI and RPC for the stake split threshold (default: %s)"), FormatMoney(DEFAULT_MIN_STAKE_SPLIT_THRESHOLD)));
     strUsage += HelpMessageOpt("-staking=<n>", strprintf(_("Enable staking functionality (0-1, default: %u)"), DEFAULT_STAKING));
+    strUsage += HelpMessageOpt("-stakethreads=<n>", strprintf(_("Set the number of threads searching for stake kernels (<= 0 = all cores, default: %d)"), DEFAULT_STAKETHREADS));
     if (showDebug) {
         strUsage += HelpMessageGroup(_("Wallet debugging/testing options:"));
         strUsage += HelpMessageOpt("-dblogsize=<n>", strprintf(_("Flush database activity from memory pool to disk log every <n> megabytes (default: %u)"), DEFAULT_WALLET_DBLOGSIZE));
@@ -3642,6 +3836,19 @@ CWallet* CWallet::CreateWalletFromFile(const std::string walletFile)
             pindexRescan = chainActive.Genesis();
     }
     if (chainActive.Tip() && chainActive.Tip() != pindexRescan) {
+        // We can't rescan beyond pruned blocks, this might happen if an old wallet is used
+        // with a pruned node, or if the wallet was disabled for longer than the kept blocks
+        if (fHavePruned) {
+            CBlockIndex* block = chainActive.Tip();
+            while (block && block->pprev && (block->pprev->nStatus & BLOCK_HAVE_DATA) && pindexRescan != block)
+                block = block->pprev;
+
+            if (pindexRescan != block) {
+                UIError(_("Prune: last wallet synchronisation goes beyond pruned data. You need to -reindex (download the whole blockchain again in case of pruned node)"));
+                return nullptr;
+            }
+        }
+
         uiInterface.InitMessage(_("Rescanning..."));
         LogPrintf("Rescanning last %i blocks (from block %i)...\n", chainActive.Height() - pindexRescan->nHeight, pindexRescan->nHeight);
         const int64_t nWalletRescanTime = GetTimeMillis();
@@ -72,6 +72,8 @@ static const bool DEFAULT_SPEND_ZEROCONF_CHANGE = true;
 static const bool DEFAULT_SEND_FREE_TRANSACTIONS = false;
 //! Default for -staking
 static const bool DEFAULT_STAKING = true;
+//! -stakethreads default
+static const int DEFAULT_STAKETHREADS = 1;
 //! Defaults for -gen and -genproclimit
 static const bool DEFAULT_GENERATE = false;
 static const unsigned int DEFAULT_GENERATE_PROCLIMIT = 1;
@@ -177,6 +179,15 @@ private:
     int nTries{0};
     int nCoins{0};
     CAmount nValue{0};
+    // Stats shared with the validation and RPC threads
+    mutable RecursiveMutex cs_stats;
+    // Tries per second of each kernel search thread during the last attempt
+    std::vector<double> vThreadTriesPerSec;
+    // Latest tip notification, and the delay from tip notifications to the first kernel search on them
+    const CBlockIndex* pindexNotified{nullptr};
+    int64_t nNotifiedTime{0};
+    int64_t nTipLatencySum{0};
+    int nTipLatencyCount{0};
 
 public:
     // Get
@@ -187,6 +198,9 @@ public:
     int GetLastTries() const { return nTries; }
     int64_t GetLastTime() const { return nTime; }
     CAmount GetLastValue() const { return nValue; }
+    std::vector<double> GetThreadTriesPerSec() const { LOCK(cs_stats); return vThreadTriesPerSec; }
+    // Mean tip to first kernel search latency, in milliseconds
+    double GetTipLatency() const { LOCK(cs_stats); return nTipLatencyCount ? nTipLatencySum / 1000.0 / nTipLatencyCount : 0; }
 
     // Set
     void SetLastCoins(const int coins) { nCoins = coins; }
@@ -194,6 +208,22 @@ public:
     void SetLastTip(const CBlockIndex* lastTip) { tipBlock = lastTip; }
     void SetLastTime(const uint64_t lastTime) { nTime = lastTime; }
     void SetLastValue(CAmount lastValue) { nValue = lastValue; }
+    void SetThreadTriesPerSec(const std::vector<double>& vRates) { LOCK(cs_stats); vThreadTriesPerSec = vRates; }
+    void SetTipNotified(const CBlockIndex* pindex)
+    {
+        LOCK(cs_stats);
+        pindexNotified = pindex;
+        nNotifiedTime = GetTimeMicros();
+    }
+    // Kernel search started on top of pindex: account the latency if it is the first one on the notified tip
+    void SetSearchStarted(const CBlockIndex* pindex)
+    {
+        LOCK(cs_stats);
+        if (pindex != pindexNotified || nNotifiedTime == 0) return;
+        nTipLatencySum += GetTimeMicros() - nNotifiedTime;
+        nTipLatencyCount++;
+        nNotifiedTime = 0;
+    }
 
     void SetNull()
     {
@@ -202,11 +232,52 @@ public:
         SetLastTip(nullptr);
         SetLastTime(0);
         SetLastValue(0);
+        SetThreadTriesPerSec(std::vector<double>());
     }
     // Check whether staking status is active (last attempt earlier than 30 seconds ago)
     bool IsActive() const { return (nTime + 30) >= GetTime(); }
 };
 
+/** A stakeable output with the data of its stake kernel resolved in advance */
+struct CStakeableCoin
+{
+    const CWalletTx* pwtx{nullptr};             // as of the last refresh, only valid for its snapshot
+    unsigned int nPosition{0};
+    CAmount nValue{0};
+    const CBlockIndex* pindexFrom{nullptr};     // block containing the output
+    int nHeightBlockFrom{0};
+    uint32_t nTimeBlockFrom{0};
+    bool fContextOk{false};                     // min depth/age verdict at the last refresh
+    unsigned char vchUniqueness[CStakeInput::UNIQUENESS_SIZE];
+};
+
+/**
+ * Staking candidates of a wallet. Refresh() diffs the stakeable outputs
+ * against the cache: the block of a new output is looked up in the block
+ * index (no disk read), known outputs are kept and only re-validated when the
+ * tip moves, and outputs spent by wallet transactions are dropped as soon as
+ * these are synced. The kernel search then runs on the returned snapshot
+ * without touching the disk or cs_main.
+ */
+class CStakeCache
+{
+private:
+    mutable RecursiveMutex cs;
+    const CBlockIndex* pindexTip{nullptr};
+    std::map<COutPoint, CStakeableCoin> mapCoins;
+    // bumped on every tip notification, lets a running search notice a new block without cs_main
+    std::atomic<uint64_t> nTipUpdates{0};
+
+public:
+    //! Update the cache for a search on top of pindexPrev starting at nTimeTx and return the snapshot to search
+    std::vector<CStakeableCoin> Refresh(const CBlockIndex* pindexPrev, int64_t nTimeTx, const std::vector<COutput>& vCoins);
+    //! Drop the outputs spent by tx
+    void SyncTransaction(const CTransaction& tx);
+    void UpdatedBlockTip() { nTipUpdates++; }
+    uint64_t GetTipUpdates() const { return nTipUpdates; }
+    size_t size() const { LOCK(cs); return mapCoins.size(); }
+};
+
 struct CRecipient
 {
     CScript scriptPubKey;
@@ -308,6 +379,8 @@ public:
     static CAmount minStakeSplitThreshold;
     // Staker status (last hashed block and time)
     CStakerStatus* pStakerStatus = nullptr;
+    // Staking candidates, refreshed on each stake attempt
+    CStakeCache stakeCache;
 
     // User-defined fee XMD/kb
     bool fUseCustomFee;
@@ -442,6 +515,7 @@ public:
     bool AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose = true);
     bool LoadToWallet(const CWalletTx& wtxIn);
     void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock);
+    void UpdatedBlockTip(const CBlockIndex *pindex);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlockIndex* pIndex, int posInBlock, bool fUpdate);
     void EraseFromWallet(const uint256& hash);
 
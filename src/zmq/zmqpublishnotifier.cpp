@@ -182,15 +182,15 @@ bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     {
         LOCK(cs_main);
-        CBlock block;
+        std::shared_ptr<const CBlock> pblock;
 // XX42        if(!ReadBlockFromDisk(block, pindex, consensusParams))
-        if(!ReadBlockFromDisk(block, pindex))
+        if(!ReadBlockFromDisk(pblock, pindex))
         {
             zmqError("Can't read block from disk");
             return false;
         }
 
-        ss << block;
+        ss << *pblock;
     }
 
     return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());